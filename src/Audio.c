@@ -35,13 +35,6 @@ static void Volume_Mix16(int16_t* samples, int count, int volume) {
 	}
 }
 
-static void Volume_Mix8(uint8_t* samples, int count, int volume) {
-	int i;
-	for (i = 0; i < count; i++, samples++) {
-		samples[0] = (127 + (samples[0] - 127) * volume / 100);
-	}
-}
-
 /*########################################################################################################################*
 *------------------------------------------------------Soundboard---------------------------------------------------------*
 *#########################################################################################################################*/
@@ -90,6 +83,9 @@ static ReturnCode Sound_ReadWaveData(struct Stream* stream, struct Sound* snd) {
 			/* tmp[8] (6) alignment data and stuff */
 			snd->Format.BitsPerSample = Stream_GetU16_LE(&tmp[14]);
 			size -= WAV_FMT_SIZE;
+
+			if (snd->Format.Channels      != 1 && snd->Format.Channels      != 2)  return WAV_ERR_DATA_TYPE;
+			if (snd->Format.BitsPerSample != 8 && snd->Format.BitsPerSample != 16) return WAV_ERR_DATA_TYPE;
 		} else if (fourCC == WAV_FourCC('d','a','t','a')) {
 			snd->Data = Mem_Alloc(size, 1, "WAV sound data");
 			snd->DataSize = size;
@@ -101,6 +97,23 @@ static ReturnCode Sound_ReadWaveData(struct Stream* stream, struct Sound* snd) {
 	}
 }
 
+/* The mixer only deals with 16 bit samples, so 8 bit sounds are expanded once when loaded */
+static void Sound_Expand8(struct Sound* snd) {
+	uint8_t* src = snd->Data;
+	int16_t* dst;
+	uint32_t i;
+
+	dst = Mem_Alloc(snd->DataSize, 2, "WAV sound data");
+	for (i = 0; i < snd->DataSize; i++) {
+		dst[i] = (src[i] - 128) * 256;
+	}
+
+	Mem_Free(src);
+	snd->Data     = (uint8_t*)dst;
+	snd->DataSize = snd->DataSize * 2;
+	snd->Format.BitsPerSample = 16;
+}
+
 static ReturnCode Sound_ReadWave(const String* filename, struct Sound* snd) {
 	String path; char pathBuffer[FILENAME_SIZE];
 	struct Stream stream;
@@ -114,6 +127,7 @@ static ReturnCode Sound_ReadWave(const String* filename, struct Sound* snd) {
 
 	res = Sound_ReadWaveData(&stream, snd);
 	if (res) { stream.Close(&stream); return res; }
+	if (snd->Format.BitsPerSample == 8) Sound_Expand8(snd);
 
 	return stream.Close(&stream);
 }
@@ -193,107 +207,185 @@ static struct Sound* Soundboard_PickRandom(struct Soundboard* board, uint8_t typ
 
 
 /*########################################################################################################################*
-*--------------------------------------------------------Sounds-----------------------------------------------------------*
+*--------------------------------------------------------Mixer------------------------------------------------------------*
 *#########################################################################################################################*/
-struct SoundOutput { AudioHandle Handle; void* Buffer; uint32_t BufferSize; };
-#define AUDIO_MAX_HANDLES 6
-#define AUDIO_DEF_ELEMS 0
-#define HANDLE_INV -1
-#define SOUND_INV { HANDLE_INV, NULL, 0 }
+/* Sounds are mixed together in software and played through a single output, rather than needing */
+/*  a separate output per concurrently playing sound (which may need recreating for a different format) */
+#define MIXER_SAMPLE_RATE 44100
+#define MIXER_CHANNELS 2
+/* Number of frames mixed into each output buffer (~23 milliseconds) */
+#define MIXER_CHUNK_FRAMES 1024
+#define MIXER_CHUNK_SAMPLES (MIXER_CHUNK_FRAMES * MIXER_CHANNELS)
+#define MIXER_MAX_VOICES 32
+/* Voice steps are 16.16 fixed point, so sounds can be played at a different sample rate (pitch) */
+#define MIXER_FRAC_BITS 16
+#define MIXER_FRAC_MASK ((1 << MIXER_FRAC_BITS) - 1)
+/* How long mixer thread sleeps for when idle. (Waitable_Signal can be missed on some platforms) */
+#define MIXER_IDLE_MS 100
+
+struct Voice {
+	struct Sound* Snd;
+	uint32_t Index, Frac; /* Current frame in sound, and fractional part of it */
+	uint32_t Step;        /* Source frames advanced per output frame, in 16.16 fixed point */
+	int Volume;           /* 0 to 256 */
+};
 
-static struct Soundboard digBoard, stepBoard;
-static struct SoundOutput monoOutputs[AUDIO_MAX_HANDLES]   = { SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV };
-static struct SoundOutput stereoOutputs[AUDIO_MAX_HANDLES] = { SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV };
+static struct Voice mixer_voices[MIXER_MAX_VOICES];
+static int mixer_voicesCount;
+static int32_t mixer_accum[MIXER_CHUNK_SAMPLES];
+static int16_t mixer_data[AUDIO_MAX_BUFFERS][MIXER_CHUNK_SAMPLES];
+
+static AudioHandle mixer_out;
+static void* mixer_thread;
+static void* mixer_lock;
+static void* mixer_waitable;
+static volatile bool mixer_pendingStop, mixer_joining;
+
+/* Adds up to count frames of the given voice to the mix. Returns false once the voice has finished. */
+static bool Mixer_MixVoice(struct Voice* v, int32_t* dst, int count) {
+	int16_t* src   = (int16_t*)v->Snd->Data;
+	int channels   = v->Snd->Format.Channels;
+	uint32_t index = v->Index, frac = v->Frac;
+	uint32_t last  = v->Snd->DataSize / (2 * channels);
+	int i, l, r, t, volume = v->Volume;
+	/* last frame is only interpolated towards */
+	if (last) last--;
+
+	for (i = 0; i < count && index < last; i++, dst += MIXER_CHANNELS) {
+		/* linearly interpolate between this frame and the next (top 15 bits of fraction avoids overflow) */
+		t = frac >> 1;
+		if (channels == 1) {
+			l = src[index]; l += ((src[index + 1] - l) * t) >> 15;
+			r = l;
+		} else {
+			l = src[index * 2 + 0]; l += ((src[index * 2 + 2] - l) * t) >> 15;
+			r = src[index * 2 + 1]; r += ((src[index * 2 + 3] - r) * t) >> 15;
+		}
 
-CC_NOINLINE static void Sounds_Fail(ReturnCode res) {
-	Logger_OldWarn(res, "playing sounds");
-	Chat_AddRaw("&cDisabling sounds");
-	Audio_SetSounds(0);
+		dst[0] += (l * volume) >> 8;
+		dst[1] += (r * volume) >> 8;
+
+		frac  += v->Step;
+		index += frac >> MIXER_FRAC_BITS;
+		frac  &= MIXER_FRAC_MASK;
+	}
+
+	v->Index = index; v->Frac = frac;
+	return index < last;
 }
 
-static void Sounds_PlayRaw(struct SoundOutput* output, struct Sound* snd, struct AudioFormat* fmt, int volume) {
-	uint32_t expandBy;
-	void* data = snd->Data;
+/* Mixes all active voices into the given output buffer. Returns number of voices that were mixed. */
+static int Mixer_Mix(int16_t* data) {
+	int i, mixed = mixer_voicesCount, sample;
+	Mem_Set(mixer_accum, 0, sizeof(mixer_accum));
+
+	for (i = 0; i < mixer_voicesCount;) {
+		if (Mixer_MixVoice(&mixer_voices[i], mixer_accum, MIXER_CHUNK_FRAMES)) { i++; continue; }
+		/* voice has finished, so move last active voice into its slot */
+		mixer_voices[i] = mixer_voices[--mixer_voicesCount];
+	}
+
+	for (i = 0; i < MIXER_CHUNK_SAMPLES; i++) {
+		sample  = mixer_accum[i];
+		data[i] = sample < -32768 ? -32768 : (sample > 32767 ? 32767 : sample);
+	}
+	return mixed;
+}
+
+static void Mixer_Play(struct Sound* snd, int sampleRate, int volume) {
+	struct Voice* v;
+
+	Mutex_Lock(mixer_lock);
+	/* Just drop the sound when too many are already playing */
+	if (mixer_voicesCount < MIXER_MAX_VOICES) {
+		v = &mixer_voices[mixer_voicesCount++];
+		v->Snd    = snd;
+		v->Index  = 0;
+		v->Frac   = 0;
+		v->Step   = (uint32_t)(((uint64_t)sampleRate << MIXER_FRAC_BITS) / MIXER_SAMPLE_RATE);
+		v->Volume = volume * 256 / 100;
+	}
+	Mutex_Unlock(mixer_lock);
+	Waitable_Signal(mixer_waitable);
+}
+
+static void Mixer_RunLoop(void) {
+	struct AudioFormat fmt;
+	bool completed, finished;
+	int i, next, mixed;
 	ReturnCode res;
 
-	if ((res = Audio_SetFormat(output->Handle, fmt))) { Sounds_Fail(res); return; }
-	
-	/* copy to temp buffer to apply volume */
-	if (volume < 100) {		
-		if (output->BufferSize < snd->DataSize) {
-			expandBy       = snd->DataSize - output->BufferSize;
-			output->Buffer = Utils_Resize(output->Buffer, &output->BufferSize, 
-											1, AUDIO_DEF_ELEMS, expandBy);
+	fmt.Channels      = MIXER_CHANNELS;
+	fmt.BitsPerSample = 16;
+	fmt.SampleRate    = MIXER_SAMPLE_RATE;
+
+	Audio_Init(&mixer_out, AUDIO_MAX_BUFFERS);
+	res = Audio_SetFormat(mixer_out, &fmt);
+
+	while (!res && !mixer_pendingStop) {
+		next = -1;
+
+		for (i = 0; i < AUDIO_MAX_BUFFERS; i++) {
+			res = Audio_IsCompleted(mixer_out, i, &completed);
+			if (res)       break;
+			if (completed) { next = i; break; }
 		}
-		data = output->Buffer;
 
-		Mem_Copy(data, snd->Data, snd->DataSize);
-		if (fmt->BitsPerSample == 8) {
-			Volume_Mix8(data,  snd->DataSize,     volume);
-		} else {
-			Volume_Mix16(data, snd->DataSize / 2, volume);
+		if (res) break;
+		if (next == -1) { Thread_Sleep(10); continue; }
+
+		Mutex_Lock(mixer_lock);
+		{
+			mixed = Mixer_Mix(mixer_data[next]);
 		}
+		Mutex_Unlock(mixer_lock);
+
+		/* Nothing left to play, so wait until another sound is played */
+		if (!mixed) { Waitable_WaitFor(mixer_waitable, MIXER_IDLE_MS); continue; }
+
+		/* Output stops once it runs out of buffered data, so needs to be restarted */
+		if ((res = Audio_IsFinished(mixer_out, &finished))) break;
+		if ((res = Audio_BufferData(mixer_out, next, mixer_data[next], sizeof(mixer_data[next])))) break;
+		if (finished && (res = Audio_Play(mixer_out))) break;
 	}
 
-	if ((res = Audio_BufferData(output->Handle, 0, data, snd->DataSize))) { Sounds_Fail(res); return; }
-	if ((res = Audio_Play(output->Handle)))                               { Sounds_Fail(res); return; }
+	if (res) {
+		Logger_OldWarn(res, "playing sounds");
+		Chat_AddRaw("&cDisabling sounds");
+		Audio_SoundsVolume = 0;
+	}
+	Audio_StopAndFree(mixer_out);
+
+	if (mixer_joining) return;
+	Thread_Detach(mixer_thread);
+	mixer_thread = NULL;
 }
 
+
+/*########################################################################################################################*
+*--------------------------------------------------------Sounds-----------------------------------------------------------*
+*#########################################################################################################################*/
+static struct Soundboard digBoard, stepBoard;
+
 static void Sounds_Play(uint8_t type, struct Soundboard* board) {
 	struct Sound* snd;
-	struct AudioFormat  fmt;
-	struct SoundOutput* outputs;
-	struct SoundOutput* output;
-	struct AudioFormat* l;
-
-	bool finished;
-	int i, volume;
-	ReturnCode res;
+	int sampleRate, volume;
 
 	if (type == SOUND_NONE || !Audio_SoundsVolume) return;
 	snd = Soundboard_PickRandom(board, type);
 	if (!snd) return;
 
-	fmt     = snd->Format;
-	volume  = Audio_SoundsVolume;
-	outputs = fmt.Channels == 1 ? monoOutputs : stereoOutputs;
+	sampleRate = snd->Format.SampleRate;
+	volume     = Audio_SoundsVolume;
 
 	if (board == &digBoard) {
-		if (type == SOUND_METAL) fmt.SampleRate = (fmt.SampleRate * 6) / 5;
-		else fmt.SampleRate = (fmt.SampleRate * 4) / 5;
+		if (type == SOUND_METAL) sampleRate = (sampleRate * 6) / 5;
+		else sampleRate = (sampleRate * 4) / 5;
 	} else {
 		volume /= 2;
-		if (type == SOUND_METAL) fmt.SampleRate = (fmt.SampleRate * 7) / 5;
-	}
-
-	/* Try to play on fresh device, or device with same data format */
-	for (i = 0; i < AUDIO_MAX_HANDLES; i++) {
-		output = &outputs[i];
-		if (output->Handle == HANDLE_INV) {
-			Audio_Init(&output->Handle, 1);
-		} else {
-			res = Audio_IsFinished(output->Handle, &finished);
-
-			if (res) { Sounds_Fail(res); return; }
-			if (!finished) continue;
-		}
-
-		l = Audio_GetFormat(output->Handle);
-		if (!l->Channels || AudioFormat_Eq(l, &fmt)) {
-			Sounds_PlayRaw(output, snd, &fmt, volume); return;
-		}
-	}
-
-	/* Try again with all devices, even if need to recreate one (expensive) */
-	for (i = 0; i < AUDIO_MAX_HANDLES; i++) {
-		output = &outputs[i];
-		res = Audio_IsFinished(output->Handle, &finished);
-
-		if (res) { Sounds_Fail(res); return; }
-		if (!finished) continue;
-
-		Sounds_PlayRaw(output, snd, &fmt, volume); return;
+		if (type == SOUND_METAL) sampleRate = (sampleRate * 7) / 5;
 	}
+	Mixer_Play(snd, sampleRate, volume);
 }
 
 static void Audio_PlayBlockSound(void* obj, Vector3I coords, BlockID old, BlockID now) {
@@ -304,32 +396,29 @@ static void Audio_PlayBlockSound(void* obj, Vector3I coords, BlockID old, BlockI
 	}
 }
 
-static void Sounds_FreeOutputs(struct SoundOutput* outputs) {
-	int i;
-	for (i = 0; i < AUDIO_MAX_HANDLES; i++) {
-		if (outputs[i].Handle == HANDLE_INV) continue;
-
-		Audio_StopAndFree(outputs[i].Handle);
-		outputs[i].Handle = HANDLE_INV;
-
-		Mem_Free(outputs[i].Buffer);
-		outputs[i].Buffer     = NULL;
-		outputs[i].BufferSize = 0;
-	}
-}
-
 static void Sounds_Init(void) {
 	const static String dig  = String_FromConst("dig_");
 	const static String step = String_FromConst("step_");
 
-	if (digBoard.Count || stepBoard.Count) return;
-	Soundboard_Init(&digBoard,  &dig,  &files);
-	Soundboard_Init(&stepBoard, &step, &files);
+	if (!digBoard.Count && !stepBoard.Count) {
+		Soundboard_Init(&digBoard,  &dig,  &files);
+		Soundboard_Init(&stepBoard, &step, &files);
+	}
+
+	if (mixer_thread || (!digBoard.Count && !stepBoard.Count)) return;
+	mixer_joining     = false;
+	mixer_pendingStop = false;
+	mixer_thread = Thread_Start(Mixer_RunLoop, false);
 }
 
 static void Sounds_Free(void) {
-	Sounds_FreeOutputs(monoOutputs);
-	Sounds_FreeOutputs(stereoOutputs);
+	mixer_joining     = true;
+	mixer_pendingStop = true;
+	Waitable_Signal(mixer_waitable);
+
+	if (mixer_thread) Thread_Join(mixer_thread);
+	mixer_thread      = NULL;
+	mixer_voicesCount = 0;
 }
 
 void Audio_SetSounds(int volume) {
@@ -542,6 +631,8 @@ static void AudioManager_Init(void) {
 		Directory_Enum(&path, NULL, AudioManager_FilesCallback);
 	}
 	music_waitable = Waitable_Create();
+	mixer_waitable = Waitable_Create();
+	mixer_lock     = Mutex_Create();
 
 	volume = AudioManager_GetVolume(OPT_MUSIC_VOLUME, OPT_USE_MUSIC);
 	Audio_SetMusic(volume);
@@ -554,6 +645,8 @@ static void AudioManager_Free(void) {
 	Music_Free();
 	Sounds_Free();
 	Waitable_Free(music_waitable);
+	Waitable_Free(mixer_waitable);
+	Mutex_Free(mixer_lock);
 	Event_UnregisterBlock(&UserEvents.BlockChanged, NULL, Audio_PlayBlockSound);
 }
 
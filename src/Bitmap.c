@@ -7,6 +7,10 @@
 #include "Stream.h"
 #include "Errors.h"
 #include "Utils.h"
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PNG_SSE2
+#endif
 
 BitmapCol BitmapCol_Scale(BitmapCol value, float t) {
 	value.R = (uint8_t)(value.R * t);
@@ -69,8 +73,85 @@ bool Png_Detect(const uint8_t* data, uint32_t len) {
 	return true;
 }
 
+#ifdef PNG_SSE2
+/* Reads/writes one 3 or 4 byte pixel. Done byte by byte to avoid reading/writing past the end of the scanline. */
+static __m128i Png_Load3(const uint8_t* p) { return _mm_cvtsi32_si128(p[0] | (p[1] << 8) | (p[2] << 16)); }
+static __m128i Png_Load4(const uint8_t* p) { return _mm_cvtsi32_si128(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)); }
+static void Png_Store3(uint8_t* p, __m128i v) {
+	uint32_t x = (uint32_t)_mm_cvtsi128_si32(v);
+	p[0] = (uint8_t)x; p[1] = (uint8_t)(x >> 8); p[2] = (uint8_t)(x >> 16);
+}
+static void Png_Store4(uint8_t* p, __m128i v) {
+	uint32_t x = (uint32_t)_mm_cvtsi128_si32(v);
+	p[0] = (uint8_t)x; p[1] = (uint8_t)(x >> 8); p[2] = (uint8_t)(x >> 16); p[3] = (uint8_t)(x >> 24);
+}
+#define Png_LoadPixel(p)     (bpp == 4 ? Png_Load4(p) : Png_Load3(p))
+#define Png_StorePixel(p, v) if (bpp == 4) { Png_Store4(p, v); } else { Png_Store3(p, v); }
+
+/* Sub, Average and Paeth depend on the previous pixel, so can't be vectorised across pixels. */
+/* Instead all the channels of each 3 or 4 byte pixel are reconstructed at once. (based on libpng) */
+static void Png_ReconstructSSE2(uint8_t type, int bpp, uint8_t* line, uint8_t* prior, uint32_t lineLen) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i a = zero, b, c = zero, d, pa, pb, pc, smallest, nearest;
+	uint32_t i;
+
+	switch (type) {
+	case PNG_FILTER_SUB:
+		for (i = 0; i < lineLen; i += bpp) {
+			a = _mm_add_epi8(a, Png_LoadPixel(line + i));
+			Png_StorePixel(line + i, a);
+		}
+		return;
+
+	case PNG_FILTER_AVERAGE:
+		for (i = 0; i < lineLen; i += bpp) {
+			b = Png_LoadPixel(prior + i);
+			/* _mm_avg_epu8 rounds up, so subtract 1 when a + b is odd to round down instead */
+			d = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+			a = _mm_add_epi8(Png_LoadPixel(line + i), d);
+			Png_StorePixel(line + i, a);
+		}
+		return;
+
+	case PNG_FILTER_PAETH:
+		/* a and c are kept widened to 16 bits, to avoid overflow in calculating p - a etc */
+		for (i = 0; i < lineLen; i += bpp) {
+			b = _mm_unpacklo_epi8(Png_LoadPixel(prior + i), zero);
+
+			/* p - a = b - c, p - b = a - c, p - c = (b - c) + (a - c) */
+			pa = _mm_sub_epi16(b, c);
+			pb = _mm_sub_epi16(a, c);
+			pc = _mm_add_epi16(pa, pb);
+
+			pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+			pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+			pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+			smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+			/* a if pa is smallest, otherwise b if pb is smallest, otherwise c */
+			nearest = _mm_cmpeq_epi16(pb, smallest);
+			nearest = _mm_or_si128(_mm_and_si128(nearest, b), _mm_andnot_si128(nearest, c));
+			d       = _mm_cmpeq_epi16(pa, smallest);
+			nearest = _mm_or_si128(_mm_and_si128(d, a), _mm_andnot_si128(d, nearest));
+
+			d = _mm_add_epi8(Png_LoadPixel(line + i), _mm_packus_epi16(nearest, nearest));
+			Png_StorePixel(line + i, d);
+			a = _mm_unpacklo_epi8(d, zero);
+			c = b;
+		}
+		return;
+	}
+}
+#endif
+
 static void Png_Reconstruct(uint8_t type, uint8_t bytesPerPixel, uint8_t* line, uint8_t* prior, uint32_t lineLen) {
 	uint32_t i, j;
+#ifdef PNG_SSE2
+	if ((bytesPerPixel == 3 || bytesPerPixel == 4) && type >= PNG_FILTER_SUB && type <= PNG_FILTER_PAETH && type != PNG_FILTER_UP) {
+		Png_ReconstructSSE2(type, bytesPerPixel, line, prior, lineLen); return;
+	}
+#endif
+
 	switch (type) {
 	case PNG_FILTER_NONE:
 		return;
@@ -82,7 +163,15 @@ static void Png_Reconstruct(uint8_t type, uint8_t bytesPerPixel, uint8_t* line,
 		return;
 
 	case PNG_FILTER_UP:
-		for (i = 0; i < lineLen; i++) {
+		i = 0;
+#ifdef PNG_SSE2
+		for (; i + 16 <= lineLen; i += 16) {
+			__m128i cur = _mm_loadu_si128((__m128i*)(line  + i));
+			__m128i up  = _mm_loadu_si128((__m128i*)(prior + i));
+			_mm_storeu_si128((__m128i*)(line + i), _mm_add_epi8(cur, up));
+		}
+#endif
+		for (; i < lineLen; i++) {
 			line[i] += prior[i];
 		}
 		return;
@@ -97,16 +186,16 @@ static void Png_Reconstruct(uint8_t type, uint8_t bytesPerPixel, uint8_t* line,
 		return;
 
 	case PNG_FILTER_PAETH:
-		/* TODO: verify this is right */
 		for (i = 0; i < bytesPerPixel; i++) {
 			line[i] += prior[i];
 		}
 		for (j = 0; i < lineLen; i++, j++) {
 			uint8_t a = line[j], b = prior[i], c = prior[j];
-			int p = a + b - c;
-			int pa = Math_AbsI(p - a);
-			int pb = Math_AbsI(p - b);
-			int pc = Math_AbsI(p - c);
+			/* p - a = b - c, p - b = a - c, p - c = (b - c) + (a - c) */
+			int pa = b - c, pb = a - c, pc = pa + pb;
+			pa = pa < 0 ? -pa : pa;
+			pb = pb < 0 ? -pb : pb;
+			pc = pc < 0 ? -pc : pc;
 
 			if (pa <= pb && pa <= pc) { line[i] += a; } 
 			else if (pb <= pc) {        line[i] += b; } 
@@ -239,6 +328,22 @@ static void Png_Expand_GRAYSCALE_A_16(int width, BitmapCol* palette, uint8_t* sr
 }
 
 static void Png_Expand_RGB_A_8(int width, BitmapCol* palette, uint8_t* src, BitmapCol* dst) {
+#if defined CC_BUILD_WEB
+	/* Bitmaps are already in RGBA order */
+	Mem_Copy(dst, src, width * 4);
+#elif defined PNG_SSE2
+	__m128i ga = _mm_set1_epi32(0xFF00FF00), rb = _mm_set1_epi32(0x00FF00FF), px;
+	int i, j;
+
+	/* Swap R and B of 4 pixels at once */
+	for (i = 0, j = 0; i < (width & ~0x3); i += 4, j += 16) {
+		px = _mm_loadu_si128((__m128i*)(src + j));
+		px = _mm_or_si128(_mm_and_si128(px, ga),
+			_mm_shufflehi_epi16(_mm_shufflelo_epi16(_mm_and_si128(px, rb), 0xB1), 0xB1));
+		_mm_storeu_si128((__m128i*)(dst + i), px);
+	}
+	for (; i < width; i++, j += 4) { PNG_Do_RGB_A__8(i, j); }
+#else
 	int i, j;
 
 	for (i = 0, j = 0; i < (width & ~0x3); i += 4, j += 16) {
@@ -246,6 +351,7 @@ static void Png_Expand_RGB_A_8(int width, BitmapCol* palette, uint8_t* src, Bitm
 		PNG_Do_RGB_A__8(i + 2, j + 8); PNG_Do_RGB_A__8(i + 3, j + 12);
 	}
 	for (; i < width; i++, j += 4) { PNG_Do_RGB_A__8(i, j); }
+#endif
 }
 
 static void Png_Expand_RGB_A_16(int width, BitmapCol* palette, uint8_t* src, BitmapCol* dst) {
@@ -300,12 +406,12 @@ Png_RowExpander Png_GetExpander(uint8_t col, uint8_t bitsPerSample) {
 	return NULL;
 }
 
-static void Png_ComputeTransparency(Bitmap* bmp, BitmapCol col) {
+static void Png_ComputeTransparency(Bitmap* bmp, int dstX, int dstY, int width, int height, BitmapCol col) {
 	uint32_t trnsRGB = col.B | (col.G << 8) | (col.R << 16); /* TODO: Remove this!! */
-	int x, y, width = bmp->Width, height = bmp->Height;
+	int x, y;
 
 	for (y = 0; y < height; y++) {
-		uint32_t* row = Bitmap_RawRow(bmp, y);
+		uint32_t* row = Bitmap_RawRow(bmp, dstY + y) + dstX;
 		for (x = 0; x < width; x++) {
 			uint32_t rgb = row[x] & PNG_RGB_MASK;
 			row[x] = (rgb == trnsRGB) ? trnsRGB : row[x];
@@ -317,8 +423,9 @@ static void Png_ComputeTransparency(Bitmap* bmp, BitmapCol col) {
 /* Need to store both current and prior row, per PNG specification. */
 #define PNG_BUFFER_SIZE ((PNG_MAX_DIMS * 2 * 4 + 1) * 2)
 
-/* TODO: Test a lot of .png files and ensure output is right */
-ReturnCode Png_Decode(Bitmap* bmp, struct Stream* stream) {
+/* Decodes into bmp, either allocating it to be the size of the image, */
+/* or decoding into the region starting at (dstX, dstY) of the existing bitmap. */
+static ReturnCode Png_DecodeCore(Bitmap* bmp, int dstX, int dstY, bool allocate, struct Stream* stream) {
 	uint8_t tmp[PNG_PALETTE * 3];
 	uint32_t dataSize, fourCC;
 	ReturnCode res;
@@ -326,7 +433,8 @@ ReturnCode Png_Decode(Bitmap* bmp, struct Stream* stream) {
 	/* header variables */
 	static uint32_t samplesPerPixel[7] = { 1, 0, 3, 1, 2, 0, 4 };
 	uint8_t col, bitsPerSample, bytesPerPixel;
-	Png_RowExpander rowExpander;
+	Png_RowExpander rowExpander = NULL;
+	int width = 0, height = 0;
 	uint32_t scanlineSize, scanlineBytes;
 
 	/* palette data */
@@ -346,9 +454,6 @@ ReturnCode Png_Decode(Bitmap* bmp, struct Stream* stream) {
 	struct Stream compStream, datStream;
 	struct ZLibHeader zlibHeader;
 
-	bmp->Width = 0; bmp->Height = 0;
-	bmp->Scan0 = NULL;
-
 	res = Stream_Read(stream, tmp, PNG_SIG_SIZE);
 	if (res) return res;
 	if (!Png_Detect(tmp, PNG_SIG_SIZE)) return PNG_ERR_INVALID_SIG;
@@ -371,12 +476,18 @@ ReturnCode Png_Decode(Bitmap* bmp, struct Stream* stream) {
 			res = Stream_Read(stream, tmp, PNG_IHDR_SIZE);
 			if (res) return res;
 
-			bmp->Width  = (int)Stream_GetU32_BE(&tmp[0]);
-			bmp->Height = (int)Stream_GetU32_BE(&tmp[4]);
-			if (bmp->Width  < 0 || bmp->Width  > PNG_MAX_DIMS) return PNG_ERR_TOO_WIDE;
-			if (bmp->Height < 0 || bmp->Height > PNG_MAX_DIMS) return PNG_ERR_TOO_TALL;
+			width  = (int)Stream_GetU32_BE(&tmp[0]);
+			height = (int)Stream_GetU32_BE(&tmp[4]);
+			if (width  < 0 || width  > PNG_MAX_DIMS) return PNG_ERR_TOO_WIDE;
+			if (height < 0 || height > PNG_MAX_DIMS) return PNG_ERR_TOO_TALL;
 
-			bmp->Scan0 = Mem_Alloc(bmp->Width * bmp->Height, 4, "PNG bitmap data");
+			if (allocate) {
+				bmp->Width = width; bmp->Height = height;
+				bmp->Scan0 = Mem_Alloc(width * height, 4, "PNG bitmap data");
+			} else {
+				if (dstX + width  > bmp->Width)  return PNG_ERR_TOO_WIDE;
+				if (dstY + height > bmp->Height) return PNG_ERR_TOO_TALL;
+			}
 			bitsPerSample = tmp[8]; col = tmp[9];
 			rowExpander = Png_GetExpander(col, bitsPerSample);
 			if (rowExpander == NULL) return PNG_ERR_INVALID_COL_BPP;
@@ -386,7 +497,7 @@ ReturnCode Png_Decode(Bitmap* bmp, struct Stream* stream) {
 			if (tmp[12] != 0) return PNG_ERR_INTERLACED;
 
 			bytesPerPixel = ((samplesPerPixel[col] * bitsPerSample) + 7) >> 3;
-			scanlineSize  = ((samplesPerPixel[col] * bitsPerSample * bmp->Width) + 7) >> 3;
+			scanlineSize  = ((samplesPerPixel[col] * bitsPerSample * width) + 7) >> 3;
 			scanlineBytes = scanlineSize + 1; /* Add 1 byte for filter byte of each scanline */
 
 			Mem_Set(buffer, 0, scanlineBytes); /* Prior row should be 0 per PNG spec */
@@ -447,9 +558,9 @@ ReturnCode Png_Decode(Bitmap* bmp, struct Stream* stream) {
 			while (!zlibHeader.Done) {
 				if ((res = ZLibHeader_Read(&datStream, &zlibHeader))) return res;
 			}
-			if (!bmp->Scan0) return PNG_ERR_NO_DATA;
+			if (!rowExpander) return PNG_ERR_NO_DATA;
 
-			while (curY < bmp->Height) {
+			while (curY < height) {
 				/* Need to leave one row in buffer untouched for storing prior scanline. Illustrated example of process:
 				*          |=====|        #-----|        |-----|        #-----|        |-----|
 				* initial  #-----| read 3 |-----| read 3 |-----| read 1 |-----| read 3 |-----| etc
@@ -481,15 +592,15 @@ ReturnCode Png_Decode(Bitmap* bmp, struct Stream* stream) {
 					uint8_t* scanline = &buffer[rowY         * scanlineBytes];
 
 					Png_Reconstruct(scanline[0], bytesPerPixel, &scanline[1], &prior[1], scanlineSize);
-					rowExpander(bmp->Width, palette, &scanline[1], Bitmap_GetRow(bmp, curY));
+					rowExpander(width, palette, &scanline[1], Bitmap_GetRow(bmp, dstY + curY) + dstX);
 				}
 			}
 		} break;
 
 		case PNG_FourCC('I','E','N','D'): {
 			if (dataSize) return PNG_ERR_INVALID_END_SIZE;
-			if (!transparentCol.A) Png_ComputeTransparency(bmp, transparentCol);
-			return bmp->Scan0 ? 0 : PNG_ERR_NO_DATA;
+			if (!transparentCol.A) Png_ComputeTransparency(bmp, dstX, dstY, width, height, transparentCol);
+			return rowExpander ? 0 : PNG_ERR_NO_DATA;
 		} break;
 
 		default:
@@ -501,6 +612,17 @@ ReturnCode Png_Decode(Bitmap* bmp, struct Stream* stream) {
 	}
 }
 
+/* TODO: Test a lot of .png files and ensure output is right */
+ReturnCode Png_Decode(Bitmap* bmp, struct Stream* stream) {
+	bmp->Width = 0; bmp->Height = 0;
+	bmp->Scan0 = NULL;
+	return Png_DecodeCore(bmp, 0, 0, true, stream);
+}
+
+ReturnCode Png_DecodeInto(Bitmap* dst, int x, int y, struct Stream* stream) {
+	return Png_DecodeCore(dst, x, y, false, stream);
+}
+
 
 /*########################################################################################################################*
 *------------------------------------------------------PNG encoder--------------------------------------------------------*
@@ -599,7 +721,7 @@ static void Png_EncodeRow(const uint8_t* cur, const uint8_t* prior, uint8_t* bes
 }
 
 static int Png_SelectRow(Bitmap* bmp, int y) { return y; }
-ReturnCode Png_Encode(Bitmap* bmp, struct Stream* stream, Png_RowSelector selectRow, bool alpha) {	
+ReturnCode Png_EncodeEx(Bitmap* bmp, struct Stream* stream, Png_RowSelector selectRow, bool alpha, int level) {	
 	uint8_t tmp[32];
 	/* TODO: This should be * 4 for alpha (should switch to mem_alloc though) */
 	uint8_t prevLine[PNG_MAX_DIMS * 3], curLine[PNG_MAX_DIMS * 3];
@@ -638,7 +760,7 @@ ReturnCode Png_Encode(Bitmap* bmp, struct Stream* stream, Png_RowSelector select
 	Stream_SetU32_BE(&tmp[0], PNG_FourCC('I','D','A','T'));
 	if ((res = Stream_Write(&chunk, tmp, 4))) return res;
 
-	ZLib_MakeStream(&zlStream, &zlState, &chunk); 
+	ZLib_MakeStreamEx(&zlStream, &zlState, &chunk, level); 
 	lineSize = bmp->Width * (alpha ? 4 : 3);
 	Mem_Set(prevLine, 0, lineSize);
 
@@ -671,3 +793,7 @@ ReturnCode Png_Encode(Bitmap* bmp, struct Stream* stream, Png_RowSelector select
 	if ((res = Stream_Write(stream, tmp, 4))) return res;
 	return stream->Seek(stream, stream_end);
 }
+
+ReturnCode Png_Encode(Bitmap* bmp, struct Stream* stream, Png_RowSelector selectRow, bool alpha) {
+	return Png_EncodeEx(bmp, stream, selectRow, alpha, DEFLATE_LEVEL_DEFAULT);
+}
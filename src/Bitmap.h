@@ -61,8 +61,14 @@ typedef int (*Png_RowSelector)(Bitmap* bmp, int row);
      https://github.com/nothings/stb/blob/master/stb_image.h
 */
 CC_API ReturnCode Png_Decode(Bitmap* bmp, struct Stream* stream);
+/* Decodes a bitmap in PNG format directly into an existing bitmap, with top left corner at (x, y). */
+/* This avoids needing to decode into a temp bitmap first and then copy from that. (e.g. atlas tiles) */
+/* NOTE: Returns PNG_ERR_TOO_WIDE or PNG_ERR_TOO_TALL if the image doesn't fit inside dst. */
+CC_API ReturnCode Png_DecodeInto(Bitmap* dst, int x, int y, struct Stream* stream);
 /* Encodes a bitmap in PNG format. */
 /* selectRow is optional. Can be used to modify how rows are encoded. (e.g. flip image) */
 /* if alpha is non-zero, RGBA channels are saved, otherwise only RGB channels are. */
 CC_API ReturnCode Png_Encode(Bitmap* bmp, struct Stream* stream, Png_RowSelector selectRow, bool alpha);
+/* Same as Png_Encode, but level is the DEFLATE compression level to use. (see DeflateLevel enum in Deflate.h) */
+CC_API ReturnCode Png_EncodeEx(Bitmap* bmp, struct Stream* stream, Png_RowSelector selectRow, bool alpha, int level);
 #endif
@@ -448,7 +448,11 @@ static void Block_CalcStretch(BlockID block) {
 	}
 }
 
-static bool Block_MightCull(BlockID block, BlockID other) {
+static bool cull_pending;
+#define Block_LiquidGroup(b) ((b) == BLOCK_WATER || (b) == BLOCK_STILL_WATER ? 1 : ((b) == BLOCK_LAVA || (b) == BLOCK_STILL_LAVA ? 2 : 0))
+
+/* same is whether block and other are the same block, rather than just two blocks with identical properties */
+static bool Block_MightCull(BlockID block, BlockID other, bool same) {
 	uint8_t bType, oType;
 	/* Sprite blocks can never cull blocks. */
 	if (Blocks.Draw[block] == DRAW_SPRITE) return false;
@@ -459,7 +463,7 @@ static bool Block_MightCull(BlockID block, BlockID other) {
 		return true;
 
 	/* All blocks (except for say leaves) cull with themselves */
-	if (block == other) return Blocks.Draw[block] != DRAW_TRANSPARENT_THICK;
+	if (same) return Blocks.Draw[block] != DRAW_TRANSPARENT_THICK;
 
 	/* An opaque neighbour (asides from lava) culls this block. */
 	if (Blocks.Draw[other] == DRAW_OPAQUE && !Blocks.IsLiquid[other]) return true;
@@ -472,17 +476,14 @@ static bool Block_MightCull(BlockID block, BlockID other) {
 	return (bType == COLLIDE_SOLID && oType == COLLIDE_SOLID) || bType != COLLIDE_SOLID;
 }
 
-static void Block_CalcCulling(BlockID block, BlockID other) {
+static int Block_CalcHidden(BlockID block, BlockID other, bool same) {
 	Vector3 bMin, bMax, oMin, oMax;
 	bool occludedX, occludedY, occludedZ, bothLiquid;
 	int f;
 
 	/* Some blocks may not cull 'other' block, in which case just skip per-face check */
 	/* e.g. sprite blocks, default leaves, will not cull any other blocks */
-	if (!Block_MightCull(block, other)) {	
-		Blocks.Hidden[(block * BLOCK_COUNT) + other] = 0;
-		return;
-	}
+	if (!Block_MightCull(block, other, same)) return 0;
 
 	bMin = Blocks.MinBB[block]; bMax = Blocks.MaxBB[block];
 	oMin = Blocks.MinBB[other]; oMax = Blocks.MaxBB[other];
@@ -506,31 +507,62 @@ static void Block_CalcCulling(BlockID block, BlockID other) {
 	f |= occludedZ && oMin.Z == 0.0f && bMax.Z == 1.0f ? (1 << FACE_ZMAX) : 0;
 	f |= occludedY && (bothLiquid || (oMax.Y == 1.0f && bMin.Y == 0.0f)) ? (1 << FACE_YMIN) : 0;
 	f |= occludedY && (bothLiquid || (oMin.Y == 0.0f && bMax.Y == 1.0f)) ? (1 << FACE_YMAX) : 0;
-	Blocks.Hidden[(block * BLOCK_COUNT) + other] = f;
+	return f;
+}
+
+/* Whether two blocks hide, and are hidden by, other blocks identically. */
+static bool Block_SameCulling(BlockID a, BlockID b) {
+	return Blocks.Draw[a] == Blocks.Draw[b] && Blocks.IsLiquid[a] == Blocks.IsLiquid[b]
+		&& Blocks.Collide[a] == Blocks.Collide[b] && Block_LiquidGroup(a) == Block_LiquidGroup(b)
+		&& Vector3_Equals(&Blocks.MinBB[a], &Blocks.MinBB[b]) && Vector3_Equals(&Blocks.MaxBB[a], &Blocks.MaxBB[b]);
 }
 
 bool Block_IsFaceHidden(BlockID block, BlockID other, Face face) {
-	return (Blocks.Hidden[(block * BLOCK_COUNT) + other] & (1 << face)) != 0;
+	return (Block_Hidden(block, other) & (1 << face)) != 0;
 }
 
 void Block_UpdateAllCulling(void) {
-	int block, neighbour;
+	BlockID reps[BLOCK_COUNT];
+	bool shared[BLOCK_COUNT];
+	int block, i, j, count = 0;
+	bool unique;
+
 	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
 		Block_CalcStretch((BlockID)block);
-		for (neighbour = BLOCK_AIR; neighbour < BLOCK_COUNT; neighbour++) {
-			Block_CalcCulling((BlockID)block, (BlockID)neighbour);
+
+		/* e.g. glass hides faces of itself, but not of a different glass block with identical properties */
+		/* Such blocks must have a class of their own, since blocks in a class must also hide each other */
+		unique = Block_CalcHidden(block, block, true) != Block_CalcHidden(block, block, false);
+		for (i = 0; i < count && !unique; i++) {
+			if (shared[i] && Block_SameCulling(reps[i], block)) break;
+		}
+
+		if (unique || i == count) {
+			i = count++;
+			reps[i] = block; shared[i] = !unique;
+		}
+		Blocks.CullClass[block] = i;
+	}
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < count; j++) {
+			Blocks.Hidden[i * count + j] = Block_CalcHidden(reps[i], reps[j], i == j);
 		}
 	}
+
+	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
+		Blocks.CullRow[block] = Blocks.CullClass[block] * count;
+	}
+	cull_pending = false;
 }
 
 void Block_UpdateCulling(BlockID block) {
-	int neighbour;
 	Block_CalcStretch(block);
-	
-	for (neighbour = BLOCK_AIR; neighbour < BLOCK_COUNT; neighbour++) {
-		Block_CalcCulling(block, (BlockID)neighbour);
-		Block_CalcCulling((BlockID)neighbour, block);
-	}
+	cull_pending = true;
+}
+
+void Block_UpdatePendingCulling(void) {
+	if (cull_pending) Block_UpdateAllCulling();
 }
 
 
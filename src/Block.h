@@ -96,7 +96,12 @@ CC_VAR extern struct _BlockLists {
 	/* Whether this block is allowed to be deleted. */
 	bool CanDelete[BLOCK_COUNT];
 
-	/* Bit flags of faces hidden of two neighbouring blocks. */
+	/* Culling class of this block. Blocks in the same class hide, and are hidden by, other blocks identically. */
+	uint16_t CullClass[BLOCK_COUNT];
+	/* Start of the row for this block's culling class in Hidden. (i.e. CullClass * number of classes) */
+	int CullRow[BLOCK_COUNT];
+	/* Bit flags of faces hidden between blocks of two culling classes. Use Block_Hidden to index this. */
+	/* NOTE: Only the first (number of classes)^2 entries are used, so the used portion stays small. */
 	uint8_t Hidden[BLOCK_COUNT * BLOCK_COUNT];
 	/* Bit flags of which faces of this block can stretch with greedy meshing. */
 	uint8_t CanStretch[BLOCK_COUNT];
@@ -153,12 +158,18 @@ void Block_SetSide(TextureLoc texLoc, BlockID blockId);
 /* The texture for the given face of the given block. */
 #define Block_Tex(block, face) Blocks.Textures[(block) * FACE_COUNT + (face)]
 
+/* Bit flags of the faces of the given block that are hidden by the other block. */
+#define Block_Hidden(block, other) Blocks.Hidden[Blocks.CullRow[block] + Blocks.CullClass[other]]
 bool Block_IsFaceHidden(BlockID block, BlockID other, Face face);
 /* Updates culling data of all blocks. */
 void Block_UpdateAllCulling(void);
 /* Updates culling data just for this block. */
 /* (e.g. whether block can be stretched, visibility with other blocks) */
+/* NOTE: Visibility with other blocks is only recalculated by Block_UpdatePendingCulling, */
+/* so that a burst of block definitions only recalculates visibility once. */
 void Block_UpdateCulling(BlockID block);
+/* Recalculates visibility between blocks, if any block's culling data changed since last time. */
+void Block_UpdatePendingCulling(void);
 
 /* Whether blocks can be automatically rotated. */
 extern bool AutoRotate_Enabled;
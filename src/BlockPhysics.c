@@ -14,91 +14,195 @@
 #include "Vectors.h"
 #include "Chat.h"
 
-/* Data for a resizable queue, used for liquid physic tick entries. */
-struct TickQueue {
-	uint32_t* Entries;     /* Buffer holding the items in the tick queue */
-	int EntriesSize; /* Max number of elements in the buffer */
-	int EntriesMask; /* EntriesSize - 1, as EntriesSize is always a power of two */
-	int Size;        /* Number of used elements */
-	int Head;        /* Head index into the buffer */
-	int Tail;        /* Tail index into the buffer */
+/* Number of ticks covered by the timing wheel. Must be a power of two, and more than the longest delay + 1. */
+#define WHEEL_SLOTS 32
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+/* Maximum time spent activating liquids each physics tick, before leaving the rest until the next tick. */
+#define PHYSICS_TICK_BUDGET_US 20000
+
+/* Indices of the blocks whose liquid physics tick is due on a particular tick. */
+struct TickSlot {
+	uint32_t* Entries;
+	int Count, Capacity;
 };
 
-static void TickQueue_Init(struct TickQueue* queue) {
-	queue->Entries     = NULL;
-	queue->EntriesSize = 0;
-	queue->EntriesMask = 0;
-	queue->Head = 0;
-	queue->Tail = 0;
-	queue->Size = 0;
+/* Timing wheel of liquid physics ticks, with one slot for each of the next WHEEL_SLOTS ticks. */
+struct TickWheel {
+	struct TickSlot Slots[WHEEL_SLOTS];
+	uint32_t* Pending; /* Bit flags of which blocks already have a tick scheduled (allocated on first use) */
+	int Size;          /* Number of ticks scheduled across all slots */
+};
+
+static void TickSlot_Add(struct TickSlot* slot, uint32_t index) {
+	if (slot->Count == slot->Capacity) {
+		slot->Capacity = slot->Capacity ? slot->Capacity * 2 : 32;
+		slot->Entries  = Mem_Realloc(slot->Entries, slot->Capacity, 4, "physics tick slot");
+	}
+	slot->Entries[slot->Count++] = index;
 }
 
-static void TickQueue_Clear(struct TickQueue* queue) {
-	if (!queue->Entries) return;
-	Mem_Free(queue->Entries);
-	TickQueue_Init(queue);
+static void TickWheel_Clear(struct TickWheel* wheel) {
+	int i;
+	for (i = 0; i < WHEEL_SLOTS; i++) {
+		Mem_Free(wheel->Slots[i].Entries);
+		wheel->Slots[i].Entries  = NULL;
+		wheel->Slots[i].Count    = 0;
+		wheel->Slots[i].Capacity = 0;
+	}
+
+	Mem_Free(wheel->Pending);
+	wheel->Pending = NULL;
+	wheel->Size    = 0;
 }
 
-static void TickQueue_Resize(struct TickQueue* queue) {
-	uint32_t* entries;
-	int i, idx, capacity;
 
-	if (queue->EntriesSize >= (Int32_MaxValue / 4)) {
-		Chat_AddRaw("&cToo many physics entries, clearing");
-		TickQueue_Clear(queue);
-		return;
+struct Physics_ Physics;
+struct PhysicsStats_ PhysicsStats;
+static RNGState physics_rnd;
+static int physics_tickCount;
+static int physics_maxWaterX, physics_maxWaterY, physics_maxWaterZ;
+static struct TickWheel lavaQ, waterQ;
+
+/* Number of blocks with a random tick handler in each chunk. */
+static uint16_t* physics_tickable;
+/* Chunks that contain any blocks with a random tick handler, so other chunks can be skipped. */
+static int* physics_tickChunks;
+/* Position of each chunk in physics_tickChunks, or -1 if not in it. */
+static int* physics_tickSlots;
+static int physics_tickChunksCount;
+static int physics_chunksX, physics_chunksY, physics_chunksZ;
+
+#ifdef SPARSE_WORLD
+/* Physics works with packed indices, which must be unpacked to read from sub chunks (slow) */
+static BlockRaw Physics_GetBlock(int index) {
+	int x, y, z;
+	World_Unpack(index, x, y, z);
+	return (BlockRaw)World_GetBlock(x, y, z);
+}
+#else
+#define Physics_GetBlock(index) World.Blocks[index]
+#endif
+
+#define Physics_PackChunk(cx, cy, cz) (((cy) * physics_chunksZ + (cz)) * physics_chunksX + (cx))
+
+#define PHYSICS_ONE_DELAY   1
+#define PHYSICS_LAVA_DELAY  30
+#define PHYSICS_WATER_DELAY 5
+
+/* Schedules the block to be activated after the given number of ticks, unless it already has been. */
+static void Physics_Schedule(struct TickWheel* wheel, int index, int delay) {
+	uint32_t bit = 1U << (index & 0x1F);
+	if (!wheel->Pending) {
+		wheel->Pending = Mem_AllocCleared(((uint32_t)World.Volume >> 5) + 1, 4, "physics pending ticks");
 	}
 
-	capacity = queue->EntriesSize * 2;
-	if (capacity < 32) capacity = 32;
-	entries = Mem_Alloc(capacity, 4, "physics tick queue");
+	if (wheel->Pending[index >> 5] & bit) return;
+	wheel->Pending[index >> 5] |= bit;
+	/* physics_tickCount is the tick currently (or most recently) being processed */
+	TickSlot_Add(&wheel->Slots[(physics_tickCount + 1 + delay) & WHEEL_MASK], index);
+	wheel->Size++;
+}
+
+/* Activates liquid blocks whose tick is due, until the time budget for this physics tick runs out. */
+static void Physics_TickLiquid(struct TickWheel* wheel, BlockID flowing, BlockID still, PhysicsHandler activate, uint64_t beg) {
+	struct TickSlot* slot = &wheel->Slots[physics_tickCount & WHEEL_MASK];
+	struct TickSlot* next = &wheel->Slots[(physics_tickCount + 1) & WHEEL_MASK];
+	BlockID block;
+	int i, index;
+
+	for (i = 0; i < slot->Count; i++) {
+		if ((i & 0xFF) == 0xFF && Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure()) >= PHYSICS_TICK_BUDGET_US) break;
 
-	for (i = 0; i < queue->Size; i++) {
-		idx = (queue->Head + i) & queue->EntriesMask;
-		entries[i] = queue->Entries[idx];
+		index = slot->Entries[i];
+		wheel->Pending[index >> 5] &= ~(1U << (index & 0x1F));
+		wheel->Size--;
+		PhysicsStats.Activated++;
+
+		block = Physics_GetBlock(index);
+		if (block == flowing || block == still) activate(index, block);
 	}
-	Mem_Free(queue->Entries);
 
-	queue->Entries     = entries;
-	queue->EntriesSize = capacity;
-	queue->EntriesMask = capacity - 1; /* capacity is power of two */
-	queue->Head = 0;
-	queue->Tail = queue->Size;
+	/* Out of time, so leave the rest until the next tick */
+	for (; i < slot->Count; i++) {
+		TickSlot_Add(next, slot->Entries[i]);
+		PhysicsStats.Deferred++;
+	}
+	slot->Count = 0;
 }
 
-static void TickQueue_Enqueue(struct TickQueue* queue, uint32_t item) {
-	if (queue->Size == queue->EntriesSize)
-		TickQueue_Resize(queue);
+static void Physics_FreeTickable(void) {
+	Mem_Free(physics_tickable);   physics_tickable   = NULL;
+	Mem_Free(physics_tickChunks); physics_tickChunks = NULL;
+	Mem_Free(physics_tickSlots);  physics_tickSlots  = NULL;
+	physics_tickChunksCount = 0;
+}
 
-	queue->Entries[queue->Tail] = item;
-	queue->Tail = (queue->Tail + 1) & queue->EntriesMask;
-	queue->Size++;
+static void Physics_AddTickable(int chunk) {
+	if (physics_tickable[chunk]++) return;
+	physics_tickSlots[chunk] = physics_tickChunksCount;
+	physics_tickChunks[physics_tickChunksCount++] = chunk;
 }
 
-static uint32_t TickQueue_Dequeue(struct TickQueue* queue) {
-	uint32_t result = queue->Entries[queue->Head];
-	queue->Head = (queue->Head + 1) & queue->EntriesMask;
-	queue->Size--;
-	return result;
+static void Physics_RemoveTickable(int chunk) {
+	int slot, last;
+	if (--physics_tickable[chunk]) return;
+
+	/* Move the last chunk in the list into the now empty slot */
+	slot = physics_tickSlots[chunk];
+	last = physics_tickChunks[--physics_tickChunksCount];
+	physics_tickChunks[slot] = last;
+	physics_tickSlots[last]  = slot;
+	physics_tickSlots[chunk] = -1;
 }
 
+static void Physics_FindTickable(void) {
+	int x, y, z, count;
+	BlockRaw block;
 
-struct Physics_ Physics;
-static RNGState physics_rnd;
-static int physics_tickCount;
-static int physics_maxWaterX, physics_maxWaterY, physics_maxWaterZ;
-static struct TickQueue lavaQ, waterQ;
+	physics_chunksX = (World.Width  + CHUNK_MAX) >> CHUNK_SHIFT;
+	physics_chunksY = (World.Height + CHUNK_MAX) >> CHUNK_SHIFT;
+	physics_chunksZ = (World.Length + CHUNK_MAX) >> CHUNK_SHIFT;
+	count = physics_chunksX * physics_chunksY * physics_chunksZ;
+
+	physics_tickable   = Mem_AllocCleared(count, 2, "physics tickable counts");
+	physics_tickChunks = Mem_Alloc(count, 4, "physics tickable chunks");
+	physics_tickSlots  = Mem_Alloc(count, 4, "physics tickable slots");
+	Mem_Set(physics_tickSlots, 0xFF, count * 4);
+
+	for (y = 0; y < World.Height; y++) {
+		for (z = 0; z < World.Length; z++) {
+			for (x = 0; x < World.Width; x++) {
+				block = (BlockRaw)World_GetBlock(x, y, z);
+				if (!Physics.OnRandomTick[block]) continue;
+				Physics_AddTickable(Physics_PackChunk(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT));
+			}
+		}
+	}
+}
+
+void Physics_OnBlockUpdated(int x, int y, int z, BlockID old, BlockID now) {
+	bool wasTickable, isTickable;
+	int chunk;
+	if (!physics_tickable) return;
 
-#define PHYSICS_DELAY_MASK 0xF8000000UL
-#define PHYSICS_POS_MASK   0x07FFFFFFUL
-#define PHYSICS_DELAY_SHIFT 27
-#define PHYSICS_ONE_DELAY   (1U << PHYSICS_DELAY_SHIFT)
-#define PHYSICS_LAVA_DELAY (30U << PHYSICS_DELAY_SHIFT)
-#define PHYSICS_WATER_DELAY (5U << PHYSICS_DELAY_SHIFT)
+	/* Handlers are looked up using only the lower 8 bits of blocks */
+	wasTickable = Physics.OnRandomTick[(BlockRaw)old] != NULL;
+	isTickable  = Physics.OnRandomTick[(BlockRaw)now] != NULL;
+	if (wasTickable == isTickable) return;
+
+	chunk = Physics_PackChunk(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+	if (isTickable) {
+		Physics_AddTickable(chunk);
+	} else {
+		Physics_RemoveTickable(chunk);
+	}
+}
 
 static void Physics_OnNewMapLoaded(void* obj) {
-	TickQueue_Clear(&lavaQ);
-	TickQueue_Clear(&waterQ);
+	TickWheel_Clear(&lavaQ);
+	TickWheel_Clear(&waterQ);
+	Physics_FreeTickable();
+	if (Physics.Enabled && World.Loaded) Physics_FindTickable();
 
 	physics_maxWaterX = World.MaxX - 2;
 	physics_maxWaterY = World.MaxY - 2;
@@ -115,7 +219,7 @@ void Physics_SetEnabled(bool enabled) {
 }
 
 static void Physics_Activate(int index) {
-	BlockID block = World.Blocks[index];
+	BlockID block = Physics_GetBlock(index);
 	PhysicsHandler activate = Physics.OnActivate[block];
 	if (activate) activate(index, block);
 }
@@ -158,38 +262,34 @@ void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now) {
 	Physics_ActivateNeighbours(x, y, z, index);
 }
 
+/* Randomly ticks 3 blocks in each chunk that contains blocks with a random tick handler */
 static void Physics_TickRandomBlocks(void) {
-	int lo, hi, index;
+	int i, j, n, chunk, index;
+	int cx, cy, cz, x, y, z;
 	BlockID block;
 	PhysicsHandler tick;
-	int x, y, z, x2, y2, z2;
-
-	for (y = 0; y < World.Height; y += CHUNK_SIZE) {
-		y2 = min(y + CHUNK_MAX, World.MaxY);
-		for (z = 0; z < World.Length; z += CHUNK_SIZE) {
-			z2 = min(z + CHUNK_MAX, World.MaxZ);
-			for (x = 0; x < World.Width; x += CHUNK_SIZE) {
-				x2 = min(x + CHUNK_MAX, World.MaxX);
-
-				/* Inlined 3 random ticks for this chunk */
-				lo = World_Pack( x,  y,  z);
-				hi = World_Pack(x2, y2, z2);
-				
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
-
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
-
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
-			}
+
+	/* Handlers may add or remove chunks, so go backwards to avoid skipping a chunk moved into an earlier slot */
+	for (i = physics_tickChunksCount - 1; i >= 0; i--) {
+		if (i >= physics_tickChunksCount) continue;
+		chunk = physics_tickChunks[i];
+
+		cx = chunk % physics_chunksX;
+		cz = (chunk / physics_chunksX) % physics_chunksZ;
+		cy = (chunk / physics_chunksX) / physics_chunksZ;
+
+		for (j = 0; j < 3; j++) {
+			n = Random_Next(&physics_rnd, CHUNK_SIZE_3);
+			x = (cx << CHUNK_SHIFT) | (n & CHUNK_MASK);
+			z = (cz << CHUNK_SHIFT) | ((n >> CHUNK_SHIFT) & CHUNK_MASK);
+			y = (cy << CHUNK_SHIFT) | (n >> (CHUNK_SHIFT * 2));
+			/* Chunks on the edges of the map may be partially outside it */
+			if (!World_Contains(x, y, z)) continue;
+
+			index = World_Pack(x, y, z);
+			block = Physics_GetBlock(index);
+			tick  = Physics.OnRandomTick[block];
+			if (tick) tick(index, block);
 		}
 	}
 }
@@ -203,7 +303,7 @@ static void Physics_DoFalling(int index, BlockID block) {
 	/* Find lowest block can fall into */
 	while (index >= World.OneY) {
 		index -= World.OneY;
-		other  = World.Blocks[index];
+		other  = Physics_GetBlock(index);
 
 		if (other == BLOCK_AIR || (other >= BLOCK_WATER && other <= BLOCK_STILL_LAVA))
 			found = index;
@@ -220,22 +320,11 @@ static void Physics_DoFalling(int index, BlockID block) {
 	Physics_ActivateNeighbours(x, y, z, start);
 }
 
-static bool Physics_CheckItem(struct TickQueue* queue, int* posIndex) {
-	uint32_t item = TickQueue_Dequeue(queue);
-	*posIndex     = (int)(item & PHYSICS_POS_MASK);
-
-	if (item >= PHYSICS_ONE_DELAY) {
-		item -= PHYSICS_ONE_DELAY;
-		TickQueue_Enqueue(queue, item);
-		return false;
-	}
-	return true;
-}
-
-
 static void Physics_HandleSapling(int index, BlockID block) {
 	Vector3I coords[TREE_MAX_COUNT];
 	BlockRaw blocks[TREE_MAX_COUNT];
+	int32_t indices[TREE_MAX_COUNT];
+	BlockID treeBlocks[TREE_MAX_COUNT];
 	int i, count, height;
 
 	BlockID below;
@@ -243,7 +332,7 @@ static void Physics_HandleSapling(int index, BlockID block) {
 	World_Unpack(index, x, y, z);
 
 	below = BLOCK_AIR;
-	if (y > 0) below = World.Blocks[index - World.OneY];
+	if (y > 0) below = Physics_GetBlock(index - World.OneY);
 	if (below != BLOCK_GRASS) return;
 
 	height = 5 + Random_Next(&physics_rnd, 3);
@@ -253,8 +342,10 @@ static void Physics_HandleSapling(int index, BlockID block) {
 		count = TreeGen_Grow(x, y, z, height, coords, blocks);
 
 		for (i = 0; i < count; i++) {
-			Game_UpdateBlock(coords[i].X, coords[i].Y, coords[i].Z, blocks[i]);
+			indices[i]    = World_Pack(coords[i].X, coords[i].Y, coords[i].Z);
+			treeBlocks[i] = blocks[i];
 		}
+		Game_UpdateBlocksBatch(indices, treeBlocks, count);
 	} else {
 		Game_UpdateBlock(x, y, z, BLOCK_SAPLING);
 	}
@@ -290,7 +381,7 @@ static void Physics_HandleFlower(int index, BlockID block) {
 	}
 
 	below = BLOCK_DIRT;
-	if (y > 0) below = World.Blocks[index - World.OneY];
+	if (y > 0) below = Physics_GetBlock(index - World.OneY);
 	if (!(below == BLOCK_DIRT || below == BLOCK_GRASS)) {
 		Game_UpdateBlock(x, y, z, BLOCK_AIR);
 		Physics_ActivateNeighbours(x, y, z, index);
@@ -309,7 +400,7 @@ static void Physics_HandleMushroom(int index, BlockID block) {
 	}
 
 	below = BLOCK_STONE;
-	if (y > 0) below = World.Blocks[index - World.OneY];
+	if (y > 0) below = Physics_GetBlock(index - World.OneY);
 	if (!(below == BLOCK_STONE || below == BLOCK_COBBLE)) {
 		Game_UpdateBlock(x, y, z, BLOCK_AIR);
 		Physics_ActivateNeighbours(x, y, z, index);
@@ -318,15 +409,15 @@ static void Physics_HandleMushroom(int index, BlockID block) {
 
 
 static void Physics_PlaceLava(int index, BlockID block) {
-	TickQueue_Enqueue(&lavaQ, PHYSICS_LAVA_DELAY | index);
+	Physics_Schedule(&lavaQ, index, PHYSICS_LAVA_DELAY);
 }
 
 static void Physics_PropagateLava(int posIndex, int x, int y, int z) {
-	BlockID block = World.Blocks[posIndex];
+	BlockID block = Physics_GetBlock(posIndex);
 	if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
 		Game_UpdateBlock(x, y, z, BLOCK_STONE);
 	} else if (Blocks.Collide[block] == COLLIDE_GAS) {
-		TickQueue_Enqueue(&lavaQ, PHYSICS_LAVA_DELAY | posIndex);
+		Physics_Schedule(&lavaQ, posIndex, PHYSICS_LAVA_DELAY);
 		Game_UpdateBlock(x, y, z, BLOCK_LAVA);
 	}
 }
@@ -342,25 +433,14 @@ static void Physics_ActivateLava(int index, BlockID block) {
 	if (y > 0)          Physics_PropagateLava(index - World.OneY, x, y - 1, z);
 }
 
-static void Physics_TickLava(void) {
-	int i, count = lavaQ.Size;
-	for (i = 0; i < count; i++) {
-		int index;
-		if (Physics_CheckItem(&lavaQ, &index)) {
-			BlockID block = World.Blocks[index];
-			if (!(block == BLOCK_LAVA || block == BLOCK_STILL_LAVA)) continue;
-			Physics_ActivateLava(index, block);
-		}
-	}
-}
 
 
 static void Physics_PlaceWater(int index, BlockID block) {
-	TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | index);
+	Physics_Schedule(&waterQ, index, PHYSICS_WATER_DELAY);
 }
 
 static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
-	BlockID block = World.Blocks[posIndex];
+	BlockID block = Physics_GetBlock(posIndex);
 	int xx, yy, zz;
 
 	if (block == BLOCK_LAVA || block == BLOCK_STILL_LAVA) {
@@ -376,7 +456,7 @@ static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
 			}
 		}
 
-		TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | posIndex);
+		Physics_Schedule(&waterQ, posIndex, PHYSICS_WATER_DELAY);
 		Game_UpdateBlock(x, y, z, BLOCK_WATER);
 	}
 }
@@ -392,21 +472,12 @@ static void Physics_ActivateWater(int index, BlockID block) {
 	if (y > 0)          Physics_PropagateWater(index - World.OneY,  x,     y - 1, z);
 }
 
-static void Physics_TickWater(void) {
-	int i, count = waterQ.Size;
-	for (i = 0; i < count; i++) {
-		int index;
-		if (Physics_CheckItem(&waterQ, &index)) {
-			BlockID block = World.Blocks[index];
-			if (!(block == BLOCK_WATER || block == BLOCK_STILL_WATER)) continue;
-			Physics_ActivateWater(index, block);
-		}
-	}
-}
 
 
 static void Physics_PlaceSponge(int index, BlockID block) {
-	int x, y, z, xx, yy, zz;
+	int32_t indices[5 * 5 * 5];
+	BlockID blocks[5 * 5 * 5];
+	int x, y, z, xx, yy, zz, count = 0;
 	World_Unpack(index, x, y, z);
 
 	for (yy = y - 2; yy <= y + 2; yy++) {
@@ -416,11 +487,13 @@ static void Physics_PlaceSponge(int index, BlockID block) {
 
 				block = World_GetBlock(xx, yy, zz);
 				if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
-					Game_UpdateBlock(xx, yy, zz, BLOCK_AIR);
+					indices[count] = World_Pack(xx, yy, zz);
+					blocks[count]  = BLOCK_AIR; count++;
 				}
 			}
 		}
 	}
+	Game_UpdateBlocksBatch(indices, blocks, count);
 }
 
 static void Physics_DeleteSponge(int index, BlockID block) {
@@ -434,9 +507,9 @@ static void Physics_DeleteSponge(int index, BlockID block) {
 					if (!World_Contains(xx, yy, zz)) continue;
 
 					index = World_Pack(xx, yy, zz);
-					block = World.Blocks[index];
+					block = Physics_GetBlock(index);
 					if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
-						TickQueue_Enqueue(&waterQ, index | PHYSICS_ONE_DELAY);
+						Physics_Schedule(&waterQ, index, PHYSICS_ONE_DELAY);
 					}
 				}
 			}
@@ -450,7 +523,7 @@ static void Physics_HandleSlab(int index, BlockID block) {
 	World_Unpack(index, x, y, z);
 	if (index < World.OneY) return;
 
-	if (World.Blocks[index - World.OneY] != BLOCK_SLAB) return;
+	if (Physics_GetBlock(index - World.OneY) != BLOCK_SLAB) return;
 	Game_UpdateBlock(x, y,     z, BLOCK_AIR);
 	Game_UpdateBlock(x, y - 1, z, BLOCK_DOUBLE_SLAB);
 }
@@ -460,7 +533,7 @@ static void Physics_HandleCobblestoneSlab(int index, BlockID block) {
 	World_Unpack(index, x, y, z);
 	if (index < World.OneY) return;
 
-	if (World.Blocks[index - World.OneY] != BLOCK_COBBLE_SLAB) return;
+	if (Physics_GetBlock(index - World.OneY) != BLOCK_COBBLE_SLAB) return;
 	Game_UpdateBlock(x, y,     z, BLOCK_AIR);
 	Game_UpdateBlock(x, y - 1, z, BLOCK_COBBLE);
 }
@@ -472,15 +545,17 @@ const static uint8_t blocksTnt[BLOCK_CPE_COUNT] = {
 	1, 1, 1, 0, 1, 0, 0, 0,  0, 0, 0, 0, 0, 1, 1, 1,  1, 1,
 };
 
+#define TNT_POWER 4
+#define TNT_MAX_BLOCKS ((TNT_POWER * 2 + 1) * (TNT_POWER * 2 + 1) * (TNT_POWER * 2 + 1))
+
 static void Physics_Explode(int x, int y, int z, int power) {	
-	int index = World_Pack(x, y, z);
+	int32_t indices[TNT_MAX_BLOCKS];
+	BlockID blocks[TNT_MAX_BLOCKS];
 	int powerSquared = power * power;
 	BlockID block;
-	int dx, dy, dz, xx, yy, zz;
+	int dx, dy, dz, xx, yy, zz, index, i, count = 0;
 
-	Game_UpdateBlock(x, y, z, BLOCK_AIR);
-	Physics_ActivateNeighbours(x, y, z, index);
-	
+	/* NOTE: This also removes the TNT block itself at the centre */
 	for (dy = -power; dy <= power; dy++) {
 		for (dz = -power; dz <= power; dz++) {
 			for (dx = -power; dx <= power; dx++) {
@@ -490,27 +565,33 @@ static void Physics_Explode(int x, int y, int z, int power) {
 				if (!World_Contains(xx, yy, zz)) continue;
 				index = World_Pack(xx, yy, zz);
 
-				block = World.Blocks[index];
+				block = Physics_GetBlock(index);
 				if (block < BLOCK_CPE_COUNT && blocksTnt[block]) continue;
 
-				Game_UpdateBlock(xx, yy, zz, BLOCK_AIR);
-				Physics_ActivateNeighbours(xx, yy, zz, index);
+				indices[count] = index;
+				blocks[count]  = BLOCK_AIR; count++;
 			}
 		}
 	}
+
+	/* Neighbours are only activated once the whole crater has been removed */
+	Game_UpdateBlocksBatch(indices, blocks, count);
+	for (i = 0; i < count; i++) {
+		index = indices[i];
+		World_Unpack(index, xx, yy, zz);
+		Physics_ActivateNeighbours(xx, yy, zz, index);
+	}
 }
 
 static void Physics_HandleTnt(int index, BlockID block) {
 	int x, y, z;
 	World_Unpack(index, x, y, z);
-	Physics_Explode(x, y, z, 4);
+	Physics_Explode(x, y, z, TNT_POWER);
 }
 
 void Physics_Init(void) {
 	Event_RegisterVoid(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
 	Physics.Enabled = Options_GetBool(OPT_BLOCK_PHYSICS, true);
-	TickQueue_Init(&lavaQ);
-	TickQueue_Init(&waterQ);
 
 	Physics.OnPlace[BLOCK_SAND]        = Physics_DoFalling;
 	Physics.OnPlace[BLOCK_GRAVEL]      = Physics_DoFalling;
@@ -551,15 +632,23 @@ void Physics_Init(void) {
 
 void Physics_Free(void) {
 	Event_UnregisterVoid(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
+	TickWheel_Clear(&lavaQ);
+	TickWheel_Clear(&waterQ);
+	Physics_FreeTickable();
 }
 
 void Physics_Tick(void) {
-	if (!Physics.Enabled || !World.Blocks) return;
+	uint64_t beg;
+	if (!Physics.Enabled || !World.Loaded) return;
 
-	/*if ((tickCount % 5) == 0) {*/
-	Physics_TickLava();
-	Physics_TickWater();
-	/*}*/
+	beg = Stopwatch_Measure();
 	physics_tickCount++;
+	PhysicsStats.Activated = 0;
+	PhysicsStats.Deferred  = 0;
+
+	Physics_TickLiquid(&lavaQ,  BLOCK_LAVA,  BLOCK_STILL_LAVA,  Physics_ActivateLava,  beg);
+	Physics_TickLiquid(&waterQ, BLOCK_WATER, BLOCK_STILL_WATER, Physics_ActivateWater, beg);
+	PhysicsStats.Pending   = lavaQ.Size + waterQ.Size;
+	PhysicsStats.ElapsedUs = (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
 	Physics_TickRandomBlocks();
 }
@@ -21,8 +21,23 @@ CC_VAR extern struct Physics_ {
 	PhysicsHandler OnDelete[256];
 } Physics;
 
+/* Statistics about liquid physics for the most recent physics tick. */
+CC_VAR extern struct PhysicsStats_ {
+	/* Number of scheduled liquid ticks that were processed. */
+	int Activated;
+	/* Number of liquid ticks that were due, but left until the next tick as the time budget ran out. */
+	int Deferred;
+	/* Number of liquid ticks still scheduled. */
+	int Pending;
+	/* Time spent processing liquid ticks, in microseconds. */
+	int ElapsedUs;
+} PhysicsStats;
+
 void Physics_SetEnabled(bool enabled);
 void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now);
+/* Keeps track of which chunks contain blocks that can be randomly ticked. */
+/* NOTE: Must be called for every block change, not just changes made by the user. */
+void Physics_OnBlockUpdated(int x, int y, int z, BlockID old, BlockID now);
 void Physics_Init(void);
 void Physics_Free(void);
 void Physics_Tick(void);
@@ -16,29 +16,59 @@
 #include "Options.h"
 
 int Builder_SidesLevel, Builder_EdgeLevel;
+int Builder_WorkersCount;
 /* Packs an index into the 16x16x16 count array. Coordinates range from 0 to 15. */
 #define Builder_PackCount(xx, yy, zz) ((((yy) << 8) | ((zz) << 4) | (xx)) * FACE_COUNT)
 /* Packs an index into the 18x18x18 chunk array. Coordinates range from -1 to 16. */
 #define Builder_PackChunk(xx, yy, zz) (((yy) + 1) * EXTCHUNK_SIZE_2 + ((zz) + 1) * EXTCHUNK_SIZE + ((xx) + 1))
 
-static BlockID* Builder_Chunk;
-static uint8_t* Builder_Counts;
-static int* Builder_BitFlags;
-static bool Builder_UseBitFlags;
-static int Builder_X, Builder_Y, Builder_Z;
-static BlockID Builder_Block;
-static int Builder_ChunkIndex;
-static bool Builder_FullBright;
-static bool Builder_Tinted;
-static int Builder_ChunkEndX, Builder_ChunkEndZ;
+/* NOTE: Chunk meshes are built on worker threads, so all mesh building state must be thread local. */
+static CC_THREADLOCAL BlockID* Builder_Chunk;
+static CC_THREADLOCAL uint8_t* Builder_Counts;
+/* Number of rows along the V axis that each stretched face covers. (only used by normal builder) */
+static CC_THREADLOCAL uint8_t* Builder_Rows;
+static CC_THREADLOCAL int* Builder_BitFlags;
+static CC_THREADLOCAL bool Builder_UseBitFlags;
+static CC_THREADLOCAL int Builder_X, Builder_Y, Builder_Z;
+static CC_THREADLOCAL BlockID Builder_Block;
+static CC_THREADLOCAL int Builder_ChunkIndex;
+static CC_THREADLOCAL bool Builder_FullBright;
+static CC_THREADLOCAL bool Builder_Tinted;
+static CC_THREADLOCAL int Builder_ChunkEndX, Builder_ChunkEndZ;
 static int Builder_Offsets[FACE_COUNT] = { -1,1, -EXTCHUNK_SIZE,EXTCHUNK_SIZE, -EXTCHUNK_SIZE_2,EXTCHUNK_SIZE_2 };
 
-static int (*Builder_StretchXLiquid)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
-static int (*Builder_StretchX)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
-static int (*Builder_StretchZ)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
-static void (*Builder_RenderBlock)(int countsIndex);
-static void (*Builder_PreStretchTiles)(int x1, int y1, int z1);
-static void (*Builder_PostStretchTiles)(int x1, int y1, int z1);
+/* Light heights of the 18x18 columns around the chunk being built. (copied from Lighting_Heightmap) */
+static CC_THREADLOCAL int16_t* Builder_Heights;
+/* World coordinates of the first column in Builder_Heights. */
+static CC_THREADLOCAL int Builder_HeightsX, Builder_HeightsZ;
+#define Builder_LightHeight(x, z) Builder_Heights[((z) - Builder_HeightsZ) * EXTCHUNK_SIZE + ((x) - Builder_HeightsX)]
+
+/* Flood fill light levels of the 18x18x18 blocks around the chunk being built. (NULL when using light heights) */
+static CC_THREADLOCAL uint8_t* Builder_Light;
+/* World Y coordinate of the first layer in Builder_Light. */
+static CC_THREADLOCAL int Builder_LightY;
+/* Colour of each light level, for sprite/top, bottom, X side, and Z side faces. */
+static CC_THREADLOCAL PackedCol Builder_LightCols[4][16];
+#define Builder_LightLevel(x, y, z) Builder_Light[(((y) - Builder_LightY) * EXTCHUNK_SIZE + ((z) - Builder_HeightsZ)) * EXTCHUNK_SIZE + ((x) - Builder_HeightsX)]
+
+static PackedCol Builder_FloodCol(int x, int y, int z, int cols) {
+	int light = Builder_LightLevel(x, y, z);
+	return Builder_LightCols[cols][max(light & 0x0F, light >> 4)];
+}
+
+/* Equivalent to Lighting_Col_XYZ_Fast, but uses the lighting copied for the chunk being built. */
+#define Builder_Col_Sprite(x, y, z) (Builder_Light ? Builder_FloodCol(x, y, z, 0) : (y) > Builder_LightHeight(x, z) ? Env.SunCol   : Env.ShadowCol)
+#define Builder_Col_YMax(x, y, z)   (Builder_Light ? Builder_FloodCol(x, y, z, 0) : (y) > Builder_LightHeight(x, z) ? Env.SunCol   : Env.ShadowCol)
+#define Builder_Col_YMin(x, y, z)   (Builder_Light ? Builder_FloodCol(x, y, z, 1) : (y) > Builder_LightHeight(x, z) ? Env.SunYMin  : Env.ShadowYMin)
+#define Builder_Col_XSide(x, y, z)  (Builder_Light ? Builder_FloodCol(x, y, z, 2) : (y) > Builder_LightHeight(x, z) ? Env.SunXSide : Env.ShadowXSide)
+#define Builder_Col_ZSide(x, y, z)  (Builder_Light ? Builder_FloodCol(x, y, z, 3) : (y) > Builder_LightHeight(x, z) ? Env.SunZSide : Env.ShadowZSide)
+
+static CC_THREADLOCAL int (*Builder_StretchXLiquid)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
+static CC_THREADLOCAL int (*Builder_StretchX)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
+static CC_THREADLOCAL int (*Builder_StretchZ)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
+static CC_THREADLOCAL void (*Builder_RenderBlock)(int countsIndex);
+static CC_THREADLOCAL void (*Builder_PreStretchTiles)(int x1, int y1, int z1);
+static CC_THREADLOCAL void (*Builder_PostStretchTiles)(int x1, int y1, int z1);
 
 /* Contains state for vertices for a portion of a chunk mesh (vertices that are in a 1D atlas) */
 struct Builder1DPart {
@@ -47,11 +77,29 @@ struct Builder1DPart {
 	int sCount, sOffset, sAdvance;
 };
 
+#define BUILDER_PARTS_COUNT (ATLAS1D_MAX_ATLASES * 2)
 /* Part builder data, for both normal and translucent parts.
 The first ATLAS1D_MAX_ATLASES parts are for normal parts, remainder are for translucent parts. */
-static struct Builder1DPart Builder_Parts[ATLAS1D_MAX_ATLASES * 2];
-static VertexP3fT2fC4b* Builder_Vertices;
-static int Builder_VerticesElems;
+static CC_THREADLOCAL struct Builder1DPart* Builder_Parts;
+static CC_THREADLOCAL VertexP3fT2fC4b* Builder_Vertices;
+static CC_THREADLOCAL int Builder_VerticesElems;
+
+/* Contains the blocks and lighting needed to build a chunk's mesh, and the mesh once it has been built. */
+/* NOTE: Blocks and lighting are copied on the main thread, so the world can be changed while building. */
+struct BuilderJob {
+	struct ChunkInfo* Info;
+	int X, Y, Z;  /* Coordinates of the minimum corner of the chunk */
+	bool AllAir;  /* Whether the chunk is completely air */
+	bool HasMesh; /* Whether any vertices were produced */
+	uint16_t OcclusionFlags; /* Pairs of faces that can see each other through the chunk */
+	BlockID Chunk[EXTCHUNK_SIZE_3];
+	int16_t Heights[EXTCHUNK_SIZE * EXTCHUNK_SIZE];
+	bool HasLight; /* Whether Light contains flood fill light levels */
+	uint8_t Light[EXTCHUNK_SIZE_3];
+	struct Builder1DPart Parts[BUILDER_PARTS_COUNT];
+	VertexP3fT2fC4b* Vertices;
+	int VerticesElems;
+};
 
 static int Builder1DPart_VerticesCount(struct Builder1DPart* part) {
 	int i, count = part->sCount;
@@ -74,7 +122,7 @@ static void Builder1DPart_CalcOffsets(struct Builder1DPart* part, int* offset) {
 
 static int Builder_TotalVerticesCount(void) {
 	int i, count = 0;
-	for (i = 0; i < ATLAS1D_MAX_ATLASES * 2; i++) {
+	for (i = 0; i < BUILDER_PARTS_COUNT; i++) {
 		count += Builder1DPart_VerticesCount(&Builder_Parts[i]);
 	}
 	return count;
@@ -97,7 +145,7 @@ static void Builder_AddVertices(BlockID block, Face face) {
 	part->fCount[face] += 4;
 }
 
-static void Builder_SetPartInfo(struct Builder1DPart* part, int* offset, struct ChunkPartInfo* info, bool* hasParts) {
+static void Builder_SetPartInfo(struct Builder1DPart* part, VertexP3fT2fC4b* vertices, int* offset, struct ChunkPartInfo* info, bool* hasParts) {
 	int vCount = Builder1DPart_VerticesCount(part);
 	info->Offset = -1;
 	if (!vCount) return;
@@ -107,7 +155,7 @@ static void Builder_SetPartInfo(struct Builder1DPart* part, int* offset, struct
 	*hasParts = true;
 
 #ifdef CC_BUILD_GL11
-	info->Vb = Gfx_CreateVb(&Builder_Vertices[info->Offset], VERTEX_FORMAT_P3FT2FC4B, vCount);
+	info->Vb = Gfx_CreateVb(&vertices[info->Offset], VERTEX_FORMAT_P3FT2FC4B, vCount);
 #endif
 
 	info->Counts[FACE_XMIN] = part->fCount[FACE_XMIN];
@@ -129,20 +177,6 @@ static void Builder_Stretch(int x1, int y1, int z1) {
 	BlockID b;
 	int x, y, z, xx, yy, zz;
 
-#ifdef OCCLUSION
-	int flags = ComputeOcclusion();
-#endif
-#ifdef DEBUG_OCCLUSION
-	FastColour col = new FastColour(60, 60, 60, 255);
-	if (flags & 1) col.R = 255; /* x */
-	if (flags & 4) col.G = 255; /* y */
-	if (flags & 2) col.B = 255; /* z */
-	map.Sunlight = map.Shadowlight = col;
-	map.SunlightXSide = map.ShadowlightXSide = col;
-	map.SunlightZSide = map.ShadowlightZSide = col;
-	map.SunlightYBottom = map.ShadowlightYBottom = col;
-#endif
-	
 	for (y = y1, yy = 0; y < yMax; y++, yy++) {
 		for (z = z1, zz = 0; z < zMax; z++, zz++) {
 			cIndex = Builder_PackChunk(0, yy, zz);
@@ -166,12 +200,12 @@ static void Builder_Stretch(int x1, int y1, int z1) {
 
 				Builder_X = x; Builder_Y = y; Builder_Z = z;
 				Builder_FullBright = Blocks.FullBright[b];
-				tileIdx = b * BLOCK_COUNT;
+				tileIdx = Blocks.CullRow[b];
 				/* All of these function calls are inlined as they can be called tens of millions to hundreds of millions of times. */
 
 				if (Builder_Counts[index] == 0 ||
 					(x == 0 && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(x != 0 && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - 1]] & (1 << FACE_XMIN)) != 0)) {
+					(x != 0 && (Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex - 1]]] & (1 << FACE_XMIN)) != 0)) {
 					Builder_Counts[index] = 0;
 				} else {
 					count = Builder_StretchZ(index, x, y, z, cIndex, b, FACE_XMIN);
@@ -182,7 +216,7 @@ static void Builder_Stretch(int x1, int y1, int z1) {
 				index++;
 				if (Builder_Counts[index] == 0 ||
 					(x == World.MaxX && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(x != World.MaxX && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + 1]] & (1 << FACE_XMAX)) != 0)) {
+					(x != World.MaxX && (Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex + 1]]] & (1 << FACE_XMAX)) != 0)) {
 					Builder_Counts[index] = 0;
 				} else {
 					count = Builder_StretchZ(index, x, y, z, cIndex, b, FACE_XMAX);
@@ -193,7 +227,7 @@ static void Builder_Stretch(int x1, int y1, int z1) {
 				index++;
 				if (Builder_Counts[index] == 0 ||
 					(z == 0 && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(z != 0 && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - EXTCHUNK_SIZE]] & (1 << FACE_ZMIN)) != 0)) {
+					(z != 0 && (Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex - EXTCHUNK_SIZE]]] & (1 << FACE_ZMIN)) != 0)) {
 					Builder_Counts[index] = 0;
 				} else {
 					count = Builder_StretchX(index, Builder_X, Builder_Y, Builder_Z, cIndex, b, FACE_ZMIN);
@@ -204,7 +238,7 @@ static void Builder_Stretch(int x1, int y1, int z1) {
 				index++;
 				if (Builder_Counts[index] == 0 ||
 					(z == World.MaxZ && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(z != World.MaxZ && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + EXTCHUNK_SIZE]] & (1 << FACE_ZMAX)) != 0)) {
+					(z != World.MaxZ && (Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex + EXTCHUNK_SIZE]]] & (1 << FACE_ZMAX)) != 0)) {
 					Builder_Counts[index] = 0;
 				} else {
 					count = Builder_StretchX(index, x, y, z, cIndex, b, FACE_ZMAX);
@@ -214,7 +248,7 @@ static void Builder_Stretch(int x1, int y1, int z1) {
 
 				index++;
 				if (Builder_Counts[index] == 0 || y == 0 ||
-					(Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - EXTCHUNK_SIZE_2]] & (1 << FACE_YMIN)) != 0) {
+					(Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex - EXTCHUNK_SIZE_2]]] & (1 << FACE_YMIN)) != 0) {
 					Builder_Counts[index] = 0;
 				} else {
 					count = Builder_StretchX(index, x, y, z, cIndex, b, FACE_YMIN);
@@ -224,7 +258,7 @@ static void Builder_Stretch(int x1, int y1, int z1) {
 
 				index++;
 				if (Builder_Counts[index] == 0 ||
-					(Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + EXTCHUNK_SIZE_2]] & (1 << FACE_YMAX)) != 0) {
+					(Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex + EXTCHUNK_SIZE_2]]] & (1 << FACE_YMAX)) != 0) {
 					Builder_Counts[index] = 0;
 				} else if (b < BLOCK_WATER || b > BLOCK_STILL_LAVA) {
 					count = Builder_StretchX(index, x, y, z, cIndex, b, FACE_YMAX);
@@ -240,6 +274,60 @@ static void Builder_Stretch(int x1, int y1, int z1) {
 	}
 }
 
+#ifdef SPARSE_WORLD
+/* Copies the blocks in the given sub chunk that lie inside the chunk being read */
+static void Builder_ReadSubChunk(int cx, int cy, int cz, int x1, int y1, int z1) {
+	const struct SubChunk* c = &World.Chunks[World_PackChunk(cx, cy, cz)];
+	int xMin = max(cx << SUBCHUNK_SHIFT, x1 - 1), xMax = min(min(x1 + CHUNK_SIZE + 1, World.Width),  (cx + 1) << SUBCHUNK_SHIFT);
+	int yMin = max(cy << SUBCHUNK_SHIFT, y1 - 1), yMax = min(min(y1 + CHUNK_SIZE + 1, World.Height), (cy + 1) << SUBCHUNK_SHIFT);
+	int zMin = max(cz << SUBCHUNK_SHIFT, z1 - 1), zMax = min(min(z1 + CHUNK_SIZE + 1, World.Length), (cz + 1) << SUBCHUNK_SHIFT);
+	int x, y, z, cIndex;
+
+	for (y = yMin; y < yMax; y++) {
+		for (z = zMin; z < zMax; z++) {
+			cIndex = Builder_PackChunk(xMin - x1, y - y1, z - z1);
+
+			if (!c->Data) {
+				for (x = xMin; x < xMax; x++, cIndex++) { Builder_Chunk[cIndex] = c->Uniform; }
+			} else {
+				for (x = xMin; x < xMax; x++, cIndex++) { Builder_Chunk[cIndex] = SubChunk_Get(c, SubChunk_Pack(x, y, z)); }
+			}
+		}
+	}
+}
+
+static bool Builder_ReadChunk(int x1, int y1, int z1, bool* outAllAir) {
+	bool allAir = true, allSolid;
+	int cx, cy, cz, i;
+	BlockID block;
+
+	int minCx = max(x1 - 1, 0) >> SUBCHUNK_SHIFT, maxCx = min(x1 + CHUNK_SIZE, World.MaxX) >> SUBCHUNK_SHIFT;
+	int minCy = max(y1 - 1, 0) >> SUBCHUNK_SHIFT, maxCy = min(y1 + CHUNK_SIZE, World.MaxY) >> SUBCHUNK_SHIFT;
+	int minCz = max(z1 - 1, 0) >> SUBCHUNK_SHIFT, maxCz = min(z1 + CHUNK_SIZE, World.MaxZ) >> SUBCHUNK_SHIFT;
+	bool onBorder = 
+		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
+		y1 + CHUNK_SIZE >= World.Height || z1 + CHUNK_SIZE >= World.Length;
+
+	if (onBorder) Mem_Set(Builder_Chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
+	for (cy = minCy; cy <= maxCy; cy++) {
+		for (cz = minCz; cz <= maxCz; cz++) {
+			for (cx = minCx; cx <= maxCx; cx++) {
+				Builder_ReadSubChunk(cx, cy, cz, x1, y1, z1);
+			}
+		}
+	}
+
+	allSolid = !onBorder;
+	for (i = 0; i < EXTCHUNK_SIZE_3; i++) {
+		block    = Builder_Chunk[i];
+		allAir   = allAir   && Blocks.Draw[block] == DRAW_GAS;
+		allSolid = allSolid && Blocks.FullOpaque[block];
+	}
+
+	*outAllAir = allAir;
+	return allSolid;
+}
+#else
 #define ReadChunkBody(get_block)\
 for (yy = -1; yy < 17; ++yy) {\
 	y = yy + y1;\
@@ -323,35 +411,142 @@ static bool ReadBorderChunkData(int x1, int y1, int z1, bool* outAllAir) {
 	return false;
 }
 
-static bool Builder_BuildChunk(int x1, int y1, int z1, bool* allAir) {
-	BlockID chunk[EXTCHUNK_SIZE_3]; 
+static bool Builder_ReadChunk(int x1, int y1, int z1, bool* allAir) {
+	bool onBorder = 
+		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
+		y1 + CHUNK_SIZE >= World.Height || z1 + CHUNK_SIZE >= World.Length;
+
+	if (onBorder) {
+		/* less optimal case here */
+		Mem_Set(Builder_Chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
+		return ReadBorderChunkData(x1, y1, z1, allAir);
+	}
+	return ReadChunkData(x1, y1, z1, allAir);
+}
+#endif
+
+static void Builder_ReadHeights(int x1, int z1, int16_t* heights) {
+	int x, z, xx, zz;
+
+	for (zz = 0; zz < EXTCHUNK_SIZE; zz++) {
+		z = z1 + zz;
+		for (xx = 0; xx < EXTCHUNK_SIZE; xx++) {
+			x = x1 + xx;
+			*heights++ = World_ContainsXZ(x, z) ? Lighting_Heightmap[Lighting_Pack(x, z)] : -10;
+		}
+	}
+}
+
+#define Builder_VisitNeighbour(inside, face, offset)\
+if (inside) {\
+	if (!visited[i + (offset)]) { visited[i + (offset)] = true; stack[count++] = i + (offset); }\
+} else { faces |= 1 << face; }
+
+/* Calculates which pairs of faces of the chunk can see each other, */
+/* by flood filling through blocks that are not fully opaque. */
+static int Builder_ComputeOcclusion(void) {
+	bool visited[CHUNK_SIZE_3];
+	uint16_t stack[CHUNK_SIZE_3];
+	int start, i, count, faces, flags = 0;
+	int x, y, z, a, b;
+
+	for (i = 0; i < CHUNK_SIZE_3; i++) {
+		x = i & CHUNK_MASK; z = (i >> CHUNK_SHIFT) & CHUNK_MASK; y = i >> (CHUNK_SHIFT * 2);
+		visited[i] = Blocks.FullOpaque[Builder_Chunk[Builder_PackChunk(x, y, z)]];
+	}
+
+	for (start = 0; start < CHUNK_SIZE_3 && flags != OCCLUSION_ALL; start++) {
+		if (visited[start]) continue;
+		visited[start] = true;
+		stack[0] = start; count = 1; faces = 0;
+
+		while (count) {
+			i = stack[--count];
+			x = i & CHUNK_MASK; z = (i >> CHUNK_SHIFT) & CHUNK_MASK; y = i >> (CHUNK_SHIFT * 2);
+
+			Builder_VisitNeighbour(x > 0,         FACE_XMIN, -1);
+			Builder_VisitNeighbour(x < CHUNK_MAX, FACE_XMAX, +1);
+			Builder_VisitNeighbour(z > 0,         FACE_ZMIN, -CHUNK_SIZE);
+			Builder_VisitNeighbour(z < CHUNK_MAX, FACE_ZMAX, +CHUNK_SIZE);
+			Builder_VisitNeighbour(y > 0,         FACE_YMIN, -CHUNK_SIZE_2);
+			Builder_VisitNeighbour(y < CHUNK_MAX, FACE_YMAX, +CHUNK_SIZE_2);
+		}
+
+		for (a = 0; a < FACE_COUNT; a++) {
+			if (!(faces & (1 << a))) continue;
+			for (b = a + 1; b < FACE_COUNT; b++) {
+				if (faces & (1 << b)) flags |= Occlusion_Bit(a, b);
+			}
+		}
+	}
+	return flags;
+}
+
+#ifdef CC_BUILD_COMPACTCHUNKS
+/* Converts the chunk's vertices into compact vertices, in place. */
+/* NOTE: Safe since a compact vertex is smaller than a normal vertex, so is never written over an unread vertex. */
+static void Builder_PackVertices(struct BuilderJob* job, int count) {
+	VertexP3fT2fC4b* src = job->Vertices;
+	VertexP3sT2sC4b* dst = (VertexP3sT2sC4b*)job->Vertices;
+	VertexP3fT2fC4b v;
+	VertexP3sT2sC4b p;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		v = src[i];
+		p.X = (int16_t)Math_Floor((v.X - job->X) * COMPACT_POS_SCALE + 0.5f);
+		p.Y = (int16_t)Math_Floor((v.Y - job->Y) * COMPACT_POS_SCALE + 0.5f);
+		p.Z = (int16_t)Math_Floor((v.Z - job->Z) * COMPACT_POS_SCALE + 0.5f);
+		p.Padding = 0;
+		p.Col     = v.Col;
+
+		/* Round down so texture coords stay just inside the tile. (see UV2_Scale) */
+		p.U = (int16_t)Math_Floor(v.U * COMPACT_U_SCALE);
+		p.V = (int16_t)(Math_Floor(v.V * COMPACT_V_SCALE) - COMPACT_V_SCALE / 2);
+		/* Vertices overlap in memory, so avoid pointer aliasing issues */
+		Mem_Copy(&dst[i], &p, sizeof(p));
+	}
+}
+#endif
+
+/* Calculates the lighting colours for this thread, using the current environment colours. */
+static void Builder_CalcLightCols(void) {
+	int level;
+	for (level = 0; level < 16; level++) {
+		Builder_LightCols[0][level] = Lighting_LevelCol(Env.ShadowCol,   Env.SunCol,   level);
+		Builder_LightCols[1][level] = Lighting_LevelCol(Env.ShadowYMin,  Env.SunYMin,  level);
+		Builder_LightCols[2][level] = Lighting_LevelCol(Env.ShadowXSide, Env.SunXSide, level);
+		Builder_LightCols[3][level] = Lighting_LevelCol(Env.ShadowZSide, Env.SunZSide, level);
+	}
+}
+
+/* Builds the mesh for the chunk described by the given job. */
+/* NOTE: Can be called from any thread. */
+static void Builder_BuildChunk(struct BuilderJob* job) {
 	uint8_t counts[CHUNK_SIZE_3 * FACE_COUNT]; 
+	uint8_t rows[CHUNK_SIZE_3 * FACE_COUNT];
 	int bitFlags[EXTCHUNK_SIZE_3];
 
-	bool allSolid, onBorder;
+	int x1 = job->X, y1 = job->Y, z1 = job->Z;
 	int xMax, yMax, zMax;
 	int cIndex, index;
 	int x, y, z, xx, yy, zz;
 
-	Builder_Chunk  = chunk;
-	Builder_Counts = counts;
+	Builder_ApplyActive();
+	Builder_Chunk    = job->Chunk;
+	Builder_Counts   = counts;
+	Builder_Rows     = rows;
 	Builder_BitFlags = bitFlags;
+	Builder_Parts    = job->Parts;
+	Builder_Heights  = job->Heights;
+	Builder_HeightsX = x1 - 1; Builder_HeightsZ = z1 - 1;
+	Builder_Light    = job->HasLight ? job->Light : NULL;
+	Builder_LightY   = y1 - 1;
+	if (Builder_Light) Builder_CalcLightCols();
+
+	Builder_Vertices      = job->Vertices;
+	Builder_VerticesElems = job->VerticesElems;
 	Builder_PreStretchTiles(x1, y1, z1);
-	
-	onBorder = 
-		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
-		y1 + CHUNK_SIZE >= World.Height || z1 + CHUNK_SIZE >= World.Length;
-
-	if (onBorder) {
-		/* less optimal case here */
-		Mem_Set(chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
-		allSolid = ReadBorderChunkData(x1, y1, z1, allAir);
-	} else {
-		allSolid = ReadChunkData(x1, y1, z1, allAir);
-	}
-
-	if (*allAir || allSolid) return false;
-	Lighting_LightHint(x1 - 1, z1 - 1);
 
 	Mem_Set(counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
 	xMax = min(World.Width,  x1 + CHUNK_SIZE);
@@ -367,7 +562,7 @@ static bool Builder_BuildChunk(int x1, int y1, int z1, bool* allAir) {
 			cIndex = Builder_PackChunk(0, yy, zz);
 
 			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
-				Builder_Block = chunk[cIndex];
+				Builder_Block = Builder_Chunk[cIndex];
 				if (Blocks.Draw[Builder_Block] == DRAW_GAS) continue;
 
 				index = Builder_PackCount(xx, yy, zz);
@@ -377,25 +572,30 @@ static bool Builder_BuildChunk(int x1, int y1, int z1, bool* allAir) {
 			}
 		}
 	}
-	return true;
+
+	job->Vertices       = Builder_Vertices;
+	job->VerticesElems  = Builder_VerticesElems;
+	job->HasMesh        = Builder_TotalVerticesCount() > 0;
+	job->OcclusionFlags = Builder_ComputeOcclusion();
+#ifdef CC_BUILD_COMPACTCHUNKS
+	Builder_PackVertices(job, Builder_TotalVerticesCount());
+#endif
 }
 
-void Builder_MakeChunk(struct ChunkInfo* info) {
-	int x = info->CentreX - 8, y = info->CentreY - 8, z = info->CentreZ - 8;
-	bool allAir, hasMesh, hasNorm, hasTran;
+static void Builder_UploadChunk(struct BuilderJob* job) {
+	struct ChunkInfo* info = job->Info;
+	int x = job->X, y = job->Y, z = job->Z;
+	bool hasNorm, hasTran;
 	int totalVerts, partsIndex;
 	int i, j, curIdx, offset;
 
-	allAir  = false;
-	hasMesh = Builder_BuildChunk(x, y, z, &allAir);
-	info->AllAir = allAir;
-	if (!hasMesh) return;
-
-	totalVerts = Builder_TotalVerticesCount();
-	if (!totalVerts) return;
-#ifndef CC_BUILD_GL11
+	Builder_Parts = job->Parts;
+	totalVerts    = Builder_TotalVerticesCount();
 	/* add an extra element to fix crashing on some GPUs */
-	info->Vb = Gfx_CreateVb(Builder_Vertices, VERTEX_FORMAT_P3FT2FC4B, totalVerts + 1);
+#if defined CC_BUILD_COMPACTCHUNKS
+	info->Vb = Gfx_CreateVb(job->Vertices, VERTEX_FORMAT_P3ST2SC4B, totalVerts + 1);
+#elif !defined CC_BUILD_GL11
+	info->Vb = Gfx_CreateVb(job->Vertices, VERTEX_FORMAT_P3FT2FC4B, totalVerts + 1);
 #endif
 
 	partsIndex = MapRenderer_Pack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
@@ -407,8 +607,8 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 		j = i + ATLAS1D_MAX_ATLASES;
 		curIdx = partsIndex + i * MapRenderer_ChunksCount;
 
-		Builder_SetPartInfo(&Builder_Parts[i], &offset, &MapRenderer_PartsNormal[curIdx],      &hasNorm);
-		Builder_SetPartInfo(&Builder_Parts[j], &offset, &MapRenderer_PartsTranslucent[curIdx], &hasTran);
+		Builder_SetPartInfo(&job->Parts[i], job->Vertices, &offset, &MapRenderer_PartsNormal[curIdx],      &hasNorm);
+		Builder_SetPartInfo(&job->Parts[j], job->Vertices, &offset, &MapRenderer_PartsTranslucent[curIdx], &hasTran);
 	}
 
 	if (hasNorm) {
@@ -417,11 +617,6 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 	if (hasTran) {
 		info->TranslucentParts = &MapRenderer_PartsTranslucent[partsIndex];
 	}
-
-#ifdef OCCLUSION
-	if (info.NormalParts != null || info.TranslucentParts != null)
-		info.occlusionFlags = (uint8_t)ComputeOcclusion();
-#endif
 }
 
 static bool Builder_OccludedLiquid(int chunkIndex) {
@@ -435,7 +630,7 @@ static bool Builder_OccludedLiquid(int chunkIndex) {
 }
 
 static void Builder_DefaultPreStretchTiles(int x1, int y1, int z1) {
-	Mem_Set(Builder_Parts, 0, sizeof(Builder_Parts));
+	Mem_Set(Builder_Parts, 0, BUILDER_PARTS_COUNT * sizeof(struct Builder1DPart));
 }
 
 static void Builder_DefaultPostStretchTiles(int x1, int y1, int z1) {
@@ -456,7 +651,7 @@ static void Builder_DefaultPostStretchTiles(int x1, int y1, int z1) {
 	}
 }
 
-static RNGState spriteRng;
+static CC_THREADLOCAL RNGState spriteRng;
 static void Builder_DrawSprite(int count) {
 	struct Builder1DPart* part;
 	VertexP3fT2fC4b v;
@@ -494,7 +689,7 @@ static void Builder_DrawSprite(int count) {
 	}
 	
 	part  = &Builder_Parts[Atlas1D_Index(loc)];
-	v.Col = Builder_FullBright ? white : Lighting_Col_Sprite_Fast(Builder_X, Builder_Y, Builder_Z);
+	v.Col = Builder_FullBright ? white : Builder_Col_Sprite(Builder_X, Builder_Y, Builder_Z);
 	Block_Tint(v.Col, Builder_Block);
 
 	/* Draw Z axis */
@@ -532,23 +727,148 @@ static void Builder_DrawSprite(int count) {
 /*########################################################################################################################*
 *--------------------------------------------------Normal mesh builder----------------------------------------------------*
 *#########################################################################################################################*/
+/* NOTE: The global Drawer state is also used by the main thread, so the normal builder uses its own copy. */
+static CC_THREADLOCAL struct _DrawerData norm_drawer;
+
+/* Performance critical, use macro to ensure always inlined. */
+#define Normal_ApplyTint \
+if (norm_drawer.Tinted) {\
+col.R = (uint8_t)(col.R * norm_drawer.TintCol.R / 255);\
+col.G = (uint8_t)(col.G * norm_drawer.TintCol.G / 255);\
+col.B = (uint8_t)(col.B * norm_drawer.TintCol.B / 255);\
+}
+
+static void Normal_DrawXMin(int count, int rows, PackedCol col, TextureLoc texLoc, VertexP3fT2fC4b** vertices) {
+	VertexP3fT2fC4b* ptr = *vertices; VertexP3fT2fC4b v;
+	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+
+	float u1 = norm_drawer.MinBB.Z;
+	float u2 = (count - 1) + norm_drawer.MaxBB.Z * UV2_Scale;
+	float v1 = vOrigin + norm_drawer.MaxBB.Y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + norm_drawer.MinBB.Y * Atlas1D.InvTileSize * UV2_Scale;
+
+	Normal_ApplyTint;
+	v.X = norm_drawer.X1; v.Col = col;
+
+	v.Y = norm_drawer.Y2 + (rows - 1); v.Z = norm_drawer.Z2 + (count - 1); v.U = u2; v.V = v1; *ptr++ = v;
+	v.Z = norm_drawer.Z1;							    v.U = u1;           *ptr++ = v;
+	v.Y = norm_drawer.Y1;										  v.V = v2; *ptr++ = v;
+	v.Z = norm_drawer.Z2 + (count - 1);                  v.U = u2;           *ptr++ = v;
+	*vertices = ptr;
+}
+
+static void Normal_DrawXMax(int count, int rows, PackedCol col, TextureLoc texLoc, VertexP3fT2fC4b** vertices) {
+	VertexP3fT2fC4b* ptr = *vertices; VertexP3fT2fC4b v;
+	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+
+	float u1 = (count - norm_drawer.MinBB.Z);
+	float u2 = (1 - norm_drawer.MaxBB.Z) * UV2_Scale;
+	float v1 = vOrigin + norm_drawer.MaxBB.Y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + norm_drawer.MinBB.Y * Atlas1D.InvTileSize * UV2_Scale;
+
+	Normal_ApplyTint;
+	v.X = norm_drawer.X2; v.Col = col;
+
+	v.Y = norm_drawer.Y2 + (rows - 1); v.Z = norm_drawer.Z1; v.U = u1; v.V = v1; *ptr++ = v;
+	v.Z = norm_drawer.Z2 + (count - 1);    v.U = u2;           *ptr++ = v;
+	v.Y = norm_drawer.Y1;                            v.V = v2; *ptr++ = v;
+	v.Z = norm_drawer.Z1;                  v.U = u1;           *ptr++ = v;
+	*vertices = ptr;
+}
+
+static void Normal_DrawZMin(int count, int rows, PackedCol col, TextureLoc texLoc, VertexP3fT2fC4b** vertices) {
+	VertexP3fT2fC4b* ptr = *vertices; VertexP3fT2fC4b v;
+	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+
+	float u1 = (count - norm_drawer.MinBB.X);
+	float u2 = (1 - norm_drawer.MaxBB.X) * UV2_Scale;
+	float v1 = vOrigin + norm_drawer.MaxBB.Y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + norm_drawer.MinBB.Y * Atlas1D.InvTileSize * UV2_Scale;
+
+	Normal_ApplyTint;
+	v.Z = norm_drawer.Z1; v.Col = col;
+
+	v.X = norm_drawer.X2 + (count - 1); v.Y = norm_drawer.Y1; v.U = u2; v.V = v2; *ptr++ = v;
+	v.X = norm_drawer.X1;                                v.U = u1;           *ptr++ = v;
+	v.Y = norm_drawer.Y2 + (rows - 1);                                          v.V = v1; *ptr++ = v;
+	v.X = norm_drawer.X2 + (count - 1);                  v.U = u2;           *ptr++ = v;
+	*vertices = ptr;
+}
+
+static void Normal_DrawZMax(int count, int rows, PackedCol col, TextureLoc texLoc, VertexP3fT2fC4b** vertices) {
+	VertexP3fT2fC4b* ptr = *vertices; VertexP3fT2fC4b v;
+	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+
+	float u1 = norm_drawer.MinBB.X;
+	float u2 = (count - 1) + norm_drawer.MaxBB.X * UV2_Scale;
+	float v1 = vOrigin + norm_drawer.MaxBB.Y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + norm_drawer.MinBB.Y * Atlas1D.InvTileSize * UV2_Scale;
+
+	Normal_ApplyTint;
+	v.Z = norm_drawer.Z2; v.Col = col;
+
+	v.X = norm_drawer.X2 + (count - 1); v.Y = norm_drawer.Y2 + (rows - 1); v.U = u2; v.V = v1; *ptr++ = v;
+	v.X = norm_drawer.X1;                                v.U = u1;           *ptr++ = v;
+	v.Y = norm_drawer.Y1;                                          v.V = v2; *ptr++ = v;
+	v.X = norm_drawer.X2 + (count - 1);                  v.U = u2;           *ptr++ = v;
+	*vertices = ptr;
+}
+
+static void Normal_DrawYMin(int count, int rows, PackedCol col, TextureLoc texLoc, VertexP3fT2fC4b** vertices) {
+	VertexP3fT2fC4b* ptr = *vertices; VertexP3fT2fC4b v;
+
+	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float u1 = norm_drawer.MinBB.X;
+	float u2 = (count - 1) + norm_drawer.MaxBB.X * UV2_Scale;
+	float v1 = vOrigin + norm_drawer.MinBB.Z * Atlas1D.InvTileSize;
+	float v2 = vOrigin + norm_drawer.MaxBB.Z * Atlas1D.InvTileSize * UV2_Scale;
+
+	Normal_ApplyTint;
+	v.Y = norm_drawer.Y1; v.Col = col;
+
+	v.X = norm_drawer.X2 + (count - 1); v.Z = norm_drawer.Z2 + (rows - 1); v.U = u2; v.V = v2; *ptr++ = v;
+	v.X = norm_drawer.X1;                                v.U = u1;           *ptr++ = v;
+	v.Z = norm_drawer.Z1;                                          v.V = v1; *ptr++ = v;
+	v.X = norm_drawer.X2 + (count - 1);                  v.U = u2;           *ptr++ = v;
+	*vertices = ptr;
+}
+
+static void Normal_DrawYMax(int count, int rows, PackedCol col, TextureLoc texLoc, VertexP3fT2fC4b** vertices) {
+	VertexP3fT2fC4b* ptr = *vertices; VertexP3fT2fC4b v;
+	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+
+	float u1 = norm_drawer.MinBB.X;
+	float u2 = (count - 1) + norm_drawer.MaxBB.X * UV2_Scale;
+	float v1 = vOrigin + norm_drawer.MinBB.Z * Atlas1D.InvTileSize;
+	float v2 = vOrigin + norm_drawer.MaxBB.Z * Atlas1D.InvTileSize * UV2_Scale;
+
+	Normal_ApplyTint;
+	v.Y = norm_drawer.Y2; v.Col = col;
+
+	v.X = norm_drawer.X2 + (count - 1); v.Z = norm_drawer.Z1; v.U = u2; v.V = v1; *ptr++ = v;
+	v.X = norm_drawer.X1;                                v.U = u1;           *ptr++ = v;
+	v.Z = norm_drawer.Z2 + (rows - 1);                                          v.V = v2; *ptr++ = v;
+	v.X = norm_drawer.X2 + (count - 1);                  v.U = u2;           *ptr++ = v;
+	*vertices = ptr;
+}
+
 static PackedCol Normal_LightCol(int x, int y, int z, Face face, BlockID block) {
 	PackedCol invalid = PACKEDCOL_CONST(0, 0, 0, 0);
 	int offset = (Blocks.LightOffset[block] >> face) & 1;
 
 	switch (face) {
 	case FACE_XMIN:
-		return x < offset                ? Env.SunXSide : Lighting_Col_XSide_Fast(x - offset, y, z);
+		return x < offset                ? Env.SunXSide : Builder_Col_XSide(x - offset, y, z);
 	case FACE_XMAX:
-		return x > (World.MaxX - offset) ? Env.SunXSide : Lighting_Col_XSide_Fast(x + offset, y, z);
+		return x > (World.MaxX - offset) ? Env.SunXSide : Builder_Col_XSide(x + offset, y, z);
 	case FACE_ZMIN:
-		return z < offset                ? Env.SunZSide : Lighting_Col_ZSide_Fast(x, y, z - offset);
+		return z < offset                ? Env.SunZSide : Builder_Col_ZSide(x, y, z - offset);
 	case FACE_ZMAX:
-		return z > (World.MaxZ - offset) ? Env.SunZSide : Lighting_Col_ZSide_Fast(x, y, z + offset);
+		return z > (World.MaxZ - offset) ? Env.SunZSide : Builder_Col_ZSide(x, y, z + offset);
 	case FACE_YMIN:
-		return y <= 0                    ? Env.SunYMin  : Lighting_Col_YMin_Fast(x, y - offset, z);
+		return y <= 0                    ? Env.SunYMin  : Builder_Col_YMin(x, y - offset, z);
 	case FACE_YMAX:
-		return y >= World.MaxY           ? Env.SunCol   : Lighting_Col_YMax_Fast(x, (y + 1) - offset, z);
+		return y >= World.MaxY           ? Env.SunCol   : Builder_Col_YMax(x, (y + 1) - offset, z);
 	}
 	return invalid; /* should never happen */
 }
@@ -659,15 +979,15 @@ static void NormalBuilder_RenderBlock(int index) {
 	baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
 	lightFlags = Blocks.LightOffset[Builder_Block];
 
-	Drawer.MinBB = Blocks.MinBB[Builder_Block]; Drawer.MinBB.Y = 1.0f - Drawer.MinBB.Y;
-	Drawer.MaxBB = Blocks.MaxBB[Builder_Block]; Drawer.MaxBB.Y = 1.0f - Drawer.MaxBB.Y;
+	norm_drawer.MinBB = Blocks.MinBB[Builder_Block]; norm_drawer.MinBB.Y = 1.0f - norm_drawer.MinBB.Y;
+	norm_drawer.MaxBB = Blocks.MaxBB[Builder_Block]; norm_drawer.MaxBB.Y = 1.0f - norm_drawer.MaxBB.Y;
 
 	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
-	Drawer.X1 = Builder_X + min.X; Drawer.Y1 = Builder_Y + min.Y; Drawer.Z1 = Builder_Z + min.Z;
-	Drawer.X2 = Builder_X + max.X; Drawer.Y2 = Builder_Y + max.Y; Drawer.Z2 = Builder_Z + max.Z;
+	norm_drawer.X1 = Builder_X + min.X; norm_drawer.Y1 = Builder_Y + min.Y; norm_drawer.Z1 = Builder_Z + min.Z;
+	norm_drawer.X2 = Builder_X + max.X; norm_drawer.Y2 = Builder_Y + max.Y; norm_drawer.Z2 = Builder_Z + max.Z;
 
-	Drawer.Tinted  = Blocks.Tinted[Builder_Block];
-	Drawer.TintCol = Blocks.FogCol[Builder_Block];
+	norm_drawer.Tinted  = Blocks.Tinted[Builder_Block];
+	norm_drawer.TintCol = Blocks.FogCol[Builder_Block];
 
 	if (count_XMin) {
 		loc    = Block_Tex(Builder_Block, FACE_XMIN);
@@ -675,8 +995,8 @@ static void NormalBuilder_RenderBlock(int index) {
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? white :
-			Builder_X >= offset ? Lighting_Col_XSide_Fast(Builder_X - offset, Builder_Y, Builder_Z) : Env.SunXSide;
-		Drawer_XMin(count_XMin, col, loc, &part->fVertices[FACE_XMIN]);
+			Builder_X >= offset ? Builder_Col_XSide(Builder_X - offset, Builder_Y, Builder_Z) : Env.SunXSide;
+		Normal_DrawXMin(count_XMin, Builder_Rows[index + FACE_XMIN], col, loc, &part->fVertices[FACE_XMIN]);
 	}
 
 	if (count_XMax) {
@@ -685,8 +1005,8 @@ static void NormalBuilder_RenderBlock(int index) {
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? white :
-			Builder_X <= (World.MaxX - offset) ? Lighting_Col_XSide_Fast(Builder_X + offset, Builder_Y, Builder_Z) : Env.SunXSide;
-		Drawer_XMax(count_XMax, col, loc, &part->fVertices[FACE_XMAX]);
+			Builder_X <= (World.MaxX - offset) ? Builder_Col_XSide(Builder_X + offset, Builder_Y, Builder_Z) : Env.SunXSide;
+		Normal_DrawXMax(count_XMax, Builder_Rows[index + FACE_XMAX], col, loc, &part->fVertices[FACE_XMAX]);
 	}
 
 	if (count_ZMin) {
@@ -695,8 +1015,8 @@ static void NormalBuilder_RenderBlock(int index) {
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? white :
-			Builder_Z >= offset ? Lighting_Col_ZSide_Fast(Builder_X, Builder_Y, Builder_Z - offset) : Env.SunZSide;
-		Drawer_ZMin(count_ZMin, col, loc, &part->fVertices[FACE_ZMIN]);
+			Builder_Z >= offset ? Builder_Col_ZSide(Builder_X, Builder_Y, Builder_Z - offset) : Env.SunZSide;
+		Normal_DrawZMin(count_ZMin, Builder_Rows[index + FACE_ZMIN], col, loc, &part->fVertices[FACE_ZMIN]);
 	}
 
 	if (count_ZMax) {
@@ -705,8 +1025,8 @@ static void NormalBuilder_RenderBlock(int index) {
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? white :
-			Builder_Z <= (World.MaxZ - offset) ? Lighting_Col_ZSide_Fast(Builder_X, Builder_Y, Builder_Z + offset) : Env.SunZSide;
-		Drawer_ZMax(count_ZMax, col, loc, &part->fVertices[FACE_ZMAX]);
+			Builder_Z <= (World.MaxZ - offset) ? Builder_Col_ZSide(Builder_X, Builder_Y, Builder_Z + offset) : Env.SunZSide;
+		Normal_DrawZMax(count_ZMax, Builder_Rows[index + FACE_ZMAX], col, loc, &part->fVertices[FACE_ZMAX]);
 	}
 
 	if (count_YMin) {
@@ -714,8 +1034,8 @@ static void NormalBuilder_RenderBlock(int index) {
 		offset = (lightFlags >> FACE_YMIN) & 1;
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
-		col = fullBright ? white : Lighting_Col_YMin_Fast(Builder_X, Builder_Y - offset, Builder_Z);
-		Drawer_YMin(count_YMin, col, loc, &part->fVertices[FACE_YMIN]);
+		col = fullBright ? white : Builder_Col_YMin(Builder_X, Builder_Y - offset, Builder_Z);
+		Normal_DrawYMin(count_YMin, Builder_Rows[index + FACE_YMIN], col, loc, &part->fVertices[FACE_YMIN]);
 	}
 
 	if (count_YMax) {
@@ -723,11 +1043,86 @@ static void NormalBuilder_RenderBlock(int index) {
 		offset = (lightFlags >> FACE_YMAX) & 1;
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
-		col = fullBright ? white : Lighting_Col_YMax_Fast(Builder_X, (Builder_Y + 1) - offset, Builder_Z);
-		Drawer_YMax(count_YMax, col, loc, &part->fVertices[FACE_YMAX]);
+		col = fullBright ? white : Builder_Col_YMax(Builder_X, (Builder_Y + 1) - offset, Builder_Z);
+		Normal_DrawYMax(count_YMax, Builder_Rows[index + FACE_YMAX], col, loc, &part->fVertices[FACE_YMAX]);
 	}
 }
 
+static void NormalBuilder_PreStretchTiles(int x1, int y1, int z1) {
+	Builder_DefaultPreStretchTiles(x1, y1, z1);
+	Mem_Set(Builder_Rows, 1, CHUNK_SIZE_3 * FACE_COUNT);
+}
+
+/* Merges stretched faces with identical stretched faces in following rows along the V axis. */
+/* Only possible when the face's tile has the same pixels in every row, since V cannot repeat in a 1D atlas. */
+static void GreedyBuilder_MergeRows(int x1, int y1, int z1, Face face) {
+	int xMax = Builder_ChunkEndX, yMax = min(World.Height, y1 + CHUNK_SIZE), zMax = Builder_ChunkEndZ;
+	/* side faces are merged along Y axis, top and bottom faces are merged along Z axis */
+	bool alongY   = face < FACE_YMIN;
+	int countStep = alongY ? CHUNK_SIZE_2 * FACE_COUNT : CHUNK_SIZE * FACE_COUNT;
+	int chunkStep = alongY ? EXTCHUNK_SIZE_2 : EXTCHUNK_SIZE;
+
+	struct Builder1DPart* part;
+	PackedColUnion col, curCol;
+	int cIndex, index, count, rows;
+	int curIndex, curCIndex, v, vMax;
+	int x, y, z, xx, yy, zz;
+	BlockID b;
+
+	for (y = y1, yy = 0; y < yMax; y++, yy++) {
+		for (z = z1, zz = 0; z < zMax; z++, zz++) {
+			cIndex = Builder_PackChunk(0, yy, zz);
+
+			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
+				index = Builder_PackCount(xx, yy, zz) + face;
+				count = Builder_Counts[index];
+				if (!count) continue;
+
+				b = Builder_Chunk[cIndex];
+				if (Blocks.Draw[b] == DRAW_GAS || Blocks.Draw[b] == DRAW_SPRITE) continue;
+				if (!Atlas1D.SameRows[Block_Tex(b, face)]) continue;
+
+				if (alongY) {
+					if (Blocks.MinBB[b].Y != 0.0f || Blocks.MaxBB[b].Y != 1.0f) continue;
+					v = y; vMax = yMax;
+				} else {
+					if (Blocks.MinBB[b].Z != 0.0f || Blocks.MaxBB[b].Z != 1.0f) continue;
+					v = z; vMax = zMax;
+				}
+
+				col.C     = Normal_LightCol(x, y, z, face, b);
+				curIndex  = index  + countStep;
+				curCIndex = cIndex + chunkStep;
+
+				for (rows = 1, v++; v < vMax; rows++, v++) {
+					if (Builder_Counts[curIndex] != count || Builder_Chunk[curCIndex] != b) break;
+
+					if (!Blocks.FullBright[b]) {
+						curCol.C = alongY ? Normal_LightCol(x, v, z, face, b) : Normal_LightCol(x, y, v, face, b);
+						if (curCol.Raw != col.Raw) break;
+					}
+					Builder_Counts[curIndex] = 0;
+					curIndex  += countStep;
+					curCIndex += chunkStep;
+				}
+				if (rows == 1) continue;
+
+				Builder_Rows[index] = rows;
+				part = &Builder_Parts[(Blocks.Draw[b] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES + Atlas1D_Index(Block_Tex(b, face))];
+				part->fCount[face] -= 4 * (rows - 1);
+			}
+		}
+	}
+}
+
+static void GreedyBuilder_PostStretchTiles(int x1, int y1, int z1) {
+	Face face;
+	for (face = 0; face < FACE_COUNT; face++) {
+		GreedyBuilder_MergeRows(x1, y1, z1, face);
+	}
+	Builder_DefaultPostStretchTiles(x1, y1, z1);
+}
+
 static void Builder_SetDefault(void) {
 	Builder_StretchXLiquid = NULL;
 	Builder_StretchX       = NULL;
@@ -745,17 +1140,23 @@ void NormalBuilder_SetActive(void) {
 	Builder_StretchX       = NormalBuilder_StretchX;
 	Builder_StretchZ       = NormalBuilder_StretchZ;
 	Builder_RenderBlock    = NormalBuilder_RenderBlock;
+	Builder_PreStretchTiles = NormalBuilder_PreStretchTiles;
+}
+
+void GreedyBuilder_SetActive(void) {
+	NormalBuilder_SetActive();
+	Builder_PostStretchTiles = GreedyBuilder_PostStretchTiles;
 }
 
 
 /*########################################################################################################################*
 *-------------------------------------------------Advanced mesh builder---------------------------------------------------*
 *#########################################################################################################################*/
-static Vector3 adv_minBB, adv_maxBB;
-static int adv_initBitFlags, adv_lightFlags, adv_baseOffset;
-static int* adv_bitFlags;
-static float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
-static PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
+static CC_THREADLOCAL Vector3 adv_minBB, adv_maxBB;
+static CC_THREADLOCAL int adv_initBitFlags, adv_lightFlags, adv_baseOffset;
+static CC_THREADLOCAL int* adv_bitFlags;
+static CC_THREADLOCAL float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
+static CC_THREADLOCAL PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
 
 enum ADV_MASK {
 	/* z-1 cube points */
@@ -784,7 +1185,7 @@ static int Adv_Lit(int x, int y, int z, int cIndex) {
 
 	flags = 0;
 	block = Builder_Chunk[cIndex];
-	lightHeight    = Lighting_Heightmap[Lighting_Pack(x, z)];
+	lightHeight    = Builder_LightHeight(x, z);
 	adv_lightFlags = Blocks.LightOffset[block];
 
 	/* Use fact Light(Y.YMin) == Light((Y-1).YMax) */
@@ -1238,13 +1639,234 @@ void AdvBuilder_SetActive(void) {
 }
 
 
+/*########################################################################################################################*
+*-----------------------------------------------------Builder workers-----------------------------------------------------*
+*#########################################################################################################################*/
+#define BUILDER_MAX_JOBS 32
+/* Simple FIFO queue of jobs. */
+struct BuilderQueue { struct BuilderJob* Jobs[BUILDER_MAX_JOBS]; int Head, Count; };
+
+static struct BuilderJob* builder_jobs;
+/* Jobs that are not in use, jobs waiting to be built, and jobs that have been built and need to be uploaded. */
+static struct BuilderQueue builder_free, builder_pending, builder_done;
+static void* builder_threads[BUILDER_MAX_WORKERS];
+static void* builder_mutex;
+static void* builder_waitable;
+/* Signalled by worker threads when the last job being built has finished. */
+static void* builder_idle;
+/* Number of jobs currently being built by worker threads. */
+static volatile int builder_busy;
+static volatile bool builder_terminate;
+
+static void BuilderQueue_Push(struct BuilderQueue* queue, struct BuilderJob* job) {
+	queue->Jobs[(queue->Head + queue->Count) % BUILDER_MAX_JOBS] = job;
+	queue->Count++;
+}
+
+static struct BuilderJob* BuilderQueue_Pop(struct BuilderQueue* queue) {
+	struct BuilderJob* job;
+	if (!queue->Count) return NULL;
+
+	job = queue->Jobs[queue->Head];
+	queue->Head = (queue->Head + 1) % BUILDER_MAX_JOBS;
+	queue->Count--;
+	return job;
+}
+
+/* Moves all jobs in the given queue back into the free queue, discarding them. */
+static void BuilderQueue_Discard(struct BuilderQueue* queue) {
+	struct BuilderJob* job;
+	while ((job = BuilderQueue_Pop(queue))) {
+		job->Info->Building = false;
+		BuilderQueue_Push(&builder_free, job);
+	}
+}
+
+static void Builder_CompleteJob(struct BuilderJob* job) {
+	Mutex_Lock(builder_mutex);
+	{
+		BuilderQueue_Push(&builder_done, job);
+	}
+	Mutex_Unlock(builder_mutex);
+}
+
+static void Builder_WorkerLoop(void) {
+	struct BuilderJob* job;
+	bool stop, idle;
+
+	for (;;) {
+		Mutex_Lock(builder_mutex);
+		{
+			stop = builder_terminate;
+			job  = stop ? NULL : BuilderQueue_Pop(&builder_pending);
+			if (job) builder_busy++;
+		}
+		Mutex_Unlock(builder_mutex);
+
+		if (stop) return;
+		/* Block until main thread queues another chunk to build */
+		/* NOTE: Times out, as the signal might have been raised right before this thread started waiting */
+		if (!job) { Waitable_WaitFor(builder_waitable, 100); continue; }
+		Builder_BuildChunk(job);
+
+		Mutex_Lock(builder_mutex);
+		{
+			BuilderQueue_Push(&builder_done, job);
+			builder_busy--;
+			idle = builder_busy == 0;
+		}
+		Mutex_Unlock(builder_mutex);
+		if (idle) Waitable_Signal(builder_idle);
+	}
+}
+
+bool Builder_StartChunk(struct ChunkInfo* info) {
+	int x = info->CentreX - 8, y = info->CentreY - 8, z = info->CentreZ - 8;
+	struct BuilderJob* job;
+	bool allAir, allSolid;
+
+	Mutex_Lock(builder_mutex);
+	{
+		job = BuilderQueue_Pop(&builder_free);
+	}
+	Mutex_Unlock(builder_mutex);
+	if (!job) return false;
+	/* Block definitions only mark culling as changed, so a burst of them is recalculated just once */
+	Block_UpdatePendingCulling();
+
+	job->Info = info;
+	job->X = x; job->Y = y; job->Z = z;
+	job->HasMesh  = false;
+	info->Building = true;
+
+	Builder_Chunk = job->Chunk;
+	allSolid    = Builder_ReadChunk(x, y, z, &allAir);
+	job->AllAir = allAir;
+	if (allAir || allSolid) {
+		job->OcclusionFlags = allAir ? OCCLUSION_ALL : 0;
+		Builder_CompleteJob(job); return true;
+	}
+
+	/* Lighting heightmap is lazily calculated, so must be calculated here on the main thread */
+	Lighting_LightHint(x - 1, z - 1);
+	Builder_ReadHeights(x - 1, z - 1, job->Heights);
+	job->HasLight = Lighting_Flood;
+	if (Lighting_Flood) Lighting_ReadLevels(x - 1, y - 1, z - 1, job->Light);
+
+	if (!Builder_WorkersCount) {
+		Builder_BuildChunk(job);
+		Builder_CompleteJob(job);
+		return true;
+	}
+
+	Mutex_Lock(builder_mutex);
+	{
+		BuilderQueue_Push(&builder_pending, job);
+	}
+	Mutex_Unlock(builder_mutex);
+	Waitable_Signal(builder_waitable);
+	return true;
+}
+
+struct ChunkInfo* Builder_FinishChunk(void) {
+	struct ChunkInfo* info;
+	struct BuilderJob* job;
+	bool pending;
+
+	Mutex_Lock(builder_mutex);
+	{
+		job     = BuilderQueue_Pop(&builder_done);
+		pending = builder_pending.Count > 0;
+	}
+	Mutex_Unlock(builder_mutex);
+
+	if (pending) Waitable_Signal(builder_waitable);
+	if (!job) return NULL;
+
+	info = job->Info;
+	MapRenderer_DeleteChunk(info);
+	info->Building = false;
+	/* A block may have been placed in the chunk while the mesh was being built */
+	info->AllAir   = job->AllAir && !info->PendingDelete;
+	info->OcclusionFlags = job->OcclusionFlags;
+	if (job->HasMesh) Builder_UploadChunk(job);
+
+	Mutex_Lock(builder_mutex);
+	{
+		BuilderQueue_Push(&builder_free, job);
+	}
+	Mutex_Unlock(builder_mutex);
+	return info;
+}
+
+void Builder_CancelChunks(void) {
+	int busy;
+	Mutex_Lock(builder_mutex);
+	{
+		BuilderQueue_Discard(&builder_pending);
+	}
+	Mutex_Unlock(builder_mutex);
+
+	/* Chunks currently being built can't be cancelled, so wait for them to finish */
+	for (;;) {
+		Mutex_Lock(builder_mutex);
+		{
+			busy = builder_busy;
+			if (!busy) BuilderQueue_Discard(&builder_done);
+		}
+		Mutex_Unlock(builder_mutex);
+
+		if (!busy) return;
+		/* NOTE: Signal may be left over from an earlier job, so busy needs to be checked again */
+		Waitable_Wait(builder_idle);
+	}
+}
+
+static void Builder_InitWorkers(void) {
+	int i;
+	builder_jobs     = Mem_AllocCleared(BUILDER_MAX_JOBS, sizeof(struct BuilderJob), "chunk builder jobs");
+	builder_mutex    = Mutex_Create();
+	builder_waitable = Waitable_Create();
+	builder_idle     = Waitable_Create();
+
+	for (i = 0; i < BUILDER_MAX_JOBS; i++) {
+		BuilderQueue_Push(&builder_free, &builder_jobs[i]);
+	}
+	for (i = 0; i < Builder_WorkersCount; i++) {
+		builder_threads[i] = Thread_Start(Builder_WorkerLoop, false);
+	}
+}
+
+void Builder_Free(void) {
+	int i;
+	builder_terminate = true;
+
+	for (i = 0; i < Builder_WorkersCount; i++) {
+		Waitable_Signal(builder_waitable);
+		Thread_Join(builder_threads[i]);
+	}
+	for (i = 0; i < BUILDER_MAX_JOBS; i++) {
+		Mem_Free(builder_jobs[i].Vertices);
+	}
+
+	Mem_Free(builder_jobs);
+	Mutex_Free(builder_mutex);
+	Waitable_Free(builder_waitable);
+	Waitable_Free(builder_idle);
+	builder_jobs = NULL;
+}
+
+
 /*########################################################################################################################*
 *---------------------------------------------------Builder interface-----------------------------------------------------*
 *#########################################################################################################################*/
-bool Builder_SmoothLighting;
+bool Builder_SmoothLighting, Builder_GreedyMeshing;
 void Builder_ApplyActive(void) {
-	if (Builder_SmoothLighting) {
+	/* Advanced lighting only understands the heightmap, so flood lighting takes priority */
+	if (Builder_SmoothLighting && !Lighting_Flood) {
 		AdvBuilder_SetActive();
+	} else if (Builder_GreedyMeshing) {
+		GreedyBuilder_SetActive();
 	} else {
 		NormalBuilder_SetActive();
 	}
@@ -1259,6 +1881,9 @@ void Builder_Init(void) {
 	Builder_Offsets[FACE_YMAX] =  EXTCHUNK_SIZE_2;
 
 	Builder_SmoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
+	Builder_GreedyMeshing  = Options_GetBool(OPT_GREEDY_MESHING, false);
+	Builder_WorkersCount   = Options_GetInt(OPT_CHUNK_WORKERS, 0, BUILDER_MAX_WORKERS, 2);
+	Builder_InitWorkers();
 }
 
 void Builder_OnNewMapLoaded(void) {
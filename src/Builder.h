@@ -5,6 +5,8 @@
 NormalMeshBuilder:
    Implements a simple chunk mesh builder, where each block face is a single colour.
    (whatever lighting engine returns as light colour for given block face at given coordinates)
+GreedyMeshBuilder:
+   Normal mesh builder, which also merges identical rows of stretched faces into rectangles.
 
 Copyright 2014-2017 ClassicalSharp | Licensed under BSD-3
 */
@@ -13,13 +15,31 @@ struct ChunkInfo;
 extern int Builder_SidesLevel, Builder_EdgeLevel;
 /* Whether smooth/advanced lighting mesh builder is used. */
 extern bool Builder_SmoothLighting;
+/* Whether the normal mesh builder also merges faces along both axes of a plane, instead of only one. */
+/* NOTE: Only applies to faces whose tile has the same pixels in every row. Ignored with smooth lighting. */
+extern bool Builder_GreedyMeshing;
+/* Maximum number of worker threads that can build chunk meshes. */
+#define BUILDER_MAX_WORKERS 8
+/* Number of worker threads building chunk meshes. 0 means meshes are built on the main thread. */
+extern int Builder_WorkersCount;
 
 void Builder_Init(void);
+/* Stops all worker threads, and frees the memory used by the builder. */
+/* NOTE: Builder_CancelChunks must have been called before this. */
+void Builder_Free(void);
 void Builder_OnNewMapLoaded(void);
-/* Builds the mesh of vertices for the given chunk. */
-void Builder_MakeChunk(struct ChunkInfo* info);
+/* Queues the mesh of vertices for the given chunk to be built on a worker thread. */
+/* Returns false if too many chunks are already being built, so the chunk could not be queued. */
+/* NOTE: The blocks around the chunk are copied immediately, so the world can be changed afterwards. */
+bool Builder_StartChunk(struct ChunkInfo* info);
+/* Creates the vertex buffer for the next chunk whose mesh has finished being built. */
+/* Returns the chunk, or NULL if there are no more built chunks. */
+struct ChunkInfo* Builder_FinishChunk(void);
+/* Discards all chunks queued or being built, waiting for worker threads to finish if necessary. */
+void Builder_CancelChunks(void);
 
 void NormalBuilder_SetActive(void);
+void GreedyBuilder_SetActive(void);
 void AdvBuilder_SetActive(void);
 void Builder_ApplyActive(void);
 #endif
@@ -415,6 +415,12 @@ static struct ChatCommand ModelCommand = {
 static int cuboid_block = -1;
 static Vector3I cuboid_mark1, cuboid_mark2;
 static bool cuboid_persist, cuboid_hooked;
+
+/* Blocks are changed in batches of this size, so lighting and chunks are updated far less often */
+#define CUBOID_BATCH_SIZE 4096
+static int32_t cuboid_indices[CUBOID_BATCH_SIZE];
+static BlockID cuboid_blocks[CUBOID_BATCH_SIZE];
+static BlockID cuboid_olds[CUBOID_BATCH_SIZE];
 const static String cuboid_msg = String_FromConst("&eCuboid: &fPlace or delete a block.");
 
 static bool CuboidCommand_ParseBlock(const String* args, int argsCount) {
@@ -435,10 +441,21 @@ static bool CuboidCommand_ParseBlock(const String* args, int argsCount) {
 	return true;
 }
 
+static void CuboidCommand_ChangeBatch(int count) {
+	int i, x, y, z, index;
+	Game_UpdateBlocksBatch(cuboid_indices, cuboid_blocks, count);
+
+	for (i = 0; i < count; i++) {
+		index = cuboid_indices[i];
+		World_Unpack(index, x, y, z);
+		Server.SendBlock(x, y, z, cuboid_olds[i], cuboid_blocks[i]);
+	}
+}
+
 static void CuboidCommand_DoCuboid(void) {
 	Vector3I min, max;
 	BlockID toPlace;
-	int x, y, z;
+	int x, y, z, count = 0;
 
 	Vector3I_Min(&min, &cuboid_mark1, &cuboid_mark2);
 	Vector3I_Max(&max, &cuboid_mark1, &cuboid_mark2);
@@ -451,10 +468,16 @@ static void CuboidCommand_DoCuboid(void) {
 	for (y = min.Y; y <= max.Y; y++) {
 		for (z = min.Z; z <= max.Z; z++) {
 			for (x = min.X; x <= max.X; x++) {
-				Game_ChangeBlock(x, y, z, toPlace);
+				cuboid_indices[count] = World_Pack(x, y, z);
+				cuboid_blocks[count]  = toPlace;
+				cuboid_olds[count]    = World_GetBlock(x, y, z);
+
+				if (++count < CUBOID_BATCH_SIZE) continue;
+				CuboidCommand_ChangeBatch(count); count = 0;
 			}
 		}
 	}
+	CuboidCommand_ChangeBatch(count);
 }
 
 static void CuboidCommand_BlockChanged(void* obj, Vector3I coords, BlockID old, BlockID now) {
@@ -22,6 +22,7 @@ typedef signed __int64 int64_t;
 #define CC_INLINE inline
 #define CC_NOINLINE __declspec(noinline)
 #define CC_ALIGN_HINT(x) __declspec(align(x))
+#define CC_THREADLOCAL __declspec(thread)
 #ifndef CC_API
 #define CC_API __declspec(dllexport, noinline)
 #define CC_VAR __declspec(dllexport)
@@ -31,6 +32,7 @@ typedef signed __int64 int64_t;
 #define CC_INLINE inline
 #define CC_NOINLINE __attribute__((noinline))
 #define CC_ALIGN_HINT(x) __attribute__((aligned(x)))
+#define CC_THREADLOCAL __thread
 #ifndef CC_API
 #ifdef _WIN32
 #define CC_API __attribute__((dllexport, noinline))
@@ -58,6 +60,9 @@ typedef uint16_t BlockID;
 #else
 typedef uint8_t BlockID;
 #endif
+/* Stores the world as palette compressed 16x16x16 sub chunks, instead of flat arrays. */
+/* Uses far less memory for large maps, but reading/setting blocks is slower. */
+/*#define SPARSE_WORLD*/
 
 #define EXTENDED_TEXTURES
 #ifdef EXTENDED_TEXTURES
@@ -125,6 +130,12 @@ typedef struct TextureRec_ { float U1, V1, U2, V2; } TextureRec;
 #endif
 #endif
 
+/* Direct3D9 fixed function cannot use 16 bit positions, and display lists store vertices in their own format */
+#if !defined CC_BUILD_D3D9 && !defined CC_BUILD_GL11 && !defined CC_BUILD_GLMODERN
+/* Chunk meshes are stored using the compact VERTEX_FORMAT_P3ST2SC4B vertex format. */
+#define CC_BUILD_COMPACTCHUNKS
+#endif
+
 #ifdef CC_BUILD_D3D9
 typedef void* GfxResourceID;
 #define GFX_NULL NULL
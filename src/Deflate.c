@@ -5,6 +5,10 @@
 #include "Stream.h"
 #include "Errors.h"
 #include "Utils.h"
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ADLER32_SSE2
+#endif
 
 #define Header_ReadU8(value) if ((res = s->ReadU8(s, &value))) return res;
 /*########################################################################################################################*
@@ -141,7 +145,7 @@ enum INFLATE_STATE_ {
 };
 
 /* Insert next byte into the bit buffer */
-#define Inflate_GetByte(state) state->AvailIn--; state->Bits |= (uint32_t)(*state->NextIn++) << state->NumBits; state->NumBits += 8;
+#define Inflate_GetByte(state) state->AvailIn--; state->Bits |= (uint64_t)(*state->NextIn++) << state->NumBits; state->NumBits += 8;
 /* Retrieves bits from the bit buffer */
 #define Inflate_PeekBits(state, bits) (state->Bits & ((1UL << (bits)) - 1UL))
 /* Consumes/eats up bits from the bit buffer */
@@ -150,18 +154,30 @@ enum INFLATE_STATE_ {
 #define Inflate_AlignBits(state) uint32_t alignSkip = state->NumBits & 7; Inflate_ConsumeBits(state, alignSkip);
 /* Ensures there are 'bitsCount' bits, or returns if not */
 #define Inflate_EnsureBits(state, bitsCount) while (state->NumBits < bitsCount) { if (!state->AvailIn) return; Inflate_GetByte(state); }
-/* Ensures there are 'bitsCount' bits */
-#define Inflate_UNSAFE_EnsureBits(state, bitsCount) while (state->NumBits < bitsCount) { Inflate_GetByte(state); }
 /* Peeks then consumes given bits */
 #define Inflate_ReadBits(state, bitsCount) Inflate_PeekBits(state, bitsCount); Inflate_ConsumeBits(state, bitsCount);
 
+/* Reads 8 bytes as a little endian 64 bit integer (compilers turn this into a single load) */
+#define Inflate_ReadU64_LE(p) ((uint64_t)(p)[0]         | ((uint64_t)(p)[1] << 8)  | ((uint64_t)(p)[2] << 16) | ((uint64_t)(p)[3] << 24) |\
+							  ((uint64_t)(p)[4] << 32) | ((uint64_t)(p)[5] << 40) | ((uint64_t)(p)[6] << 48) | ((uint64_t)(p)[7] << 56))
+/* Tops up the bit buffer to at least 56 bits, using a single 64 bit read. Requires at least 8 bytes of input. */
+/* NOTE: Leaves the next input bits above NumBits, so these must be cleared before using Inflate_GetByte again */
+#define Inflate_UNSAFE_RefillBits(state) \
+	state->Bits    |= Inflate_ReadU64_LE(state->NextIn) << state->NumBits;\
+	state->NextIn  += (63 - state->NumBits) >> 3;\
+	state->AvailIn -= (63 - state->NumBits) >> 3;\
+	state->NumBits |= 56;
+/* Clears any bits above NumBits left behind by Inflate_UNSAFE_RefillBits */
+#define Inflate_ClearExtraBits(state) state->Bits &= ((uint64_t)1 << state->NumBits) - 1;
+
 /* Goes to the next state, after having read data of a block */
 #define Inflate_NextBlockState(state) (state->LastBlock ? INFLATE_STATE_DONE : INFLATE_STATE_HEADER)
 /* Goes to the next state, after having finished reading a compressed entry */
 #define Inflate_NextCompressState(state) ((state->AvailIn >= INFLATE_FASTINF_IN && state->AvailOut >= INFLATE_FASTINF_OUT) ? INFLATE_STATE_FASTCOMPRESSED : INFLATE_STATE_COMPRESSED_LIT)
 /* The maximum amount of bytes that can be output is 258 */
 #define INFLATE_FASTINF_OUT 258
-/* The most input bytes required for huffman codes and extra data is 16 + 5 + 16 + 13 bits. Add 3 extra bytes to account for putting data into the bit buffer. */
+/* The most input bits required for huffman codes and extra data is 15 + 5 + 15 + 13 = 48 bits. */
+/* A single refill always gives at least 56 bits, but reads 8 bytes at once. Add 2 bytes extra for safety. */
 #define INFLATE_FASTINF_IN 10
 
 static uint32_t Huffman_ReverseBits(uint32_t n, uint8_t bits) {
@@ -293,10 +309,10 @@ static int Huffman_Decode(struct InflateState* state, struct HuffmanTable* table
 	return -1;
 }
 
-/* Inline the common <= 9 bits case */
+/* Inline the common <= INFLATE_FAST_BITS bits case */
+/* NOTE: Bit buffer must already contain at least INFLATE_MAX_BITS bits */
 #define Huffman_Unsafe_Decode(state, table, result) \
 {\
-	Inflate_UNSAFE_EnsureBits(state, INFLATE_MAX_BITS);\
 	packed = table.Fast[Inflate_PeekBits(state, INFLATE_FAST_BITS)];\
 	if (packed >= 0) {\
 		consumedBits = packed >> INFLATE_FAST_BITS;\
@@ -381,16 +397,43 @@ const static uint8_t codelens_order[INFLATE_MAX_CODELENS] = {
 	16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 
 };
 
+/* Computes the literal (if any) that can be decoded straight after each literal in the fast lookup table */
+static void Inflate_BuildLitPairs(struct InflateState* state) {
+	int16_t* fast = state->Table.Lits.Fast;
+	int i, packed, second, bits;
+
+	for (i = 0; i < (1 << INFLATE_FAST_BITS); i++) {
+		state->LitPairs[i] = -1;
+		packed = fast[i];
+		if (packed < 0 || (packed & 0x1FF) >= 256) continue;
+
+		/* Remaining bits after first literal, with unknown upper bits as 0 */
+		/* Codewords are prefix free, so this is correct when second codeword fits in remaining bits */
+		bits   = packed >> INFLATE_FAST_BITS;
+		second = fast[i >> bits];
+		if (second < 0 || (second & 0x1FF) >= 256) continue;
+		if ((second >> INFLATE_FAST_BITS) > INFLATE_FAST_BITS - bits) continue;
+		state->LitPairs[i] = second;
+	}
+}
+
+/* Copies 8 bytes from src to dst (compilers turn this into a single load and store) */
+#define Inflate_Copy8(dst, src) \
+	tmp = Inflate_ReadU64_LE(src);\
+	dst[0] = (uint8_t)(tmp);       dst[1] = (uint8_t)(tmp >> 8);  dst[2] = (uint8_t)(tmp >> 16); dst[3] = (uint8_t)(tmp >> 24);\
+	dst[4] = (uint8_t)(tmp >> 32); dst[5] = (uint8_t)(tmp >> 40); dst[6] = (uint8_t)(tmp >> 48); dst[7] = (uint8_t)(tmp >> 56);
+
 static void Inflate_InflateFast(struct InflateState* state) {
 	/* huffman variables */
 	uint32_t lit, len, dist;
-	uint32_t bits, lenIdx, distIdx;
+	uint32_t bits, lenIdx, distIdx, fastIdx;
 	int packed, consumedBits;
 
 	/* window variables */
 	uint8_t* window;
 	uint32_t i, curIdx, startIdx;
 	uint32_t copyStart, copyLen, partLen;
+	uint64_t tmp;
 
 	window = state->Window;
 	curIdx = state->WindowIndex;
@@ -399,6 +442,30 @@ static void Inflate_InflateFast(struct InflateState* state) {
 
 #define INFLATE_FAST_COPY_MAX (INFLATE_WINDOW_SIZE - INFLATE_FASTINF_OUT)
 	while (state->AvailOut >= INFLATE_FASTINF_OUT && state->AvailIn >= INFLATE_FASTINF_IN && copyLen < INFLATE_FAST_COPY_MAX) {
+		/* Bit buffer now has enough bits for a whole literal/length + distance pair */
+		Inflate_UNSAFE_RefillBits(state);
+		fastIdx = Inflate_PeekBits(state, INFLATE_FAST_BITS);
+		packed  = state->Table.Lits.Fast[fastIdx];
+
+		/* Most common case is one or more literals in a row, so try to decode two at once */
+		if (packed >= 0 && (packed & 0x1FF) < 256) {
+			consumedBits = packed >> INFLATE_FAST_BITS;
+			Inflate_ConsumeBits(state, consumedBits);
+			window[curIdx] = (uint8_t)packed;
+			curIdx = (curIdx + 1) & INFLATE_WINDOW_MASK;
+
+			packed = state->LitPairs[fastIdx];
+			if (packed >= 0) {
+				consumedBits = packed >> INFLATE_FAST_BITS;
+				Inflate_ConsumeBits(state, consumedBits);
+				window[curIdx] = (uint8_t)packed;
+				curIdx = (curIdx + 1) & INFLATE_WINDOW_MASK;
+				state->AvailOut -= 2; copyLen += 2;
+			} else {
+				state->AvailOut--;    copyLen++;
+			}
+			continue;
+		}
 		Huffman_Unsafe_Decode(state, state->Table.Lits, lit);
 
 		if (lit <= 256) {
@@ -413,12 +480,10 @@ static void Inflate_InflateFast(struct InflateState* state) {
 		} else {
 			lenIdx = lit - 257;
 			bits = len_bits[lenIdx];
-			Inflate_UNSAFE_EnsureBits(state, bits);
 			len  = len_base[lenIdx] + Inflate_ReadBits(state, bits);
 
 			Huffman_Unsafe_Decode(state, state->TableDists, distIdx);
 			bits = dist_bits[distIdx];
-			Inflate_UNSAFE_EnsureBits(state, bits);
 			dist = dist_base[distIdx] + Inflate_ReadBits(state, bits);
 	
 			/* Window is infinitely repeating like ... [xyz][xyz][xyz] ... */
@@ -428,8 +493,15 @@ static void Inflate_InflateFast(struct InflateState* state) {
 				uint8_t* src = &window[startIdx]; 
 				uint8_t* dst = &window[curIdx];
 
-				for (i = 0; i < (len & ~0x3); i += 4) {
-					*dst++ = *src++; *dst++ = *src++; *dst++ = *src++; *dst++ = *src++;
+				if (dist >= 8) {
+					/* Each 8 byte chunk only reads bytes that have already been written */
+					for (i = 0; i < (len & ~0x7); i += 8) {
+						Inflate_Copy8(dst, src); dst += 8; src += 8;
+					}
+				} else {
+					for (i = 0; i < (len & ~0x3); i += 4) {
+						*dst++ = *src++; *dst++ = *src++; *dst++ = *src++; *dst++ = *src++;
+					}
 				}
 				for (; i < len; i++) { *dst++ = *src++; }
 			} else {
@@ -443,6 +515,7 @@ static void Inflate_InflateFast(struct InflateState* state) {
 	}
 
 	state->WindowIndex = curIdx;
+	Inflate_ClearExtraBits(state);
 	if (!copyLen) return;
 
 	if (copyStart + copyLen < INFLATE_WINDOW_SIZE) {
@@ -488,6 +561,7 @@ void Inflate_Process(struct InflateState* state) {
 			case 1: { /* Fixed/static huffman compressed */
 				Huffman_Build(&state->Table.Lits, fixed_lits,  INFLATE_MAX_LITS);
 				Huffman_Build(&state->TableDists, fixed_dists, INFLATE_MAX_DISTS);
+				Inflate_BuildLitPairs(state);
 				state->State = Inflate_NextCompressState(state);
 			} break;
 
@@ -593,6 +667,7 @@ void Inflate_Process(struct InflateState* state) {
 				state->State = Inflate_NextCompressState(state);
 				Huffman_Build(&state->Table.Lits, state->Buffer, state->NumLits);
 				Huffman_Build(&state->TableDists, &state->Buffer[state->NumLits], state->NumDists);
+				Inflate_BuildLitPairs(state);
 			}
 			break;
 		}
@@ -797,28 +872,280 @@ static uint32_t Deflate_Hash(uint8_t* src) {
 	return (uint32_t)((src[0] << 8) ^ (src[1] << 4) ^ (src[2])) & DEFLATE_HASH_MASK;
 }
 
-/* Writes a literal to state->Output */
+/* Settings for each compression level */
+const static struct DeflateLevelInfo {
+	uint16_t MaxDepth;  /* Maximum number of previous matches to explore in hash chain */
+	bool Lazy;          /* Whether to check for a longer match starting at the next byte */
+	bool Dynamic;       /* Whether to use dynamic huffman blocks instead of a single fixed block */
+	bool InsertMatches; /* Whether to also insert bytes within a match into the hash chains */
+} deflate_levels[3] = {
+	{   4, false, false, false }, /* DEFLATE_LEVEL_FAST */
+	{   5, true,  true,  false }, /* DEFLATE_LEVEL_DEFAULT */
+	{ 128, true,  true,  true  }  /* DEFLATE_LEVEL_MAX */
+};
+
+/* Returns index of length in len_base/len_bits */
+static int Deflate_LenIndex(int len) {
+	int j;
+	for (j = 0; len >= deflate_len[j + 1]; j++);
+	return j;
+}
+
+/* Returns index of distance in dist_base/dist_bits */
+static int Deflate_DistIndex(int dist) {
+	int j;
+	for (j = 0; dist >= deflate_dist[j + 1]; j++);
+	return j;
+}
+
+/* Writes a literal to state->Output (or buffers it, when using dynamic huffman blocks) */
 static void Deflate_Lit(struct DeflateState* state, int lit) {
+	if (deflate_levels[state->Level].Dynamic) {
+		state->SymLits[state->NumSyms]  = lit;
+		state->SymDists[state->NumSyms] = 0;
+		state->NumSyms++; return;
+	}
+
 	Deflate_PushLit(state, lit);
 	Deflate_FlushBits(state);
 }
 
-/* Writes a length-distance pair to state->Output */
+/* Writes a length-distance pair to state->Output (or buffers it, when using dynamic huffman blocks) */
 static void Deflate_LenDist(struct DeflateState* state, int len, int dist) {
 	int j;
 	/* TODO: Do we actually need the if (len_bits[j]) ????????? does writing 0 bits matter??? */
+	if (deflate_levels[state->Level].Dynamic) {
+		state->SymLits[state->NumSyms]  = len;
+		state->SymDists[state->NumSyms] = dist;
+		state->NumSyms++; return;
+	}
 
-	for (j = 0; len >= deflate_len[j + 1]; j++);
+	j = Deflate_LenIndex(len);
 	Deflate_PushLit(state, j + 257);
 	if (len_bits[j]) { Deflate_PushBits(state, len - deflate_len[j], len_bits[j]); }
 	Deflate_FlushBits(state);
 
-	for (j = 0; dist >= deflate_dist[j + 1]; j++);
+	j = Deflate_DistIndex(dist);
 	Deflate_PushHuff(state, j, 5);
 	if (dist_bits[j]) { Deflate_PushBits(state, dist - deflate_dist[j], dist_bits[j]); }
 	Deflate_FlushBits(state);
 }
 
+/* Writes all data in state->Output to the destination stream */
+static ReturnCode Deflate_FlushOutput(struct DeflateState* state) {
+	ReturnCode res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+	state->NextOut  = state->Output;
+	state->AvailOut = DEFLATE_OUT_SIZE;
+	return res;
+}
+/* Flushes state->Output when nearly full (leaves room for a few bytes and literals at end) */
+#define Deflate_CheckFlushOutput(state) if (state->AvailOut < 20 && (res = Deflate_FlushOutput(state))) return res;
+
+/* Constructs a huffman encoding table (for values to codewords) */
+static void Deflate_BuildTable(const uint8_t* lens, int count, uint16_t* codewords, uint8_t* bitlens) {
+	int i, j, offset, codeword;
+	struct HuffmanTable table;
+
+	Huffman_Build(&table, lens, count);
+	for (i = 0; i < INFLATE_MAX_BITS; i++) {
+		if (!table.EndCodewords[i]) continue;
+		count = table.EndCodewords[i] - table.FirstCodewords[i];
+
+		for (j = 0; j < count; j++) {
+			offset   = table.Values[table.FirstOffsets[i] + j];
+			codeword = table.FirstCodewords[i] + j;
+			bitlens[offset]   = i;
+			codewords[offset] = Huffman_ReverseBits(codeword, i);
+		}
+	}
+}
+
+/* Computes optimal huffman codeword lengths for the given frequencies, limited to at most maxBits */
+/* Uses the in-place algorithm from "In-Place Calculation of Minimum-Redundancy Codes" by Moffat and Katajainen */
+static void Deflate_CalcLengths(const int* freqs, int count, uint8_t* lens, int maxBits) {
+	int syms[INFLATE_MAX_LITS], A[INFLATE_MAX_LITS];
+	int blCount[INFLATE_MAX_BITS];
+	int i, j, n, root, leaf, next, avail, used, depth, total;
+
+	/* Sort used symbols by ascending frequency (insertion sort is fine for at most 288 symbols) */
+	n = 0;
+	for (i = 0; i < count; i++) {
+		lens[i] = 0;
+		if (!freqs[i]) continue;
+
+		for (j = n; j > 0 && freqs[syms[j - 1]] > freqs[i]; j--) { syms[j] = syms[j - 1]; }
+		syms[j] = i; n++;
+	}
+
+	if (!n) return;
+	if (n == 1) { lens[syms[0]] = 1; return; }
+	for (i = 0; i < n; i++) { A[i] = freqs[syms[i]]; }
+
+	/* Phase 1: Build tree, with A[i] ending up as the index of each internal node's parent */
+	A[0] += A[1]; root = 0; leaf = 2;
+	for (next = 1; next < n - 1; next++) {
+		if (leaf >= n || A[root] < A[leaf]) { A[next] = A[root]; A[root++] = next; }
+		else { A[next] = A[leaf++]; }
+
+		if (leaf >= n || (root < next && A[root] < A[leaf])) { A[next] += A[root]; A[root++] = next; }
+		else { A[next] += A[leaf++]; }
+	}
+
+	/* Phase 2: Convert parent indices into depths of internal nodes */
+	A[n - 2] = 0;
+	for (next = n - 3; next >= 0; next--) { A[next] = A[A[next]] + 1; }
+
+	/* Phase 3: Convert internal node depths into depths of leaf nodes */
+	avail = 1; used = 0; depth = 0;
+	root  = n - 2; next = n - 1;
+	while (avail > 0) {
+		while (root >= 0 && A[root] == depth) { used++; root--; }
+		while (avail > used) { A[next--] = depth; avail--; }
+		avail = 2 * used; depth++; used = 0;
+	}
+
+	/* Count codewords for each length, moving any that are too long into the longest allowed length */
+	for (i = 0; i < Array_Elems(blCount); i++) blCount[i] = 0;
+	for (i = 0; i < n; i++) { blCount[min(A[i], maxBits)]++; }
+
+	/* Then fix up the tree so it is complete again (i.e. Kraft sum is exactly 1) */
+	total = 0;
+	for (i = maxBits; i > 0; i--) { total += blCount[i] << (maxBits - i); }
+
+	while (total != (1 << maxBits)) {
+		blCount[maxBits]--;
+		for (i = maxBits - 1; i > 0; i--) {
+			if (!blCount[i]) continue;
+			blCount[i]--; blCount[i + 1] += 2; break;
+		}
+		total--;
+	}
+
+	/* Most frequent symbols get the shortest codewords */
+	for (i = 1, j = n; i <= maxBits; i++) {
+		for (used = blCount[i]; used > 0; used--) { lens[syms[--j]] = i; }
+	}
+}
+
+/* Writes the given huffman codeword, then flushes bit buffer */
+#define Deflate_PushCode(state, value, codewords, lens) Deflate_PushBits(state, codewords[value], lens[value]); Deflate_FlushBits(state);
+
+/* Writes the buffered symbols as a dynamic huffman block */
+static ReturnCode Deflate_WriteDynamicBlock(struct DeflateState* state) {
+	int litFreqs[INFLATE_MAX_LITS], distFreqs[INFLATE_MAX_DISTS], codeFreqs[INFLATE_MAX_CODELENS];
+	uint16_t litCodewords[INFLATE_MAX_LITS], distCodewords[INFLATE_MAX_DISTS], codeCodewords[INFLATE_MAX_CODELENS];
+	uint8_t litLens[INFLATE_MAX_LITS], distLens[INFLATE_MAX_DISTS], codeLens[INFLATE_MAX_CODELENS];
+	uint8_t lens[INFLATE_MAX_LITS_DISTS];
+	/* Run length encoded codeword lengths, and the extra bits for each */
+	uint8_t rleSyms[INFLATE_MAX_LITS_DISTS], rleExtra[INFLATE_MAX_LITS_DISTS];
+	int numLits, numDists, numCodeLens, numRle;
+	int i, j, run, len, dist, lit;
+	ReturnCode res;
+
+	if (!state->NumSyms) return 0;
+	for (i = 0; i < INFLATE_MAX_LITS;      i++) litFreqs[i]  = 0;
+	for (i = 0; i < INFLATE_MAX_DISTS;     i++) distFreqs[i] = 0;
+	for (i = 0; i < INFLATE_MAX_CODELENS;  i++) codeFreqs[i] = 0;
+
+	for (i = 0; i < state->NumSyms; i++) {
+		if (!state->SymDists[i]) {
+			litFreqs[state->SymLits[i]]++;
+		} else {
+			litFreqs[Deflate_LenIndex(state->SymLits[i]) + 257]++;
+			distFreqs[Deflate_DistIndex(state->SymDists[i])]++;
+		}
+	}
+	litFreqs[256] = 1;
+	/* Some decoders reject an empty distances tree */
+	if (!distFreqs[0]) distFreqs[0] = 1;
+
+	Deflate_CalcLengths(litFreqs,  286, litLens,  15);
+	Deflate_CalcLengths(distFreqs, 30,  distLens, 15);
+	for (numLits  = 286; numLits  > 257 && !litLens[numLits   - 1]; numLits--)  {}
+	for (numDists = 30;  numDists > 1   && !distLens[numDists - 1]; numDists--) {}
+
+	/* Run length encode all the codeword lengths */
+	Mem_Copy(lens, litLens, numLits);
+	Mem_Copy(&lens[numLits], distLens, numDists);
+	numRle = 0;
+
+	for (i = 0; i < numLits + numDists; i += run) {
+		len = lens[i];
+		for (run = 1; i + run < numLits + numDists && lens[i + run] == len; run++) {}
+
+		if (!len && run >= 11) {
+			run = min(run, 138);
+			rleSyms[numRle] = 18; rleExtra[numRle++] = run - 11;
+		} else if (!len && run >= 3) {
+			rleSyms[numRle] = 17; rleExtra[numRle++] = run - 3;
+		} else if (run >= 4) {
+			/* First length must be written out, then can be repeated */
+			run = min(run, 7);
+			rleSyms[numRle] = len; rleExtra[numRle++] = 0;
+			rleSyms[numRle] = 16;  rleExtra[numRle++] = run - 4;
+		} else {
+			run = 1;
+			rleSyms[numRle] = len; rleExtra[numRle++] = 0;
+		}
+	}
+
+	for (i = 0; i < numRle; i++) { codeFreqs[rleSyms[i]]++; }
+	Deflate_CalcLengths(codeFreqs, INFLATE_MAX_CODELENS, codeLens, 7);
+	for (numCodeLens = INFLATE_MAX_CODELENS; numCodeLens > 4 && !codeLens[codelens_order[numCodeLens - 1]]; numCodeLens--) {}
+
+	Deflate_BuildTable(litLens,  numLits,  litCodewords,  litLens);
+	Deflate_BuildTable(distLens, numDists, distCodewords, distLens);
+	Deflate_BuildTable(codeLens, INFLATE_MAX_CODELENS, codeCodewords, codeLens);
+
+	/* Write block header: final block FALSE, block type DYNAMIC */
+	Deflate_PushBits(state, 2 << 1, 3);
+	Deflate_PushBits(state, numLits - 257, 5);
+	Deflate_PushBits(state, numDists - 1,  5);
+	Deflate_PushBits(state, numCodeLens - 4, 4);
+	Deflate_FlushBits(state);
+
+	for (i = 0; i < numCodeLens; i++) {
+		Deflate_PushBits(state, codeLens[codelens_order[i]], 3);
+		Deflate_FlushBits(state);
+	}
+
+	for (i = 0; i < numRle; i++) {
+		j = rleSyms[i];
+		Deflate_PushCode(state, j, codeCodewords, codeLens);
+
+		if (j == 16) { Deflate_PushBits(state, rleExtra[i], 2); }
+		if (j == 17) { Deflate_PushBits(state, rleExtra[i], 3); }
+		if (j == 18) { Deflate_PushBits(state, rleExtra[i], 7); }
+		Deflate_FlushBits(state);
+		Deflate_CheckFlushOutput(state);
+	}
+
+	/* Write block data */
+	for (i = 0; i < state->NumSyms; i++) {
+		lit  = state->SymLits[i];
+		dist = state->SymDists[i];
+
+		if (!dist) {
+			Deflate_PushCode(state, lit, litCodewords, litLens);
+		} else {
+			j = Deflate_LenIndex(lit);
+			Deflate_PushCode(state, j + 257, litCodewords, litLens);
+			if (len_bits[j]) { Deflate_PushBits(state, lit - deflate_len[j], len_bits[j]); }
+			Deflate_FlushBits(state);
+
+			j = Deflate_DistIndex(dist);
+			Deflate_PushCode(state, j, distCodewords, distLens);
+			if (dist_bits[j]) { Deflate_PushBits(state, dist - deflate_dist[j], dist_bits[j]); }
+			Deflate_FlushBits(state);
+		}
+		Deflate_CheckFlushOutput(state);
+	}
+
+	Deflate_PushCode(state, 256, litCodewords, litLens);
+	state->NumSyms = 0;
+	return 0;
+}
+
 /* Moves "current block" to "previous block", adjusting state if needed. */
 static void Deflate_MoveBlock(struct DeflateState* state) {
 	int i;
@@ -836,15 +1163,16 @@ static void Deflate_MoveBlock(struct DeflateState* state) {
 
 /* Compresses current block of data */
 static ReturnCode Deflate_FlushBlock(struct DeflateState* state, int len) {
+	const struct DeflateLevelInfo* level = &deflate_levels[state->Level];
 	uint32_t hash, nextHash;
 	int bestLen, maxLen, matchLen, depth;
-	int bestPos, pos, nextPos;
+	int bestPos, pos, nextPos, i;
 	uint16_t oldHead;
 	uint8_t* input;
 	uint8_t* cur;
 	ReturnCode res;
 
-	if (!state->WroteHeader) {
+	if (!state->WroteHeader && !level->Dynamic) {
 		state->WroteHeader = true;
 		Deflate_PushBits(state, 3, 3); /* final block TRUE, block type FIXED */
 	}
@@ -864,12 +1192,13 @@ static ReturnCode Deflate_FlushBlock(struct DeflateState* state, int len) {
 		bestPos = 0;
 
 		/* Find longest match starting at this byte */
-		/* Only explore up to 5 previous matches, to avoid slow performance */
+		/* Only explore up to a few previous matches (depending on level), to avoid slow performance */
 		/* (i.e prefer quickly saving maps/screenshots to completely optimal filesize) */
 		pos = state->Head[hash];
-		for (depth = 0; pos != 0 && depth < 5; depth++) {
+		for (depth = 0; pos != 0 && depth < level->MaxDepth; depth++) {
 			matchLen = Deflate_MatchLen(&input[pos], cur, maxLen);
 			if (matchLen > bestLen) { bestLen = matchLen; bestPos = pos; }
+			if (bestLen == maxLen) break;
 			pos = state->Prev[pos];
 		}
 
@@ -881,12 +1210,12 @@ static ReturnCode Deflate_FlushBlock(struct DeflateState* state, int len) {
 
 		/* Lazy evaluation: Find longest match starting at next byte */
 		/* If that's longer than the longest match at current byte, throwaway this match */
-		if (bestPos) {
+		if (bestPos && level->Lazy) {
 			nextHash = Deflate_Hash(cur + 1);
 			nextPos  = state->Head[nextHash];
 			maxLen   = min(len - 1, MAX_MATCH_LEN);
 
-			for (depth = 0; nextPos != 0 && depth < 5; depth++) {
+			for (depth = 0; nextPos != 0 && depth < level->MaxDepth; depth++) {
 				matchLen = Deflate_MatchLen(&input[nextPos], cur + 1, maxLen);
 				if (matchLen > bestLen) { bestPos = 0; break; }
 				nextPos = state->Prev[nextPos];
@@ -895,18 +1224,19 @@ static ReturnCode Deflate_FlushBlock(struct DeflateState* state, int len) {
 
 		if (bestPos) {
 			Deflate_LenDist(state, bestLen, pos - bestPos);
+
+			/* Also insert the rest of the match into the hash chains, so later data can match against it */
+			for (i = 1; level->InsertMatches && i < bestLen && len - i > MIN_MATCH_LEN; i++) {
+				hash = Deflate_Hash(cur + i);
+				state->Prev[pos + i] = state->Head[hash];
+				state->Head[hash]    = pos + i;
+			}
 			len -= bestLen; cur += bestLen;
 		} else {
 			Deflate_Lit(state, *cur);
 			len--; cur++;
 		}
-
-		/* leave room for a few bytes and literals at end */
-		if (state->AvailOut >= 20) continue;
-		res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-		state->NextOut  = state->Output;
-		state->AvailOut = DEFLATE_OUT_SIZE;
-		if (res) return res;
+		Deflate_CheckFlushOutput(state);
 	}
 
 	/* literals for last few bytes */
@@ -915,9 +1245,8 @@ static ReturnCode Deflate_FlushBlock(struct DeflateState* state, int len) {
 		len--; cur++;
 	}
 
-	res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-	state->NextOut  = state->Output;
-	state->AvailOut = DEFLATE_OUT_SIZE;
+	if (level->Dynamic && (res = Deflate_WriteDynamicBlock(state))) return res;
+	res = Deflate_FlushOutput(state);
 
 	Deflate_MoveBlock(state);
 	return res;
@@ -961,6 +1290,11 @@ static ReturnCode Deflate_StreamClose(struct Stream* stream) {
 	res   = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE);
 	if (res) return res;
 
+	/* Dynamic huffman blocks are never final, so finish with an empty fixed block */
+	if (deflate_levels[state->Level].Dynamic) {
+		Deflate_PushBits(state, 3, 3); /* final block TRUE, block type FIXED */
+	}
+
 	/* Write huffman encoded "literal 256" to terminate symbols */
 	Deflate_PushLit(state, 256);
 	Deflate_FlushBits(state);
@@ -974,26 +1308,7 @@ static ReturnCode Deflate_StreamClose(struct Stream* stream) {
 	return Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
 }
 
-/* Constructs a huffman encoding table (for values to codewords) */
-static void Deflate_BuildTable(const uint8_t* lens, int count, uint16_t* codewords, uint8_t* bitlens) {
-	int i, j, offset, codeword;
-	struct HuffmanTable table;
-
-	Huffman_Build(&table, lens, count);
-	for (i = 0; i < INFLATE_MAX_BITS; i++) {
-		if (!table.EndCodewords[i]) continue;
-		count = table.EndCodewords[i] - table.FirstCodewords[i];
-
-		for (j = 0; j < count; j++) {
-			offset   = table.Values[table.FirstOffsets[i] + j];
-			codeword = table.FirstCodewords[i] + j;
-			bitlens[offset]   = i;
-			codewords[offset] = Huffman_ReverseBits(codeword, i);
-		}
-	}
-}
-
-void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying) {
+void Deflate_MakeStreamEx(struct Stream* stream, struct DeflateState* state, struct Stream* underlying, int level) {
 	Stream_Init(stream);
 	stream->Meta.Inflate = state;
 	stream->Write = Deflate_StreamWrite;
@@ -1008,12 +1323,22 @@ void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struc
 	state->AvailOut = DEFLATE_OUT_SIZE;
 	state->Dest     = underlying;
 	state->WroteHeader = false;
+	state->NumSyms  = 0;
+
+	/* Level is used to index deflate_levels, so must be a valid level */
+	if (level < DEFLATE_LEVEL_FAST) level = DEFLATE_LEVEL_FAST;
+	if (level > DEFLATE_LEVEL_MAX)  level = DEFLATE_LEVEL_MAX;
+	state->Level    = level;
 
 	Mem_Set(state->Head, 0, sizeof(state->Head));
 	Mem_Set(state->Prev, 0, sizeof(state->Prev));
 	Deflate_BuildTable(fixed_lits, INFLATE_MAX_LITS, state->LitsCodewords, state->LitsLens);
 }
 
+void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying) {
+	Deflate_MakeStreamEx(stream, state, underlying, DEFLATE_LEVEL_DEFAULT);
+}
+
 
 /*########################################################################################################################*
 *-----------------------------------------------------GZip (compress)-----------------------------------------------------*
@@ -1031,15 +1356,8 @@ static ReturnCode GZip_StreamClose(struct Stream* stream) {
 
 static ReturnCode GZip_StreamWrite(struct Stream* stream, const uint8_t* data, uint32_t count, uint32_t* modified) {
 	struct GZipState* state = stream->Meta.Inflate;
-	uint32_t i, crc32 = state->Crc32;
 	state->Size += count;
-
-	/* TODO: Optimise this calculation */
-	for (i = 0; i < count; i++) {
-		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
-	}
-
-	state->Crc32 = crc32;
+	state->Crc32 = Utils_Crc32Update(state->Crc32, data, count);
 	return Deflate_StreamWrite(stream, data, count, modified);
 }
 
@@ -1053,14 +1371,18 @@ static ReturnCode GZip_StreamWriteFirst(struct Stream* stream, const uint8_t* da
 	return GZip_StreamWrite(stream, data, count, modified);
 }
 
-void GZip_MakeStream(struct Stream* stream, struct GZipState* state, struct Stream* underlying) {
-	Deflate_MakeStream(stream, &state->Base, underlying);
+void GZip_MakeStreamEx(struct Stream* stream, struct GZipState* state, struct Stream* underlying, int level) {
+	Deflate_MakeStreamEx(stream, &state->Base, underlying, level);
 	state->Crc32  = 0xFFFFFFFFUL;
 	state->Size   = 0;
 	stream->Write = GZip_StreamWriteFirst;
 	stream->Close = GZip_StreamClose;
 }
 
+void GZip_MakeStream(struct Stream* stream, struct GZipState* state, struct Stream* underlying) {
+	GZip_MakeStreamEx(stream, state, underlying, DEFLATE_LEVEL_DEFAULT);
+}
+
 
 /*########################################################################################################################*
 *-----------------------------------------------------ZLib (compress)-----------------------------------------------------*
@@ -1075,19 +1397,68 @@ static ReturnCode ZLib_StreamClose(struct Stream* stream) {
 	return Stream_Write(state->Base.Dest, data, sizeof(data));
 }
 
-static ReturnCode ZLib_StreamWrite(struct Stream* stream, const uint8_t* data, uint32_t count, uint32_t* modified) {
-	struct ZLibState* state = stream->Meta.Inflate;
-	uint32_t i, adler32 = state->Adler32;
-	uint32_t s1 = adler32 & 0xFFFF, s2 = (adler32 >> 16) & 0xFFFF;
+#define ADLER32_BASE 65521
+/* Largest n such that 255n(n+1)/2 + (n+1)(BASE-1) fits in 32 bits. */
+/* Hence the modulo only needs to be done once every this many bytes. */
+#define ADLER32_NMAX 5552
 
-	/* TODO: Optimise this calculation */
-	for (i = 0; i < count; i++) {
-		#define ADLER32_BASE 65521
-		s1 = (s1 + data[i]) % ADLER32_BASE;
-		s2 = (s2 + s1)      % ADLER32_BASE;
+#ifdef ADLER32_SSE2
+static uint32_t Adler32_Sum(__m128i v) {
+	uint32_t lanes[4];
+	_mm_storeu_si128((__m128i*)lanes, v);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+/* Adds 16 bytes at a time to s1 and s2. Length must be a multiple of 16 and at most ADLER32_NMAX. */
+static void Adler32_SSE2(uint32_t* s1, uint32_t* s2, const uint8_t* data, uint32_t length) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i weightsLo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+	__m128i weightsHi = _mm_setr_epi16( 8,  7,  6,  5,  4,  3,  2, 1);
+	__m128i vs1 = zero, vs2 = zero, vs1Prior = zero, bytes;
+	uint32_t i;
+
+	for (i = 0; i < length; i += 16) {
+		bytes = _mm_loadu_si128((const __m128i*)(data + i));
+		/* s2 gets the sum of all bytes in prior blocks added to it once for each byte of this block */
+		vs1Prior = _mm_add_epi32(vs1Prior, vs1);
+		vs1 = _mm_add_epi32(vs1, _mm_sad_epu8(bytes, zero));
+		vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weightsLo));
+		vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weightsHi));
 	}
 
-	state->Adler32 = (s2 << 16) | s1;
+	*s2 += *s1 * length + 16 * Adler32_Sum(vs1Prior) + Adler32_Sum(vs2);
+	*s1 += Adler32_Sum(vs1);
+}
+#endif
+
+static uint32_t ZLib_Adler32(uint32_t adler32, const uint8_t* data, uint32_t count) {
+	uint32_t s1 = adler32 & 0xFFFF, s2 = (adler32 >> 16) & 0xFFFF;
+	uint32_t n;
+#ifdef ADLER32_SSE2
+	uint32_t blocks;
+#endif
+
+	while (count) {
+		n = min(count, ADLER32_NMAX);
+		count -= n;
+
+#ifdef ADLER32_SSE2
+		blocks = n & ~15u;
+		Adler32_SSE2(&s1, &s2, data, blocks);
+		data += blocks; n -= blocks;
+#endif
+		for (; n; n--, data++) {
+			s1 += *data; s2 += s1;
+		}
+		s1 %= ADLER32_BASE;
+		s2 %= ADLER32_BASE;
+	}
+	return (s2 << 16) | s1;
+}
+
+static ReturnCode ZLib_StreamWrite(struct Stream* stream, const uint8_t* data, uint32_t count, uint32_t* modified) {
+	struct ZLibState* state = stream->Meta.Inflate;
+	state->Adler32 = ZLib_Adler32(state->Adler32, data, count);
 	return Deflate_StreamWrite(stream, data, count, modified);
 }
 
@@ -1101,13 +1472,17 @@ static ReturnCode ZLib_StreamWriteFirst(struct Stream* stream, const uint8_t* da
 	return ZLib_StreamWrite(stream, data, count, modified);
 }
 
-void ZLib_MakeStream(struct Stream* stream, struct ZLibState* state, struct Stream* underlying) {
-	Deflate_MakeStream(stream, &state->Base, underlying);
+void ZLib_MakeStreamEx(struct Stream* stream, struct ZLibState* state, struct Stream* underlying, int level) {
+	Deflate_MakeStreamEx(stream, &state->Base, underlying, level);
 	state->Adler32 = 1;
 	stream->Write = ZLib_StreamWriteFirst;
 	stream->Close = ZLib_StreamClose;
 }
 
+void ZLib_MakeStream(struct Stream* stream, struct ZLibState* state, struct Stream* underlying) {
+	ZLib_MakeStreamEx(stream, state, underlying, DEFLATE_LEVEL_DEFAULT);
+}
+
 
 /*########################################################################################################################*
 *--------------------------------------------------------ZipEntry---------------------------------------------------------*
@@ -20,13 +20,13 @@ void ZLibHeader_Init(struct ZLibHeader* header);
 ReturnCode ZLibHeader_Read(struct Stream* s, struct ZLibHeader* header);
 
 
-#define INFLATE_MAX_INPUT 8192
+#define INFLATE_MAX_INPUT 16384
 #define INFLATE_MAX_CODELENS 19
 #define INFLATE_MAX_LITS 288
 #define INFLATE_MAX_DISTS 32
 #define INFLATE_MAX_LITS_DISTS (INFLATE_MAX_LITS + INFLATE_MAX_DISTS)
 #define INFLATE_MAX_BITS 16
-#define INFLATE_FAST_BITS 9
+#define INFLATE_FAST_BITS 10
 #define INFLATE_WINDOW_SIZE 0x8000UL
 #define INFLATE_WINDOW_MASK 0x7FFFUL
 
@@ -41,7 +41,7 @@ struct HuffmanTable {
 struct InflateState {
 	uint8_t State;
 	bool LastBlock;   /* Whether the last DEFLATE block has been encounted in the stream */
-	uint32_t Bits;    /* Holds bits across byte boundaries */
+	uint64_t Bits;    /* Holds bits across byte boundaries */
 	uint32_t NumBits; /* Number of bits in Bits buffer */
 
 	uint8_t* NextIn;   /* Pointer within Input buffer to next byte that can be read */
@@ -62,6 +62,7 @@ struct InflateState {
 		struct HuffmanTable Lits;           /* Values represent literal or lengths */
 	} Table; /* union to save on memory */
 	struct HuffmanTable TableDists;         /* Values represent distances back */
+	int16_t LitPairs[1 << INFLATE_FAST_BITS]; /* Literal that fully fits in the bits after a literal in Table.Lits.Fast */
 	uint8_t Window[INFLATE_WINDOW_SIZE];    /* Holds circular buffer of recent output data, used for LZ77 */
 };
 
@@ -81,10 +82,18 @@ CC_API void Inflate_MakeStream(struct Stream* stream, struct InflateState* state
 #define DEFLATE_OUT_SIZE 8192
 #define DEFLATE_HASH_SIZE 0x1000UL
 #define DEFLATE_HASH_MASK 0x0FFFUL
+/* How much effort the compressor spends on making output smaller */
+enum DeflateLevel {
+	DEFLATE_LEVEL_FAST,    /* Shallow match search, no lazy matching, fixed huffman codes */
+	DEFLATE_LEVEL_DEFAULT, /* Shallow match search with lazy matching, dynamic huffman codes */
+	DEFLATE_LEVEL_MAX      /* Deep match search with lazy matching, dynamic huffman codes */
+};
+
 struct DeflateState {
 	uint32_t Bits;         /* Holds bits across byte boundaries */
 	uint32_t NumBits;      /* Number of bits in Bits buffer */
 	uint32_t InputPosition;
+	uint8_t Level;         /* Compression level (see DeflateLevel enum) */
 
 	uint8_t* NextOut;    /* Pointer within Output buffer to next byte that can be written */
 	uint32_t AvailOut;   /* Max number of bytes that can be written to Output buffer */
@@ -98,20 +107,31 @@ struct DeflateState {
 	int Head[DEFLATE_HASH_SIZE];
 	int Prev[DEFLATE_BUFFER_SIZE];
 	bool WroteHeader;
+
+	uint32_t NumSyms;                    /* Number of symbols buffered for current dynamic huffman block */
+	uint16_t SymLits[DEFLATE_BLOCK_SIZE];  /* Literal value or match length of each buffered symbol */
+	uint16_t SymDists[DEFLATE_BLOCK_SIZE]; /* Match distance of each buffered symbol, 0 for literals */
 };
 /* Compresses input data using DEFLATE, then writes compressed output to another stream. Write only stream. */
 /* DEFLATE compression is pure compressed data, there is no header or footer. */
+/* NOTE: Uses DEFLATE_LEVEL_DEFAULT, use Deflate_MakeStreamEx to choose a different compression level. */
 CC_API void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying);
+/* Same as Deflate_MakeStream, but level is one of the DeflateLevel enum values. */
+CC_API void Deflate_MakeStreamEx(struct Stream* stream, struct DeflateState* state, struct Stream* underlying, int level);
 
 struct GZipState { struct DeflateState Base; uint32_t Crc32, Size; };
 /* Compresses input data using GZIP, then writes compressed output to another stream. Write only stream. */
 /* GZIP compression is GZIP header, followed by DEFLATE compressed data, followed by GZIP footer. */
 CC_API void GZip_MakeStream(struct Stream* stream, struct GZipState* state, struct Stream* underlying);
+/* Same as GZip_MakeStream, but level is one of the DeflateLevel enum values. */
+CC_API void GZip_MakeStreamEx(struct Stream* stream, struct GZipState* state, struct Stream* underlying, int level);
 
 struct ZLibState { struct DeflateState Base; uint32_t Adler32; };
 /* Compresses input data using ZLIB, then writes compressed output to another stream. Write only stream. */
 /* ZLIB compression is ZLIB header, followed by DEFLATE compressed data, followed by ZLIB footer. */
 CC_API void ZLib_MakeStream(struct Stream* stream, struct ZLibState* state, struct Stream* underlying);
+/* Same as ZLib_MakeStream, but level is one of the DeflateLevel enum values. */
+CC_API void ZLib_MakeStreamEx(struct Stream* stream, struct ZLibState* state, struct Stream* underlying, int level);
 
 /* Minimal data needed to describe an entry in a .zip archive. */
 struct ZipEntry { uint32_t CompressedSize, UncompressedSize, LocalHeaderOffset, CRC32; };
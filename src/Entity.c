@@ -216,11 +216,234 @@ bool Entity_TouchesAnyWater(struct Entity* e) {
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------EntityGrid--------------------------------------------------------*
+*#########################################################################################################################*/
+struct _EntityGridData EntityGrid;
+#define GRID_BUCKETS 64
+
+/* NOTE: Entity IDs and buckets are stored plus 1, so that 0 means none. */
+static uint16_t grid_heads[GRID_BUCKETS];
+static uint16_t grid_next[ENTITIES_MAX_COUNT];
+static uint16_t grid_bucket[ENTITIES_MAX_COUNT];
+static Vector3I grid_cell[ENTITIES_MAX_COUNT];
+/* Bounding sphere of each entity in the grid */
+static Vector3 grid_centre[ENTITIES_MAX_COUNT];
+static float   grid_radius[ENTITIES_MAX_COUNT];
+/* Largest bounding sphere radius of any entity in the grid */
+static float grid_maxRadius;
+/* Whether bucket was already visited in the current query */
+static int grid_bucketStamp[GRID_BUCKETS], grid_stamp;
+
+static int EntityGrid_Hash(int x, int y, int z) {
+	uint32_t hash = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+	return (int)(hash & (GRID_BUCKETS - 1));
+}
+
+static void EntityGrid_GetCell(const Vector3* pos, Vector3I* cell) {
+	cell->X = Math_Floor(pos->X / ENTITYGRID_CELL_SIZE);
+	cell->Y = Math_Floor(pos->Y / ENTITYGRID_CELL_SIZE);
+	cell->Z = Math_Floor(pos->Z / ENTITYGRID_CELL_SIZE);
+}
+
+static void EntityGrid_Expand(struct AABB* bb, const Vector3* pos) {
+	bb->Min.X = min(bb->Min.X, pos->X); bb->Max.X = max(bb->Max.X, pos->X);
+	bb->Min.Y = min(bb->Min.Y, pos->Y); bb->Max.Y = max(bb->Max.Y, pos->Y);
+	bb->Min.Z = min(bb->Min.Z, pos->Z); bb->Max.Z = max(bb->Max.Z, pos->Z);
+}
+
+/* Calculates a sphere that bounds the entity's model and collision box until the next tick */
+/* NOTE: Model bounds are the same as used by Model_ShouldRender, which limbs might extend past */
+static void EntityGrid_CalcBounds(EntityID id, struct Entity* e) {
+	struct AABB bb, model;
+	Vector3 size;
+	float extent, height;
+	bb.Min = e->Position; bb.Max = e->Position;
+
+	/* Position is interpolated between previous and next tick's state */
+	if (e == &LocalPlayer_Instance.Base) {
+		EntityGrid_Expand(&bb, &LocalPlayer_Instance.Interp.Prev.Pos);
+		EntityGrid_Expand(&bb, &LocalPlayer_Instance.Interp.Next.Pos);
+	} else if (id < ENTITIES_SELF_ID && e == &NetPlayers_List[id].Base) {
+		EntityGrid_Expand(&bb, &NetPlayers_List[id].Interp.Prev.Pos);
+		EntityGrid_Expand(&bb, &NetPlayers_List[id].Interp.Next.Pos);
+	}
+
+	Vector3_Sub(&size, &e->ModelAABB.Max, &e->ModelAABB.Min);
+	extent = max(size.X, max(size.Y, size.Z));
+	height = size.Y * 0.5f;
+
+	model.Min.X = -extent; model.Min.Y = height - extent; model.Min.Z = -extent;
+	model.Max.X =  extent; model.Max.Y = height + extent; model.Max.Z =  extent;
+	model.Min.X = min(model.Min.X, -e->Size.X * 0.5f); model.Max.X = max(model.Max.X, e->Size.X * 0.5f);
+	model.Min.Y = min(model.Min.Y, 0.0f);              model.Max.Y = max(model.Max.Y, e->Size.Y);
+	model.Min.Z = min(model.Min.Z, -e->Size.Z * 0.5f); model.Max.Z = max(model.Max.Z, e->Size.Z * 0.5f);
+	Vector3_AddBy(&bb.Min, &model.Min);
+	Vector3_AddBy(&bb.Max, &model.Max);
+
+	Vector3_Lerp(&grid_centre[id], &bb.Min, &bb.Max, 0.5f);
+	Vector3_Sub(&size, &bb.Max, &bb.Min);
+	grid_radius[id] = Math_SqrtF(Vector3_LengthSquared(&size)) * 0.5f;
+}
+
+void EntityGrid_Update(EntityID id) {
+	struct Entity* e = Entities.List[id];
+	Vector3I cell;
+	int bucket;
+	if (!e) { EntityGrid_Remove(id); return; }
+
+	EntityGrid_CalcBounds(id, e);
+	grid_maxRadius = max(grid_maxRadius, grid_radius[id]);
+
+	EntityGrid_GetCell(&grid_centre[id], &cell);
+	if (grid_bucket[id] && Vector3I_Equals(&cell, &grid_cell[id])) return;
+	EntityGrid_Remove(id);
+
+	bucket = EntityGrid_Hash(cell.X, cell.Y, cell.Z);
+	grid_next[id]      = grid_heads[bucket];
+	grid_heads[bucket] = id + 1;
+	grid_bucket[id]    = bucket + 1;
+	grid_cell[id]      = cell;
+	EntityGrid.Moves++;
+}
+
+void EntityGrid_Remove(EntityID id) {
+	uint16_t* link;
+	int bucket = grid_bucket[id] - 1;
+	if (bucket < 0) return;
+
+	for (link = &grid_heads[bucket]; *link != id + 1; link = &grid_next[*link - 1]) { }
+	*link = grid_next[id];
+	grid_bucket[id] = 0;
+}
+
+static void EntityGrid_EntityAdded(void* obj, int id) { EntityGrid_Update((EntityID)id); }
+
+typedef bool (*EntityGrid_Filter)(EntityID id, const void* obj);
+/* Adds the entities in the given bucket which pass the filter, if bucket was not already visited */
+static int EntityGrid_VisitBucket(int bucket, EntityGrid_Filter filter, const void* obj, EntityID* ids, int count) {
+	int id;
+	if (grid_bucketStamp[bucket] == grid_stamp) return count;
+	grid_bucketStamp[bucket] = grid_stamp;
+	EntityGrid.CellsVisited++;
+
+	for (id = grid_heads[bucket] - 1; id >= 0; id = grid_next[id] - 1) {
+		EntityGrid.Tested++;
+		if (filter((EntityID)id, obj)) ids[count++] = (EntityID)id;
+	}
+	return count;
+}
+
+/* Finds entities passing the filter whose bounding sphere centre may lie within the given box. */
+static int EntityGrid_Query(const struct AABB* bb, EntityGrid_Filter filter, const void* obj, EntityID* ids) {
+	Vector3 expand = Vector3_Create1(grid_maxRadius);
+	Vector3 pMin, pMax;
+	Vector3I min, max;
+	int x, y, z, count = 0;
+
+	EntityGrid.Queries++;
+	grid_stamp++;
+	Vector3_Sub(&pMin, &bb->Min, &expand); EntityGrid_GetCell(&pMin, &min);
+	Vector3_Add(&pMax, &bb->Max, &expand); EntityGrid_GetCell(&pMax, &max);
+
+	/* Cheaper to just check every bucket when query covers many cells */
+	if ((float)(max.X - min.X + 1) * (max.Y - min.Y + 1) * (max.Z - min.Z + 1) > GRID_BUCKETS) {
+		for (x = 0; x < GRID_BUCKETS; x++) {
+			count = EntityGrid_VisitBucket(x, filter, obj, ids, count);
+		}
+		return count;
+	}
+
+	for (y = min.Y; y <= max.Y; y++) {
+		for (z = min.Z; z <= max.Z; z++) {
+			for (x = min.X; x <= max.X; x++) {
+				count = EntityGrid_VisitBucket(EntityGrid_Hash(x, y, z), filter, obj, ids, count);
+			}
+		}
+	}
+	return count;
+}
+
+static bool EntityGrid_IntersectsAABB(EntityID id, const void* obj) {
+	const struct AABB* bb = (const struct AABB*)obj;
+	Vector3 p = grid_centre[id];
+	float r = grid_radius[id], dx, dy, dz;
+
+	dx = p.X < bb->Min.X ? bb->Min.X - p.X : (p.X > bb->Max.X ? p.X - bb->Max.X : 0.0f);
+	dy = p.Y < bb->Min.Y ? bb->Min.Y - p.Y : (p.Y > bb->Max.Y ? p.Y - bb->Max.Y : 0.0f);
+	dz = p.Z < bb->Min.Z ? bb->Min.Z - p.Z : (p.Z > bb->Max.Z ? p.Z - bb->Max.Z : 0.0f);
+	return dx * dx + dy * dy + dz * dz <= r * r;
+}
+
+int EntityGrid_QueryAABB(const struct AABB* bb, EntityID* ids) {
+	return EntityGrid_Query(bb, EntityGrid_IntersectsAABB, bb, ids);
+}
+
+struct EntityGridSphere { Vector3 Pos; float Radius; };
+static bool EntityGrid_IntersectsSphere(EntityID id, const void* obj) {
+	const struct EntityGridSphere* sphere = (const struct EntityGridSphere*)obj;
+	float r = grid_radius[id] + sphere->Radius;
+	Vector3 delta;
+
+	Vector3_Sub(&delta, &grid_centre[id], &sphere->Pos);
+	return Vector3_LengthSquared(&delta) <= r * r;
+}
+
+int EntityGrid_QueryRadius(const Vector3* pos, float radius, EntityID* ids) {
+	struct EntityGridSphere sphere;
+	struct AABB bb;
+	Vector3 expand = Vector3_Create1(radius);
+
+	sphere.Pos = *pos; sphere.Radius = radius;
+	Vector3_Sub(&bb.Min, pos, &expand);
+	Vector3_Add(&bb.Max, pos, &expand);
+	return EntityGrid_Query(&bb, EntityGrid_IntersectsSphere, &sphere, ids);
+}
+
+int EntityGrid_QueryFrustum(EntityID* ids) {
+	/* Radius of sphere around a cell, that bounds all entities whose centre lies in that cell */
+	float cellRadius = ENTITYGRID_CELL_SIZE * 0.8660254f + grid_maxRadius;
+	float half = ENTITYGRID_CELL_SIZE * 0.5f;
+	Vector3I cell = { 0, 0, 0 };
+	bool cellVisible = false, first;
+	Vector3 p;
+	int bucket, id, count = 0;
+
+	EntityGrid.Queries++;
+	for (bucket = 0; bucket < GRID_BUCKETS; bucket++) {
+		if (!grid_heads[bucket]) continue;
+		EntityGrid.CellsVisited++;
+		first = true;
+
+		for (id = grid_heads[bucket] - 1; id >= 0; id = grid_next[id] - 1) {
+			/* Most buckets only contain entities from one cell, so only test each cell once */
+			if (first || !Vector3I_Equals(&cell, &grid_cell[id])) {
+				cell = grid_cell[id]; first = false;
+				cellVisible = FrustumCulling_SphereInFrustum(cell.X * ENTITYGRID_CELL_SIZE + half,
+					cell.Y * ENTITYGRID_CELL_SIZE + half, cell.Z * ENTITYGRID_CELL_SIZE + half, cellRadius);
+			}
+			if (!cellVisible) continue;
+
+			EntityGrid.Tested++;
+			p = grid_centre[id];
+			if (FrustumCulling_SphereInFrustum(p.X, p.Y, p.Z, grid_radius[id])) ids[count++] = (EntityID)id;
+		}
+	}
+
+	for (id = 0; id < ENTITIES_MAX_COUNT; id++) {
+		if (Entities.List[id] && !grid_bucket[id]) ids[count++] = (EntityID)id;
+	}
+	return count;
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------Entities---------------------------------------------------------*
 *#########################################################################################################################*/
 struct _EntitiesData Entities;
 static EntityID entities_closestId;
+/* Whether entity was outside the view frustum when last rendered */
+static bool entities_culled[ENTITIES_MAX_COUNT];
 
 void Entities_Tick(struct ScheduledTask* task) {
 	int i;
@@ -228,17 +451,38 @@ void Entities_Tick(struct ScheduledTask* task) {
 		if (!Entities.List[i]) continue;
 		Entities.List[i]->VTABLE->Tick(Entities.List[i], task->Interval);
 	}
+
+	/* Entities may have moved, and maximum radius may have shrunk */
+	grid_maxRadius = 0.0f;
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
+		if (!Entities.List[i]) continue;
+		EntityGrid_Update((EntityID)i);
+	}
 }
 
 void Entities_RenderModels(double delta, float t) {
-	int i;
+	EntityID ids[ENTITIES_MAX_COUNT];
+	int i, count, total = 0;
 	Gfx_SetTexturing(true);
 	Gfx_SetAlphaTest(true);
+
+	count = EntityGrid_QueryFrustum(ids);
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) { entities_culled[i] = true; }
+	for (i = 0; i < count; i++) { entities_culled[ids[i]] = false; }
+	/* Local player is never culled, as first person view still uses its animation state */
+	entities_culled[ENTITIES_SELF_ID] = false;
 	
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
 		if (!Entities.List[i]) continue;
 		Entities.List[i]->VTABLE->RenderModel(Entities.List[i], delta, t);
+		total++;
 	}
+
+	EntityGrid.InView = 0;
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
+		if (Entities.List[i] && !entities_culled[i]) EntityGrid.InView++;
+	}
+	EntityGrid.Culled = total - EntityGrid.InView;
 	Gfx_SetTexturing(false);
 	Gfx_SetAlphaTest(false);
 }
@@ -259,7 +503,7 @@ void Entities_RenderNames(double delta) {
 	if (hadFog) Gfx_SetFog(false);
 
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
-		if (!Entities.List[i]) continue;
+		if (!Entities.List[i] || entities_culled[i]) continue;
 		if (i != entities_closestId || i == ENTITIES_SELF_ID) {
 			Entities.List[i]->VTABLE->RenderName(Entities.List[i]);
 		}
@@ -286,7 +530,7 @@ void Entities_RenderHoveredNames(double delta) {
 	if (hadFog) Gfx_SetFog(false);
 
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
-		if (!Entities.List[i]) continue;
+		if (!Entities.List[i] || entities_culled[i]) continue;
 		if ((i == entities_closestId || allNames) && i != ENTITIES_SELF_ID) {
 			Entities.List[i]->VTABLE->RenderName(Entities.List[i]);
 		}
@@ -320,7 +564,13 @@ static void Entities_ChatFontChanged(void* obj) {
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
 		if (!Entities.List[i]) continue;
 		if (Entities.List[i]->EntityType != ENTITY_TYPE_PLAYER) continue;
-		Player_UpdateNameTex((struct Player*)Entities.List[i]);
+
+		/* Name texture of culled entities is remade when next drawn instead */
+		if (entities_culled[i]) {
+			Entities.List[i]->VTABLE->ContextLost(Entities.List[i]);
+		} else {
+			Player_UpdateNameTex((struct Player*)Entities.List[i]);
+		}
 	}
 }
 
@@ -328,6 +578,7 @@ void Entities_Remove(EntityID id) {
 	Event_RaiseInt(&EntityEvents.Removed, id);
 	Entities.List[id]->VTABLE->Despawn(Entities.List[id]);
 	Entities.List[id] = NULL;
+	EntityGrid_Remove(id);
 }
 
 EntityID Entities_GetCloset(struct Entity* src) {
@@ -351,6 +602,15 @@ EntityID Entities_GetCloset(struct Entity* src) {
 	return targetId;
 }
 
+/* Whether the shadow under the given entity might be visible */
+static bool Entities_ShadowInView(EntityID id) {
+	struct Entity* e = Entities.List[id];
+	if (!entities_culled[id]) return true;
+
+	/* Shadows fade out completely 6 blocks below an entity */
+	return FrustumCulling_SphereInFrustum(e->Position.X, e->Position.Y - 3.0f, e->Position.Z, 4.0f);
+}
+
 void Entities_DrawShadows(void) {
 	int i;
 	if (Entities.ShadowsMode == SHADOW_MODE_NONE) return;
@@ -368,6 +628,7 @@ void Entities_DrawShadows(void) {
 		for (i = 0; i < ENTITIES_SELF_ID; i++) {
 			if (!Entities.List[i]) continue;
 			if (Entities.List[i]->EntityType != ENTITY_TYPE_PLAYER) continue;
+			if (!Entities_ShadowInView((EntityID)i)) continue;
 			ShadowComponent_Draw(Entities.List[i]);
 		}
 	}
@@ -837,6 +1098,7 @@ static void LocalPlayer_HandleInput(float* xMoving, float* zMoving) {
 static void LocalPlayer_SetLocation(struct Entity* e, struct LocationUpdate* update, bool interpolate) {
 	struct LocalPlayer* p = (struct LocalPlayer*)e;
 	LocalInterpComp_SetLocation(&p->Interp, update, interpolate);
+	EntityGrid_Update(ENTITIES_SELF_ID);
 }
 
 static void LocalPlayer_Tick(struct Entity* e, double delta) {
@@ -846,7 +1108,7 @@ static void LocalPlayer_Tick(struct Entity* e, double delta) {
 	bool wasOnGround;
 	Vector3 headingVelocity;
 
-	if (!World.Blocks) return;
+	if (!World.Loaded) return;
 	e->StepSize = hacks->FullBlockStep && hacks->Enabled && hacks->CanAnyHacks && hacks->CanSpeed ? 1.0f : 0.5f;
 	p->OldVelocity = e->Velocity;
 	wasOnGround    = e->OnGround;
@@ -956,7 +1218,7 @@ static void LocalPlayer_DoRespawn(void) {
 	float height, spawnY;
 	int y;
 
-	if (!World.Blocks) return;
+	if (!World.Loaded) return;
 	Vector3I_Floor(&pos, &spawn);	
 
 	/* Spawn player at highest solid position to match vanilla Minecraft classic */
@@ -1086,6 +1348,7 @@ struct NetPlayer NetPlayers_List[ENTITIES_SELF_ID];
 static void NetPlayer_SetLocation(struct Entity* e, struct LocationUpdate* update, bool interpolate) {
 	struct NetPlayer* p = (struct NetPlayer*)e;
 	NetInterpComp_SetLocation(&p->Interp, update, interpolate);
+	EntityGrid_Update((EntityID)(p - NetPlayers_List));
 }
 
 static void NetPlayer_Tick(struct Entity* e, double delta) {
@@ -1098,6 +1361,10 @@ static void NetPlayer_Tick(struct Entity* e, double delta) {
 static void NetPlayer_RenderModel(struct Entity* e, double deltaTime, float t) {
 	struct NetPlayer* p = (struct NetPlayer*)e;
 	Vector3_Lerp(&e->Position, &p->Interp.Prev.Pos, &p->Interp.Next.Pos, t);
+	/* Position is still needed by picking and pushing, but not the rest */
+	p->ShouldRender = false;
+	if (entities_culled[p - NetPlayers_List]) return;
+
 	InterpComp_LerpAngles((struct InterpComp*)(&p->Interp), e, t);
 
 	AnimatedComp_GetCurrent(e, t);
@@ -1147,6 +1414,8 @@ static void Entities_Init(void) {
 
 	Entities.List[ENTITIES_SELF_ID] = &LocalPlayer_Instance.Base;
 	LocalPlayer_Init();
+	EntityGrid_Update(ENTITIES_SELF_ID);
+	Event_RegisterInt(&EntityEvents.Added, NULL, EntityGrid_EntityAdded);
 }
 
 static void Entities_Free(void) {
@@ -1159,6 +1428,7 @@ static void Entities_Free(void) {
 	Event_UnregisterVoid(&GfxEvents.ContextLost,      NULL, Entities_ContextLost);
 	Event_UnregisterVoid(&GfxEvents.ContextRecreated, NULL, Entities_ContextRecreated);
 	Event_UnregisterVoid(&ChatEvents.FontChanged,     NULL, Entities_ChatFontChanged);
+	Event_UnregisterInt(&EntityEvents.Added,          NULL, EntityGrid_EntityAdded);
 
 	if (ShadowComponent_ShadowTex) {
 		Gfx_DeleteTexture(&ShadowComponent_ShadowTex);
@@ -137,6 +137,33 @@ EntityID Entities_GetCloset(struct Entity* src);
 /* Draws shadows under entities, depending on Entities.ShadowsMode */
 void Entities_DrawShadows(void);
 
+/* Size of a cell in the entity grid, in blocks. */
+#define ENTITYGRID_CELL_SIZE 16
+/* Uniform spatial hash of entities. Each entity is stored as a sphere that bounds */
+/* its model over the whole interpolation interval until the next tick. */
+CC_VAR extern struct _EntityGridData {
+	/* Number of times entities moved to a different cell. */
+	int Moves;
+	/* Number of queries, cells visited and entities tested by queries. */
+	int Queries, CellsVisited, Tested;
+	/* Number of entities in view and culled in the last rendered frame. */
+	int InView, Culled;
+} EntityGrid;
+
+/* Updates the position of the given entity in the grid, adding it to the grid if necessary. */
+/* NOTE: Entities are automatically updated every tick and when added/removed. */
+void EntityGrid_Update(EntityID id);
+/* Removes the given entity from the grid. */
+void EntityGrid_Remove(EntityID id);
+/* Finds all entities whose bounding spheres intersect the given bounding box. Returns number found. */
+/* NOTE: ids must have room for ENTITIES_MAX_COUNT entries. */
+int EntityGrid_QueryAABB(const struct AABB* bb, EntityID* ids);
+/* Finds all entities whose bounding spheres intersect the given sphere. Returns number found. */
+int EntityGrid_QueryRadius(const Vector3* pos, float radius, EntityID* ids);
+/* Finds all entities whose bounding spheres are inside the current view frustum. Returns number found. */
+/* NOTE: Entities not yet added to the grid are always included. */
+int EntityGrid_QueryFrustum(EntityID* ids);
+
 #define TABLIST_MAX_NAMES 256
 /* Data for all entries in tab list */
 CC_VAR extern struct _TabListData {
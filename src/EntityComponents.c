@@ -1213,15 +1213,23 @@ void PhysicsComp_CalculateJumpVelocity(struct PhysicsComp* comp, float jumpHeigh
 }
 
 void PhysicsComp_DoEntityPush(struct Entity* entity) {
+	EntityID ids[ENTITIES_MAX_COUNT];
 	struct Entity* other;
+	struct AABB bb;
 	bool yIntersects;
 	Vector3 dir;
 	float dist, pushStrength;
-	int id;
+	int i, count;
 	dir.Y = 0.0f;
 
-	for (id = 0; id < ENTITIES_MAX_COUNT; id++) {
-		other = Entities.List[id];
+	/* Only entities within 1 block horizontally can push */
+	Entity_GetBounds(entity, &bb);
+	bb.Min.X = entity->Position.X - 1.0f; bb.Max.X = entity->Position.X + 1.0f;
+	bb.Min.Z = entity->Position.Z - 1.0f; bb.Max.Z = entity->Position.Z + 1.0f;
+	count = EntityGrid_QueryAABB(&bb, ids);
+
+	for (i = 0; i < count; i++) {
+		other = Entities.List[ids[i]];
 		if (!other || other == entity) continue;
 		if (!other->Model->Pushes)     continue;
 
@@ -109,7 +109,7 @@ static void EnvRenderer_UpdateFogNormal(float fogDensity, PackedCol fogCol) {
 
 void EnvRenderer_UpdateFog(void) {
 	float fogDensity; PackedCol fogCol;
-	if (!World.Blocks) return;
+	if (!World.Loaded) return;
 
 	EnvRenderer_CalcFog(&fogDensity, &fogCol);
 	Gfx_ClearCol(fogCol);
@@ -183,7 +183,7 @@ static void EnvRenderer_UpdateClouds(void) {
 	int extent;
 	int x1, z1, x2, z2;
 	
-	if (!World.Blocks || Gfx.LostContext) return;
+	if (!World.Loaded || Gfx.LostContext) return;
 	Gfx_DeleteVb(&clouds_vb);
 	if (EnvRenderer_Minimal) return;
 
@@ -262,7 +262,7 @@ static void EnvRenderer_UpdateSky(void) {
 	int extent, height;
 	int x1, z1, x2, z2;
 
-	if (!World.Blocks || Gfx.LostContext) return;
+	if (!World.Loaded || Gfx.LostContext) return;
 	Gfx_DeleteVb(&sky_vb);
 	if (EnvRenderer_Minimal) return;
 
@@ -389,7 +389,9 @@ static int EnvRenderer_CalcRainHeightAt(int x, int maxY, int z, int hIndex) {
 	int i = World_Pack(x, maxY, z), y;
 	uint8_t draw;
 
-#ifndef EXTENDED_BLOCKS
+#if defined SPARSE_WORLD
+	EnvRenderer_RainCalcBody(World_GetBlock(x, y, z));
+#elif !defined EXTENDED_BLOCKS
 	EnvRenderer_RainCalcBody(World.Blocks[i]);
 #else
 	if (Block_UsedCount <= 256) {
@@ -438,6 +440,16 @@ void EnvRenderer_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID n
 	}
 }
 
+void EnvRenderer_OnColumnChanged(int x, int z, int maxY) {
+	int hIndex = Weather_Pack(x, z);
+	int height = Weather_Heightmap[hIndex];
+	/* Same as EnvRenderer_OnBlockChanged, skip if rain height not calculated or all changes below it */
+	if (maxY < height) return;
+
+	/* Blocks above both the old rain height and the highest changed block can't block rain */
+	EnvRenderer_CalcRainHeightAt(x, max(height, maxY), z, hIndex);
+}
+
 static float EnvRenderer_RainAlphaAt(float x) {
 	/* Wolfram Alpha: fit {0,178},{1,169},{4,147},{9,114},{16,59},{25,9} */
 	float falloff = 0.05f * x * x - 7 * x;
@@ -694,7 +706,7 @@ static void EnvRenderer_UpdateMapSides(void) {
 	VertexP3fT2fC4b* ptr;
 	VertexP3fT2fC4b* cur;
 
-	if (!World.Blocks || Gfx.LostContext) return;
+	if (!World.Loaded || Gfx.LostContext) return;
 	Gfx_DeleteVb(&sides_vb);
 	block = Env.SidesBlock;
 
@@ -753,7 +765,7 @@ static void EnvRenderer_UpdateMapEdges(void) {
 	VertexP3fT2fC4b* ptr;
 	VertexP3fT2fC4b* cur;
 
-	if (!World.Blocks || Gfx.LostContext) return;
+	if (!World.Loaded || Gfx.LostContext) return;
 	Gfx_DeleteVb(&edges_vb);
 	block = Env.EdgeBlock;
 
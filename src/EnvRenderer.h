@@ -28,6 +28,8 @@ bool EnvRenderer_ShouldRenderSkybox(void);
 
 extern int16_t* Weather_Heightmap;
 void EnvRenderer_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+/* Called after several blocks in a column were changed at once, where maxY is the highest changed block. */
+void EnvRenderer_OnColumnChanged(int x, int z, int maxY);
 /* Renders rainfall/snowfall weather. */
 void EnvRenderer_RenderWeather(double deltaTime);
 
@@ -26,6 +26,35 @@ static ReturnCode Map_ReadBlocks(struct Stream* stream) {
 	return Stream_Read(stream, World.Blocks, World.Volume);
 }
 
+/* Writes the lower (shift 0) or upper (shift 8) 8 bits of every block in the world */
+#ifdef SPARSE_WORLD
+static ReturnCode Map_WriteBlocks(struct Stream* stream, int shift) {
+	uint8_t buffer[8192];
+	int x, y, z, count = 0;
+	ReturnCode res;
+
+	for (y = 0; y < World.Height; y++) {
+		for (z = 0; z < World.Length; z++) {
+			for (x = 0; x < World.Width; x++) {
+				buffer[count++] = (BlockRaw)(World_GetBlock(x, y, z) >> shift);
+				if (count < sizeof(buffer)) continue;
+
+				if ((res = Stream_Write(stream, buffer, count))) return res;
+				count = 0;
+			}
+		}
+	}
+	return Stream_Write(stream, buffer, count);
+}
+#else
+static ReturnCode Map_WriteBlocks(struct Stream* stream, int shift) {
+#ifdef EXTENDED_BLOCKS
+	if (shift) return Stream_Write(stream, World.Blocks2, World.Volume);
+#endif
+	return Stream_Write(stream, World.Blocks, World.Volume);
+}
+#endif
+
 static ReturnCode Map_SkipGZipHeader(struct Stream* stream) {
 	struct GZipHeader gzHeader;
 	ReturnCode res;
@@ -49,28 +78,216 @@ IMapImporter Map_FindImporter(const String* path) {
 	return NULL;
 }
 
-void Map_LoadFrom(const String* path) {
-	struct LocalPlayer* p = &LocalPlayer_Instance;
-	struct LocationUpdate update;
-	IMapImporter importer;
-	struct Stream stream;
-	ReturnCode res;
 
+/*########################################################################################################################*
+*-------------------------------------------------Background load/save-----------------------------------------------------*
+*#########################################################################################################################*/
+volatile float Map_TaskProgress;
+volatile bool  Map_TaskDone;
+
+static String map_taskPath; static char map_taskPathBuffer[FILENAME_SIZE];
+static const char* map_taskAction;
+static ReturnCode map_taskRes;
+static bool map_taskClosed;
+
+/* Fields of a MapBlockDef that were present in the map file */
+enum MapBlockDefField {
+	MAPDEF_COLLIDE = 0x001, MAPDEF_SPEED = 0x002, MAPDEF_LIGHT = 0x004, MAPDEF_BRIGHT = 0x008,
+	MAPDEF_DRAW    = 0x010, MAPDEF_SHAPE = 0x020, MAPDEF_NAME  = 0x040, MAPDEF_TEX    = 0x080,
+	MAPDEF_SOUND   = 0x100, MAPDEF_FOG   = 0x200, MAPDEF_COORDS = 0x400
+};
+
+/* A custom block definition read from a map, applied to Blocks in Map_EndLoad */
+struct MapBlockDef {
+	BlockID ID;
+	int Fields;
+	uint8_t Collide, Draw, Shape, Sound;
+	bool BlocksLight, FullBright;
+	float Speed, FogDensity;
+	PackedCol FogCol;
+	TextureLoc Tex[FACE_COUNT];
+	Vector3 MinBB, MaxBB;
+	uint8_t NameLen; char Name[STRING_SIZE];
+};
+
+/* Importers run on a background thread, so anything that raises events, touches the GUI, */
+/* or changes block properties the main thread is using, is instead recorded here, */
+/* and then applied on the main thread in Map_EndLoad */
+static struct MapDeferred {
+	bool SetSunCol, SetShadowCol;
+	PackedCol SunCol, ShadowCol;
+	String TexUrl; char __TexUrlBuffer[STRING_SIZE];
+	uint32_t DefinedBlocks[BLOCK_COUNT >> 5];
+	struct MapBlockDef* Defs;
+	int DefsCount, DefsCapacity;
+} map_deferred;
+
+static uint8_t* map_saveData;
+static uint32_t map_saveSize;
+
+static void Map_SetResult(ReturnCode res, const char* action) {
+	map_taskRes    = res;
+	map_taskAction = action;
+}
+
+static ReturnCode Map_ProgressRead(struct Stream* s, uint8_t* data, uint32_t count, uint32_t* modified) {
+	struct Stream* source = s->Meta.Portion.Source;
+	ReturnCode res = source->Read(source, data, count, modified);
+
+	s->Meta.Portion.Left -= min(*modified, s->Meta.Portion.Left);
+	Map_TaskProgress = 1.0f - (float)s->Meta.Portion.Left / s->Meta.Portion.Length;
+	return res;
+}
+
+/* Wraps a file stream, updating Map_TaskProgress as data is read from it */
+static void Map_ProgressStream(struct Stream* s, struct Stream* source) {
+	uint32_t length;
+	Stream_Init(s);
+	s->Read = Map_ProgressRead;
+
+	if (source->Length(source, &length) || !length) length = 1;
+	s->Meta.Portion.Source = source;
+	s->Meta.Portion.Left   = length;
+	s->Meta.Portion.Length = length;
+}
+
+static void Map_AddBlockDef(const struct MapBlockDef* def) {
+	struct MapDeferred* d = &map_deferred;
+	BlockID id = def->ID;
+
+	if (d->DefsCount == d->DefsCapacity) {
+		d->DefsCapacity = d->DefsCapacity ? d->DefsCapacity * 2 : 64;
+		d->Defs = Mem_Realloc(d->Defs, d->DefsCapacity, sizeof(struct MapBlockDef), "map block defs");
+	}
+	d->Defs[d->DefsCount++] = *def;
+	d->DefinedBlocks[id >> 5] |= 1u << (id & 0x1F);
+}
+
+static void Map_ApplyBlockDef(const struct MapBlockDef* def) {
+	BlockID id = def->ID;
+	String name;
+	int i;
+
+	if (def->Fields & MAPDEF_COLLIDE) Block_SetCollide(id, def->Collide);
+	if (def->Fields & MAPDEF_SPEED)   Blocks.SpeedMultiplier[id] = def->Speed;
+	if (def->Fields & MAPDEF_LIGHT)   Blocks.BlocksLight[id]     = def->BlocksLight;
+	if (def->Fields & MAPDEF_BRIGHT)  Blocks.FullBright[id]      = def->FullBright;
+	if (def->Fields & MAPDEF_DRAW)    Blocks.Draw[id]            = def->Draw;
+	if (def->Fields & MAPDEF_SHAPE)   Blocks.SpriteOffset[id]    = def->Shape;
+
+	if (def->Fields & MAPDEF_NAME) {
+		name = String_Init((char*)def->Name, def->NameLen, STRING_SIZE);
+		Block_SetName(id, &name);
+	}
+	if (def->Fields & MAPDEF_TEX) {
+		for (i = 0; i < FACE_COUNT; i++) { Block_Tex(id, i) = def->Tex[i]; }
+	}
+	if (def->Fields & MAPDEF_SOUND) {
+		Blocks.DigSounds[id]  = def->Sound;
+		Blocks.StepSounds[id] = def->Sound;
+		if (def->Sound == SOUND_GLASS) Blocks.StepSounds[id] = SOUND_STONE;
+	}
+	if (def->Fields & MAPDEF_FOG) {
+		Blocks.FogDensity[id] = def->FogDensity;
+		Blocks.FogCol[id]     = def->FogCol;
+	}
+	if (def->Fields & MAPDEF_COORDS) {
+		Blocks.MinBB[id] = def->MinBB;
+		Blocks.MaxBB[id] = def->MaxBB;
+	}
+
+	/* hack for sprite draw (can't rely on order of tags when reading) */
+	if (Blocks.SpriteOffset[id] == 0) {
+		Blocks.SpriteOffset[id] = Blocks.Draw[id];
+		Blocks.Draw[id] = DRAW_SPRITE;
+	} else {
+		Blocks.SpriteOffset[id] = 0;
+	}
+}
+
+static void Map_FreeDeferred(void) {
+	Mem_Free(map_deferred.Defs);
+	map_deferred.Defs         = NULL;
+	map_deferred.DefsCount    = 0;
+	map_deferred.DefsCapacity = 0;
+}
+
+static void Map_PrepareLoad(const String* path) {
 	World_Reset();
 	Event_RaiseVoid(&WorldEvents.NewMap);
 	Game_Reset();
-	
-	res = Stream_OpenFile(&stream, path);
-	if (res) { Logger_Warn2(res, "opening", path); return; }
 
-	importer = Map_FindImporter(path);
-	if ((res = importer(&stream))) {
-		World_Reset();
-		Logger_Warn2(res, "decoding", path); stream.Close(&stream); return;
+	String_InitArray(map_taskPath, map_taskPathBuffer);
+	String_Copy(&map_taskPath, path);
+	Map_FreeDeferred();
+	Mem_Set(&map_deferred, 0, sizeof(map_deferred));
+	String_InitArray(map_deferred.TexUrl, map_deferred.__TexUrlBuffer);
+
+	Map_SetResult(0, NULL);
+	map_taskClosed   = false;
+	Map_TaskProgress = 0.0f;
+	Map_TaskDone     = false;
+}
+
+static void Map_LoadWorker(void) {
+	IMapImporter importer;
+	struct Stream stream, progStream;
+	ReturnCode res;
+
+	res = Stream_OpenFile(&stream, &map_taskPath);
+	if (res) { Map_SetResult(res, "opening"); Map_TaskDone = true; return; }
+	Map_ProgressStream(&progStream, &stream);
+
+	importer = Map_FindImporter(&map_taskPath);
+	if ((res = importer(&progStream))) {
+		Map_SetResult(res, "decoding"); stream.Close(&stream);
+		Map_TaskDone = true; return;
 	}
 
 	res = stream.Close(&stream);
-	if (res) { Logger_Warn2(res, "closing", path); }
+	if (res) { Map_SetResult(res, "closing"); map_taskClosed = true; }
+	Map_TaskDone = true;
+}
+
+void Map_BeginLoad(const String* path) {
+	Map_PrepareLoad(path);
+	Thread_Start(Map_LoadWorker, true);
+}
+
+void Map_EndLoad(void) {
+	struct LocalPlayer* p = &LocalPlayer_Instance;
+	struct LocationUpdate update;
+	bool defined = false;
+	BlockID b;
+	int i;
+	Map_TaskDone = false;
+
+	if (map_taskRes) {
+		Logger_Warn2(map_taskRes, map_taskAction, &map_taskPath);
+		/* Failing to close the file still leaves a usable map */
+		if (!map_taskClosed) { Map_FreeDeferred(); World_Reset(); return; }
+	}
+
+	if (map_deferred.SetSunCol)    Env_SetSunCol(map_deferred.SunCol);
+	if (map_deferred.SetShadowCol) Env_SetShadowCol(map_deferred.ShadowCol);
+
+	for (i = 0; i < map_deferred.DefsCount; i++) {
+		Map_ApplyBlockDef(&map_deferred.Defs[i]);
+	}
+	Map_FreeDeferred();
+
+	for (b = 1; b < BLOCK_COUNT; b++) {
+		if (!(map_deferred.DefinedBlocks[b >> 5] & (1u << (b & 0x1F)))) continue;
+		Block_DefineCustom(b);
+		Blocks.CanPlace[b]  = true;
+		Blocks.CanDelete[b] = true;
+		defined = true;
+	}
+	if (defined) Event_RaiseVoid(&BlockEvents.PermissionsChanged);
+
+	if (map_deferred.TexUrl.length) {
+		Server_RetrieveTexturePack(&map_deferred.TexUrl);
+	}
 
 	World_SetNewMap(World.Blocks, World.Width, World.Height, World.Length);
 	Event_RaiseVoid(&WorldEvents.MapLoaded);
@@ -79,6 +296,106 @@ void Map_LoadFrom(const String* path) {
 	p->Base.VTABLE->SetLocation(&p->Base, &update, false);
 }
 
+void Map_LoadFrom(const String* path) {
+	Map_PrepareLoad(path);
+	Map_LoadWorker();
+	Map_EndLoad();
+}
+
+static void Map_SaveWorker(void) {
+	struct Stream stream, compStream;
+	struct GZipState* state;
+	uint32_t i, count;
+	ReturnCode res;
+
+	res = Stream_CreateFile(&stream, &map_taskPath);
+	if (res) { Map_SetResult(res, "creating"); Map_TaskDone = true; return; }
+
+	state = Mem_Alloc(1, sizeof(struct GZipState), "map save state");
+	GZip_MakeStreamEx(&compStream, state, &stream, DEFLATE_LEVEL_MAX);
+
+	for (i = 0; i < map_saveSize; i += count) {
+		count = min(map_saveSize - i, 64 * 1024);
+		if ((res = Stream_Write(&compStream, map_saveData + i, count))) break;
+		Map_TaskProgress = (float)(i + count) / map_saveSize;
+	}
+
+	if (res) {
+		Map_SetResult(res, "encoding"); stream.Close(&stream);
+	} else if ((res = compStream.Close(&compStream))) {
+		Map_SetResult(res, "closing");  stream.Close(&stream);
+	} else if ((res = stream.Close(&stream))) {
+		Map_SetResult(res, "closing");
+	}
+
+	Mem_Free(state);
+	Map_TaskDone = true;
+}
+
+static ReturnCode Map_CountWrite(struct Stream* s, const uint8_t* data, uint32_t count, uint32_t* modified) {
+	s->Meta.Mem.Length += count;
+	*modified = count; return 0;
+}
+
+/* Returns how many bytes the given exporter writes, without storing the data anywhere */
+static ReturnCode Map_CountExported(IMapExporter exporter, uint32_t* size) {
+	struct Stream stream;
+	ReturnCode res;
+	Stream_Init(&stream);
+	stream.Write = Map_CountWrite;
+	stream.Meta.Mem.Length = 0;
+
+	res   = exporter(&stream);
+	*size = stream.Meta.Mem.Length;
+	return res;
+}
+
+void Map_BeginSave(const String* path, IMapExporter exporter) {
+	struct Stream stream;
+	uint32_t size;
+	ReturnCode res;
+
+	String_InitArray(map_taskPath, map_taskPathBuffer);
+	String_Copy(&map_taskPath, path);
+	Map_SetResult(0, NULL);
+	Map_TaskProgress = 0.0f;
+	Map_TaskDone     = false;
+
+	/* Exporting is just copying the world into memory, so it is done here on the main thread. */
+	/* That way the world can't change while the much slower compression runs in the background. */
+	/* Exporters only write what they need (e.g. upper block array only if used), so measure that first */
+	if ((res = Map_CountExported(exporter, &size))) {
+		Map_SetResult(res, "encoding");
+		Map_TaskDone = true; return;
+	}
+
+	map_saveData = Mem_TryAlloc(size, 1);
+	if (!map_saveData) {
+		Map_SetResult(ERR_OUT_OF_MEMORY, "allocating");
+		Map_TaskDone = true; return;
+	}
+	Stream_WriteonlyMemory(&stream, map_saveData, size);
+
+	if ((res = exporter(&stream))) {
+		Map_SetResult(res, "encoding");
+		Map_TaskDone = true; return;
+	}
+	map_saveSize = size - stream.Meta.Mem.Left;
+	Thread_Start(Map_SaveWorker, true);
+}
+
+bool Map_EndSave(void) {
+	Map_TaskDone = false;
+	Mem_Free(map_saveData);
+	map_saveData = NULL;
+
+	if (map_taskRes) {
+		Logger_Warn2(map_taskRes, map_taskAction, &map_taskPath); return false;
+	}
+	Chat_Add1("&eSaved map to: %s", &map_taskPath);
+	return true;
+}
+
 
 /*########################################################################################################################*
 *--------------------------------------------------MCSharp level Format---------------------------------------------------*
@@ -528,7 +845,7 @@ static void Cw_Callback_2(struct NbtTag* tag) {
 	if (IsTag(tag, "P")) { p->SpawnHeadX = Math_Deg2Packed(NbtTag_U8(tag)); return; }
 }
 
-static BlockID cw_curID;
+static struct MapBlockDef cw_def;
 static int cw_colR, cw_colG, cw_colB;
 static PackedCol Cw_ParseCol(PackedCol defValue) {
 	int r = cw_colR, g = cw_colG, b = cw_colB;
@@ -540,7 +857,6 @@ static PackedCol Cw_ParseCol(PackedCol defValue) {
 }
 
 static void Cw_Callback_4(struct NbtTag* tag) {
-	BlockID id = cw_curID;
 	struct LocalPlayer* p = &LocalPlayer_Instance;
 
 	if (!IsTag(tag->Parent->Parent, "CPE")) return;
@@ -561,7 +877,7 @@ static void Cw_Callback_4(struct NbtTag* tag) {
 		if (IsTag(tag, "TextureURL")) {
 			String url = NbtTag_String(tag);
 			if (Game_AllowServerTextures && url.length) {
-				Server_RetrieveTexturePack(&url);
+				String_Copy(&map_deferred.TexUrl, &url);
 			}
 			return;
 		}
@@ -576,9 +892,11 @@ static void Cw_Callback_4(struct NbtTag* tag) {
 		} else if (IsTag(tag, "Fog")) {
 			Env.FogCol = Cw_ParseCol(Env_DefaultFogCol); return;
 		} else if (IsTag(tag, "Sunlight")) {
-			Env_SetSunCol(Cw_ParseCol(Env_DefaultSunCol)); return;
+			map_deferred.SetSunCol = true;
+			map_deferred.SunCol    = Cw_ParseCol(Env_DefaultSunCol); return;
 		} else if (IsTag(tag, "Ambient")) {
-			Env_SetShadowCol(Cw_ParseCol(Env_DefaultShadowCol)); return;
+			map_deferred.SetShadowCol = true;
+			map_deferred.ShadowCol    = Cw_ParseCol(Env_DefaultShadowCol); return;
 		}
 	}
 
@@ -586,27 +904,15 @@ static void Cw_Callback_4(struct NbtTag* tag) {
 		const static String blockStr = String_FromConst("Block");
 		if (!String_CaselessStarts(&tag->Name, &blockStr)) return;	
 
-		/* hack for sprite draw (can't rely on order of tags when reading) */
-		if (Blocks.SpriteOffset[id] == 0) {
-			Blocks.SpriteOffset[id] = Blocks.Draw[id];
-			Blocks.Draw[id] = DRAW_SPRITE;
-		} else {
-			Blocks.SpriteOffset[id] = 0;
-		}
-
-		Block_DefineCustom(id);
-		Blocks.CanPlace[id]  = true;
-		Blocks.CanDelete[id] = true;
-		Event_RaiseVoid(&BlockEvents.PermissionsChanged);
-
-		cw_curID = 0;
+		/* ID is 0 when custom blocks are disallowed */
+		if (cw_def.ID) Map_AddBlockDef(&cw_def);
+		Mem_Set(&cw_def, 0, sizeof(cw_def));
 	}
 }
 
 static void Cw_Callback_5(struct NbtTag* tag) {
-	BlockID id = cw_curID;
+	struct MapBlockDef* def = &cw_def;
 	uint8_t* arr;
-	uint8_t sound;
 
 	if (!IsTag(tag->Parent->Parent->Parent, "CPE")) return;
 	if (!IsTag(tag->Parent->Parent->Parent->Parent, "Metadata")) return;
@@ -618,63 +924,80 @@ static void Cw_Callback_5(struct NbtTag* tag) {
 	}
 
 	if (IsTag(tag->Parent->Parent, "BlockDefinitions") && Game_AllowCustomBlocks) {
-		if (IsTag(tag, "ID"))             { cw_curID = NbtTag_U8(tag);  return; }
-		if (IsTag(tag, "ID2"))            { cw_curID = NbtTag_U16(tag); return; }
-		if (IsTag(tag, "CollideType"))    { Block_SetCollide(id, NbtTag_U8(tag)); return; }
-		if (IsTag(tag, "Speed"))          { Blocks.SpeedMultiplier[id] = NbtTag_F32(tag); return; }
-		if (IsTag(tag, "TransmitsLight")) { Blocks.BlocksLight[id] = NbtTag_U8(tag) == 0; return; }
-		if (IsTag(tag, "FullBright"))     { Blocks.FullBright[id] = NbtTag_U8(tag) != 0; return; }
-		if (IsTag(tag, "BlockDraw"))      { Blocks.Draw[id] = NbtTag_U8(tag); return; }
-		if (IsTag(tag, "Shape"))          { Blocks.SpriteOffset[id] = NbtTag_U8(tag); return; }
+		if (IsTag(tag, "ID"))  { def->ID = NbtTag_U8(tag);  return; }
+		if (IsTag(tag, "ID2")) { def->ID = NbtTag_U16(tag); return; }
+
+		if (IsTag(tag, "CollideType")) {
+			def->Collide = NbtTag_U8(tag);
+			def->Fields |= MAPDEF_COLLIDE; return;
+		}
+		if (IsTag(tag, "Speed")) {
+			def->Speed = NbtTag_F32(tag);
+			def->Fields |= MAPDEF_SPEED; return;
+		}
+		if (IsTag(tag, "TransmitsLight")) {
+			def->BlocksLight = NbtTag_U8(tag) == 0;
+			def->Fields |= MAPDEF_LIGHT; return;
+		}
+		if (IsTag(tag, "FullBright")) {
+			def->FullBright = NbtTag_U8(tag) != 0;
+			def->Fields |= MAPDEF_BRIGHT; return;
+		}
+		if (IsTag(tag, "BlockDraw")) {
+			def->Draw = NbtTag_U8(tag);
+			def->Fields |= MAPDEF_DRAW; return;
+		}
+		if (IsTag(tag, "Shape")) {
+			def->Shape = NbtTag_U8(tag);
+			def->Fields |= MAPDEF_SHAPE; return;
+		}
 
 		if (IsTag(tag, "Name")) {
 			String name = NbtTag_String(tag);
-			Block_SetName(id, &name);
-			return;
+			def->NameLen = min(name.length, STRING_SIZE);
+			Mem_Copy(def->Name, name.buffer, def->NameLen);
+			def->Fields |= MAPDEF_NAME; return;
 		}
 
 		if (IsTag(tag, "Textures")) {
 			arr = NbtTag_U8_Array(tag, 6);
-			Block_Tex(id, FACE_YMAX) = arr[0]; Block_Tex(id, FACE_YMIN) = arr[1];
-			Block_Tex(id, FACE_XMIN) = arr[2]; Block_Tex(id, FACE_XMAX) = arr[3];
-			Block_Tex(id, FACE_ZMIN) = arr[4]; Block_Tex(id, FACE_ZMAX) = arr[5];
+			def->Tex[FACE_YMAX] = arr[0]; def->Tex[FACE_YMIN] = arr[1];
+			def->Tex[FACE_XMIN] = arr[2]; def->Tex[FACE_XMAX] = arr[3];
+			def->Tex[FACE_ZMIN] = arr[4]; def->Tex[FACE_ZMAX] = arr[5];
 
 			/* hacky way of storing upper 8 bits */
 			if (tag->DataSize >= 12) {
-				Block_Tex(id, FACE_YMAX) |= arr[6]  << 8; Block_Tex(id, FACE_YMIN) |= arr[7]  << 8;
-				Block_Tex(id, FACE_XMIN) |= arr[8]  << 8; Block_Tex(id, FACE_XMAX) |= arr[9]  << 8;
-				Block_Tex(id, FACE_ZMIN) |= arr[10] << 8; Block_Tex(id, FACE_ZMAX) |= arr[11] << 8;
+				def->Tex[FACE_YMAX] |= arr[6]  << 8; def->Tex[FACE_YMIN] |= arr[7]  << 8;
+				def->Tex[FACE_XMIN] |= arr[8]  << 8; def->Tex[FACE_XMAX] |= arr[9]  << 8;
+				def->Tex[FACE_ZMIN] |= arr[10] << 8; def->Tex[FACE_ZMAX] |= arr[11] << 8;
 			}
-			return;
+			def->Fields |= MAPDEF_TEX; return;
 		}
 		
 		if (IsTag(tag, "WalkSound")) {
-			sound = NbtTag_U8(tag);
-			Blocks.DigSounds[id]  = sound;
-			Blocks.StepSounds[id] = sound;
-			if (sound == SOUND_GLASS) Blocks.StepSounds[id] = SOUND_STONE;
-			return;
+			def->Sound = NbtTag_U8(tag);
+			def->Fields |= MAPDEF_SOUND; return;
 		}
 
 		if (IsTag(tag, "Fog")) {
 			arr = NbtTag_U8_Array(tag, 4);
-			Blocks.FogDensity[id] = (arr[0] + 1) / 128.0f;
+			def->FogDensity = (arr[0] + 1) / 128.0f;
 			/* Fix for older ClassicalSharp versions which saved wrong fog density value */
-			if (arr[0] == 0xFF) Blocks.FogDensity[id] = 0.0f;
+			if (arr[0] == 0xFF) def->FogDensity = 0.0f;
  
-			Blocks.FogCol[id].R = arr[1];
-			Blocks.FogCol[id].G = arr[2];
-			Blocks.FogCol[id].B = arr[3];
-			Blocks.FogCol[id].A = 255;
-			return;
+			def->FogCol.R = arr[1];
+			def->FogCol.G = arr[2];
+			def->FogCol.B = arr[3];
+			def->FogCol.A = 255;
+			def->Fields |= MAPDEF_FOG; return;
 		}
 
 		if (IsTag(tag, "Coords")) {
 			arr = NbtTag_U8_Array(tag, 6);
-			Blocks.MinBB[id].X = arr[0] / 16.0f; Blocks.MaxBB[id].X = arr[3] / 16.0f;
-			Blocks.MinBB[id].Y = arr[1] / 16.0f; Blocks.MaxBB[id].Y = arr[4] / 16.0f;
-			Blocks.MinBB[id].Z = arr[2] / 16.0f; Blocks.MaxBB[id].Z = arr[5] / 16.0f;
-			return;
+			def->MinBB.X = arr[0] / 16.0f; def->MaxBB.X = arr[3] / 16.0f;
+			def->MinBB.Y = arr[1] / 16.0f; def->MaxBB.Y = arr[4] / 16.0f;
+			def->MinBB.Z = arr[2] / 16.0f; def->MaxBB.Z = arr[5] / 16.0f;
+			def->Fields |= MAPDEF_COORDS; return;
 		}
 	}
 }
@@ -704,6 +1027,7 @@ ReturnCode Cw_Load(struct Stream* stream) {
 	Inflate_MakeStream(&compStream, &state, stream);
 	if ((res = Map_SkipGZipHeader(stream))) return res;
 	if ((res = compStream.ReadU8(&compStream, &tag))) return res;
+	Mem_Set(&cw_def, 0, sizeof(cw_def));
 
 	if (tag != NBT_DICT) return CW_ERR_ROOT_TAG;
 	res = Nbt_ReadTag(NBT_DICT, true, &compStream, NULL, Cw_Callback);
@@ -1119,16 +1443,18 @@ ReturnCode Cw_Save(struct Stream* stream) {
 		tmp[107] = Math_Deg2Packed(p->SpawnRotY);
 		tmp[112] = Math_Deg2Packed(p->SpawnHeadX);
 	}
-	if ((res = Stream_Write(stream, tmp,      sizeof(cw_begin)))) return res;
-	if ((res = Stream_Write(stream, World.Blocks, World.Volume))) return res;
+	if ((res = Stream_Write(stream, tmp, sizeof(cw_begin)))) return res;
+	if ((res = Map_WriteBlocks(stream, 0)))                   return res;
 
-	if (World.Blocks != World.Blocks2) {
+#ifdef EXTENDED_BLOCKS
+	if (Block_UsedCount > 256) {
 		Mem_Copy(tmp, cw_map2, sizeof(cw_map2));
 		Stream_SetU32_BE(&tmp[14], World.Volume);
 
-		if ((res = Stream_Write(stream, tmp,        sizeof(cw_map2)))) return res;
-		if ((res = Stream_Write(stream, World.Blocks2, World.Volume))) return res;
+		if ((res = Stream_Write(stream, tmp, sizeof(cw_map2)))) return res;
+		if ((res = Map_WriteBlocks(stream, 8)))                 return res;
 	}
+#endif
 
 	Mem_Copy(tmp, cw_meta_cpe, sizeof(cw_meta_cpe));
 	{
@@ -1191,7 +1517,7 @@ ReturnCode Schematic_Save(struct Stream* stream) {
 		Stream_SetU32_BE(&tmp[74], World.Volume);
 	}
 	if ((res = Stream_Write(stream, tmp, sizeof(sc_begin)))) return res;
-	if ((res = Stream_Write(stream, World.Blocks, World.Volume))) return res;
+	if ((res = Map_WriteBlocks(stream, 0)))                   return res;
 
 	Mem_Copy(tmp, sc_data, sizeof(sc_data));
 	{
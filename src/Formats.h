@@ -8,6 +8,8 @@
 struct Stream;
 /* Imports a world encoded in a particular map file format. */
 typedef ReturnCode (*IMapImporter)(struct Stream* stream);
+/* Exports a world encoded in a particular map file format. */
+typedef ReturnCode (*IMapExporter)(struct Stream* stream);
 /* Attempts to find a suitable importer based on filename. */
 /* Returns NULL if no match found. */
 CC_API IMapImporter Map_FindImporter(const String* path);
@@ -15,6 +17,21 @@ CC_API IMapImporter Map_FindImporter(const String* path);
 /* NOTE: Uses Map_FindImporter to import based on filename. */
 CC_API void Map_LoadFrom(const String* path);
 
+/* Progress of the load/save started by Map_BeginLoad or Map_BeginSave. (0 to 1) */
+extern volatile float Map_TaskProgress;
+/* Whether the load/save started by Map_BeginLoad or Map_BeginSave has finished. */
+extern volatile bool  Map_TaskDone;
+/* Resets the world, then imports the map from the given file on a background thread. */
+/* NOTE: Map_EndLoad must be called on the main thread once Map_TaskDone is true. */
+void Map_BeginLoad(const String* path);
+/* Applies the map imported by Map_BeginLoad, or warns if importing failed. */
+void Map_EndLoad(void);
+/* Exports the world to memory, then compresses it to the given file on a background thread. */
+/* NOTE: Map_EndSave must be called on the main thread once Map_TaskDone is true. */
+void Map_BeginSave(const String* path, IMapExporter exporter);
+/* Shows whether the map was saved or not. Returns true if saved successfully. */
+bool Map_EndSave(void);
+
 /* Imports a world from a .lvl MCSharp server map file. */
 /* Used by MCSharp/MCLawl/MCForge/MCDzienny/MCGalaxy. */
 ReturnCode Lvl_Load(struct Stream* stream);
@@ -28,10 +28,12 @@
 #include "AxisLinesRenderer.h"
 #include "EnvRenderer.h"
 #include "HeldBlockRenderer.h"
+#include "IsometricDrawer.h"
 #include "PickedPosRenderer.h"
 #include "Menus.h"
 #include "Audio.h"
 #include "Stream.h"
+#include "BlockPhysics.h"
 
 struct _GameData Game;
 int  Game_Port;
@@ -199,6 +201,7 @@ void Game_UpdateBlock(int x, int y, int z, BlockID block) {
 		EnvRenderer_OnBlockChanged(x, y, z, old, block);
 	}
 	Lighting_OnBlockChanged(x, y, z, old, block);
+	Physics_OnBlockUpdated(x, y, z, old, block);
 
 	/* Refresh the chunk the block was located in. */
 	chunk = MapRenderer_GetChunk(cx, cy, cz);
@@ -212,6 +215,142 @@ void Game_ChangeBlock(int x, int y, int z, BlockID block) {
 	Server.SendBlock(x, y, z, old, block);
 }
 
+
+/*########################################################################################################################*
+*-----------------------------------------------------Batched updates-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Each changed block needs 1 column key, and up to 4 keys for its chunk and neighbouring chunks */
+#define BATCH_KEYS_PER_BLOCK 5
+#define BATCH_DEFAULT_BLOCKS 256
+static int batch_defaultKeys[BATCH_DEFAULT_BLOCKS * BATCH_KEYS_PER_BLOCK];
+static int* batch_keys = batch_defaultKeys;
+static int batch_maxBlocks = BATCH_DEFAULT_BLOCKS;
+/* Highest changed Y in each column whose light/rain height might change, or -1 if none */
+static int16_t* batch_columnMaxY;
+static int batch_columnsCount;
+
+/* Whether changing the block might change how far down light or rain reaches in the column */
+/* NOTE: Changes below the highest block that stops light/rain can't change the height. */
+static bool Batch_ChangesHeight(int x, int y, int z, BlockID old, BlockID now) {
+	int oldOffset, newOffset;
+	bool didBlock, nowBlocks;
+
+	if (y >= Lighting_Heightmap[Lighting_Pack(x, z)]) {
+		if (Blocks.BlocksLight[old] != Blocks.BlocksLight[now]) return true;
+		oldOffset = (Blocks.LightOffset[old] >> FACE_YMAX) & 1;
+		newOffset = (Blocks.LightOffset[now] >> FACE_YMAX) & 1;
+		if (Blocks.BlocksLight[now] && oldOffset != newOffset) return true;
+	}
+
+	if (Weather_Heightmap && y >= Weather_Heightmap[x * World.Length + z]) {
+		didBlock  = !(Blocks.Draw[old] == DRAW_GAS || Blocks.Draw[old] == DRAW_SPRITE);
+		nowBlocks = !(Blocks.Draw[now] == DRAW_GAS || Blocks.Draw[now] == DRAW_SPRITE);
+		if (didBlock != nowBlocks) return true;
+	}
+	return false;
+}
+
+static void Batch_FreeKeys(void) {
+	if (batch_keys != batch_defaultKeys) Mem_Free(batch_keys);
+	batch_keys      = batch_defaultKeys;
+	batch_maxBlocks = BATCH_DEFAULT_BLOCKS;
+}
+
+static void Batch_FreeColumns(void) {
+	Mem_Free(batch_columnMaxY);
+	batch_columnMaxY   = NULL;
+	batch_columnsCount = 0;
+}
+
+void Game_UpdateBlocksBatch(const int32_t* indices, const BlockID* blocks, int count) {
+	int area = World.Width * World.Length;
+	int numColumns = 0, numChunks = 0;
+	int i, index, column, x, y, z, cx, cy, cz;
+	int chunk, lastChunk = -1;
+	int* columns; int* chunks;
+	BlockID old, block;
+
+	if (count > batch_maxBlocks) {
+		Batch_FreeKeys();
+		batch_maxBlocks = count;
+		batch_keys      = Mem_Alloc(count * BATCH_KEYS_PER_BLOCK, 4, "batch keys");
+	}
+	if (area != batch_columnsCount) {
+		Batch_FreeColumns();
+		batch_columnsCount = area;
+		batch_columnMaxY   = Mem_Alloc(area, 2, "batch columns");
+		for (i = 0; i < area; i++) { batch_columnMaxY[i] = -1; }
+	}
+	columns = batch_keys;
+	chunks  = batch_keys + count;
+
+	/* Change all the blocks first, remembering which columns and chunks were changed */
+	for (i = 0; i < count; i++) {
+		index  = indices[i];
+		y      = index / area; column = index - y * area;
+		z      = column / World.Width; x = column - z * World.Width;
+
+		block = blocks[i];
+		old   = World_GetBlock(x, y, z);
+		if (old == block) continue;
+		World_SetBlock(x, y, z, block);
+
+		/* Flood fill light depends on the order blocks are changed in */
+		if (Lighting_Flood) Lighting_OnBlockChanged(x, y, z, old, block);
+		Physics_OnBlockUpdated(x, y, z, old, block);
+		if (Batch_ChangesHeight(x, y, z, old, block)) {
+			if (batch_columnMaxY[column] == -1) columns[numColumns++] = column;
+			batch_columnMaxY[column] = max(batch_columnMaxY[column], y);
+		}
+
+		cx = x >> CHUNK_SHIFT; cy = y >> CHUNK_SHIFT; cz = z >> CHUNK_SHIFT;
+		MapRenderer_GetChunk(cx, cy, cz)->AllAir &= Blocks.Draw[block] == DRAW_GAS;
+
+		/* Changes are usually in runs along the X axis, so most duplicates are skipped here */
+		/* NOTE: Refreshing a chunk is cheap, so the few remaining duplicates aren't worth sorting out */
+		chunk = MapRenderer_Pack(cx, cy, cz);
+		if (chunk != lastChunk) { chunks[numChunks++] = chunk; lastChunk = chunk; }
+
+		/* Faces of blocks in neighbouring chunks might now be hidden or visible */
+		if ((x & CHUNK_MASK) == 0 && cx > 0) {
+			chunks[numChunks++] = MapRenderer_Pack(cx - 1, cy, cz);
+		} else if ((x & CHUNK_MASK) == CHUNK_MAX && cx < MapRenderer_ChunksX - 1) {
+			chunks[numChunks++] = MapRenderer_Pack(cx + 1, cy, cz);
+		}
+		if ((y & CHUNK_MASK) == 0 && cy > 0) {
+			chunks[numChunks++] = MapRenderer_Pack(cx, cy - 1, cz);
+		} else if ((y & CHUNK_MASK) == CHUNK_MAX && cy < MapRenderer_ChunksY - 1) {
+			chunks[numChunks++] = MapRenderer_Pack(cx, cy + 1, cz);
+		}
+		if ((z & CHUNK_MASK) == 0 && cz > 0) {
+			chunks[numChunks++] = MapRenderer_Pack(cx, cy, cz - 1);
+		} else if ((z & CHUNK_MASK) == CHUNK_MAX && cz < MapRenderer_ChunksZ - 1) {
+			chunks[numChunks++] = MapRenderer_Pack(cx, cy, cz + 1);
+		}
+	}
+
+	/* Then update light and rain heights once per changed column */
+	for (i = 0; i < numColumns; i++) {
+		column = columns[i];
+		y      = batch_columnMaxY[column];
+		batch_columnMaxY[column] = -1;
+
+		z = column / World.Width; x = column - z * World.Width;
+		Lighting_OnColumnChanged(x, z, y);
+		if (Weather_Heightmap) EnvRenderer_OnColumnChanged(x, z, y);
+	}
+
+	/* Then refresh the changed chunks */
+	for (i = 0; i < numChunks; i++) {
+		index = chunks[i];
+
+		cx = index % MapRenderer_ChunksX;
+		cy = (index / MapRenderer_ChunksX) % MapRenderer_ChunksY;
+		cz = (index / MapRenderer_ChunksX) / MapRenderer_ChunksY;
+		MapRenderer_RefreshChunk(cx, cy, cz);
+	}
+}
+
 bool Game_CanPick(BlockID block) {
 	if (Blocks.Draw[block] == DRAW_GAS)    return false;
 	if (Blocks.Draw[block] == DRAW_SPRITE) return true;
@@ -470,6 +609,7 @@ static void Game_Load(void) {
 	Game_AddComponent(&Gui_Component);
 	Game_AddComponent(&Selections_Component);
 	Game_AddComponent(&HeldBlockRenderer_Component);
+	Game_AddComponent(&IsometricDrawer_Component);
 
 	Gfx_SetDepthTest(true);
 	Gfx_SetDepthTestFunc(COMPARE_FUNC_LESSEQUAL);
@@ -657,7 +797,7 @@ static void Game_RenderFrame(double delta) {
 	Game_UpdateViewMatrix();
 
 	visible = !Gui_Active || !Gui_Active->BlocksWorld;
-	if (visible && World.Blocks) {
+	if (visible && World.Loaded) {
 		Game_Render3D(delta, t);
 	} else {
 		PickedPos_SetAsInvalid(&Game_SelectedPos);
@@ -688,6 +828,8 @@ void Game_Free(void* obj) {
 
 	Logger_WarnFunc = Logger_DialogWarn;
 	Gfx_Free();
+	Batch_FreeKeys();
+	Batch_FreeColumns();
 
 	if (!Options_ChangedCount()) return;
 	Options_Load();
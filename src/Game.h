@@ -78,6 +78,11 @@ CC_API void Game_UpdateBlock(int x, int y, int z, BlockID block);
 /* Calls Game_UpdateBlock, then informs server connection of the block change. */
 /* In multiplayer this is sent to the server, in singleplayer just activates physics. */
 CC_API void Game_ChangeBlock(int x, int y, int z, BlockID block);
+/* Sets the blocks at the given indices (see World_Pack) in the map, then updates state associated with the blocks. */
+/* Unlike calling Game_UpdateBlock for each block, light/rain heights and chunks are only updated */
+/* once for each changed column/chunk, after all the blocks have been set. */
+/* NOTE: Indices must be inside the map. This does NOT notify the server. */
+CC_API void Game_UpdateBlocksBatch(const int32_t* indices, const BlockID* blocks, int count);
 
 bool Game_CanPick(BlockID block);
 bool Game_UpdateTexture(GfxResourceID* texId, struct Stream* src, const String* file, uint8_t* skinType);
@@ -5,6 +5,11 @@
 #include "Platform.h"
 #include "World.h"
 #include "Utils.h"
+#include "Builder.h"
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NOISE_SSE2
+#endif
 
 volatile float Gen_CurrentProgress;
 volatile const char* Gen_CurrentState;
@@ -60,6 +65,7 @@ void FlatgrassGen_Generate(void) {
 *---------------------------------------------------Noise generation------------------------------------------------------*
 *#########################################################################################################################*/
 #define NOISE_TABLE_SIZE 512
+#define NOISE_BATCH_SIZE 64
 static void ImprovedNoise_Init(uint8_t* p, RNGState* rnd) {
 	uint8_t tmp;
 	int i, j;
@@ -124,6 +130,98 @@ static void OctaveNoise_Init(struct OctaveNoise* n, RNGState* rnd, int octaves)
 	}
 }
 
+#ifdef NOISE_SSE2
+/* Grad factors for x and y for each hash, same as unpacking xFlags and yFlags */
+static const float noise_gradX[16] = { 1,-1, 1,-1, 1,-1, 1,-1, 0, 0, 0, 0, 1, 0,-1, 0 };
+static const float noise_gradY[16] = { 1, 1,-1,-1, 0, 0, 0, 0, 1,-1, 1,-1, 1,-1, 1,-1 };
+
+/* Calculates 4 samples at once. Performs the exact same float operations as the scalar version. */
+static void ImprovedNoise_Calc4(const uint8_t* p, const float* xs, float freq, float y, int Y, float v, float amplitude, float* sums) {
+	float gx[4][4], gy[4][4];
+	int xFloors[4], X, A, B, h, i;
+	__m128 x, xm1, u, g22, g12, c1, g21, g11, c2;
+	__m128i xFloor;
+
+	x = _mm_mul_ps(_mm_loadu_ps(xs), _mm_set1_ps(freq));
+	/* Truncate towards 0, then adding the all bits set mask of negative values subtracts 1 from them */
+	xFloor = _mm_cvttps_epi32(x);
+	xFloor = _mm_add_epi32(xFloor, _mm_castps_si128(_mm_cmplt_ps(x, _mm_setzero_ps())));
+	x      = _mm_sub_ps(x, _mm_cvtepi32_ps(xFloor));
+	_mm_storeu_si128((__m128i*)xFloors, xFloor);
+
+	/* Fade(x) */
+	u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(x, x), x),
+		_mm_add_ps(_mm_mul_ps(x, _mm_sub_ps(_mm_mul_ps(x, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10)));
+
+	/* Permutation table lookups can't be vectorised with SSE2 */
+	for (i = 0; i < 4; i++) {
+		X = xFloors[i] & 0xFF;
+		A = p[X] + Y; B = p[X + 1] + Y;
+
+		h = p[p[A]]     & 0xF; gx[0][i] = noise_gradX[h]; gy[0][i] = noise_gradY[h];
+		h = p[p[B]]     & 0xF; gx[1][i] = noise_gradX[h]; gy[1][i] = noise_gradY[h];
+		h = p[p[A + 1]] & 0xF; gx[2][i] = noise_gradX[h]; gy[2][i] = noise_gradY[h];
+		h = p[p[B + 1]] & 0xF; gx[3][i] = noise_gradX[h]; gy[3][i] = noise_gradY[h];
+	}
+
+	xm1 = _mm_sub_ps(x, _mm_set1_ps(1));
+	g22 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx[0]), x),   _mm_mul_ps(_mm_loadu_ps(gy[0]), _mm_set1_ps(y)));
+	g12 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx[1]), xm1), _mm_mul_ps(_mm_loadu_ps(gy[1]), _mm_set1_ps(y)));
+	c1  = _mm_add_ps(g22, _mm_mul_ps(u, _mm_sub_ps(g12, g22)));
+
+	g21 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx[2]), x),   _mm_mul_ps(_mm_loadu_ps(gy[2]), _mm_set1_ps(y - 1)));
+	g11 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx[3]), xm1), _mm_mul_ps(_mm_loadu_ps(gy[3]), _mm_set1_ps(y - 1)));
+	c2  = _mm_add_ps(g21, _mm_mul_ps(u, _mm_sub_ps(g11, g21)));
+
+	c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_set1_ps(v), _mm_sub_ps(c2, c1)));
+	_mm_storeu_ps(sums, _mm_add_ps(_mm_loadu_ps(sums), _mm_mul_ps(c1, _mm_set1_ps(amplitude))));
+}
+#endif
+
+/* Adds noise at (xs[i] * freq, y) multiplied by amplitude to sums[i], for each of the given samples. */
+/* Samples always lie along one row, so the work that only depends on y is done once for all of them. */
+static void ImprovedNoise_CalcRow(const uint8_t* p, const float* xs, float freq, float y, float amplitude, float* sums, int count) {
+	int xFloor, yFloor, X, Y, i = 0;
+	float x, u, v;
+	int A, B, hash;
+	float g22, g12, c1;
+	float g21, g11, c2;
+
+	yFloor = y >= 0 ? (int)y : (int)y - 1;
+	Y = yFloor & 0xFF; y -= yFloor;
+	v = y * y * y * (y * (y * 6 - 15) + 10); /* Fade(y) */
+
+#ifdef NOISE_SSE2
+	for (; i + 4 <= count; i += 4) {
+		ImprovedNoise_Calc4(p, xs + i, freq, y, Y, v, amplitude, sums + i);
+	}
+#endif
+
+	for (; i < count; i++) {
+		x = xs[i] * freq;
+		xFloor = x >= 0 ? (int)x : (int)x - 1;
+		X = xFloor & 0xFF; x -= xFloor;
+
+		u = x * x * x * (x * (x * 6 - 15) + 10); /* Fade(x) */
+		A = p[X] + Y; B = p[X + 1] + Y;
+
+		hash = (p[p[A]] & 0xF) << 1;
+		g22  = (((xFlags >> hash) & 3) - 1) * x       + (((yFlags >> hash) & 3) - 1) * y;
+		hash = (p[p[B]] & 0xF) << 1;
+		g12  = (((xFlags >> hash) & 3) - 1) * (x - 1) + (((yFlags >> hash) & 3) - 1) * y;
+		c1   = g22 + u * (g12 - g22);
+
+		hash = (p[p[A + 1]] & 0xF) << 1;
+		g21  = (((xFlags >> hash) & 3) - 1) * x       + (((yFlags >> hash) & 3) - 1) * (y - 1);
+		hash = (p[p[B + 1]] & 0xF) << 1;
+		g11  = (((xFlags >> hash) & 3) - 1) * (x - 1) + (((yFlags >> hash) & 3) - 1) * (y - 1);
+		c2   = g21 + u * (g11 - g21);
+
+		sums[i] += (c1 + v * (c2 - c1)) * amplitude;
+	}
+}
+
+
 static float OctaveNoise_Calc(const struct OctaveNoise* n, float x, float y) {
 	float amplitude = 1, freq = 1;
 	float sum = 0;
@@ -138,15 +236,34 @@ static float OctaveNoise_Calc(const struct OctaveNoise* n, float x, float y) {
 }
 
 
+/* Calculates octave noise for up to NOISE_BATCH_SIZE samples along a row at once. */
+/* Gives exactly the same results as calling OctaveNoise_Calc for each sample. */
+static void OctaveNoise_CalcRow(const struct OctaveNoise* n, const float* xs, float y, float* results, int count) {
+	float amplitude = 1, freq = 1;
+	int i;
+
+	for (i = 0; i < count; i++) { results[i] = 0; }
+	for (i = 0; i < n->octaves; i++) {
+		ImprovedNoise_CalcRow(n->p[i], xs, freq, y * freq, amplitude, results, count);
+		amplitude *= 2.0f;
+		freq *= 0.5f;
+	}
+}
+
+
 struct CombinedNoise { struct OctaveNoise noise1, noise2; };
 static void CombinedNoise_Init(struct CombinedNoise* n, RNGState* rnd, int octaves1, int octaves2) {
 	OctaveNoise_Init(&n->noise1, rnd, octaves1);
 	OctaveNoise_Init(&n->noise2, rnd, octaves2);
 }
 
-static float CombinedNoise_Calc(const struct CombinedNoise* n, float x, float y) {
-	float offset = OctaveNoise_Calc(&n->noise2, x, y);
-	return OctaveNoise_Calc(&n->noise1, x + offset, y);
+static void CombinedNoise_CalcRow(const struct CombinedNoise* n, const float* xs, float y, float* results, int count) {
+	float offsets[NOISE_BATCH_SIZE];
+	int i;
+
+	OctaveNoise_CalcRow(&n->noise2, xs, y, offsets, count);
+	for (i = 0; i < count; i++) { offsets[i] += xs[i]; }
+	OctaveNoise_CalcRow(&n->noise1, offsets, y, results, count);
 }
 
 
@@ -219,40 +336,104 @@ static void NotchyGen_FloodFill(int index, BlockRaw block) {
 }
 
 
-static void NotchyGen_CreateHeightmap(void) {
-	float hLow, hHigh, height;
-	int hIndex = 0, adjHeight;
-	int x, z;
-	struct CombinedNoise n1, n2;
-	struct OctaveNoise n3;
+#define GEN_ROWS_BATCH 8
+typedef void (*NotchyGen_RowFunc)(int z);
+static NotchyGen_RowFunc gen_rowFunc;
+static void* gen_rowMutex;
+static int gen_nextRow;
 
-	CombinedNoise_Init(&n1, &rnd, 8, 8);
-	CombinedNoise_Init(&n2, &rnd, 8, 8);	
-	OctaveNoise_Init(&n3, &rnd, 6);
+static void NotchyGen_RowWorker(void) {
+	int z, end;
+	for (;;) {
+		Mutex_Lock(gen_rowMutex);
+		{
+			z = gen_nextRow;
+			gen_nextRow += GEN_ROWS_BATCH;
+		}
+		Mutex_Unlock(gen_rowMutex);
 
-	Gen_CurrentState = "Building heightmap";
-	for (z = 0; z < World.Length; z++) {
+		if (z >= World.Length) return;
 		Gen_CurrentProgress = (float)z / World.Length;
+		end = min(World.Length, z + GEN_ROWS_BATCH);
+		for (; z < end; z++) { gen_rowFunc(z); }
+	}
+}
+
+/* Calls the given function for every row of columns along the X axis, split across the generating thread */
+/* and as many extra threads as chunk workers. The function must only modify columns in its own row. */
+static void NotchyGen_ForEachRow(NotchyGen_RowFunc func) {
+	void* threads[BUILDER_MAX_WORKERS];
+	int i, count = Builder_WorkersCount;
+
+	gen_rowFunc = func;
+	gen_nextRow = 0;
+	for (i = 0; i < count; i++) {
+		threads[i] = Thread_Start(NotchyGen_RowWorker, false);
+	}
+
+	NotchyGen_RowWorker();
+	for (i = 0; i < count; i++) {
+		Thread_Join(threads[i]);
+	}
+}
+
+
+static struct CombinedNoise heightmap_n1, heightmap_n2;
+static struct OctaveNoise heightmap_n3;
+
+static void NotchyGen_CreateHeightmapRow(int z) {
+	float xs[NOISE_BATCH_SIZE], lows[NOISE_BATCH_SIZE], selects[NOISE_BATCH_SIZE];
+	float highXs[NOISE_BATCH_SIZE], highs[NOISE_BATCH_SIZE];
+	float hLow, hHigh, height;
+	int hIndex = z * World.Width;
+	int x, i, j, count, highCount;
 
-		for (x = 0; x < World.Width; x++) {
-			hLow   = CombinedNoise_Calc(&n1, x * 1.3f, z * 1.3f) / 6 - 4;
+	for (x = 0; x < World.Width; x += NOISE_BATCH_SIZE) {
+		count = min(World.Width - x, NOISE_BATCH_SIZE);
+
+		for (i = 0; i < count; i++) { xs[i] = (float)(x + i); }
+		OctaveNoise_CalcRow(&heightmap_n3, xs, (float)z, selects, count);
+
+		for (i = 0; i < count; i++) { xs[i] = (x + i) * 1.3f; }
+		CombinedNoise_CalcRow(&heightmap_n1, xs, z * 1.3f, lows, count);
+
+		/* High noise is only used by some columns, so avoid calculating it for the others */
+		for (i = 0, highCount = 0; i < count; i++) {
+			if (selects[i] <= 0) highXs[highCount++] = xs[i];
+		}
+		CombinedNoise_CalcRow(&heightmap_n2, highXs, z * 1.3f, highs, highCount);
+
+		for (i = 0, j = 0; i < count; i++) {
+			hLow   = lows[i] / 6 - 4;
 			height = hLow;
 
-			if (OctaveNoise_Calc(&n3, (float)x, (float)z) <= 0) {
-				hHigh = CombinedNoise_Calc(&n2, x * 1.3f, z * 1.3f) / 5 + 6;
+			if (selects[i] <= 0) {
+				hHigh  = highs[j++] / 5 + 6;
 				height = max(hLow, hHigh);
 			}
 
 			height *= 0.5f;
 			if (height < 0) height *= 0.8f;
-
-			adjHeight = (int)(height + waterLevel);
-			minHeight = min(adjHeight, minHeight);
-			Heightmap[hIndex++] = adjHeight;
+			Heightmap[hIndex++] = (int)(height + waterLevel);
 		}
 	}
 }
 
+static void NotchyGen_CreateHeightmap(void) {
+	int i, count = World.Width * World.Length;
+
+	CombinedNoise_Init(&heightmap_n1, &rnd, 8, 8);
+	CombinedNoise_Init(&heightmap_n2, &rnd, 8, 8);	
+	OctaveNoise_Init(&heightmap_n3, &rnd, 6);
+
+	Gen_CurrentState = "Building heightmap";
+	NotchyGen_ForEachRow(NotchyGen_CreateHeightmapRow);
+
+	for (i = 0; i < count; i++) {
+		minHeight = min(Heightmap[i], minHeight);
+	}
+}
+
 static int NotchyGen_CreateStrataFast(void) {
 	uint32_t oneY = (uint32_t)World.OneY;
 	int stoneHeight, airHeight;
@@ -282,36 +463,36 @@ static int NotchyGen_CreateStrataFast(void) {
 	return max(stoneHeight, 1);
 }
 
-static void NotchyGen_CreateStrata(void) {
-	int dirtThickness, dirtHeight;
-	int minStoneY, stoneHeight;
-	int hIndex = 0, maxY = World.MaxY, index = 0;
-	int x, y, z;
-	struct OctaveNoise n;
+static struct OctaveNoise strata_n;
+static int strata_minStoneY;
 
-	/* Try to bulk fill bottom of the map if possible */
-	minStoneY = NotchyGen_CreateStrataFast();
-	OctaveNoise_Init(&n, &rnd, 8);
+static void NotchyGen_CreateStrataRow(int z) {
+	float xs[NOISE_BATCH_SIZE], thickness[NOISE_BATCH_SIZE];
+	int dirtThickness, dirtHeight, stoneHeight;
+	int hIndex = z * World.Width, maxY = World.MaxY, index;
+	int x, y, i, count;
 
-	Gen_CurrentState = "Creating strata";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+	for (x = 0; x < World.Width; x += NOISE_BATCH_SIZE) {
+		count = min(World.Width - x, NOISE_BATCH_SIZE);
+
+		for (i = 0; i < count; i++) { xs[i] = (float)(x + i); }
+		OctaveNoise_CalcRow(&strata_n, xs, (float)z, thickness, count);
 
-		for (x = 0; x < World.Width; x++) {
-			dirtThickness = (int)(OctaveNoise_Calc(&n, (float)x, (float)z) / 24 - 4);
+		for (i = 0; i < count; i++) {
+			dirtThickness = (int)(thickness[i] / 24 - 4);
 			dirtHeight    = Heightmap[hIndex++];
 			stoneHeight   = dirtHeight + dirtThickness;
 
 			stoneHeight = min(stoneHeight, maxY);
 			dirtHeight  = min(dirtHeight,  maxY);
 
-			index = World_Pack(x, minStoneY, z);
-			for (y = minStoneY; y <= stoneHeight; y++) {
+			index = World_Pack(x + i, strata_minStoneY, z);
+			for (y = strata_minStoneY; y <= stoneHeight; y++) {
 				Gen_Blocks[index] = BLOCK_STONE; index += World.OneY;
 			}
 
 			stoneHeight = max(stoneHeight, 0);
-			index = World_Pack(x, (stoneHeight + 1), z);
+			index = World_Pack(x + i, (stoneHeight + 1), z);
 			for (y = stoneHeight + 1; y <= dirtHeight; y++) {
 				Gen_Blocks[index] = BLOCK_DIRT; index += World.OneY;
 			}
@@ -319,6 +500,15 @@ static void NotchyGen_CreateStrata(void) {
 	}
 }
 
+static void NotchyGen_CreateStrata(void) {
+	/* Try to bulk fill bottom of the map if possible */
+	strata_minStoneY = NotchyGen_CreateStrataFast();
+	OctaveNoise_Init(&strata_n, &rnd, 8);
+
+	Gen_CurrentState = "Creating strata";
+	NotchyGen_ForEachRow(NotchyGen_CreateStrataRow);
+}
+
 static void NotchyGen_CarveCaves(void) {
 	int cavesCount, caveLen;
 	float caveX, caveY, caveZ;
@@ -459,36 +649,37 @@ static void NotchyGen_FloodFillLava(void) {
 	}
 }
 
-static void NotchyGen_CreateSurfaceLayer(void) {	
-	int hIndex = 0, index;
-	BlockRaw above;
-	int x, y, z;
-	struct OctaveNoise n1, n2;
-
-	OctaveNoise_Init(&n1, &rnd, 8);
-	OctaveNoise_Init(&n2, &rnd, 8);
+static struct OctaveNoise surface_n1, surface_n2;
 
-	Gen_CurrentState = "Creating surface";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+static void NotchyGen_CreateSurfaceRow(int z) {
+	int hIndex = z * World.Width, index;
+	BlockRaw above;
+	int x, y;
 
-		for (x = 0; x < World.Width; x++) {
-			y = Heightmap[hIndex++];
-			if (y < 0 || y >= World.Height) continue;
+	for (x = 0; x < World.Width; x++) {
+		y = Heightmap[hIndex++];
+		if (y < 0 || y >= World.Height) continue;
 
-			index = World_Pack(x, y, z);
-			above = y >= World.MaxY ? BLOCK_AIR : Gen_Blocks[index + World.OneY];
+		index = World_Pack(x, y, z);
+		above = y >= World.MaxY ? BLOCK_AIR : Gen_Blocks[index + World.OneY];
 
-			/* TODO: update heightmap */
-			if (above == BLOCK_WATER && (OctaveNoise_Calc(&n2, (float)x, (float)z) > 12)) {
-				Gen_Blocks[index] = BLOCK_GRAVEL;
-			} else if (above == BLOCK_AIR) {
-				Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(&n1, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
-			}
+		/* TODO: update heightmap */
+		if (above == BLOCK_WATER && (OctaveNoise_Calc(&surface_n2, (float)x, (float)z) > 12)) {
+			Gen_Blocks[index] = BLOCK_GRAVEL;
+		} else if (above == BLOCK_AIR) {
+			Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(&surface_n1, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
 		}
 	}
 }
 
+static void NotchyGen_CreateSurfaceLayer(void) {
+	OctaveNoise_Init(&surface_n1, &rnd, 8);
+	OctaveNoise_Init(&surface_n2, &rnd, 8);
+
+	Gen_CurrentState = "Creating surface";
+	NotchyGen_ForEachRow(NotchyGen_CreateSurfaceRow);
+}
+
 static void NotchyGen_PlantFlowers(void) {
 	int numPatches;
 	BlockRaw block;
@@ -614,6 +805,7 @@ void NotchyGen_Generate(void) {
 	Random_Seed(&rnd, Gen_Seed);
 	waterLevel = World.Height / 2;	
 	minHeight  = World.Height;
+	gen_rowMutex = Mutex_Create();
 
 	NotchyGen_CreateHeightmap();
 	NotchyGen_CreateStrata();
@@ -631,6 +823,7 @@ void NotchyGen_Generate(void) {
 	NotchyGen_PlantMushrooms();
 	NotchyGen_PlantTrees();
 
+	Mutex_Free(gen_rowMutex);
 	Mem_Free(Heightmap);
 	Heightmap = NULL;
 	Gen_Done  = true;
@@ -643,6 +836,13 @@ void NotchyGen_Generate(void) {
 BlockRaw* Tree_Blocks;
 RNGState* Tree_Rnd;
 
+#ifdef SPARSE_WORLD
+/* Tree_Blocks is NULL when growing trees in a loaded world, as it has no flat blocks array */
+#define Tree_GetBlock(x, y, z, index) (Tree_Blocks ? Tree_Blocks[index] : World_GetBlock(x, y, z))
+#else
+#define Tree_GetBlock(x, y, z, index) Tree_Blocks[index]
+#endif
+
 bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 	int baseHeight = treeHeight - 4;
 	int index;
@@ -655,7 +855,7 @@ bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 
 				if (!World_Contains(x, y, z)) return false;
 				index = World_Pack(x, y, z);
-				if (Tree_Blocks[index] != BLOCK_AIR) return false;
+				if (Tree_GetBlock(x, y, z, index) != BLOCK_AIR) return false;
 			}
 		}
 	}
@@ -667,7 +867,7 @@ bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 
 				if (!World_Contains(x, y, z)) return false;
 				index = World_Pack(x, y, z);
-				if (Tree_Blocks[index] != BLOCK_AIR) return false;
+				if (Tree_GetBlock(x, y, z, index) != BLOCK_AIR) return false;
 			}
 		}
 	}
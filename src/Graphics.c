@@ -28,7 +28,7 @@ String Gfx_ApiInfo[7] = {
 GfxResourceID Gfx_defaultIb;
 GfxResourceID Gfx_quadVb, Gfx_texVb;
 
-const static int gfx_strideSizes[2] = { 16, 24 };
+const static int gfx_strideSizes[3] = { 16, 24, 16 };
 static int gfx_batchStride, gfx_batchFormat = -1;
 
 static bool gfx_vsync, gfx_fogEnabled;
@@ -271,7 +271,8 @@ void Texture_RenderShaded(const struct Texture* tex, PackedCol shadeCol) {
 #include <d3d9types.h>
 
 static D3DCMPFUNC d3d9_compareFuncs[8] = { D3DCMP_ALWAYS, D3DCMP_NOTEQUAL, D3DCMP_NEVER, D3DCMP_LESS, D3DCMP_LESSEQUAL, D3DCMP_EQUAL, D3DCMP_GREATEREQUAL, D3DCMP_GREATER };
-static DWORD d3d9_formatMappings[2] = { D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX2 };
+/* NOTE: VERTEX_FORMAT_P3ST2SC4B cannot be described by a FVF, and so is not supported */
+static DWORD d3d9_formatMappings[3] = { D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX2, 0 };
 
 static IDirect3D9* d3d;
 static IDirect3DDevice9* device;
@@ -1775,6 +1776,12 @@ static void GL_SetupVbPos3fTex2fCol4b(void) {
 	glTexCoordPointer(2, GL_FLOAT,      sizeof(VertexP3fT2fC4b), (void*)(VB_PTR + 16));
 }
 
+static void GL_SetupVbPos3sTex2sCol4b(void) {
+	glVertexPointer(3, GL_SHORT,        sizeof(VertexP3sT2sC4b), (void*)(VB_PTR + 0));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(VertexP3sT2sC4b), (void*)(VB_PTR + 8));
+	glTexCoordPointer(2, GL_SHORT,      sizeof(VertexP3sT2sC4b), (void*)(VB_PTR + 12));
+}
+
 static void GL_SetupVbPos3fCol4b_Range(int startVertex) {
 	uint32_t offset = startVertex * (uint32_t)sizeof(VertexP3fC4b);
 	glVertexPointer(3, GL_FLOAT,          sizeof(VertexP3fC4b), (void*)(VB_PTR + offset));
@@ -1788,6 +1795,13 @@ static void GL_SetupVbPos3fTex2fCol4b_Range(int startVertex) {
 	glTexCoordPointer(2, GL_FLOAT,        sizeof(VertexP3fT2fC4b), (void*)(VB_PTR + offset + 16));
 }
 
+static void GL_SetupVbPos3sTex2sCol4b_Range(int startVertex) {
+	uint32_t offset = startVertex * (uint32_t)sizeof(VertexP3sT2sC4b);
+	glVertexPointer(3,  GL_SHORT,         sizeof(VertexP3sT2sC4b), (void*)(VB_PTR + offset));
+	glColorPointer(4, GL_UNSIGNED_BYTE,   sizeof(VertexP3sT2sC4b), (void*)(VB_PTR + offset + 8));
+	glTexCoordPointer(2, GL_SHORT,        sizeof(VertexP3sT2sC4b), (void*)(VB_PTR + offset + 12));
+}
+
 void Gfx_SetVertexFormat(VertexFormat fmt) {
 	if (fmt == gfx_batchFormat) return;
 	gfx_batchFormat = fmt;
@@ -1797,6 +1811,10 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 		gfx_setupVBFunc      = GL_SetupVbPos3fTex2fCol4b;
 		gfx_setupVBRangeFunc = GL_SetupVbPos3fTex2fCol4b_Range;
+	} else if (fmt == VERTEX_FORMAT_P3ST2SC4B) {
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		gfx_setupVBFunc      = GL_SetupVbPos3sTex2sCol4b;
+		gfx_setupVBRangeFunc = GL_SetupVbPos3sTex2sCol4b_Range;
 	} else {
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		gfx_setupVBFunc      = GL_SetupVbPos3fCol4b;
@@ -1834,6 +1852,14 @@ void Gfx_DrawIndexedVb_TrisT2fC4b(int verticesCount, int startVertex) {
 	glDrawElements(GL_TRIANGLES,        ICOUNT(verticesCount),   GL_UNSIGNED_SHORT, NULL);
 }
 
+void Gfx_DrawIndexedVb_TrisT2sC4b(int verticesCount, int startVertex) {
+	uint32_t offset = startVertex * (uint32_t)sizeof(VertexP3sT2sC4b);
+	glVertexPointer(3, GL_SHORT,        sizeof(VertexP3sT2sC4b), (void*)(offset));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(VertexP3sT2sC4b), (void*)(offset + 8));
+	glTexCoordPointer(2, GL_SHORT,      sizeof(VertexP3sT2sC4b), (void*)(offset + 12));
+	glDrawElements(GL_TRIANGLES,        ICOUNT(verticesCount),   GL_UNSIGNED_SHORT, NULL);
+}
+
 static void GL_CheckSupport(void) {
 	const static String vboExt = String_FromConst("GL_ARB_vertex_buffer_object");
 	String extensions = String_FromReadonly(glGetString(GL_EXTENSIONS));
@@ -22,7 +22,7 @@ typedef enum BlendFunc_ {
 } BlendFunc;
 
 typedef enum VertexFormat_ {
-	VERTEX_FORMAT_P3FC4B, VERTEX_FORMAT_P3FT2FC4B
+	VERTEX_FORMAT_P3FC4B, VERTEX_FORMAT_P3FT2FC4B, VERTEX_FORMAT_P3ST2SC4B
 } VertexFormat;
 typedef enum FogFunc_ {
 	FOG_LINEAR, FOG_EXP, FOG_EXP2
@@ -143,6 +143,10 @@ CC_API void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex);
 CC_API void Gfx_DrawVb_IndexedTris(int verticesCount);
 /* Special case Gfx_DrawVb_IndexedTris_Range for map renderer */
 void Gfx_DrawIndexedVb_TrisT2fC4b(int verticesCount, int startVertex);
+#ifdef CC_BUILD_COMPACTCHUNKS
+/* Special case Gfx_DrawVb_IndexedTris_Range for map renderer, when chunk meshes use compact vertices */
+void Gfx_DrawIndexedVb_TrisT2sC4b(int verticesCount, int startVertex);
+#endif
 
 /* Loads the given matrix over the currently active matrix. */
 CC_API void Gfx_LoadMatrix(MatrixType type, struct Matrix* matrix);
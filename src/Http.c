@@ -4,6 +4,7 @@
 #include "Logger.h"
 #include "Stream.h"
 #include "GameStructs.h"
+#include "Options.h"
 
 #if defined CC_BUILD_WIN
 #define WIN32_LEAN_AND_MEAN
@@ -54,24 +55,12 @@ static void RequestList_EnsureSpace(struct RequestList* list) {
 									sizeof(struct HttpRequest), HTTP_DEF_ELEMS, 10);
 }
 
-/* Adds another request to end (for normal priority request) */
+/* Adds another request to end of the list */
 static void RequestList_Append(struct RequestList* list, struct HttpRequest* item) {
 	RequestList_EnsureSpace(list);
 	list->Entries[list->Count++] = *item;
 }
 
-/* Inserts a request at start (for high priority request) */
-static void RequestList_Prepend(struct RequestList* list, struct HttpRequest* item) {
-	int i;
-	RequestList_EnsureSpace(list);
-	
-	for (i = list->Count; i > 0; i--) {
-		list->Entries[i] = list->Entries[i - 1];
-	}
-	list->Entries[0] = *item;
-	list->Count++;
-}
-
 /* Removes the request at the given index */
 static void RequestList_RemoveAt(struct RequestList* list, int i) {
 	if (i < 0 || i >= list->Count) Logger_Abort("Tried to remove element at list end");
@@ -113,25 +102,145 @@ static void RequestList_Free(struct RequestList* list) {
 }
 
 
+/*########################################################################################################################*
+*---------------------------------------------------Http requests queue---------------------------------------------------*
+*#########################################################################################################################*/
+/* Ring buffer of requests, so adding a request at either end and taking the first request are both O(1) */
+struct RequestQueue {
+	int MaxElems, Count, Head;
+	struct HttpRequest* Entries;
+	struct HttpRequest DefaultEntries[HTTP_DEF_ELEMS];
+};
+#define RequestQueue_Get(queue, i) (&(queue)->Entries[((queue)->Head + (i)) % (queue)->MaxElems])
+
+/* Doubles size of request queue buffer if there is no room for another request */
+static void RequestQueue_EnsureSpace(struct RequestQueue* queue) {
+	struct HttpRequest* entries;
+	int i;
+	if (queue->Count < queue->MaxElems) return;
+
+	entries = Mem_Alloc(queue->MaxElems * 2, sizeof(struct HttpRequest), "http requests queue");
+	for (i = 0; i < queue->Count; i++) {
+		entries[i] = *RequestQueue_Get(queue, i);
+	}
+	if (queue->Entries != queue->DefaultEntries) Mem_Free(queue->Entries);
+
+	queue->Entries   = entries;
+	queue->Head      = 0;
+	queue->MaxElems *= 2;
+}
+
+/* Adds another request to end (for normal priority request) */
+static void RequestQueue_Append(struct RequestQueue* queue, struct HttpRequest* item) {
+	RequestQueue_EnsureSpace(queue);
+	*RequestQueue_Get(queue, queue->Count) = *item;
+	queue->Count++;
+}
+
+/* Inserts a request at start (for high priority request) */
+static void RequestQueue_Prepend(struct RequestQueue* queue, struct HttpRequest* item) {
+	RequestQueue_EnsureSpace(queue);
+	queue->Head = (queue->Head + queue->MaxElems - 1) % queue->MaxElems;
+	queue->Entries[queue->Head] = *item;
+	queue->Count++;
+}
+
+/* Removes the first request, returning false if there are no requests */
+static bool RequestQueue_Dequeue(struct RequestQueue* queue, struct HttpRequest* item) {
+	if (!queue->Count) return false;
+	*item = queue->Entries[queue->Head];
+
+	queue->Head = (queue->Head + 1) % queue->MaxElems;
+	queue->Count--;
+	return true;
+}
+
+/* Resets state to default */
+static void RequestQueue_Init(struct RequestQueue* queue) {
+	queue->MaxElems = HTTP_DEF_ELEMS;
+	queue->Count    = 0;
+	queue->Head     = 0;
+	queue->Entries  = queue->DefaultEntries;
+}
+
+/* Frees any dynamically allocated memory, then resets state to default */
+static void RequestQueue_Free(struct RequestQueue* queue) {
+	if (queue->Entries != queue->DefaultEntries) {
+		Mem_Free(queue->Entries);
+	}
+	RequestQueue_Init(queue);
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------Common downloader code-------------------------------------------------*
 *#########################################################################################################################*/
+#define HTTP_MAX_WORKERS 8
+/* State of a thread that performs http requests */
+struct HttpWorker {
+	struct HttpRequest Request; /* Copy of request currently being processed. (ID is empty if none) */
+	volatile int Progress;      /* Progress of that request. (see HttpProgress, otherwise 0-100) */
+	int Index;
+};
+
 static void* workerWaitable;
-static void* workerThread;
+static void* workerThreads[HTTP_MAX_WORKERS];
 static void* pendingMutex;
 static void* processedMutex;
 static void* curRequestMutex;
 static volatile bool http_terminate;
 
-static struct RequestList pendingReqs;
+static struct HttpWorker http_workers[HTTP_MAX_WORKERS];
+static int http_workersCount, http_workersStarted;
+
+static struct RequestQueue pendingReqs;
 static struct RequestList processedReqs;
-static struct HttpRequest http_curRequest;
-static volatile int http_curProgress = ASYNC_PROGRESS_NOTHING;
+/* Requests for the same data as a pending/in progress request, which are given a copy of its result */
+static struct RequestList coalescedReqs;
 
 #ifdef CC_BUILD_WEB
 static void Http_DownloadNextAsync(void);
 #endif
 
+/* Whether the two requests are guaranteed to get the same response */
+static bool Http_SameRequest(struct HttpRequest* a, struct HttpRequest* b) {
+	String urlA, urlB;
+	/* POST requests have side effects, and conditional requests depend on what the caller has cached */
+	if (a->RequestType != b->RequestType || a->RequestType == REQUEST_TYPE_POST) return false;
+	if (a->Etag[0] || a->LastModified || b->Etag[0] || b->LastModified) return false;
+
+	urlA = String_FromRawArray(a->URL);
+	urlB = String_FromRawArray(b->URL);
+	return String_Equals(&urlA, &urlB);
+}
+
+/* Attaches a req to an identical pending or in progress request, returning false if there is none. */
+/* NOTE: Must be called with pendingMutex held. */
+static bool Http_Coalesce(struct HttpRequest* req) {
+	struct HttpRequest* other = NULL;
+	String reqID, otherID;
+	bool found = false;
+	int i;
+
+	for (i = 0; i < pendingReqs.Count && !found; i++) {
+		other = RequestQueue_Get(&pendingReqs, i);
+		found = Http_SameRequest(req, other);
+	}
+
+	/* A worker's request is only changed with pendingMutex held, so curRequestMutex isn't needed */
+	for (i = 0; i < http_workersCount && !found; i++) {
+		other = &http_workers[i].Request;
+		found = other->ID[0] && Http_SameRequest(req, other);
+	}
+	if (!found) return false;
+
+	/* Identical request with the same ID already produces the result for this one */
+	reqID   = String_FromRawArray(req->ID);
+	otherID = String_FromRawArray(other->ID);
+	if (!String_Equals(&reqID, &otherID)) RequestList_Append(&coalescedReqs, req);
+	return true;
+}
+
 /* Adds a req to the list of pending requests, waking up worker thread if needed. */
 static void Http_Add(const String* url, bool priority, const String* id, uint8_t type, TimeMS* lastModified, const String* etag, const void* data, uint32_t size) {
 	struct HttpRequest req = { 0 };
@@ -158,10 +267,12 @@ static void Http_Add(const String* url, bool priority, const String* id, uint8_t
 	Mutex_Lock(pendingMutex);
 	{	
 		req.TimeAdded = DateTime_CurrentUTC_MS();
-		if (priority) {
-			RequestList_Prepend(&pendingReqs, &req);
+		if (Http_Coalesce(&req)) {
+			/* Already being downloaded */
+		} else if (priority) {
+			RequestQueue_Prepend(&pendingReqs, &req);
 		} else {
-			RequestList_Append(&pendingReqs,  &req);
+			RequestQueue_Append(&pendingReqs,  &req);
 		}
 	}
 	Mutex_Unlock(pendingMutex);
@@ -173,15 +284,17 @@ static void Http_Add(const String* url, bool priority, const String* id, uint8_t
 #endif
 }
 
-/* Sets up state to begin a http request */
-static void Http_BeginRequest(struct HttpRequest* req) {
+/* Sets up state for a worker to begin a http request */
+/* NOTE: Must be called with pendingMutex held. */
+static void Http_BeginRequest(struct HttpWorker* worker, struct HttpRequest* req) {
 	String url = String_FromRawArray(req->URL);
 	Platform_Log2("Downloading from %s (type %b)", &url, &req->RequestType);
+	req->TimeStarted = DateTime_CurrentUTC_MS();
 
 	Mutex_Lock(curRequestMutex);
 	{
-		http_curRequest  = *req;
-		http_curProgress = ASYNC_PROGRESS_MAKING_REQUEST;
+		worker->Request  = *req;
+		worker->Progress = ASYNC_PROGRESS_MAKING_REQUEST;
 	}
 	Mutex_Unlock(curRequestMutex);
 }
@@ -209,23 +322,55 @@ static void Http_CompleteRequest(struct HttpRequest* req) {
 	}
 }
 
-/* Updates state after a completed http request */
-static void Http_FinishRequest(struct HttpRequest* req) {
+/* Completes all the requests that were coalesced into the given request, with a copy of its result */
+static void Http_CompleteCoalesced(struct HttpRequest* req) {
+	struct HttpRequest* other;
+	struct HttpRequest copy;
+	int i;
+
+	for (i = coalescedReqs.Count - 1; i >= 0; i--) {
+		other = &coalescedReqs.Entries[i];
+		if (!Http_SameRequest(req, other)) continue;
+
+		copy = *req;
+		Mem_Copy(copy.ID, other->ID, sizeof(copy.ID));
+		copy.TimeAdded = other->TimeAdded;
+
+		if (req->Data && req->Size) {
+			copy.Data = Mem_Alloc(req->Size, 1, "http coalesced data");
+			Mem_Copy(copy.Data, req->Data, req->Size);
+		} else {
+			copy.Data = NULL;
+		}
+
+		Http_CompleteRequest(&copy);
+		RequestList_RemoveAt(&coalescedReqs, i);
+	}
+}
+
+/* Updates state after a worker completed a http request */
+static void Http_FinishRequest(struct HttpWorker* worker, struct HttpRequest* req) {
 	if (req->Data) Platform_Log1("HTTP returned data: %i bytes", &req->Size);
 	req->Success = !req->Result && req->StatusCode == 200 && req->Data && req->Size;
 
-	Mutex_Lock(processedMutex);
+	Mutex_Lock(pendingMutex);
 	{
-		Http_CompleteRequest(req);
-	}
-	Mutex_Unlock(processedMutex);
+		Mutex_Lock(processedMutex);
+		{
+			/* NOTE: Must be done first, as completing a request may free its data */
+			Http_CompleteCoalesced(req);
+			Http_CompleteRequest(req);
+		}
+		Mutex_Unlock(processedMutex);
 
-	Mutex_Lock(curRequestMutex);
-	{
-		http_curRequest.ID[0] = '\0';
-		http_curProgress = ASYNC_PROGRESS_NOTHING;
+		Mutex_Lock(curRequestMutex);
+		{
+			worker->Request.ID[0] = '\0';
+			worker->Progress = ASYNC_PROGRESS_NOTHING;
+		}
+		Mutex_Unlock(curRequestMutex);
 	}
-	Mutex_Unlock(curRequestMutex);
+	Mutex_Unlock(pendingMutex);
 }
 
 
@@ -239,31 +384,30 @@ static void Http_DownloadAsync(struct HttpRequest* req);
 
 static void Http_DownloadNextAsync(void) {
 	struct HttpRequest req;
-	if (http_terminate || !pendingReqs.Count) return;
+	if (http_terminate) return;
 	/* already working on a request currently */
-	if (http_curRequest.ID[0] != '\0') return;
+	if (http_workers[0].Request.ID[0] != '\0') return;
 
-	req = pendingReqs.Entries[0];
-	RequestList_RemoveAt(&pendingReqs, 0);
+	if (!RequestQueue_Dequeue(&pendingReqs, &req)) return;
 	Http_DownloadAsync(&req);
 }
 
 static void Http_UpdateProgress(emscripten_fetch_t* fetch) {
 	if (!fetch->totalBytes) return;
-	http_curProgress = (int)(100.0f * fetch->dataOffset / fetch->totalBytes);
+	http_workers[0].Progress = (int)(100.0f * fetch->dataOffset / fetch->totalBytes);
 }
 
 static void Http_FinishedAsync(emscripten_fetch_t* fetch) {
-	struct HttpRequest* req = &http_curRequest;
-	req->Data       = fetch->data;
-	req->Size       = fetch->numBytes;
-	req->StatusCode = fetch->status;
+	struct HttpRequest req = http_workers[0].Request;
+	req.Data       = fetch->data;
+	req.Size       = fetch->numBytes;
+	req.StatusCode = fetch->status;
 
 	/* data needs to persist beyond closing of fetch data */
 	fetch->data = NULL;
 	emscripten_fetch_close(fetch);
 
-	Http_FinishRequest(&http_curRequest);
+	Http_FinishRequest(&http_workers[0], &req);
 	Http_DownloadNextAsync();
 }
 
@@ -291,7 +435,7 @@ static void Http_DownloadAsync(struct HttpRequest* req) {
 	attr.onerror    = Http_FinishedAsync;
 	attr.onprogress = Http_UpdateProgress;
 
-	Http_BeginRequest(req);
+	Http_BeginRequest(&http_workers[0], req);
 	/* TODO: SET requestHeaders!!! */
 	emscripten_fetch(&attr, urlStr);
 }
@@ -317,7 +461,8 @@ struct HttpCacheEntry {
 	char _addressBuffer[STRING_SIZE + 1];
 };
 #define HTTP_CACHE_ENTRIES 10
-static struct HttpCacheEntry http_cache[HTTP_CACHE_ENTRIES];
+/* NOTE: Each worker has its own cache, so a connection is never closed while another worker is using it */
+static struct HttpCacheEntry http_cache[HTTP_MAX_WORKERS][HTTP_CACHE_ENTRIES];
 
 /* Splits up the components of a URL */
 static void HttpCache_MakeEntry(const String* url, struct HttpCacheEntry* entry, String* resource) {
@@ -344,27 +489,27 @@ static void HttpCache_MakeEntry(const String* url, struct HttpCacheEntry* entry,
 }
 
 /* Inserts entry into the cache at the given index */
-static ReturnCode HttpCache_Insert(int i, struct HttpCacheEntry* e) {
+static ReturnCode HttpCache_Insert(struct HttpCacheEntry* cache, int i, struct HttpCacheEntry* e) {
 	HINTERNET conn;
 	conn = InternetConnectA(hInternet, e->Address.buffer, e->Port, NULL, NULL, 
 				INTERNET_SERVICE_HTTP, e->Https ? INTERNET_FLAG_SECURE : 0, 0);
 	if (!conn) return GetLastError();
 
-	e->Handle     = conn;
-	http_cache[i] = *e;
+	e->Handle = conn;
+	cache[i]  = *e;
 
 	/* otherwise address buffer points to stack buffer */
-	http_cache[i].Address.buffer = http_cache[i]._addressBuffer;
+	cache[i].Address.buffer = cache[i]._addressBuffer;
 	return 0;
 }
 
 /* Finds or inserts the given entry into the cache */
-static ReturnCode HttpCache_Lookup(struct HttpCacheEntry* e) {
+static ReturnCode HttpCache_Lookup(struct HttpCacheEntry* cache, struct HttpCacheEntry* e) {
 	struct HttpCacheEntry* c;
 	int i;
 
 	for (i = 0; i < HTTP_CACHE_ENTRIES; i++) {
-		c = &http_cache[i];
+		c = &cache[i];
 		if (c->Https == e->Https && String_Equals(&c->Address, &e->Address) && c->Port == e->Port) {
 			e->Handle = c->Handle;
 			return 0;
@@ -372,14 +517,14 @@ static ReturnCode HttpCache_Lookup(struct HttpCacheEntry* e) {
 	}
 
 	for (i = 0; i < HTTP_CACHE_ENTRIES; i++) {
-		if (http_cache[i].Handle) continue;
-		return HttpCache_Insert(i, e);
+		if (cache[i].Handle) continue;
+		return HttpCache_Insert(cache, i, e);
 	}
 
 	/* TODO: Should we be consistent in which entry gets evicted? */
 	i = (uint8_t)Stopwatch_Measure() % HTTP_CACHE_ENTRIES;
-	InternetCloseHandle(http_cache[i].Handle);
-	return HttpCache_Insert(i, e);
+	InternetCloseHandle(cache[i].Handle);
+	return HttpCache_Insert(cache, i, e);
 }
 
 static void Http_SysInit(void) {
@@ -416,7 +561,7 @@ static void Http_MakeHeaders(String* headers, struct HttpRequest* req) {
 }
 
 /* Creates and sends a HTTP requst */
-static ReturnCode Http_StartRequest(struct HttpRequest* req, HINTERNET* handle) {
+static ReturnCode Http_StartRequest(struct HttpWorker* worker, struct HttpRequest* req, HINTERNET* handle) {
 	const static char* verbs[3] = { "GET", "HEAD", "POST" };
 	struct HttpCacheEntry entry;
 	DWORD flags;
@@ -429,7 +574,7 @@ static ReturnCode Http_StartRequest(struct HttpRequest* req, HINTERNET* handle)
 	Mem_Copy(pathBuffer, path.buffer, path.length);
 	pathBuffer[path.length] = '\0';
 
-	HttpCache_Lookup(&entry);
+	HttpCache_Lookup(http_cache[worker->Index], &entry);
 	/* https://stackoverflow.com/questions/25308488/c-wininet-custom-http-headers */
 	String_InitArray(headers, headersBuffer);
 	Http_MakeHeaders(&headers, req);
@@ -473,13 +618,13 @@ static ReturnCode Http_ProcessHeaders(struct HttpRequest* req, HINTERNET handle)
 }
 
 /* Downloads the data/contents of a HTTP response */
-static ReturnCode Http_DownloadData(struct HttpRequest* req, HINTERNET handle) {
+static ReturnCode Http_DownloadData(struct HttpWorker* worker, struct HttpRequest* req, HINTERNET handle) {
 	uint8_t* buffer;
 	uint32_t size, totalRead;
 	uint32_t read, avail;
 	bool success;
 	
-	http_curProgress = 0;
+	worker->Progress = 0;
 	size      = req->ContentLength ? req->ContentLength : 1;
 	buffer    = Mem_Alloc(size, 1, "http get data");
 	totalRead = 0;
@@ -503,26 +648,26 @@ static ReturnCode Http_DownloadData(struct HttpRequest* req, HINTERNET handle) {
 		if (!read) break;
 
 		totalRead += read;
-		if (req->ContentLength) http_curProgress = (int)(100.0f * totalRead / size);
+		if (req->ContentLength) worker->Progress = (int)(100.0f * totalRead / size);
 		req->Size += read;
 	}
 
- 	http_curProgress = 100;
+ 	worker->Progress = 100;
 	return 0;
 }
 
-static ReturnCode Http_SysDo(struct HttpRequest* req) {
+static ReturnCode Http_SysDo(struct HttpWorker* worker, struct HttpRequest* req) {
 	HINTERNET handle;
-	ReturnCode res = Http_StartRequest(req, &handle);
+	ReturnCode res = Http_StartRequest(worker, req, &handle);
 	HttpRequest_Free(req);
 	if (res) return res;
 
-	http_curProgress = ASYNC_PROGRESS_FETCHING_DATA;
+	worker->Progress = ASYNC_PROGRESS_FETCHING_DATA;
 	res = Http_ProcessHeaders(req, handle);
 	if (res) { InternetCloseHandle(handle); return res; }
 
 	if (req->RequestType != REQUEST_TYPE_HEAD) {
-		res = Http_DownloadData(req, handle);
+		res = Http_DownloadData(worker, req, handle);
 		if (res) { InternetCloseHandle(handle); return res; }
 	}
 
@@ -530,28 +675,35 @@ static ReturnCode Http_SysDo(struct HttpRequest* req) {
 }
 
 static void Http_SysFree(void) {
-	int i;
-	for (i = 0; i < HTTP_CACHE_ENTRIES; i++) {
-		if (!http_cache[i].Handle) continue;
-		InternetCloseHandle(http_cache[i].Handle);
+	int i, j;
+	for (i = 0; i < HTTP_MAX_WORKERS; i++) {
+		for (j = 0; j < HTTP_CACHE_ENTRIES; j++) {
+			if (!http_cache[i][j].Handle) continue;
+			InternetCloseHandle(http_cache[i][j].Handle);
+		}
 	}
 	InternetCloseHandle(hInternet);
 }
 #endif
 #ifdef CC_BUILD_POSIX
-static CURL* curl;
+/* NOTE: Each worker has its own easy handle, which keeps connections alive between its requests */
+static CURL* curl_handles[HTTP_MAX_WORKERS];
 
 static void Http_SysInit(void) {
 	CURLcode res = curl_global_init(CURL_GLOBAL_DEFAULT);
+	int i;
 	if (res) Logger_Abort2(res, "Failed to init curl");
 
-	curl = curl_easy_init();
-	if (!curl) Logger_Abort("Failed to init easy curl");
+	for (i = 0; i < http_workersCount; i++) {
+		curl_handles[i] = curl_easy_init();
+		if (!curl_handles[i]) Logger_Abort("Failed to init easy curl");
+	}
 }
 
 /* Updates progress of current download */
 static int Http_UpdateProgress(void* ptr, double total, double received, double a, double b) {
-	if (total) http_curProgress = (int)(100 * received / total);
+	struct HttpWorker* worker = (struct HttpWorker*)ptr;
+	if (total) worker->Progress = (int)(100 * received / total);
 	return 0;
 }
 
@@ -614,21 +766,21 @@ static size_t Http_ProcessHeader(char *buffer, size_t size, size_t nitems, struc
 	return nitems;
 }
 
-static int curlBufferSize;
 /* Processes a chunk of data downloaded from the web server */
 static size_t Http_ProcessData(char *buffer, size_t size, size_t nitems, struct HttpRequest* req) {
+	uint32_t bufferSize;
 	uint8_t* dst;
 
-	if (!curlBufferSize) {
-		curlBufferSize = req->ContentLength ? req->ContentLength : 1;
-		req->Data = Mem_Alloc(curlBufferSize, 1, "http get data");
+	/* Buffer starts out as content length, and is only ever expanded to exactly fit the data */
+	bufferSize = req->ContentLength ? req->ContentLength : 1;
+	if (!req->Data) {
+		req->Data = Mem_Alloc(bufferSize, 1, "http get data");
 		req->Size = 0;
 	}
 
 	/* expand buffer if needed */
-	if (req->Size + nitems > curlBufferSize) {
-		curlBufferSize = req->Size + nitems;
-		req->Data      = Mem_Realloc(req->Data, curlBufferSize, 1, "http inc data");
+	if (req->Size + nitems > max(bufferSize, req->Size)) {
+		req->Data = Mem_Realloc(req->Data, req->Size + nitems, 1, "http inc data");
 	}
 
 	dst = (uint8_t*)req->Data + req->Size;
@@ -638,13 +790,14 @@ static size_t Http_ProcessData(char *buffer, size_t size, size_t nitems, struct
 }
 
 /* Sets general curl options for a request */
-static void Http_SetCurlOpts(struct HttpRequest* req) {
+static void Http_SetCurlOpts(CURL* curl, struct HttpWorker* worker, struct HttpRequest* req) {
 	curl_easy_setopt(curl, CURLOPT_COOKIEJAR,      "");
 	curl_easy_setopt(curl, CURLOPT_USERAGENT,      GAME_APP_NAME);
 	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 
 	curl_easy_setopt(curl, CURLOPT_NOPROGRESS,       0L);
 	curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, Http_UpdateProgress);
+	curl_easy_setopt(curl, CURLOPT_PROGRESSDATA,     worker);
 
 	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, Http_ProcessHeader);
 	curl_easy_setopt(curl, CURLOPT_HEADERDATA,     req);
@@ -652,7 +805,8 @@ static void Http_SetCurlOpts(struct HttpRequest* req) {
 	curl_easy_setopt(curl, CURLOPT_WRITEDATA,      req);
 }
 
-static ReturnCode Http_SysDo(struct HttpRequest* req) {
+static ReturnCode Http_SysDo(struct HttpWorker* worker, struct HttpRequest* req) {
+	CURL* curl = curl_handles[worker->Index];
 	String url = String_FromRawArray(req->URL);
 	char urlStr[600];
 	void* post_data = req->Data;
@@ -664,7 +818,7 @@ static ReturnCode Http_SysDo(struct HttpRequest* req) {
 	list = Http_MakeHeaders(req);
 	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
 
-	Http_SetCurlOpts(req);
+	Http_SetCurlOpts(curl, worker, req);
 	Platform_ConvertString(urlStr, &url);
 	curl_easy_setopt(curl, CURLOPT_URL, urlStr);
 
@@ -680,10 +834,9 @@ static ReturnCode Http_SysDo(struct HttpRequest* req) {
 		HttpRequest_Free(req);
 	}
 
-	curlBufferSize = 0;
-	http_curProgress = ASYNC_PROGRESS_FETCHING_DATA;
+	worker->Progress = ASYNC_PROGRESS_FETCHING_DATA;
 	res = curl_easy_perform(curl);
-	http_curProgress = 100;
+	worker->Progress = 100;
 
 	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
 	req->StatusCode = status;
@@ -695,49 +848,54 @@ static ReturnCode Http_SysDo(struct HttpRequest* req) {
 }
 
 static void Http_SysFree(void) {
-	curl_easy_cleanup(curl);
+	int i;
+	for (i = 0; i < http_workersCount; i++) {
+		curl_easy_cleanup(curl_handles[i]);
+	}
 	curl_global_cleanup();
 }
 #endif
 
 #ifndef CC_BUILD_WEB
 static void Http_WorkerLoop(void) {
+	struct HttpWorker* worker;
 	struct HttpRequest request;
-	bool hasRequest, stop;
+	bool hasRequest, hasMore, stop;
 	uint64_t beg, end;
-	uint32_t elapsed;
+	uint32_t waited, elapsed;
 
-	for (;;) {
-		hasRequest = false;
+	Mutex_Lock(pendingMutex);
+	{
+		worker = &http_workers[http_workersStarted++];
+	}
+	Mutex_Unlock(pendingMutex);
 
+	for (;;) {
 		Mutex_Lock(pendingMutex);
 		{
-			stop = http_terminate;
-			if (!stop && pendingReqs.Count) {
-				request = pendingReqs.Entries[0];
-				hasRequest = true;
-				RequestList_RemoveAt(&pendingReqs, 0);
-			}
+			stop       = http_terminate;
+			hasRequest = !stop && RequestQueue_Dequeue(&pendingReqs, &request);
+			hasMore    = pendingReqs.Count > 0;
+			if (hasRequest) Http_BeginRequest(worker, &request);
 		}
 		Mutex_Unlock(pendingMutex);
 
 		if (stop) return;
 		/* Block until another thread submits a req to do */
-		if (!hasRequest) {
-			Platform_LogConst("Going back to sleep...");
-			Waitable_Wait(workerWaitable);
-			continue;
-		}
-		Http_BeginRequest(&request);
+		/* NOTE: Times out, as the signal might have been raised right before this thread started waiting */
+		if (!hasRequest) { Waitable_WaitFor(workerWaitable, 100); continue; }
+		/* Wake up another worker to start on the next request */
+		if (hasMore) Waitable_Signal(workerWaitable);
 
 		beg = Stopwatch_Measure();
-		request.Result = Http_SysDo(&request);
+		request.Result = Http_SysDo(worker, &request);
 		end = Stopwatch_Measure();
 
+		waited  = (uint32_t)(request.TimeStarted - request.TimeAdded);
 		elapsed = Stopwatch_ElapsedMicroseconds(beg, end) / 1000;
-		Platform_Log3("HTTP: return code %i (http %i), in %i ms",
-					&request.Result, &request.StatusCode, &elapsed);
-		Http_FinishRequest(&request);
+		Platform_Log4("HTTP: return code %i (http %i), queued for %i ms, took %i ms",
+					&request.Result, &request.StatusCode, &waited, &elapsed);
+		Http_FinishRequest(worker, &request);
 	}
 }
 #endif
@@ -805,19 +963,45 @@ bool Http_GetResult(const String* id, struct HttpRequest* item) {
 }
 
 bool Http_GetCurrent(struct HttpRequest* request, int* progress) {
+	int i;
+	request->ID[0] = '\0';
+
 	Mutex_Lock(curRequestMutex);
 	{
-		*request  = http_curRequest;
-		*progress = http_curProgress;
+		for (i = 0; i < http_workersCount; i++) {
+			if (!http_workers[i].Request.ID[0]) continue;
+
+			*request  = http_workers[i].Request;
+			*progress = http_workers[i].Progress;
+			break;
+		}
 	}
 	Mutex_Unlock(curRequestMutex);
 	return request->ID[0];
 }
 
+bool Http_GetProgress(const String* id, int* progress) {
+	String reqID;
+	bool found = false;
+	int i;
+
+	Mutex_Lock(curRequestMutex);
+	{
+		for (i = 0; i < http_workersCount && !found; i++) {
+			reqID = String_FromRawArray(http_workers[i].Request.ID);
+			found = reqID.length && String_Equals(&reqID, id);
+			if (found) *progress = http_workers[i].Progress;
+		}
+	}
+	Mutex_Unlock(curRequestMutex);
+	return found;
+}
+
 void Http_ClearPending(void) {
 	Mutex_Lock(pendingMutex);
 	{
-		RequestList_Free(&pendingReqs);
+		RequestQueue_Free(&pendingReqs);
+		RequestList_Free(&coalescedReqs);
 	}
 	Mutex_Unlock(pendingMutex);
 	Waitable_Signal(workerWaitable);
@@ -873,9 +1057,20 @@ void Http_FormatDate(TimeMS ms, String* str) {
 *-----------------------------------------------------Http component------------------------------------------------------*
 *#########################################################################################################################*/
 static void Http_Init(void) {
+	int i;
 	ScheduledTask_Add(30, Http_PurgeOldEntriesTask);
-	RequestList_Init(&pendingReqs);
+	RequestQueue_Init(&pendingReqs);
 	RequestList_Init(&processedReqs);
+	RequestList_Init(&coalescedReqs);
+
+#ifndef CC_BUILD_WEB
+	http_workersCount = Options_GetInt(OPT_HTTP_WORKERS, 1, HTTP_MAX_WORKERS, 4);
+#else
+	http_workersCount = 1;
+#endif
+	for (i = 0; i < http_workersCount; i++) {
+		http_workers[i].Index = i;
+	}
 	Http_SysInit();
 
 	workerWaitable  = Waitable_Create();
@@ -883,19 +1078,28 @@ static void Http_Init(void) {
 	processedMutex  = Mutex_Create();
 	curRequestMutex = Mutex_Create();
 #ifndef CC_BUILD_WEB
-	workerThread    = Thread_Start(Http_WorkerLoop, false);
+	http_workersStarted = 0;
+	for (i = 0; i < http_workersCount; i++) {
+		workerThreads[i] = Thread_Start(Http_WorkerLoop, false);
+	}
 #endif
 }
 
 static void Http_Free(void) {
+#ifndef CC_BUILD_WEB
+	int i;
+#endif
 	http_terminate = true;
 	Http_ClearPending();
 #ifndef CC_BUILD_WEB
-	Thread_Join(workerThread);
+	for (i = 0; i < http_workersCount; i++) {
+		Thread_Join(workerThreads[i]);
+	}
 #endif
 
-	RequestList_Free(&pendingReqs);
+	RequestQueue_Free(&pendingReqs);
 	RequestList_Free(&processedReqs);
+	RequestList_Free(&coalescedReqs);
 	Http_SysFree();
 
 	Waitable_Free(workerWaitable);
@@ -23,6 +23,7 @@ struct HttpRequest {
 	char URL[URL_MAX_SIZE]; /* URL data is downloaded from/uploaded to. */
 	char ID[URL_MAX_SIZE];  /* Unique identifier for this request. */
 	TimeMS TimeAdded;       /* Time this request was added to queue of requests. */
+	TimeMS TimeStarted;     /* Time a worker began processing this request. */
 	TimeMS TimeDownloaded;  /* Time response contents were completely downloaded. */
 	int StatusCode;         /* HTTP status code returned in the response. */
 	uint32_t ContentLength; /* HTTP content length returned in the response. */
@@ -67,8 +68,10 @@ void Http_FormatDate(TimeMS ms, String* str);
 /* NOTE: You MUST also check Result/StatusCode, and check Size is > 0. */
 /* (because a completed request may not have completed successfully) */
 bool Http_GetResult(const String* id, struct HttpRequest* item);
-/* Retrieves information about the request currently being processed. */
+/* Retrieves information about a request currently being processed. */
 bool Http_GetCurrent(struct HttpRequest* request, int* progress);
+/* Retrieves progress of the request with the given id, if it is currently being processed. */
+bool Http_GetProgress(const String* id, int* progress);
 /* Clears the list of pending requests. */
 void Http_ClearPending(void);
 void Http_PurgeOldEntriesTask(struct ScheduledTask* task);
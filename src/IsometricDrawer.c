@@ -6,6 +6,11 @@
 #include "Block.h"
 #include "TexturePack.h"
 #include "Block.h"
+#include "Bitmap.h"
+#include "Event.h"
+#include "Funcs.h"
+#include "Platform.h"
+#include "GameStructs.h"
 
 static float iso_scale;
 static VertexP3fT2fC4b* iso_vertices;
@@ -137,11 +142,8 @@ void IsometricDrawer_BeginBatch(VertexP3fT2fC4b* vertices, GfxResourceID vb) {
 	Gfx_LoadMatrix(MATRIX_VIEW, &iso_transform);
 }
 
-void IsometricDrawer_DrawBatch(BlockID block, float size, float x, float y) {
-	bool bright = Blocks.FullBright[block];
-	Vector3 min, max;
-	if (Blocks.Draw[block] == DRAW_GAS) return;
-
+/* Calculates isometric coordinates of the centre of a block drawn at the given screen coordinates */
+static void IsometricDrawer_CalcPos(float size, float x, float y) {
 	/* isometric coords size: cosY * -scale - sinY * scale */
 	/* we need to divide by (2 * cosY), as the calling function expects size to be in pixels. */
 	iso_scale = size / (2.0f * iso_cosY);
@@ -150,6 +152,29 @@ void IsometricDrawer_DrawBatch(BlockID block, float size, float x, float y) {
 	iso_pos.X = x; iso_pos.Y = y; iso_pos.Z = 0.0f;
 	IsometricDrawer_RotateX(iso_cosX, -iso_sinX);
 	IsometricDrawer_RotateY(iso_cosY, -iso_sinY);
+}
+
+static void IsometricDrawer_CalcBounds(BlockID block) {
+	Vector3 min, max;
+	Drawer.MinBB = Blocks.MinBB[block]; Drawer.MinBB.Y = 1.0f - Drawer.MinBB.Y;
+	Drawer.MaxBB = Blocks.MaxBB[block]; Drawer.MaxBB.Y = 1.0f - Drawer.MaxBB.Y;
+	min = Blocks.MinBB[block]; max = Blocks.MaxBB[block];
+
+	Drawer.X1 = iso_scale * (1.0f - min.X * 2.0f) + iso_pos.X; 
+	Drawer.X2 = iso_scale * (1.0f - max.X * 2.0f) + iso_pos.X;
+	Drawer.Y1 = iso_scale * (1.0f - min.Y * 2.0f) + iso_pos.Y; 
+	Drawer.Y2 = iso_scale * (1.0f - max.Y * 2.0f) + iso_pos.Y;
+	Drawer.Z1 = iso_scale * (1.0f - min.Z * 2.0f) + iso_pos.Z; 
+	Drawer.Z2 = iso_scale * (1.0f - max.Z * 2.0f) + iso_pos.Z;
+
+	Drawer.Tinted  = Blocks.Tinted[block];
+	Drawer.TintCol = Blocks.FogCol[block];
+}
+
+void IsometricDrawer_DrawBatch(BlockID block, float size, float x, float y) {
+	bool bright = Blocks.FullBright[block];
+	if (Blocks.Draw[block] == DRAW_GAS) return;
+	IsometricDrawer_CalcPos(size, x, y);
 
 	/* See comment in GfxCommon_Draw2DTexture() */
 	iso_pos.X -= 0.5f; iso_pos.Y -= 0.5f;
@@ -161,19 +186,7 @@ void IsometricDrawer_DrawBatch(BlockID block, float size, float x, float y) {
 		IsometricDrawer_SpriteZQuad(block, false);
 		IsometricDrawer_SpriteXQuad(block, false);
 	} else {
-		Drawer.MinBB = Blocks.MinBB[block]; Drawer.MinBB.Y = 1.0f - Drawer.MinBB.Y;
-		Drawer.MaxBB = Blocks.MaxBB[block]; Drawer.MaxBB.Y = 1.0f - Drawer.MaxBB.Y;
-		min = Blocks.MinBB[block]; max = Blocks.MaxBB[block];
-
-		Drawer.X1 = iso_scale * (1.0f - min.X * 2.0f) + iso_pos.X; 
-		Drawer.X2 = iso_scale * (1.0f - max.X * 2.0f) + iso_pos.X;
-		Drawer.Y1 = iso_scale * (1.0f - min.Y * 2.0f) + iso_pos.Y; 
-		Drawer.Y2 = iso_scale * (1.0f - max.Y * 2.0f) + iso_pos.Y;
-		Drawer.Z1 = iso_scale * (1.0f - min.Z * 2.0f) + iso_pos.Z; 
-		Drawer.Z2 = iso_scale * (1.0f - max.Z * 2.0f) + iso_pos.Z;
-
-		Drawer.Tinted  = Blocks.Tinted[block];
-		Drawer.TintCol = Blocks.FogCol[block];
+		IsometricDrawer_CalcBounds(block);
 
 		Drawer_XMax(1, bright ? iso_col : iso_colXSide, 
 			IsometricDrawer_GetTexLoc(block, FACE_XMAX), &iso_vertices);
@@ -193,3 +206,241 @@ void IsometricDrawer_EndBatch(void) {
 	iso_lastTexIndex = -1;
 	Gfx_LoadIdentityMatrix(MATRIX_VIEW);
 }
+
+
+/*########################################################################################################################*
+*--------------------------------------------------Software rasterisation-------------------------------------------------*
+*#########################################################################################################################*/
+static Bitmap* icon_bmp;
+static int icon_x1, icon_y1, icon_x2, icon_y2;
+
+/* Blends a texel (already multiplied by the quad's colour) over the given pixel, like alpha blending on the GPU */
+static void IsometricDrawer_BlendPixel(BitmapCol* dst, BitmapCol src) {
+	int srcA = src.A, dstA = dst->A * (255 - srcA) / 255;
+	int outA = srcA + dstA;
+	if (!srcA) return;
+
+	dst->R = (uint8_t)((src.R * srcA + dst->R * dstA) / outA);
+	dst->G = (uint8_t)((src.G * srcA + dst->G * dstA) / outA);
+	dst->B = (uint8_t)((src.B * srcA + dst->B * dstA) / outA);
+	dst->A = (uint8_t)outA;
+}
+
+/* Rasterises the 4 vertices just written for a face into icon_bmp, sampling the tile from Atlas2D. */
+/* NOTE: Faces are parallelograms on screen, so texture coordinates are found by inverting the affine mapping. */
+static void IsometricDrawer_RasterQuad(TextureLoc loc) {
+	VertexP3fT2fC4b* v = iso_vertices_base;
+	Vector3 p[4];
+	float e1X, e1Y, e2X, e2Y, det, dx, dy, a, b, u, vv;
+	float du1, du2, dv1, dv2, minX, maxX, minY, maxY;
+	int i, x, y, xStart, xEnd, yStart, yEnd, tx, ty;
+	int tileSize = Atlas2D.TileSize;
+	int tileX = Atlas2D_TileX(loc) * tileSize, tileY = Atlas2D_TileY(loc) * tileSize;
+	PackedCol col = v[0].Col;
+	BitmapCol src;
+
+	if (!Atlas2D.Bitmap.Scan0 || Atlas2D_TileY(loc) >= Atlas2D.RowsCount) return;
+	for (i = 0; i < 4; i++) {
+		Vector3 pos = { v[i].X, v[i].Y, v[i].Z };
+		Vector3_Transform(&p[i], &pos, &iso_transform);
+	}
+
+	e1X = p[1].X - p[0].X; e1Y = p[1].Y - p[0].Y;
+	e2X = p[3].X - p[0].X; e2Y = p[3].Y - p[0].Y;
+	det = e1X * e2Y - e1Y * e2X;
+	if (Math_AbsF(det) < 0.0001f) return;
+
+	du1 = v[1].U - v[0].U; du2 = v[3].U - v[0].U;
+	dv1 = v[1].V - v[0].V; dv2 = v[3].V - v[0].V;
+
+	minX = maxX = p[0].X; minY = maxY = p[0].Y;
+	for (i = 1; i < 4; i++) {
+		minX = min(minX, p[i].X); maxX = max(maxX, p[i].X);
+		minY = min(minY, p[i].Y); maxY = max(maxY, p[i].Y);
+	}
+	xStart = max(icon_x1, (int)Math_Floor(minX)); xEnd = min(icon_x2, (int)Math_Ceil(maxX));
+	yStart = max(icon_y1, (int)Math_Floor(minY)); yEnd = min(icon_y2, (int)Math_Ceil(maxY));
+
+	for (y = yStart; y < yEnd; y++) {
+		BitmapCol* row = Bitmap_GetRow(icon_bmp, y);
+		for (x = xStart; x < xEnd; x++) {
+			/* Solve pixel centre = p0 + a * e1 + b * e2 */
+			dx = (x + 0.5f) - p[0].X; dy = (y + 0.5f) - p[0].Y;
+			a  = (dx * e2Y - dy * e2X) / det;
+			b  = (e1X * dy - e1Y * dx) / det;
+			if (a < 0.0f || a >= 1.0f || b < 0.0f || b >= 1.0f) continue;
+
+			u  = v[0].U + a * du1 + b * du2;
+			vv = v[0].V + a * dv1 + b * dv2;
+			/* V coordinate is within the 1D atlas, so convert back to within the tile */
+			vv = vv * Atlas1D.TilesPerAtlas - Atlas1D_RowId(loc);
+
+			tx = (int)(u  * tileSize); Math_Clamp(tx, 0, tileSize - 1);
+			ty = (int)(vv * tileSize); Math_Clamp(ty, 0, tileSize - 1);
+			src = Bitmap_GetPixel(&Atlas2D.Bitmap, tileX + tx, tileY + ty);
+
+			src.R = (uint8_t)(src.R * col.R / 255); src.G = (uint8_t)(src.G * col.G / 255);
+			src.B = (uint8_t)(src.B * col.B / 255); src.A = (uint8_t)(src.A * col.A / 255);
+			IsometricDrawer_BlendPixel(&row[x], src);
+		}
+	}
+}
+
+static void IsometricDrawer_RasterSprite(BlockID block, bool xQuad, bool firstPart) {
+	iso_lastTexIndex = -1;
+	if (xQuad) {
+		IsometricDrawer_SpriteXQuad(block, firstPart);
+		IsometricDrawer_RasterQuad(Block_Tex(block, FACE_XMAX));
+	} else {
+		IsometricDrawer_SpriteZQuad(block, firstPart);
+		IsometricDrawer_RasterQuad(Block_Tex(block, FACE_ZMAX));
+	}
+}
+
+typedef void (*DrawFaceFunc)(int count, PackedCol col, TextureLoc texLoc, VertexP3fT2fC4b** vertices);
+static void IsometricDrawer_RasterFace(BlockID block, Face face, PackedCol col, DrawFaceFunc drawFace) {
+	TextureLoc loc = Block_Tex(block, face);
+	iso_vertices   = iso_vertices_base;
+	drawFace(1, col, loc, &iso_vertices);
+	IsometricDrawer_RasterQuad(loc);
+}
+
+void IsometricDrawer_DrawIcon(BlockID block, float size, Bitmap* bmp, int x, int y, int iconSize) {
+	VertexP3fT2fC4b vertices[4];
+	bool bright = Blocks.FullBright[block];
+	if (Blocks.Draw[block] == DRAW_GAS) return;
+
+	IsometricDrawer_InitCache();
+	icon_bmp = bmp;
+	icon_x1  = max(0, x - iconSize / 2); icon_x2 = min(bmp->Width,  icon_x1 + iconSize);
+	icon_y1  = max(0, y - iconSize / 2); icon_y2 = min(bmp->Height, icon_y1 + iconSize);
+
+	iso_vertices_base = vertices;
+	IsometricDrawer_CalcPos(size, (float)x, (float)y);
+
+	/* Faces are drawn in the same order as IsometricDrawer_DrawBatch, so overlapping parts blend the same */
+	if (Blocks.Draw[block] == DRAW_SPRITE) {
+		IsometricDrawer_RasterSprite(block, true,  true);
+		IsometricDrawer_RasterSprite(block, false, true);
+
+		IsometricDrawer_RasterSprite(block, false, false);
+		IsometricDrawer_RasterSprite(block, true,  false);
+	} else {
+		IsometricDrawer_CalcBounds(block);
+
+		IsometricDrawer_RasterFace(block, FACE_XMAX, bright ? iso_col : iso_colXSide, Drawer_XMax);
+		IsometricDrawer_RasterFace(block, FACE_ZMIN, bright ? iso_col : iso_colZSide, Drawer_ZMin);
+		IsometricDrawer_RasterFace(block, FACE_YMAX, iso_col,                         Drawer_YMax);
+	}
+	iso_lastTexIndex = -1;
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Icon cache--------------------------------------------------------*
+*#########################################################################################################################*/
+#define ICON_PAGE_SIZE 512
+#define ICON_MAX_CELL  (ICON_PAGE_SIZE / 4)
+#define ICON_MAX_PAGES 16
+
+static GfxResourceID icon_pages[ICON_MAX_PAGES];
+/* Slot in the pages of each cached block icon, plus 1. (0 means not cached yet) */
+static uint16_t icon_slots[BLOCK_COUNT];
+static int icon_slotsUsed, icon_cellSize;
+static float icon_size;
+static BitmapCol icon_cellPixels[ICON_MAX_CELL * ICON_MAX_CELL];
+
+void IsometricDrawer_ClearIcons(void) {
+	int i;
+	for (i = 0; i < ICON_MAX_PAGES; i++) {
+		Gfx_DeleteTexture(&icon_pages[i]);
+	}
+
+	Mem_Set(icon_slots, 0, sizeof(icon_slots));
+	icon_slotsUsed = 0;
+}
+
+static void IsometricDrawer_ClearIconsEvent(void* obj) { IsometricDrawer_ClearIcons(); }
+
+static GfxResourceID IsometricDrawer_MakePage(void) {
+	GfxResourceID tex;
+	Bitmap bmp;
+
+	Bitmap_AllocateClearedPow2(&bmp, ICON_PAGE_SIZE, ICON_PAGE_SIZE);
+	tex = Gfx_CreateTexture(&bmp, false, false);
+	Mem_Free(bmp.Scan0);
+	return tex;
+}
+
+static bool IsometricDrawer_MakeIcon(BlockID block, int slot) {
+	int perRow  = ICON_PAGE_SIZE / icon_cellSize;
+	int perPage = perRow * perRow;
+	int page = slot / perPage, x, y;
+	Bitmap bmp;
+
+	if (page >= ICON_MAX_PAGES) return false;
+	if (!icon_pages[page]) icon_pages[page] = IsometricDrawer_MakePage();
+	if (!icon_pages[page]) return false;
+
+	Bitmap_Init(bmp, icon_cellSize, icon_cellSize, (uint8_t*)icon_cellPixels);
+	Mem_Set(icon_cellPixels, 0, Bitmap_DataSize(icon_cellSize, icon_cellSize));
+	IsometricDrawer_DrawIcon(block, icon_size, &bmp, 
+		icon_cellSize / 2, icon_cellSize / 2, icon_cellSize);
+
+	x = (slot % perRow)            * icon_cellSize;
+	y = ((slot % perPage) / perRow) * icon_cellSize;
+	Gfx_UpdateTexturePart(icon_pages[page], x, y, &bmp, false);
+	return true;
+}
+
+bool IsometricDrawer_GetIcon(BlockID block, float size, struct Texture* tex) {
+	int perRow, perPage, slot, x, y;
+	/* Sprites stick out 10% past the block bounds, so need a little more than the cube's 2 * size */
+	int cellSize = (int)Math_Ceil(size * 2.5f) + 2;
+	if (cellSize > ICON_MAX_CELL) return false;
+
+	if (cellSize != icon_cellSize || size != icon_size) {
+		IsometricDrawer_ClearIcons();
+		icon_cellSize = cellSize;
+		icon_size     = size;
+	}
+
+	slot = icon_slots[block] - 1;
+	if (slot == -1) {
+		slot = icon_slotsUsed;
+		if (!IsometricDrawer_MakeIcon(block, slot)) return false;
+
+		icon_slots[block] = slot + 1;
+		icon_slotsUsed++;
+	}
+	if (!tex) return true;
+
+	perRow  = ICON_PAGE_SIZE / icon_cellSize;
+	perPage = perRow * perRow;
+	x = (slot % perRow)            * icon_cellSize;
+	y = ((slot % perPage) / perRow) * icon_cellSize;
+
+	tex->ID     = icon_pages[slot / perPage];
+	tex->Width  = icon_cellSize; tex->Height = icon_cellSize;
+	tex->uv.U1  = (float)x / ICON_PAGE_SIZE; tex->uv.U2 = (float)(x + icon_cellSize) / ICON_PAGE_SIZE;
+	tex->uv.V1  = (float)y / ICON_PAGE_SIZE; tex->uv.V2 = (float)(y + icon_cellSize) / ICON_PAGE_SIZE;
+	return true;
+}
+
+static void IsometricDrawer_Init(void) {
+	Event_RegisterVoid(&TextureEvents.AtlasChanged,  NULL, IsometricDrawer_ClearIconsEvent);
+	Event_RegisterVoid(&BlockEvents.BlockDefChanged, NULL, IsometricDrawer_ClearIconsEvent);
+	Event_RegisterVoid(&GfxEvents.ContextLost,       NULL, IsometricDrawer_ClearIconsEvent);
+}
+
+static void IsometricDrawer_Free(void) {
+	Event_UnregisterVoid(&TextureEvents.AtlasChanged,  NULL, IsometricDrawer_ClearIconsEvent);
+	Event_UnregisterVoid(&BlockEvents.BlockDefChanged, NULL, IsometricDrawer_ClearIconsEvent);
+	Event_UnregisterVoid(&GfxEvents.ContextLost,       NULL, IsometricDrawer_ClearIconsEvent);
+	IsometricDrawer_ClearIcons();
+}
+
+struct IGameComponent IsometricDrawer_Component = {
+	IsometricDrawer_Init, /* Init  */
+	IsometricDrawer_Free  /* Free  */
+};
@@ -1,9 +1,13 @@
 #ifndef CC_ISOMETRICDRAWER_H
 #define CC_ISOMETRICDRAWER_H
 #include "VertexStructs.h"
+#include "Bitmap.h"
 /* Draws 2D isometric blocks for the hotbar and inventory UIs.
    Copyright 2014-2017 ClassicalSharp | Licensed under BSD-3
 */
+struct IGameComponent;
+struct Texture;
+extern struct IGameComponent IsometricDrawer_Component;
 
 /* Maximum number of vertices used to draw a block in isometric way. */
 #define ISOMETRICDRAWER_MAXVERTICES 16
@@ -13,4 +17,16 @@ void IsometricDrawer_BeginBatch(VertexP3fT2fC4b* vertices, GfxResourceID vb);
 void IsometricDrawer_DrawBatch(BlockID block, float size, float x, float y);
 /* Flushes buffered vertices to the GPU, then restores state. */
 void IsometricDrawer_EndBatch(void);
+
+/* Rasterises the given block isometrically into the given bitmap on the CPU, centred at (x, y). */
+/* Pixels outside the iconSize x iconSize square around (x, y) are left untouched. */
+/* NOTE: Must not be called between IsometricDrawer_BeginBatch and IsometricDrawer_EndBatch. */
+void IsometricDrawer_DrawIcon(BlockID block, float size, Bitmap* bmp, int x, int y, int iconSize);
+/* Retrieves the cached icon texture for the given block, creating it if necessary. */
+/* Returns false if the icon could not be cached, in which case the block should be drawn using a batch. */
+/* NOTE: Icons of width and height tex->Width/Height are centred on the block's position. */
+/* NOTE: tex can be NULL, to just check whether the block's icon is cached. */
+bool IsometricDrawer_GetIcon(BlockID block, float size, struct Texture* tex);
+/* Removes all cached icons. (e.g. since terrain atlas changed) */
+void IsometricDrawer_ClearIcons(void);
 #endif
@@ -7,6 +7,15 @@
 #include "Logger.h"
 #include "Event.h"
 #include "GameStructs.h"
+#include "Options.h"
+#include "Builder.h"
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGHTING_SSE2
+#elif defined __ARM_NEON || defined __ARM_NEON__
+#include <arm_neon.h>
+#define LIGHTING_NEON
+#endif
 
 int16_t* Lighting_Heightmap;
 #define HEIGHT_UNCALCULATED Int16_MaxValue
@@ -22,6 +31,33 @@ for (y = maxY; y >= 0; y--, i -= World.OneY) {\
 	}\
 }
 
+#ifdef SPARSE_WORLD
+static int Lighting_CalcHeightAt(int x, int maxY, int z, int hIndex) {
+	const struct SubChunk* c;
+	BlockID block;
+	int y = maxY, i, offset;
+
+	while (y >= 0) {
+		c = &World.Chunks[World_PackChunk(x >> SUBCHUNK_SHIFT, y >> SUBCHUNK_SHIFT, z >> SUBCHUNK_SHIFT)];
+		/* Skip straight past sub chunks made entirely of a block that doesn't block light */
+		if (!c->Data && !Blocks.BlocksLight[c->Uniform]) {
+			y = (y & ~SUBCHUNK_MASK) - 1; continue;
+		}
+
+		for (i = SubChunk_Pack(x, y, z); i >= 0; i -= SUBCHUNK_SIZE * SUBCHUNK_SIZE, y--) {
+			block = SubChunk_Get(c, i);
+			if (!Blocks.BlocksLight[block]) continue;
+
+			offset = (Blocks.LightOffset[block] >> FACE_YMAX) & 1;
+			Lighting_Heightmap[hIndex] = y - offset;
+			return y - offset;
+		}
+	}
+
+	Lighting_Heightmap[hIndex] = -10;
+	return -10;
+}
+#else
 static int Lighting_CalcHeightAt(int x, int maxY, int z, int hIndex) {
 	int i = World_Pack(x, maxY, z);
 	BlockID block;
@@ -40,6 +76,12 @@ static int Lighting_CalcHeightAt(int x, int maxY, int z, int hIndex) {
 	Lighting_Heightmap[hIndex] = -10;
 	return -10;
 }
+#endif
+
+static int  FloodLight_Level(int x, int y, int z);
+static void FloodLight_Calc(void);
+static void FloodLight_Free(void);
+static void FloodLight_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
 
 static int Lighting_GetLightHeight(int x, int z) {
 	int hIndex = Lighting_Pack(x, z);
@@ -53,10 +95,12 @@ bool Lighting_IsLit(int x, int y, int z) {
 }
 
 PackedCol Lighting_Col(int x, int y, int z) {
+	if (Lighting_Flood) return Lighting_LevelCol(Env.ShadowCol, Env.SunCol, FloodLight_Level(x, y, z));
 	return y > Lighting_GetLightHeight(x, z) ? Env.SunCol : Env.ShadowCol;
 }
 
 PackedCol Lighting_Col_XSide(int x, int y, int z) {
+	if (Lighting_Flood) return Lighting_LevelCol(Env.ShadowXSide, Env.SunXSide, FloodLight_Level(x, y, z));
 	return y > Lighting_GetLightHeight(x, z) ? Env.SunXSide : Env.ShadowXSide;
 }
 
@@ -85,6 +129,7 @@ void Lighting_Refresh(void) {
 	for (i = 0; i < World.Width * World.Length; i++) {
 		Lighting_Heightmap[i] = HEIGHT_UNCALCULATED;
 	}
+	if (Lighting_Flood) FloodLight_Calc();
 }
 
 
@@ -138,11 +183,14 @@ for (; y >= minY; y--, i -= World.OneY) {\
 	if (affected) return true;\
 }
 
-static bool Lighting_NeedsNeighour(BlockID block, int i, int minY, int y, int nY) {
+static bool Lighting_NeedsNeighour(BlockID block, int x, int y, int z, int minY, int nY) {
+	int i = World_Pack(x, y, z);
 	BlockID other;
 	bool affected;
 
-#ifndef EXTENDED_BLOCKS
+#if defined SPARSE_WORLD
+	Lighting_NeedsNeighourBody(World_GetBlock(x, y, z));
+#elif !defined EXTENDED_BLOCKS
 	Lighting_NeedsNeighourBody(World.Blocks[i]);
 #else
 	if (Block_UsedCount <= 256) {
@@ -160,7 +208,7 @@ static void Lighting_ResetNeighbour(int x, int y, int z, BlockID block, int cx,
 	if (minCy == maxCy) {
 		minY = cy << CHUNK_SHIFT;
 
-		if (Lighting_NeedsNeighour(block, World_Pack(x, y, z), minY, y, y)) {
+		if (Lighting_NeedsNeighour(block, x, y, z, minY, y)) {
 			MapRenderer_RefreshChunk(cx, cy, cz);
 		}
 	} else {
@@ -169,13 +217,29 @@ static void Lighting_ResetNeighbour(int x, int y, int z, BlockID block, int cx,
 			maxY = (cy << CHUNK_SHIFT) + CHUNK_MAX;
 			if (maxY > World.MaxY) maxY = World.MaxY;
 
-			if (Lighting_NeedsNeighour(block, World_Pack(x, maxY, z), minY, maxY, y)) {
+			if (Lighting_NeedsNeighour(block, x, maxY, z, minY, y)) {
 				MapRenderer_RefreshChunk(cx, cy, cz);
 			}
 		}
 	}
 }
 
+/* Refreshes chunks between minCy and maxCy in a neighbouring column that have any visible blocks. */
+static void Lighting_ResetNeighbourColumn(int x, int z, int cx, int cz, int minCy, int maxCy) {
+	int cy, minY, maxY;
+
+	for (cy = maxCy; cy >= minCy; cy--) {
+		minY = (cy << CHUNK_SHIFT);
+		maxY = (cy << CHUNK_SHIFT) + CHUNK_MAX;
+		if (maxY > World.MaxY) maxY = World.MaxY;
+
+		/* nY of -1 means every block is only checked for whether it is visible */
+		if (Lighting_NeedsNeighour(BLOCK_AIR, x, maxY, z, minY, -1)) {
+			MapRenderer_RefreshChunk(cx, cy, cz);
+		}
+	}
+}
+
 static void Lighting_ResetColumn(int cx, int cy, int cz, int minCy, int maxCy) {
 	if (minCy == maxCy) {
 		MapRenderer_RefreshChunk(cx, cy, cz);
@@ -222,16 +286,49 @@ void Lighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newB
 	int hIndex = Lighting_Pack(x, z);
 	int lightH = Lighting_Heightmap[hIndex];
 	int newHeight;
+	if (Lighting_Flood) FloodLight_OnBlockChanged(x, y, z, oldBlock, newBlock);
 
 	/* Since light wasn't checked to begin with, means column never had meshes for any of its chunks built. */
 	/* So we don't need to do anything. */
 	if (lightH == HEIGHT_UNCALCULATED) return;
 
 	Lighting_UpdateLighting(x, y, z, oldBlock, newBlock, hIndex, lightH);
+	/* Chunk meshes only use the flood fill light levels in that case */
+	if (Lighting_Flood) return;
 	newHeight = Lighting_Heightmap[hIndex] + 1;
 	Lighting_RefreshAffected(x, y, z, newBlock, lightH + 1, newHeight);
 }
 
+void Lighting_OnColumnChanged(int x, int z, int maxY) {
+	int hIndex = Lighting_Pack(x, z);
+	int lightH = Lighting_Heightmap[hIndex];
+	int cx = x >> CHUNK_SHIFT, bX = x & CHUNK_MASK;
+	int cz = z >> CHUNK_SHIFT, bZ = z & CHUNK_MASK;
+	int newH, minCy, maxCy;
+
+	if (lightH == HEIGHT_UNCALCULATED || Lighting_Flood) return;
+	/* Blocks above both the old light height and the highest changed block can't block light */
+	newH = Lighting_CalcHeightAt(x, min(max(lightH + 1, maxY), World.MaxY), z, hIndex);
+	if (newH == lightH) return;
+
+	minCy = max(min(lightH, newH) + 1, 0) >> CHUNK_SHIFT;
+	maxCy = max(max(lightH, newH) + 1, 0) >> CHUNK_SHIFT;
+	Lighting_ResetColumn(cx, 0, cz, minCy, maxCy);
+
+	if (bX == 0 && cx > 0) {
+		Lighting_ResetNeighbourColumn(x - 1, z, cx - 1, cz, minCy, maxCy);
+	}
+	if (bZ == 0 && cz > 0) {
+		Lighting_ResetNeighbourColumn(x, z - 1, cx, cz - 1, minCy, maxCy);
+	}
+	if (bX == 15 && cx < MapRenderer_ChunksX - 1) {
+		Lighting_ResetNeighbourColumn(x + 1, z, cx + 1, cz, minCy, maxCy);
+	}
+	if (bZ == 15 && cz < MapRenderer_ChunksZ - 1) {
+		Lighting_ResetNeighbourColumn(x, z + 1, cx, cz + 1, minCy, maxCy);
+	}
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------Lighting heightmap----------------------------------------------------*
@@ -309,7 +406,9 @@ static bool Lighting_CalculateHeightmapCoverage(int x1, int z1, int xCount, int
 	int mapIndex, hIndex, baseIndex, index;
 	int x, y, z;
 
-#ifndef EXTENDED_BLOCKS
+#if defined SPARSE_WORLD
+	Lighting_CalculateBody(World_GetBlock(x1 + x, y, z1 + z));
+#elif !defined EXTENDED_BLOCKS
 	Lighting_CalculateBody(World.Blocks[mapIndex]);
 #else
 	if (Block_UsedCount <= 256) {
@@ -349,21 +448,473 @@ void Lighting_LightHint(int startX, int startZ) {
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------Whole map heightmap-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Rows of columns are claimed by the heightmap threads this many at a time */
+#define HEIGHTMAP_ROWS_BATCH 16
+static void* heightmap_mutex;
+static int heightmap_nextRow;
+
+#ifdef SPARSE_WORLD
+/* Sub chunks entirely of a block that doesn't block light are already skipped past */
+static void Lighting_CalcHeightmapRow(int z) {
+	int x;
+	for (x = 0; x < World.Width; x++) {
+		Lighting_CalcHeightAt(x, World.MaxY, z, Lighting_Pack(x, z));
+	}
+}
+#else
+/* Returns whether the 16 blocks starting at the given pointer are all air. */
+static bool Lighting_AllAir16(const BlockRaw* blocks) {
+#if defined LIGHTING_SSE2
+	__m128i row = _mm_loadu_si128((const __m128i*)blocks);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(row, _mm_setzero_si128())) == 0xFFFF;
+#elif defined LIGHTING_NEON
+	uint64x2_t row = vreinterpretq_u64_u8(vld1q_u8(blocks));
+	return (vgetq_lane_u64(row, 0) | vgetq_lane_u64(row, 1)) == 0;
+#else
+	return (blocks[0]  | blocks[1]  | blocks[2]  | blocks[3]  | blocks[4]  | blocks[5]  | blocks[6]  | blocks[7] |
+			blocks[8]  | blocks[9]  | blocks[10] | blocks[11] | blocks[12] | blocks[13] | blocks[14] | blocks[15]) == 0;
+#endif
+}
+
+/* Scans down a row of columns one layer at a time, which reads blocks in memory order. */
+static void Lighting_CalcHeightmapRow(int z) {
+	int16_t* heights = &Lighting_Heightmap[Lighting_Pack(0, z)];
+	int x, y, i, offset, left = World.Width;
+	/* Air can be redefined to block light by custom blocks */
+	bool skipAir = !Blocks.BlocksLight[BLOCK_AIR];
+	BlockID block;
+
+	for (x = 0; x < World.Width; x++) { heights[x] = HEIGHT_UNCALCULATED; }
+
+	for (y = World.MaxY; y >= 0 && left > 0; y--) {
+		i = World_Pack(0, y, z);
+
+		for (x = 0; x < World.Width; x++, i++) {
+			/* Most of the top of a map is usually open sky, so skip past 16 air blocks at once */
+			if (skipAir && !(x & 15) && x + 16 <= World.Width && Lighting_AllAir16(&World.Blocks[i])) {
+#ifdef EXTENDED_BLOCKS
+				if (Block_UsedCount <= 256 || Lighting_AllAir16(&World.Blocks2[i]))
+#endif
+				{ x += 15; i += 15; continue; }
+			}
+			if (heights[x] != HEIGHT_UNCALCULATED) continue;
+
+			block = World.Blocks[i];
+#ifdef EXTENDED_BLOCKS
+			if (Block_UsedCount > 256) block |= World.Blocks2[i] << 8;
+#endif
+			if (!Blocks.BlocksLight[block]) continue;
+
+			offset     = (Blocks.LightOffset[block] >> FACE_YMAX) & 1;
+			heights[x] = y - offset;
+			left--;
+		}
+	}
+
+	for (x = 0; x < World.Width; x++) {
+		if (heights[x] == HEIGHT_UNCALCULATED) heights[x] = -10;
+	}
+}
+#endif
+
+static void Lighting_HeightmapWorker(void) {
+	int z, end;
+	for (;;) {
+		Mutex_Lock(heightmap_mutex);
+		{
+			z = heightmap_nextRow;
+			heightmap_nextRow += HEIGHTMAP_ROWS_BATCH;
+		}
+		Mutex_Unlock(heightmap_mutex);
+
+		if (z >= World.Length) return;
+		end = min(World.Length, z + HEIGHTMAP_ROWS_BATCH);
+		for (; z < end; z++) { Lighting_CalcHeightmapRow(z); }
+	}
+}
+
+/* Calculates the entire heightmap up front, split across the main thread and as many threads as chunk workers. */
+/* This way chunk building never has to wait on lazily calculating light heights. */
+static void Lighting_CalcHeightmap(void) {
+	void* threads[BUILDER_MAX_WORKERS];
+	int i, count = Builder_WorkersCount;
+
+	heightmap_nextRow = 0;
+	heightmap_mutex   = Mutex_Create();
+	for (i = 0; i < count; i++) {
+		threads[i] = Thread_Start(Lighting_HeightmapWorker, false);
+	}
+
+	Lighting_HeightmapWorker();
+	for (i = 0; i < count; i++) {
+		Thread_Join(threads[i]);
+	}
+	Mutex_Free(heightmap_mutex);
+}
+
+
+/*########################################################################################################################*
+*----------------------------------------------------Flood lighting-------------------------------------------------------*
+*#########################################################################################################################*/
+bool Lighting_Flood;
+#define LIGHT_MAX 15
+#define LIGHT_SKY_SHIFT 4
+#define LIGHT_SKY_LIT (LIGHT_MAX << LIGHT_SKY_SHIFT)
+#define LIGHT_SECTION_SIZE (CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE)
+
+/* Light levels of each 16x16x16 section of the world. (low 4 bits are block light, high 4 bits are sky light) */
+/* Sections where every block has the same light level aren't allocated, and store that level in light_uniform. */
+static uint8_t** light_sections;
+static uint8_t* light_uniform;
+static int light_sectionsX, light_sectionsY, light_sectionsZ;
+/* Whether the mesh of a section's chunk must be rebuilt because light in or beside it changed. */
+static bool* light_dirty;
+static bool light_trackDirty;
+
+/* Growable FIFO of packed block indices (and light levels, for removal) */
+struct LightQueue { int* Entries; int Head, Count, Capacity; };
+static struct LightQueue light_add, light_remove, light_dirtyQueue;
+
+/* How much of the gap between shadow and sun colour each light level covers. */
+static const float light_factors[LIGHT_MAX + 1] = {
+	0.00f, 0.04f, 0.06f, 0.07f, 0.09f, 0.11f, 0.13f, 0.17f,
+	0.21f, 0.26f, 0.33f, 0.41f, 0.51f, 0.64f, 0.80f, 1.00f
+};
+
+static void LightQueue_Push(struct LightQueue* q, int value) {
+	if (q->Count == q->Capacity) {
+		q->Capacity = q->Capacity ? q->Capacity * 2 : 1024;
+		q->Entries  = Mem_Realloc(q->Entries, q->Capacity, 4, "light queue");
+	}
+	q->Entries[q->Count++] = value;
+}
+
+static void LightQueue_Free(struct LightQueue* q) {
+	Mem_Free(q->Entries);
+	q->Entries = NULL;
+	q->Head = 0; q->Count = 0; q->Capacity = 0;
+}
+
+#define FloodLight_SectionIndex(x, y, z) ((((y) >> CHUNK_SHIFT) * light_sectionsZ + ((z) >> CHUNK_SHIFT)) * light_sectionsX + ((x) >> CHUNK_SHIFT))
+#define FloodLight_BlockIndex(x, y, z) ((((y) & CHUNK_MASK) << 8) | (((z) & CHUNK_MASK) << 4) | ((x) & CHUNK_MASK))
+
+static int FloodLight_Get(int x, int y, int z) {
+	int i = FloodLight_SectionIndex(x, y, z);
+	uint8_t* section = light_sections[i];
+	return section ? section[FloodLight_BlockIndex(x, y, z)] : light_uniform[i];
+}
+
+static void FloodLight_MarkSection(int cx, int cy, int cz) {
+	int i;
+	if (cx < 0 || cy < 0 || cz < 0 || cx >= light_sectionsX || cy >= light_sectionsY || cz >= light_sectionsZ) return;
+
+	i = (cy * light_sectionsZ + cz) * light_sectionsX + cx;
+	if (light_dirty[i]) return;
+	light_dirty[i] = true;
+	LightQueue_Push(&light_dirtyQueue, i);
+}
+
+/* Marks the chunk containing the block, and any chunk whose faces can be lit by the block, as dirty. */
+static void FloodLight_MarkDirty(int x, int y, int z) {
+	int cx = x >> CHUNK_SHIFT, bX = x & CHUNK_MASK;
+	int cy = y >> CHUNK_SHIFT, bY = y & CHUNK_MASK;
+	int cz = z >> CHUNK_SHIFT, bZ = z & CHUNK_MASK;
+	FloodLight_MarkSection(cx, cy, cz);
+
+	if (bX == 0) FloodLight_MarkSection(cx - 1, cy, cz);
+	if (bY == 0) FloodLight_MarkSection(cx, cy - 1, cz);
+	if (bZ == 0) FloodLight_MarkSection(cx, cy, cz - 1);
+	if (bX == CHUNK_MAX) FloodLight_MarkSection(cx + 1, cy, cz);
+	if (bY == CHUNK_MAX) FloodLight_MarkSection(cx, cy + 1, cz);
+	if (bZ == CHUNK_MAX) FloodLight_MarkSection(cx, cy, cz + 1);
+}
+
+static void FloodLight_Set(int x, int y, int z, int value) {
+	int i = FloodLight_SectionIndex(x, y, z);
+	uint8_t* section = light_sections[i];
+
+	if (!section) {
+		if (light_uniform[i] == value) return;
+		section = Mem_Alloc(LIGHT_SECTION_SIZE, 1, "light section");
+		Mem_Set(section, light_uniform[i], LIGHT_SECTION_SIZE);
+		light_sections[i] = section;
+	}
+
+	section[FloodLight_BlockIndex(x, y, z)] = value;
+	if (light_trackDirty) FloodLight_MarkDirty(x, y, z);
+}
+
+static int FloodLight_Level(int x, int y, int z) {
+	int light = FloodLight_Get(x, y, z);
+	return max(light & LIGHT_MAX, light >> LIGHT_SKY_SHIFT);
+}
+
+static void FloodLight_SpreadTo(int x, int y, int z, int shift, int level) {
+	int light;
+	if (Blocks.BlocksLight[World_GetBlock(x, y, z)]) return;
+
+	light = FloodLight_Get(x, y, z);
+	if (((light >> shift) & LIGHT_MAX) >= level) return;
+
+	FloodLight_Set(x, y, z, (light & ~(LIGHT_MAX << shift)) | (level << shift));
+	LightQueue_Push(&light_add, World_Pack(x, y, z));
+}
+
+/* Spreads light outwards from every block in the add queue, until it fades out or is blocked. */
+static void FloodLight_PropagateAdd(int shift) {
+	int index, x, y, z, level, below;
+
+	while (light_add.Head < light_add.Count) {
+		index = light_add.Entries[light_add.Head++];
+		World_Unpack(index, x, y, z);
+
+		level = (FloodLight_Get(x, y, z) >> shift) & LIGHT_MAX;
+		if (level <= 1) continue;
+		/* Full sky light travels straight down without weakening */
+		below = (shift && level == LIGHT_MAX) ? LIGHT_MAX : level - 1;
+
+		if (x > 0)          FloodLight_SpreadTo(x - 1, y, z, shift, level - 1);
+		if (x < World.MaxX) FloodLight_SpreadTo(x + 1, y, z, shift, level - 1);
+		if (z > 0)          FloodLight_SpreadTo(x, y, z - 1, shift, level - 1);
+		if (z < World.MaxZ) FloodLight_SpreadTo(x, y, z + 1, shift, level - 1);
+		if (y < World.MaxY) FloodLight_SpreadTo(x, y + 1, z, shift, level - 1);
+		if (y > 0)          FloodLight_SpreadTo(x, y - 1, z, shift, below);
+	}
+	light_add.Head = 0; light_add.Count = 0;
+}
+
+static void FloodLight_UnspreadTo(int x, int y, int z, int shift, int level, bool down) {
+	int light = FloodLight_Get(x, y, z);
+	int cur   = (light >> shift) & LIGHT_MAX;
+	if (!cur) return;
+
+	/* Dimmer light (or sky light that came straight down) may have come from the removed light */
+	if (cur < level || (down && shift && level == LIGHT_MAX && cur == LIGHT_MAX)) {
+		FloodLight_Set(x, y, z, light & ~(LIGHT_MAX << shift));
+		LightQueue_Push(&light_remove, World_Pack(x, y, z));
+		LightQueue_Push(&light_remove, cur);
+	} else {
+		/* Brighter light came from elsewhere, so must be spread back into the darkened area */
+		LightQueue_Push(&light_add, World_Pack(x, y, z));
+	}
+}
+
+/* Darkens every block that was lit by the blocks in the remove queue. */
+static void FloodLight_PropagateRemove(int shift) {
+	int index, x, y, z, level;
+
+	while (light_remove.Head < light_remove.Count) {
+		index = light_remove.Entries[light_remove.Head++];
+		level = light_remove.Entries[light_remove.Head++];
+		World_Unpack(index, x, y, z);
+
+		if (x > 0)          FloodLight_UnspreadTo(x - 1, y, z, shift, level, false);
+		if (x < World.MaxX) FloodLight_UnspreadTo(x + 1, y, z, shift, level, false);
+		if (z > 0)          FloodLight_UnspreadTo(x, y, z - 1, shift, level, false);
+		if (z < World.MaxZ) FloodLight_UnspreadTo(x, y, z + 1, shift, level, false);
+		if (y < World.MaxY) FloodLight_UnspreadTo(x, y + 1, z, shift, level, false);
+		if (y > 0)          FloodLight_UnspreadTo(x, y - 1, z, shift, level, true);
+	}
+	light_remove.Head = 0; light_remove.Count = 0;
+}
+
+static void FloodLight_Relight(int x, int y, int z, BlockID block, int shift) {
+	int light = FloodLight_Get(x, y, z);
+	int level = (light >> shift) & LIGHT_MAX;
+
+	if (level) {
+		FloodLight_Set(x, y, z, light & ~(LIGHT_MAX << shift));
+		LightQueue_Push(&light_remove, World_Pack(x, y, z));
+		LightQueue_Push(&light_remove, level);
+		FloodLight_PropagateRemove(shift);
+	}
+
+	light = FloodLight_Get(x, y, z);
+	if (!shift && Blocks.FullBright[block]) {
+		FloodLight_Set(x, y, z, light | LIGHT_MAX);
+		LightQueue_Push(&light_add, World_Pack(x, y, z));
+	} else if (shift && y == World.MaxY && !Blocks.BlocksLight[block]) {
+		FloodLight_Set(x, y, z, light | LIGHT_SKY_LIT);
+		LightQueue_Push(&light_add, World_Pack(x, y, z));
+	}
+
+	/* Let light from surrounding blocks flow back in */
+	if (x > 0)          LightQueue_Push(&light_add, World_Pack(x - 1, y, z));
+	if (x < World.MaxX) LightQueue_Push(&light_add, World_Pack(x + 1, y, z));
+	if (z > 0)          LightQueue_Push(&light_add, World_Pack(x, y, z - 1));
+	if (z < World.MaxZ) LightQueue_Push(&light_add, World_Pack(x, y, z + 1));
+	if (y > 0)          LightQueue_Push(&light_add, World_Pack(x, y - 1, z));
+	if (y < World.MaxY) LightQueue_Push(&light_add, World_Pack(x, y + 1, z));
+	FloodLight_PropagateAdd(shift);
+}
+
+static void FloodLight_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock) {
+	int i, index, cx, cy, cz;
+	if (!light_sections) return;
+	if (Blocks.BlocksLight[oldBlock] == Blocks.BlocksLight[newBlock] 
+		&& Blocks.FullBright[oldBlock] == Blocks.FullBright[newBlock]) return;
+
+	light_trackDirty = true;
+	FloodLight_Relight(x, y, z, newBlock, 0);
+	FloodLight_Relight(x, y, z, newBlock, LIGHT_SKY_SHIFT);
+	light_trackDirty = false;
+
+	/* Only rebuild the chunks where light actually changed */
+	for (i = 0; i < light_dirtyQueue.Count; i++) {
+		index = light_dirtyQueue.Entries[i];
+		light_dirty[index] = false;
+
+		cx = index % light_sectionsX;
+		cz = (index / light_sectionsX) % light_sectionsZ;
+		cy = (index / light_sectionsX) / light_sectionsZ;
+		MapRenderer_RefreshChunk(cx, cy, cz);
+	}
+	light_dirtyQueue.Count = 0;
+}
+
+static void FloodLight_Free(void) {
+	int i, count = light_sectionsX * light_sectionsY * light_sectionsZ;
+	if (light_sections) {
+		for (i = 0; i < count; i++) { Mem_Free(light_sections[i]); }
+	}
+
+	Mem_Free(light_sections); light_sections = NULL;
+	Mem_Free(light_uniform);  light_uniform  = NULL;
+	Mem_Free(light_dirty);    light_dirty    = NULL;
+	LightQueue_Free(&light_add);
+	LightQueue_Free(&light_remove);
+	LightQueue_Free(&light_dirtyQueue);
+}
+
+/* Seeds sky light above the highest light blocking block in each column, */
+/* and block light from every light emitting block, then floods both throughout the world. */
+static void FloodLight_Calc(void) {
+	int x, y, z, cx, cy, cz, i, k, h, maxH, litY, count;
+	int16_t* heights;
+	BlockID block;
+
+	FloodLight_Free();
+	light_sectionsX = (World.Width  + CHUNK_MAX) >> CHUNK_SHIFT;
+	light_sectionsY = (World.Height + CHUNK_MAX) >> CHUNK_SHIFT;
+	light_sectionsZ = (World.Length + CHUNK_MAX) >> CHUNK_SHIFT;
+	count = light_sectionsX * light_sectionsY * light_sectionsZ;
+
+	light_sections = Mem_AllocCleared(count, sizeof(uint8_t*), "light sections");
+	light_uniform  = Mem_AllocCleared(count, 1, "light uniform");
+	light_dirty    = Mem_AllocCleared(count, 1, "light dirty");
+	heights        = Mem_Alloc(World.Width * World.Length, 2, "light heights");
+	for (i = 0; i < World.Width * World.Length; i++) { heights[i] = -1; }
+
+	/* Find light emitting blocks and the height of each column, in memory order */
+	for (y = World.MaxY; y >= 0; y--) {
+		for (z = 0, i = 0; z < World.Length; z++) {
+			for (x = 0; x < World.Width; x++, i++) {
+				block = World_GetBlock(x, y, z);
+
+				if (heights[i] == -1 && Blocks.BlocksLight[block]) heights[i] = y;
+				if (!Blocks.FullBright[block]) continue;
+
+				FloodLight_Set(x, y, z, LIGHT_MAX);
+				LightQueue_Push(&light_add, World_Pack(x, y, z));
+			}
+		}
+	}
+	FloodLight_PropagateAdd(0);
+
+	for (cz = 0; cz < light_sectionsZ; cz++) {
+		for (cx = 0; cx < light_sectionsX; cx++) {
+			maxH = -1;
+			for (z = cz << CHUNK_SHIFT; z < min(World.Length, (cz + 1) << CHUNK_SHIFT); z++) {
+				for (x = cx << CHUNK_SHIFT; x < min(World.Width, (cx + 1) << CHUNK_SHIFT); x++) {
+					maxH = max(maxH, heights[Lighting_Pack(x, z)]);
+				}
+			}
+
+			/* Sections entirely above all the columns are fully lit, so don't need storage */
+			litY = (maxH + CHUNK_SIZE) & ~CHUNK_MASK;
+			for (cy = litY >> CHUNK_SHIFT; cy < light_sectionsY; cy++) {
+				i = (cy * light_sectionsZ + cz) * light_sectionsX + cx;
+				if (!light_sections[i]) { light_uniform[i] = LIGHT_SKY_LIT; continue; }
+
+				/* Section already has block light from a nearby light emitting block */
+				for (k = 0; k < LIGHT_SECTION_SIZE; k++) { light_sections[i][k] |= LIGHT_SKY_LIT; }
+			}
+
+			for (z = cz << CHUNK_SHIFT; z < min(World.Length, (cz + 1) << CHUNK_SHIFT); z++) {
+				for (x = cx << CHUNK_SHIFT; x < min(World.Width, (cx + 1) << CHUNK_SHIFT); x++) {
+					h = heights[Lighting_Pack(x, z)];
+					for (y = h + 1; y < min(World.Height, litY); y++) {
+						FloodLight_Set(x, y, z, FloodLight_Get(x, y, z) | LIGHT_SKY_LIT);
+					}
+				}
+			}
+		}
+	}
+
+	/* Sky light only needs to spread sideways from where a neighbouring column is taller */
+	for (z = 0; z < World.Length; z++) {
+		for (x = 0; x < World.Width; x++) {
+			h = heights[Lighting_Pack(x, z)]; maxH = h;
+			if (x > 0)          maxH = max(maxH, heights[Lighting_Pack(x - 1, z)]);
+			if (x < World.MaxX) maxH = max(maxH, heights[Lighting_Pack(x + 1, z)]);
+			if (z > 0)          maxH = max(maxH, heights[Lighting_Pack(x, z - 1)]);
+			if (z < World.MaxZ) maxH = max(maxH, heights[Lighting_Pack(x, z + 1)]);
+
+			for (y = h + 1; y <= min(maxH, World.MaxY); y++) {
+				LightQueue_Push(&light_add, World_Pack(x, y, z));
+			}
+		}
+	}
+	FloodLight_PropagateAdd(LIGHT_SKY_SHIFT);
+	Mem_Free(heights);
+}
+
+void Lighting_ReadLevels(int x1, int y1, int z1, uint8_t* levels) {
+	int x, y, z;
+
+	for (y = y1; y < y1 + EXTCHUNK_SIZE; y++) {
+		for (z = z1; z < z1 + EXTCHUNK_SIZE; z++) {
+			for (x = x1; x < x1 + EXTCHUNK_SIZE; x++) {
+				if (World_Contains(x, y, z)) {
+					*levels++ = FloodLight_Get(x, y, z);
+				} else {
+					/* Outside the map is always in sunlight, except underneath it */
+					*levels++ = y < 0 ? 0 : LIGHT_SKY_LIT;
+				}
+			}
+		}
+	}
+}
+
+PackedCol Lighting_LevelCol(PackedCol shadow, PackedCol sun, int level) {
+	return PackedCol_Lerp(shadow, sun, light_factors[level]);
+}
+
+
 /*########################################################################################################################*
 *---------------------------------------------------Lighting component----------------------------------------------------*
 *#########################################################################################################################*/
+static void Lighting_Init(void) {
+	Lighting_Flood = Options_GetBool(OPT_FLOOD_LIGHTING, false);
+}
+
 static void Lighting_Reset(void) {
 	Mem_Free(Lighting_Heightmap);
 	Lighting_Heightmap = NULL;
+	FloodLight_Free();
 }
 
 static void Lighting_OnNewMapLoaded(void) {
 	Lighting_Heightmap = Mem_Alloc(World.Width * World.Length, 2, "lighting heightmap");
-	Lighting_Refresh();
+	Lighting_CalcHeightmap();
+	if (Lighting_Flood) FloodLight_Calc();
 }
 
 struct IGameComponent Lighting_Component = {
-	NULL,           /* Init  */
+	Lighting_Init,  /* Init  */
 	Lighting_Reset, /* Free  */
 	Lighting_Reset, /* Reset */
 	Lighting_Reset, /* OnNewMap */
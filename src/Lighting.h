@@ -3,6 +3,7 @@
 #include "PackedCol.h"
 /* Manages lighting of blocks in the world.
 BasicLighting: Uses a simple heightmap, where each block is either in sun or shadow.
+FloodLighting: Spreads 4 bit block light and sky light outwards from light sources, level by level.
    Copyright 2014-2017 ClassicalSharp | Licensed under BSD-3
 */
 struct IGameComponent;
@@ -10,6 +11,9 @@ extern struct IGameComponent Lighting_Component;
 
 #define Lighting_Pack(x, z) ((x) + World.Width * (z))
 extern int16_t* Lighting_Heightmap;
+/* Whether chunk meshes and entities are lit using flood fill light levels instead of the heightmap. */
+/* NOTE: The heightmap is still maintained, because Lighting_IsLit always uses it. */
+extern bool Lighting_Flood;
 
 /* Equivalent to (but far more optimised form of)
 * for x = startX; x < startX + 18; x++
@@ -20,6 +24,11 @@ void Lighting_LightHint(int startX, int startZ);
 /* Called when a block is changed, to update the lighting information. */
 /* NOTE: Implementations ***MUST*** mark all chunks affected by this lighting changeas needing to be refreshed. */
 void Lighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+/* Called after several blocks in a column were changed at once, to update the lighting information. */
+/* maxY is the highest Y coordinate of the changed blocks in the column. */
+/* NOTE: Only marks chunks affected by the change in shadows, not the chunks the blocks are in. */
+/* NOTE: Does nothing when Lighting_Flood, call Lighting_OnBlockChanged for each block instead. */
+void Lighting_OnColumnChanged(int x, int z, int maxY);
 void Lighting_Refresh(void);
 
 /* Returns whether the block at the given coordinates is fully in sunlight. */
@@ -32,6 +41,13 @@ PackedCol Lighting_Col(int x, int y, int z);
 /* NOTE: Does ***NOT*** check that the coordinates are inside the map. */
 PackedCol Lighting_Col_XSide(int x, int y, int z);
 
+/* Copies the packed light levels of the 18x18x18 blocks starting at the given coordinates. */
+/* Each level has block light in the low 4 bits, and sky light in the high 4 bits. */
+/* NOTE: Only valid when Lighting_Flood is true. */
+void Lighting_ReadLevels(int x1, int y1, int z1, uint8_t* levels);
+/* Returns the colour of a face with the given light level (0 to 15), between shadow and sun colour. */
+PackedCol Lighting_LevelCol(PackedCol shadow, PackedCol sun, int level);
+
 PackedCol Lighting_Col_Sprite_Fast(int x, int y, int z);
 PackedCol Lighting_Col_YMax_Fast(int x, int y, int z);
 PackedCol Lighting_Col_YMin_Fast(int x, int y, int z);
@@ -161,6 +161,7 @@ static const char* Logger_GetCCErrorDesc(ReturnCode res) {
 	case NBT_ERR_UNKNOWN:   return "Unknown NBT tag type";
 	case CW_ERR_ROOT_TAG:   return "Invalid root NBT tag";
 	case CW_ERR_STRING_LEN: return "NBT string too long";
+	case ERR_OUT_OF_MEMORY: return "Out of memory";
 	}
 	return NULL;
 }
@@ -44,6 +44,12 @@ static struct ChunkInfo** renderChunks;
 static int renderChunksCount;
 /* Distance of each chunk from the camera. */
 static uint32_t* distances;
+/* Chunks still to be visited by the occlusion culling walk, stored as (index << 3) | face entered from. */
+static uint32_t* occlusionQueue;
+/* Directions travelled in to reach each chunk in the occlusion culling walk, 0 if not reached. */
+static uint8_t* occlusionDirs;
+/* Whether the occlusion culling walk needs to be performed again. (e.g. chunks were built) */
+static bool occlusionDirty;
 
 /* Buffer for all chunk parts. There are (MapRenderer_ChunksCount * Atlas1D_Count) * 2 parts in the buffer,
  with parts for 'normal' buffer being in lower half. */
@@ -61,6 +67,8 @@ void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 
 	chunk->Visible = true;        chunk->Empty = false;
 	chunk->PendingDelete = false; chunk->AllAir = false;
+	chunk->Building = false;      chunk->Occluded = false;
+	chunk->OcclusionFlags = OCCLUSION_ALL;
 	chunk->DrawXMin = false; chunk->DrawXMax = false; chunk->DrawZMin = false;
 	chunk->DrawZMax = false; chunk->DrawYMin = false; chunk->DrawYMax = false;
 
@@ -99,17 +107,67 @@ static void MapRenderer_CheckWeather(double delta) {
 	Gfx_SetAlphaBlending(false);
 }
 
+#ifdef CC_BUILD_COMPACTCHUNKS
+#define MAPRENDERER_VERTEX_FORMAT VERTEX_FORMAT_P3ST2SC4B
+#define MapRenderer_DrawVb Gfx_DrawIndexedVb_TrisT2sC4b
+
+static struct Matrix meshView;
+
+/* Compact positions and texture coords must be scaled back down, see COMPACT_POS_SCALE etc */
+static void MapRenderer_BeginMeshes(void) {
+	struct Matrix tex = Matrix_Identity;
+	float scale = 1.0f / COMPACT_POS_SCALE;
+	tex.Row0.X = 1.0f / COMPACT_U_SCALE;
+	tex.Row1.Y = 1.0f / COMPACT_V_SCALE;
+	tex.Row3.Y = 0.5f;
+	Gfx_LoadMatrix(MATRIX_TEXTURE, &tex);
+
+	meshView = Gfx.View;
+	/* inlined scale matrix multiply */
+	meshView.Row0.X *= scale; meshView.Row0.Y *= scale; meshView.Row0.Z *= scale; meshView.Row0.W *= scale;
+	meshView.Row1.X *= scale; meshView.Row1.Y *= scale; meshView.Row1.Z *= scale; meshView.Row1.W *= scale;
+	meshView.Row2.X *= scale; meshView.Row2.Y *= scale; meshView.Row2.Z *= scale; meshView.Row2.W *= scale;
+}
+
+static void MapRenderer_EndMeshes(void) {
+	Gfx_LoadIdentityMatrix(MATRIX_TEXTURE);
+	Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
+}
+
+/* Compact positions are relative to the chunk, so must also be translated by chunk's minimum corner. */
+static void MapRenderer_BindMesh(struct ChunkInfo* info) {
+	struct Matrix* view = &Gfx.View;
+	struct Matrix m = meshView;
+	float x = (float)(info->CentreX - 8), y = (float)(info->CentreY - 8), z = (float)(info->CentreZ - 8);
+
+	/* inlined translation matrix multiply */
+	m.Row3.X += x * view->Row0.X + y * view->Row1.X + z * view->Row2.X;
+	m.Row3.Y += x * view->Row0.Y + y * view->Row1.Y + z * view->Row2.Y;
+	m.Row3.Z += x * view->Row0.Z + y * view->Row1.Z + z * view->Row2.Z;
+	m.Row3.W += x * view->Row0.W + y * view->Row1.W + z * view->Row2.W;
+
+	Gfx_LoadMatrix(MATRIX_VIEW, &m);
+	Gfx_BindVb(info->Vb);
+}
+#else
+#define MAPRENDERER_VERTEX_FORMAT VERTEX_FORMAT_P3FT2FC4B
+#define MapRenderer_DrawVb Gfx_DrawIndexedVb_TrisT2fC4b
+static void MapRenderer_BeginMeshes(void) { }
+static void MapRenderer_EndMeshes(void) { }
+#define MapRenderer_BindMesh(info) Gfx_BindVb((info)->Vb)
+#endif
+
 #define MapRenderer_DrawNormalFaces(minFace, maxFace) \
 if (drawMin && drawMax) { \
 	Gfx_SetFaceCulling(true); \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[minFace] + part.Counts[maxFace], offset); \
+	MapRenderer_DrawVb(part.Counts[minFace] + part.Counts[maxFace], offset); \
 	Gfx_SetFaceCulling(false); \
 	Game_Vertices += (part.Counts[minFace] + part.Counts[maxFace]); \
 } else if (drawMin) { \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[minFace], offset); \
+	MapRenderer_DrawVb(part.Counts[minFace], offset); \
 	Game_Vertices += part.Counts[minFace]; \
 } else if (drawMax) { \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[maxFace], offset + part.Counts[minFace]); \
+	MapRenderer_DrawVb(part.Counts[maxFace], offset + part.Counts[minFace]); \
 	Game_Vertices += part.Counts[maxFace]; \
 }
 
@@ -129,7 +187,7 @@ static void MapRenderer_RenderNormalBatch(int batch) {
 		hasNormParts[batch] = true;
 
 #ifndef CC_BUILD_GL11
-		Gfx_BindVb(info->Vb);
+		MapRenderer_BindMesh(info);
 #else
 		Gfx_BindVb(part.Vb);
 #endif
@@ -155,19 +213,19 @@ static void MapRenderer_RenderNormalBatch(int batch) {
 
 		Gfx_SetFaceCulling(true);
 		if (info->DrawXMax || info->DrawZMin) {
-			Gfx_DrawIndexedVb_TrisT2fC4b(count, offset); Game_Vertices += count;
+			MapRenderer_DrawVb(count, offset); Game_Vertices += count;
 		} offset += count;
 
 		if (info->DrawXMin || info->DrawZMax) {
-			Gfx_DrawIndexedVb_TrisT2fC4b(count, offset); Game_Vertices += count;
+			MapRenderer_DrawVb(count, offset); Game_Vertices += count;
 		} offset += count;
 
 		if (info->DrawXMin || info->DrawZMin) {
-			Gfx_DrawIndexedVb_TrisT2fC4b(count, offset); Game_Vertices += count;
+			MapRenderer_DrawVb(count, offset); Game_Vertices += count;
 		} offset += count;
 
 		if (info->DrawXMax || info->DrawZMax) {
-			Gfx_DrawIndexedVb_TrisT2fC4b(count, offset); Game_Vertices += count;
+			MapRenderer_DrawVb(count, offset); Game_Vertices += count;
 		}
 		Gfx_SetFaceCulling(false);
 	}
@@ -177,9 +235,10 @@ void MapRenderer_RenderNormal(double delta) {
 	int batch;
 	if (!mapChunks) return;
 
-	Gfx_SetVertexFormat(VERTEX_FORMAT_P3FT2FC4B);
+	Gfx_SetVertexFormat(MAPRENDERER_VERTEX_FORMAT);
 	Gfx_SetTexturing(true);
 	Gfx_SetAlphaTest(true);
+	MapRenderer_BeginMeshes();
 	
 	Gfx_EnableMipmaps();
 	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) {
@@ -191,24 +250,22 @@ void MapRenderer_RenderNormal(double delta) {
 		}
 	}
 	Gfx_DisableMipmaps();
+	MapRenderer_EndMeshes();
 
 	MapRenderer_CheckWeather(delta);
 	Gfx_SetAlphaTest(false);
 	Gfx_SetTexturing(false);
-#if DEBUG_OCCLUSION
-	DebugPickedPos();
-#endif
 }
 
 #define MapRenderer_DrawTranslucentFaces(minFace, maxFace) \
 if (drawMin && drawMax) { \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[minFace] + part.Counts[maxFace], offset); \
+	MapRenderer_DrawVb(part.Counts[minFace] + part.Counts[maxFace], offset); \
 	Game_Vertices += (part.Counts[minFace] + part.Counts[maxFace]); \
 } else if (drawMin) { \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[minFace], offset); \
+	MapRenderer_DrawVb(part.Counts[minFace], offset); \
 	Game_Vertices += part.Counts[minFace]; \
 } else if (drawMax) { \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[maxFace], offset + part.Counts[minFace]); \
+	MapRenderer_DrawVb(part.Counts[maxFace], offset + part.Counts[minFace]); \
 	Game_Vertices += part.Counts[maxFace]; \
 }
 
@@ -228,7 +285,7 @@ static void MapRenderer_RenderTranslucentBatch(int batch) {
 		hasTranParts[batch] = true;
 
 #ifndef CC_BUILD_GL11
-		Gfx_BindVb(info->Vb);
+		MapRenderer_BindMesh(info);
 #else
 		Gfx_BindVb(part.Vb);
 #endif
@@ -256,10 +313,11 @@ void MapRenderer_RenderTranslucent(double delta) {
 
 	/* First fill depth buffer */
 	vertices = Game_Vertices;
-	Gfx_SetVertexFormat(VERTEX_FORMAT_P3FT2FC4B);
+	Gfx_SetVertexFormat(MAPRENDERER_VERTEX_FORMAT);
 	Gfx_SetTexturing(false);
 	Gfx_SetAlphaBlending(false);
 	Gfx_SetColWriteMask(false, false, false, false);
+	MapRenderer_BeginMeshes();
 
 	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) {
 		if (tranPartsCount[batch] <= 0) continue;
@@ -284,6 +342,7 @@ void MapRenderer_RenderTranslucent(double delta) {
 		MapRenderer_RenderTranslucentBatch(batch);
 	}
 	Gfx_DisableMipmaps();
+	MapRenderer_EndMeshes();
 
 	Gfx_SetDepthWrite(true);
 	/* If we weren't under water, render weather after to blend properly */
@@ -312,11 +371,15 @@ static void MapRenderer_FreeChunks(void) {
 	Mem_Free(sortedChunks);
 	Mem_Free(renderChunks);
 	Mem_Free(distances);
+	Mem_Free(occlusionQueue);
+	Mem_Free(occlusionDirs);
 
 	mapChunks    = NULL;
 	sortedChunks = NULL;
 	renderChunks = NULL;
 	distances    = NULL;
+	occlusionQueue = NULL;
+	occlusionDirs  = NULL;
 }
 
 static void MapRenderer_AllocateParts(void) {
@@ -331,6 +394,8 @@ static void MapRenderer_AllocateChunks(void) {
 	sortedChunks = Mem_Alloc(MapRenderer_ChunksCount, sizeof(struct ChunkInfo*), "sorted chunk info");
 	renderChunks = Mem_Alloc(MapRenderer_ChunksCount, sizeof(struct ChunkInfo*), "render chunk info");
 	distances    = Mem_Alloc(MapRenderer_ChunksCount, 4, "chunk distances");
+	occlusionQueue = Mem_Alloc(MapRenderer_ChunksCount, 4, "occlusion queue");
+	occlusionDirs  = Mem_Alloc(MapRenderer_ChunksCount, 1, "occlusion dirs");
 }
 
 static void MapRenderer_ResetPartFlags(void) {
@@ -381,6 +446,7 @@ static void MapRenderer_ResetChunks(void) {
 static void MapRenderer_DeleteChunks(void) {
 	int i;
 	if (!mapChunks) return;
+	Builder_CancelChunks();
 
 	for (i = 0; i < MapRenderer_ChunksCount; i++) {
 		MapRenderer_DeleteChunk(&mapChunks[i]);
@@ -392,7 +458,7 @@ void MapRenderer_Refresh(void) {
 	int oldCount;
 	chunkPos = Vector3I_MaxValue();
 
-	if (mapChunks && World.Blocks) {
+	if (mapChunks && World.Loaded) {
 		MapRenderer_DeleteChunks();
 		MapRenderer_ResetChunks();
 
@@ -412,7 +478,7 @@ void MapRenderer_RefreshBorders(int maxHeight) {
 	bool onBorder;
 
 	chunkPos = Vector3I_MaxValue();
-	if (!mapChunks || !World.Blocks) return;
+	if (!mapChunks || !World.Loaded) return;
 
 	for (cz = 0; cz < MapRenderer_ChunksZ; cz++) {
 		for (cy = 0; cy < MapRenderer_ChunksY; cy++) {
@@ -442,6 +508,72 @@ static int MapRenderer_AdjustViewDist(int dist) {
 	return (dist + 24) * (dist + 24);
 }
 
+#define OCCLUSION_NO_FACE 7
+static const int8_t occlusion_dx[FACE_COUNT] = { -1, +1,  0,  0,  0,  0 };
+static const int8_t occlusion_dy[FACE_COUNT] = {  0,  0,  0,  0, -1, +1 };
+static const int8_t occlusion_dz[FACE_COUNT] = {  0,  0, -1, +1,  0,  0 };
+
+/* Walks outwards from the chunk the camera is in, only moving into a neighbouring chunk */
+/* if it could be seen through the faces of the current chunk. Chunks not reached are occluded. */
+static void MapRenderer_CalcOcclusion(void) {
+	int viewDistSqr = MapRenderer_AdjustViewDist(Game_ViewDistance);
+	struct ChunkInfo* info;
+	struct ChunkInfo* other;
+	Vector3I pos;
+	int head = 0, tail = 0;
+	int i, index, face, from, dx, dy, dz;
+	int cx, cy, cz, nx, ny, nz;
+	uint8_t dirs;
+
+	occlusionDirty = false;
+	/* Visibility of every chunk needs to be recalculated */
+	lastCamPos = Vector3_BigPos();
+
+	/* Chunks can be seen through any side of the map when outside it */
+	Vector3I_Floor(&pos, &Camera.CurrentPos);
+	if (!World_Contains(pos.X, pos.Y, pos.Z)) {
+		for (i = 0; i < MapRenderer_ChunksCount; i++) { mapChunks[i].Occluded = false; }
+		return;
+	}
+
+	for (i = 0; i < MapRenderer_ChunksCount; i++) { mapChunks[i].Occluded = true; }
+	Mem_Set(occlusionDirs, 0, MapRenderer_ChunksCount);
+
+	index = MapRenderer_Pack(pos.X >> CHUNK_SHIFT, pos.Y >> CHUNK_SHIFT, pos.Z >> CHUNK_SHIFT);
+	occlusionDirs[index]     = 0x80;
+	occlusionQueue[tail++] = (index << 3) | OCCLUSION_NO_FACE;
+
+	while (head < tail) {
+		index = occlusionQueue[head] >> 3;
+		from  = occlusionQueue[head] & 7; head++;
+
+		info = &mapChunks[index];
+		info->Occluded = false;
+		dirs = occlusionDirs[index];
+		cx = info->CentreX >> CHUNK_SHIFT; cy = info->CentreY >> CHUNK_SHIFT; cz = info->CentreZ >> CHUNK_SHIFT;
+
+		for (face = 0; face < FACE_COUNT; face++) {
+			/* Never move back towards the camera */
+			if (dirs & (1 << (face ^ 1))) continue;
+			if (from != OCCLUSION_NO_FACE && !(info->OcclusionFlags & Occlusion_Bit(min(from, face), max(from, face)))) continue;
+
+			nx = cx + occlusion_dx[face]; ny = cy + occlusion_dy[face]; nz = cz + occlusion_dz[face];
+			if (nx < 0 || ny < 0 || nz < 0 || nx >= MapRenderer_ChunksX 
+				|| ny >= MapRenderer_ChunksY || nz >= MapRenderer_ChunksZ) continue;
+
+			i = MapRenderer_Pack(nx, ny, nz);
+			if (occlusionDirs[i]) continue;
+			other = &mapChunks[i];
+
+			dx = other->CentreX - pos.X; dy = other->CentreY - pos.Y; dz = other->CentreZ - pos.Z;
+			if (dx * dx + dy * dy + dz * dz > viewDistSqr) continue;
+
+			occlusionDirs[i] = 0x80 | dirs | (1 << face);
+			occlusionQueue[tail++] = (i << 3) | (face ^ 1);
+		}
+	}
+}
+
 static int MapRenderer_UpdateChunksAndVisibility(int* chunkUpdates) {
 	int viewDistSqr = MapRenderer_AdjustViewDist(Game_ViewDistance);
 	int userDistSqr = MapRenderer_AdjustViewDist(Game_UserViewDistance);
@@ -463,12 +595,11 @@ static int MapRenderer_UpdateChunksAndVisibility(int* chunkUpdates) {
 		}
 		noData |= info->PendingDelete;
 
-		if (noData && distSqr <= viewDistSqr && *chunkUpdates < chunksTarget) {
-			MapRenderer_DeleteChunk(info);
+		if (noData && !info->Building && distSqr <= viewDistSqr && *chunkUpdates < chunksTarget) {
 			MapRenderer_BuildChunk(info, chunkUpdates);
 		}
 
-		info->Visible = distSqr <= viewDistSqr &&
+		info->Visible = !info->Occluded && distSqr <= viewDistSqr &&
 			FrustumCulling_SphereInFrustum(info->CentreX, info->CentreY, info->CentreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
 		if (info->Visible && !info->Empty) { renderChunks[j] = info; j++; }
 	}
@@ -496,12 +627,11 @@ static int MapRenderer_UpdateChunksStill(int* chunkUpdates) {
 		}
 		noData |= info->PendingDelete;
 
-		if (noData && distSqr <= userDistSqr && *chunkUpdates < chunksTarget) {
-			MapRenderer_DeleteChunk(info);
+		if (noData && !info->Building && distSqr <= userDistSqr && *chunkUpdates < chunksTarget) {
 			MapRenderer_BuildChunk(info, chunkUpdates);
 
 			/* only need to update the visibility of chunks in range. */
-			info->Visible = distSqr <= viewDistSqr &&
+			info->Visible = !info->Occluded && distSqr <= viewDistSqr &&
 				FrustumCulling_SphereInFrustum(info->CentreX, info->CentreY, info->CentreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
 			if (info->Visible && !info->Empty) { renderChunks[j] = info; j++; }
 		} else if (info->Visible) {
@@ -511,15 +641,51 @@ static int MapRenderer_UpdateChunksStill(int* chunkUpdates) {
 	return j;
 }
 
+/* Creates the vertex buffers for chunks whose meshes have finished being built. */
+static int MapRenderer_FinishChunks(void) {
+	struct ChunkInfo* info;
+	struct ChunkPartInfo* ptr;
+	int i, count = 0;
+
+	while ((info = Builder_FinishChunk())) {
+		Game.ChunkUpdates++;
+		count++;
+
+		if (!info->NormalParts && !info->TranslucentParts) {
+			info->Empty = true; continue;
+		}
+	
+		if (info->NormalParts) {
+			ptr = info->NormalParts;
+			for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += MapRenderer_ChunksCount) {
+				if (ptr->Offset >= 0) normPartsCount[i]++;
+			}
+		}
+
+		if (info->TranslucentParts) {
+			ptr = info->TranslucentParts;
+			for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += MapRenderer_ChunksCount) {
+				if (ptr->Offset >= 0) tranPartsCount[i]++;
+			}
+		}
+	}
+	return count;
+}
+
 static void MapRenderer_UpdateChunks(double delta) {
 	struct LocalPlayer* p;
 	bool samePos;
-	int chunkUpdates = 0;
+	int chunkUpdates = 0, finished;
 
 	/* Build more chunks if 30 FPS or over, otherwise slowdown */
 	chunksTarget += delta < CHUNK_TARGET_TIME ? 1 : -1; 
 	Math_Clamp(chunksTarget, 4, MapRenderer_MaxUpdates);
 
+	/* Newly built chunks may change what can be seen through them */
+	finished = MapRenderer_FinishChunks();
+	if (finished) occlusionDirty = true;
+	if (occlusionDirty) MapRenderer_CalcOcclusion();
+
 	p = &LocalPlayer_Instance;
 	samePos = Vector3_Equals(&Camera.CurrentPos, &lastCamPos)
 		&& p->Base.HeadX == lastHeadX && p->Base.HeadY == lastHeadY;
@@ -532,7 +698,7 @@ static void MapRenderer_UpdateChunks(double delta) {
 	lastHeadX  = p->Base.HeadX; 
 	lastHeadY  = p->Base.HeadY;
 
-	if (!samePos || chunkUpdates) {
+	if (!samePos || chunkUpdates || finished) {
 		MapRenderer_ResetPartFlags();
 	}
 }
@@ -595,7 +761,7 @@ static void MapRenderer_UpdateSortOrder(void) {
 
 	MapRenderer_QuickSort(0, MapRenderer_ChunksCount - 1);
 	MapRenderer_ResetPartFlags();
-	/*SimpleOcclusionCulling();*/
+	MapRenderer_CalcOcclusion();
 }
 
 void MapRenderer_Update(double deltaTime) {
@@ -624,10 +790,8 @@ void MapRenderer_DeleteChunk(struct ChunkInfo* info) {
 	int i;
 
 	info->Empty = false; info->AllAir = false;
-#ifdef OCCLUSION
-	info.OcclusionFlags = 0;
-	info.OccludedFlags = 0;
-#endif
+	/* Can't know what is visible through the chunk until it is built again */
+	info->OcclusionFlags = OCCLUSION_ALL;
 #ifndef CC_BUILD_GL11
 	Gfx_DeleteVb(&info->Vb);
 #endif
@@ -658,31 +822,13 @@ void MapRenderer_DeleteChunk(struct ChunkInfo* info) {
 }
 
 void MapRenderer_BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
-	struct ChunkPartInfo* ptr;
-	int i;
+	if (!Builder_StartChunk(info)) {
+		/* Too many chunks are already being built, so try again next frame */
+		*chunkUpdates = chunksTarget; return;
+	}
 
-	Game.ChunkUpdates++;
 	(*chunkUpdates)++;
 	info->PendingDelete = false;
-	Builder_MakeChunk(info);
-
-	if (!info->NormalParts && !info->TranslucentParts) {
-		info->Empty = true; return;
-	}
-	
-	if (info->NormalParts) {
-		ptr = info->NormalParts;
-		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += MapRenderer_ChunksCount) {
-			if (ptr->Offset >= 0) normPartsCount[i]++;
-		}
-	}
-
-	if (info->TranslucentParts) {
-		ptr = info->TranslucentParts;
-		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += MapRenderer_ChunksCount) {
-			if (ptr->Offset >= 0) tranPartsCount[i]++;
-		}
-	}
 }
 
 static void MapRenderer_EnvVariableChanged(void* obj, int envVar) {
@@ -715,7 +861,7 @@ static void MapRenderer_BlockDefinitionChanged(void* obj) {
 	MapRenderer_ResetPartFlags();
 }
 
-static void MapRenderer_RecalcVisibility_(void* obj) { lastCamPos = Vector3_BigPos(); }
+static void MapRenderer_RecalcVisibility_(void* obj) { lastCamPos = Vector3_BigPos(); occlusionDirty = true; }
 static void MapRenderer_DeleteChunks_(void* obj)     { MapRenderer_DeleteChunks(); }
 static void MapRenderer_Refresh_(void* obj)          { MapRenderer_Refresh(); }
 
@@ -780,6 +926,7 @@ static void MapRenderer_Free(void) {
 	Event_UnregisterVoid(&GfxEvents.ContextRecreated,    NULL, MapRenderer_Refresh_);
 
 	MapRenderer_OnNewMap();
+	Builder_Free();
 }
 
 struct IGameComponent MapRenderer_Component = {
@@ -36,6 +36,11 @@ struct ChunkPartInfo {
 	uint16_t Counts[FACE_COUNT]; /* Counts per face */
 };
 
+/* Bit in ChunkInfo.OcclusionFlags for whether faces a and b (where a < b) can see each other. */
+#define Occlusion_Bit(a, b) (1 << ((a) * (11 - (a)) / 2 + (b) - (a) - 1))
+/* All 15 pairs of faces can see each other. */
+#define OCCLUSION_ALL 0x7FFF
+
 /* Describes data necessary for rendering a chunk. */
 struct ChunkInfo {	
 	uint16_t CentreX, CentreY, CentreZ; /* Centre coordinates of the chunk */
@@ -44,6 +49,8 @@ struct ChunkInfo {
 	uint8_t Empty : 1;         /* Whether the chunk is empty of data */
 	uint8_t PendingDelete : 1; /* Whether chunk is pending deletion */
 	uint8_t AllAir : 1;        /* Whether chunk is completely air */
+	uint8_t Building : 1;      /* Whether chunk's mesh is currently being built */
+	uint8_t Occluded : 1;      /* Whether chunk is hidden behind other chunks */
 	uint8_t : 0;               /* pad to next byte*/
 
 	uint8_t DrawXMin : 1;
@@ -53,10 +60,7 @@ struct ChunkInfo {
 	uint8_t DrawYMin : 1;
 	uint8_t DrawYMax : 1;
 	uint8_t : 0;          /* pad to next byte */
-#ifdef OCCLUSION
-	public bool Visited = false, Occluded = false;
-	public byte OcclusionFlags, OccludedFlags, DistanceFlags;
-#endif
+	uint16_t OcclusionFlags;   /* Pairs of faces that can see each other through the chunk */
 #ifndef CC_BUILD_GL11
 	GfxResourceID Vb;
 #endif
@@ -83,7 +87,8 @@ void MapRenderer_RefreshChunk(int cx, int cy, int cz);
 /* Deletes the vertex buffer associated with the given chunk. */
 /* NOTE: This method also adjusts internal state, so do not bypass this. */
 void MapRenderer_DeleteChunk(struct ChunkInfo* info);
-/* Builds the mesh (and hence vertex buffer) for the given chunk. */
+/* Queues the mesh (and hence vertex buffer) for the given chunk to be built. */
+/* NOTE: The chunk's current mesh is still drawn until the new mesh has finished building. */
 /* NOTE: This method also adjusts internal state, so do not bypass this. */
 void MapRenderer_BuildChunk(struct ChunkInfo* info, int* chunkUpdates);
 
@@ -1247,36 +1247,10 @@ static void SaveLevelScreen_MakeDesc(struct SaveLevelScreen* s, const String* te
 
 static void SaveLevelScreen_SaveMap(struct SaveLevelScreen* s, const String* path) {
 	const static String cw = String_FromConst(".cw");
-	struct Stream stream, compStream;
-	struct GZipState state;
-	ReturnCode res;
+	IMapExporter exporter = String_CaselessEnds(path, &cw) ? Cw_Save : Schematic_Save;
 
-	res = Stream_CreateFile(&stream, path);
-	if (res) { Logger_Warn2(res, "creating", path); return; }
-	GZip_MakeStream(&compStream, &state, &stream);
-
-	if (String_CaselessEnds(path, &cw)) {
-		res = Cw_Save(&compStream);
-	} else {
-		res = Schematic_Save(&compStream);
-	}
-
-	if (res) {
-		stream.Close(&stream);
-		Logger_Warn2(res, "encoding", path); return;
-	}
-
-	if ((res = compStream.Close(&compStream))) {
-		stream.Close(&stream);
-		Logger_Warn2(res, "closing", path); return;
-	}
-
-	res = stream.Close(&stream);
-	if (res) { Logger_Warn2(res, "closing", path); return; }
-
-	Chat_Add1("&eSaved map to: %s", path);
 	Gui_FreeActive();
-	Gui_SetActive(PauseScreen_MakeInstance());
+	Gui_SetActive(SavingMapScreen_MakeInstance(path, exporter));
 }
 
 static void SaveLevelScreen_Save(void* screen, void* widget, const char* ext) {
@@ -1582,7 +1556,8 @@ static void LoadLevelScreen_EntryClick(void* screen, void* widget) {
 	String_Format1(&path, "maps/%s", &filename);
 
 	if (!File_Exists(&path)) return;
-	Map_LoadFrom(&path);
+	Gui_FreeActive();
+	Gui_SetActive(LoadingMapScreen_MakeInstance(&path));
 }
 
 struct Screen* LoadLevelScreen_MakeInstance(void) {
@@ -12,6 +12,14 @@
 #include "Block.h"
 #include "Stream.h"
 #include "Funcs.h"
+#include "Platform.h"
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MODEL_SSE2
+#elif defined __ARM_NEON || defined __ARM_NEON__
+#include <arm_neon.h>
+#define MODEL_NEON
+#endif
 
 struct _ModelsData Models;
 
@@ -169,46 +177,241 @@ void Model_ApplyTexture(struct Entity* entity) {
 	Models.vScale = entity->vScale * (_64x64 ? 0.015625f : 0.03125f);
 }
 
-void Model_DrawPart(struct ModelPart* part) {
+/* Transforms the vertices of the given part into Models.Vertices, rotating them if m is non NULL. */
+/* Also used for parts that aren't a multiple of 4 vertices. */
+static void Model_TransformPart(struct ModelPart* part, const struct Matrix* m) {
 	struct Model* model     = Models.Active;
 	struct ModelVertex* src = &model->vertices[part->Offset];
 	VertexP3fT2fC4b* dst    = &Models.Vertices[model->index];
+	float uScale = Models.uScale, vScale = Models.vScale;
 
 	struct ModelVertex v;
 	int i, count = part->Count;
 
 	for (i = 0; i < count; i++) {
 		v = *src;
-		dst->X = v.X; dst->Y = v.Y; dst->Z = v.Z;
+		if (m) {
+			dst->X = v.X * m->Row0.X + v.Y * m->Row1.X + v.Z * m->Row2.X + m->Row3.X;
+			dst->Y = v.X * m->Row0.Y + v.Y * m->Row1.Y + v.Z * m->Row2.Y + m->Row3.Y;
+			dst->Z = v.X * m->Row0.Z + v.Y * m->Row1.Z + v.Z * m->Row2.Z + m->Row3.Z;
+		} else {
+			dst->X = v.X; dst->Y = v.Y; dst->Z = v.Z;
+		}
 		dst->Col = Models.Cols[i >> 2];
 
-		dst->U = (v.U & UV_POS_MASK) * Models.uScale - (v.U >> UV_MAX_SHIFT) * 0.01f * Models.uScale;
-		dst->V = (v.V & UV_POS_MASK) * Models.vScale - (v.V >> UV_MAX_SHIFT) * 0.01f * Models.vScale;
+		dst->U = (v.U & UV_POS_MASK) * uScale - (v.U >> UV_MAX_SHIFT) * 0.01f * uScale;
+		dst->V = (v.V & UV_POS_MASK) * vScale - (v.V >> UV_MAX_SHIFT) * 0.01f * vScale;
 		src++; dst++;
 	}
-	model->index += count;
 }
 
+#if defined MODEL_SSE2 || defined MODEL_NEON
+/* Bind pose stores each group of 4 vertices as X[4], Y[4], Z[4], U[4], U2[4], V[4], V2[4] */
+/* U2 is the amount subtracted from U for the 'max' coordinate. (i.e. U = U * uScale - U2 * uScale) */
+#define BINDPOSE_GROUP_FLOATS 28
+
+/* Vertices of a model converted to the layout used for transforming parts with SIMD. */
+struct ModelBindPose { struct Model* Model; float* Data; int Count; };
+static struct ModelBindPose* bindPoses;
+static int bindPosesCount, bindPosesCapacity, bindPosesLast;
+
+static struct ModelBindPose* Model_GetBindPose(struct Model* model, bool create) {
+	struct ModelBindPose* pose;
+	int i;
+	if (bindPosesLast < bindPosesCount && bindPoses[bindPosesLast].Model == model) {
+		return &bindPoses[bindPosesLast];
+	}
+
+	for (i = 0; i < bindPosesCount; i++) {
+		if (bindPoses[i].Model != model) continue;
+		bindPosesLast = i; return &bindPoses[i];
+	}
+	if (!create) return NULL;
+
+	if (bindPosesCount == bindPosesCapacity) {
+		bindPosesCapacity += 16;
+		bindPoses = (struct ModelBindPose*)Mem_Realloc(bindPoses, bindPosesCapacity,
+													sizeof(struct ModelBindPose), "model bind poses");
+	}
+	bindPosesLast = bindPosesCount++;
+
+	pose = &bindPoses[bindPosesLast];
+	pose->Model = model; pose->Data = NULL; pose->Count = 0;
+	return pose;
+}
+
+static void Model_MakeBindPose(struct ModelBindPose* pose, int count) {
+	struct ModelVertex* src;
+	float* dst;
+	int i, j;
+
+	pose->Data  = (float*)Mem_Realloc(pose->Data, count / 4 * BINDPOSE_GROUP_FLOATS, 
+									sizeof(float), "model bind pose");
+	pose->Count = count;
+
+	for (i = 0; i < count; i += 4) {
+		src = &pose->Model->vertices[i];
+		dst = &pose->Data[i / 4 * BINDPOSE_GROUP_FLOATS];
+
+		for (j = 0; j < 4; j++) {
+			dst[j +  0] = src[j].X;
+			dst[j +  4] = src[j].Y;
+			dst[j +  8] = src[j].Z;
+			dst[j + 12] = (float)(src[j].U & UV_POS_MASK);
+			dst[j + 16] = (src[j].U >> UV_MAX_SHIFT) * 0.01f;
+			dst[j + 20] = (float)(src[j].V & UV_POS_MASK);
+			dst[j + 24] = (src[j].V >> UV_MAX_SHIFT) * 0.01f;
+		}
+	}
+}
+
+static void Model_FreeBindPoses(void) {
+	int i;
+	for (i = 0; i < bindPosesCount; i++) { Mem_Free(bindPoses[i].Data); }
+
+	Mem_Free(bindPoses);
+	bindPoses      = NULL;
+	bindPosesCount = 0; bindPosesCapacity = 0; bindPosesLast = 0;
+}
+#endif
+
+#if defined MODEL_SSE2
+/* Transforms 4 vertices at a time, in exactly the same order of operations as Model_TransformPart */
+static void Model_TransformPartSIMD(const float* src, struct ModelPart* part, const struct Matrix* m) {
+	VertexP3fT2fC4b* dst = &Models.Vertices[Models.Active->index];
+	__m128 m00, m01, m02, m10, m11, m12, m20, m21, m22, m30, m31, m32;
+	__m128 uScale = _mm_set1_ps(Models.uScale), vScale = _mm_set1_ps(Models.vScale);
+	__m128 x, y, z, c, u, v, uv0, uv1;
+	PackedColUnion col;
+	int i, count = part->Count;
+
+	if (m) {
+		m00 = _mm_set1_ps(m->Row0.X); m01 = _mm_set1_ps(m->Row0.Y); m02 = _mm_set1_ps(m->Row0.Z);
+		m10 = _mm_set1_ps(m->Row1.X); m11 = _mm_set1_ps(m->Row1.Y); m12 = _mm_set1_ps(m->Row1.Z);
+		m20 = _mm_set1_ps(m->Row2.X); m21 = _mm_set1_ps(m->Row2.Y); m22 = _mm_set1_ps(m->Row2.Z);
+		m30 = _mm_set1_ps(m->Row3.X); m31 = _mm_set1_ps(m->Row3.Y); m32 = _mm_set1_ps(m->Row3.Z);
+	}
+
+	for (i = 0; i < count; i += 4, src += BINDPOSE_GROUP_FLOATS, dst += 4) {
+		x = _mm_loadu_ps(src + 0); y = _mm_loadu_ps(src + 4); z = _mm_loadu_ps(src + 8);
+
+		if (m) {
+			__m128 tx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)), _mm_mul_ps(z, m20)), m30);
+			__m128 ty = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)), _mm_mul_ps(z, m21)), m31);
+			__m128 tz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)), _mm_mul_ps(z, m22)), m32);
+			x = tx; y = ty; z = tz;
+		}
+		col.C = Models.Cols[i >> 2];
+		c = _mm_castsi128_ps(_mm_set1_epi32((int)col.Raw));
+
+		u = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(src + 12), uScale), _mm_mul_ps(_mm_loadu_ps(src + 16), uScale));
+		v = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(src + 20), vScale), _mm_mul_ps(_mm_loadu_ps(src + 24), vScale));
+
+		/* Convert to X,Y,Z,Col,U,V layout of each vertex */
+		_MM_TRANSPOSE4_PS(x, y, z, c);
+		uv0 = _mm_unpacklo_ps(u, v);
+		uv1 = _mm_unpackhi_ps(u, v);
+
+		_mm_storeu_ps(&dst[0].X, x); _mm_storel_pi((__m64*)&dst[0].U, uv0);
+		_mm_storeu_ps(&dst[1].X, y); _mm_storeh_pi((__m64*)&dst[1].U, uv0);
+		_mm_storeu_ps(&dst[2].X, z); _mm_storel_pi((__m64*)&dst[2].U, uv1);
+		_mm_storeu_ps(&dst[3].X, c); _mm_storeh_pi((__m64*)&dst[3].U, uv1);
+	}
+}
+#elif defined MODEL_NEON
+/* Transforms 4 vertices at a time, in exactly the same order of operations as Model_TransformPart */
+/* NOTE: Separate multiply and add is used, as fused multiply-add would round differently */
+static void Model_TransformPartSIMD(const float* src, struct ModelPart* part, const struct Matrix* m) {
+	VertexP3fT2fC4b* dst = &Models.Vertices[Models.Active->index];
+	float32x4_t m00, m01, m02, m10, m11, m12, m20, m21, m22, m30, m31, m32;
+	float32x4_t uScale = vdupq_n_f32(Models.uScale), vScale = vdupq_n_f32(Models.vScale);
+	float32x4_t x, y, z, c, u, v;
+	float32x4x2_t xz, yc, r01, r23, uv;
+	PackedColUnion col;
+	int i, count = part->Count;
+
+	if (m) {
+		m00 = vdupq_n_f32(m->Row0.X); m01 = vdupq_n_f32(m->Row0.Y); m02 = vdupq_n_f32(m->Row0.Z);
+		m10 = vdupq_n_f32(m->Row1.X); m11 = vdupq_n_f32(m->Row1.Y); m12 = vdupq_n_f32(m->Row1.Z);
+		m20 = vdupq_n_f32(m->Row2.X); m21 = vdupq_n_f32(m->Row2.Y); m22 = vdupq_n_f32(m->Row2.Z);
+		m30 = vdupq_n_f32(m->Row3.X); m31 = vdupq_n_f32(m->Row3.Y); m32 = vdupq_n_f32(m->Row3.Z);
+	}
+
+	for (i = 0; i < count; i += 4, src += BINDPOSE_GROUP_FLOATS, dst += 4) {
+		x = vld1q_f32(src + 0); y = vld1q_f32(src + 4); z = vld1q_f32(src + 8);
+
+		if (m) {
+			float32x4_t tx = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(x, m00), vmulq_f32(y, m10)), vmulq_f32(z, m20)), m30);
+			float32x4_t ty = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(x, m01), vmulq_f32(y, m11)), vmulq_f32(z, m21)), m31);
+			float32x4_t tz = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(x, m02), vmulq_f32(y, m12)), vmulq_f32(z, m22)), m32);
+			x = tx; y = ty; z = tz;
+		}
+		col.C = Models.Cols[i >> 2];
+		c = vreinterpretq_f32_u32(vdupq_n_u32(col.Raw));
+
+		u = vsubq_f32(vmulq_f32(vld1q_f32(src + 12), uScale), vmulq_f32(vld1q_f32(src + 16), uScale));
+		v = vsubq_f32(vmulq_f32(vld1q_f32(src + 20), vScale), vmulq_f32(vld1q_f32(src + 24), vScale));
+
+		/* Convert to X,Y,Z,Col,U,V layout of each vertex */
+		xz  = vzipq_f32(x, z);
+		yc  = vzipq_f32(y, c);
+		r01 = vzipq_f32(xz.val[0], yc.val[0]);
+		r23 = vzipq_f32(xz.val[1], yc.val[1]);
+		uv  = vzipq_f32(u, v);
+
+		vst1q_f32(&dst[0].X, r01.val[0]); vst1_f32(&dst[0].U, vget_low_f32(uv.val[0]));
+		vst1q_f32(&dst[1].X, r01.val[1]); vst1_f32(&dst[1].U, vget_high_f32(uv.val[0]));
+		vst1q_f32(&dst[2].X, r23.val[0]); vst1_f32(&dst[2].U, vget_low_f32(uv.val[1]));
+		vst1q_f32(&dst[3].X, r23.val[1]); vst1_f32(&dst[3].U, vget_high_f32(uv.val[1]));
+	}
+}
+#endif
+
+/* Transforms the vertices of the given part into Models.Vertices, then advances the model's vertex index */
+static void Model_DrawTransformed(struct ModelPart* part, const struct Matrix* m) {
+	struct Model* model = Models.Active;
+#if defined MODEL_SSE2 || defined MODEL_NEON
+	struct ModelBindPose* pose;
+	int end;
+
+	if (!((part->Offset | part->Count) & 3)) {
+		end  = part->Offset + part->Count;
+		pose = Model_GetBindPose(model, true);
+		if (end > pose->Count) Model_MakeBindPose(pose, end);
+
+		Model_TransformPartSIMD(&pose->Data[part->Offset / 4 * BINDPOSE_GROUP_FLOATS], part, m);
+		model->index += part->Count;
+		return;
+	}
+#endif
+	Model_TransformPart(part, m);
+	model->index += part->Count;
+}
+
+void Model_DrawPart(struct ModelPart* part) { Model_DrawTransformed(part, NULL); }
+
 #define Model_RotateX t = cosX * v.Y + sinX * v.Z; v.Z = -sinX * v.Y + cosX * v.Z; v.Y = t;
 #define Model_RotateY t = cosY * v.X - sinY * v.Z; v.Z =  sinY * v.X + cosY * v.Z; v.X = t;
 #define Model_RotateZ t = cosZ * v.X + sinZ * v.Y; v.Y = -sinZ * v.X + cosZ * v.Y; v.X = t;
 
 void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart* part, bool head) {
-	struct Model* model     = Models.Active;
-	struct ModelVertex* src = &model->vertices[part->Offset];
-	VertexP3fT2fC4b* dst    = &Models.Vertices[model->index];
-
 	float cosX = (float)Math_Cos(-angleX), sinX = (float)Math_Sin(-angleX);
 	float cosY = (float)Math_Cos(-angleY), sinY = (float)Math_Sin(-angleY);
 	float cosZ = (float)Math_Cos(-angleZ), sinZ = (float)Math_Sin(-angleZ);
 	float t, x = part->RotX, y = part->RotY, z = part->RotZ;
-	
-	struct ModelVertex v;
-	int i, count = part->Count;
 
-	for (i = 0; i < count; i++) {
-		v = *src;
-		v.X -= x; v.Y -= y; v.Z -= z;
+	struct Matrix m;
+	Vector3 rows[4], v;
+	int i;
+
+	rows[0] = Vector3_Create3(1.0f, 0.0f, 0.0f);
+	rows[1] = Vector3_Create3(0.0f, 1.0f, 0.0f);
+	rows[2] = Vector3_Create3(0.0f, 0.0f, 1.0f);
+	rows[3] = Vector3_Create3(x, y, z);
+
+	/* Rotation is the same for every vertex, so rotate the axes once to build a matrix */
+	for (i = 0; i < 4; i++) {
+		v = rows[i];
 
 		/* Rotate locally */
 		if (Models.Rotation == ROTATE_ORDER_ZYX) {
@@ -229,14 +432,15 @@ void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart
 		if (head) {
 			t = Models.cosHead * v.X - Models.sinHead * v.Z; v.Z = Models.sinHead * v.X + Models.cosHead * v.Z; v.X = t;
 		}
-		dst->X = v.X + x; dst->Y = v.Y + y; dst->Z = v.Z + z;
-		dst->Col = Models.Cols[i >> 2];
-
-		dst->U = (v.U & UV_POS_MASK) * Models.uScale - (v.U >> UV_MAX_SHIFT) * 0.01f * Models.uScale;
-		dst->V = (v.V & UV_POS_MASK) * Models.vScale - (v.V >> UV_MAX_SHIFT) * 0.01f * Models.vScale;
-		src++; dst++;
+		rows[i] = v;
 	}
-	model->index += count;
+
+	/* Vertices are rotated around the part's pivot point */
+	m.Row0.X = rows[0].X; m.Row0.Y = rows[0].Y; m.Row0.Z = rows[0].Z; m.Row0.W = 0.0f;
+	m.Row1.X = rows[1].X; m.Row1.Y = rows[1].Y; m.Row1.Z = rows[1].Z; m.Row1.W = 0.0f;
+	m.Row2.X = rows[2].X; m.Row2.Y = rows[2].Y; m.Row2.Z = rows[2].Z; m.Row2.W = 0.0f;
+	m.Row3.X = x - rows[3].X; m.Row3.Y = y - rows[3].Y; m.Row3.Z = z - rows[3].Z; m.Row3.W = 1.0f;
+	Model_DrawTransformed(part, &m);
 }
 
 void Model_RenderArm(struct Model* model, struct Entity* entity) {
@@ -387,6 +591,13 @@ static void Model_Make(struct Model* model) {
 	model->initalised = true;
 	model->index      = 0;
 	Models.Active     = active;
+#if defined MODEL_SSE2 || defined MODEL_NEON
+	{
+		/* Vertices might have changed, so bind pose needs to be remade */
+		struct ModelBindPose* pose = Model_GetBindPose(model, false);
+		if (pose) pose->Count = 0;
+	}
+#endif
 }
 
 struct Model* Model_Get(const String* name) {
@@ -1706,6 +1917,9 @@ static void Models_Free(void) {
 	for (tex = textures_head; tex; tex = tex->Next) {
 		Gfx_DeleteTexture(&tex->TexID);
 	}
+#if defined MODEL_SSE2 || defined MODEL_NEON
+	Model_FreeBindPoses();
+#endif
 	Models_ContextLost(NULL);
 
 	Event_UnregisterEntry(&TextureEvents.FileChanged, NULL, Models_TextureChanged);
@@ -70,6 +70,11 @@ extern const char* FpsLimit_Names[FPS_LIMIT_COUNT];
 #define OPT_CLASSIC_HACKS "nostalgia-hacks"
 #define OPT_CLASSIC_ARM_MODEL "nostalgia-classicarm"
 #define OPT_MAX_CHUNK_UPDATES "gfx-maxchunkupdates"
+#define OPT_CHUNK_WORKERS "gfx-chunkworkers"
+#define OPT_HTTP_WORKERS "http-workers"
+#define OPT_GREEDY_MESHING "gfx-greedymeshing"
+#define OPT_FLOOD_LIGHTING "gfx-floodlighting"
+#define OPT_MAX_PARTICLES "gfx-maxparticles"
 
 extern struct EntryList Options;
 /* Returns the number of options changed via Options_SetXYZ since last save. */
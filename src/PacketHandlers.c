@@ -33,18 +33,27 @@ static bool classic_receivedFirstPos;
 /* Map state */
 static bool map_begunLoading;
 static TimeMS map_receiveStart;
-static struct InflateState map_inflateState;
-static struct Stream map_stream, map_part;
+static struct Stream map_part;
 static struct GZipHeader map_gzHeader;
-static int map_sizeIndex, map_index, map_volume;
-static uint8_t map_size[4];
-static BlockRaw* map_blocks;
-
+static volatile int map_volume;
+
+/* Received map data is inflated on a background thread, instead of in the packet handler */
+struct MapInflater {
+	struct InflateState State;
+	struct Stream Stream, Source;
+	void* Thread;
+	void* Waitable;
+	uint8_t* Data; /* Compressed data received so far */
+	uint32_t Length, Capacity, ReadPos;
+	bool Ended;    /* Whether all compressed data has been received */
+	BlockRaw* Blocks;
+	volatile int Index;
+};
+static void* map_mutex;
+static struct MapInflater map_lower;
 #ifdef EXTENDED_BLOCKS
-static struct InflateState map2_inflateState;
-static struct Stream map2_stream;
-static int map2_index;
-static BlockRaw* map2_blocks;
+/* Upper 8 bits of blocks are sent as a separate stream, so are inflated in parallel */
+static struct MapInflater map_upper;
 #endif
 
 /* CPE state */
@@ -385,6 +394,117 @@ static void Classic_Handshake(uint8_t* data) {
 
 static void Classic_Ping(uint8_t* data) { }
 
+static ReturnCode MapInflater_ReadData(struct Stream* s, uint8_t* data, uint32_t count, uint32_t* modified) {
+	struct MapInflater* m = s->Meta.Inflate;
+	uint32_t avail;
+	bool ended;
+
+	for (;;) {
+		Mutex_Lock(map_mutex);
+		avail = m->Length - m->ReadPos;
+		ended = m->Ended;
+
+		if (avail) {
+			count = min(count, avail);
+			Mem_Copy(data, m->Data + m->ReadPos, count);
+			m->ReadPos += count;
+		}
+		Mutex_Unlock(map_mutex);
+
+		if (avail) { *modified = count; return 0; }
+		if (ended) { *modified = 0;     return 0; }
+		Waitable_WaitFor(m->Waitable, 10);
+	}
+}
+
+static bool MapInflater_WaitVolume(struct MapInflater* m) {
+	while (!map_volume) {
+		Mutex_Lock(map_mutex);
+		if (m->Ended && m->ReadPos == m->Length) { Mutex_Unlock(map_mutex); return false; }
+		Mutex_Unlock(map_mutex);
+		Waitable_WaitFor(m->Waitable, 10);
+	}
+	return true;
+}
+
+static void MapInflater_Run(struct MapInflater* m) {
+	uint8_t size[4];
+	uint32_t left, read;
+	ReturnCode res;
+
+	/* Unless using fast map, the volume is at the start of the lower blocks stream */
+	if (m == &map_lower && !map_volume) {
+		if (Stream_Read(&m->Stream, size, 4)) return;
+		map_volume = Stream_GetU32_BE(size);
+	} else if (!MapInflater_WaitVolume(m)) {
+		return;
+	}
+	if (!m->Blocks) m->Blocks = Mem_Alloc(map_volume, 1, "map blocks");
+
+	while (m->Index < map_volume) {
+		left = map_volume - m->Index;
+		res  = m->Stream.Read(&m->Stream, &m->Blocks[m->Index], left, &read);
+		if (res || !read) break;
+		m->Index += read;
+	}
+}
+static void MapInflater_RunLower(void) { MapInflater_Run(&map_lower); }
+#ifdef EXTENDED_BLOCKS
+static void MapInflater_RunUpper(void) { MapInflater_Run(&map_upper); }
+#endif
+
+static void MapInflater_Init(struct MapInflater* m) {
+	if (!map_mutex)   map_mutex   = Mutex_Create();
+	if (!m->Waitable) m->Waitable = Waitable_Create();
+
+	m->Length = 0; m->ReadPos = 0;
+	m->Ended  = false;
+	m->Blocks = NULL;
+	m->Index  = 0;
+
+	Stream_Init(&m->Source);
+	m->Source.Read         = MapInflater_ReadData;
+	m->Source.Meta.Inflate = m;
+	Inflate_MakeStream(&m->Stream, &m->State, &m->Source);
+}
+
+static void MapInflater_Append(struct MapInflater* m, Thread_StartFunc* func, uint8_t* data, uint32_t len) {
+	Mutex_Lock(map_mutex);
+	if (m->Length + len > m->Capacity) {
+		m->Capacity = max(m->Capacity * 2, m->Length + len);
+		m->Data     = Mem_Realloc(m->Data, m->Capacity, 1, "map compressed data");
+	}
+	Mem_Copy(m->Data + m->Length, data, len);
+	m->Length += len;
+	Mutex_Unlock(map_mutex);
+
+	if (!m->Thread) m->Thread = Thread_Start(func, false);
+	Waitable_Signal(m->Waitable);
+}
+
+/* Waits for all received data to be inflated. If discard is true, stops as soon as possible instead. */
+static void MapInflater_Finish(struct MapInflater* m, bool discard) {
+	if (!m->Thread) return;
+
+	Mutex_Lock(map_mutex);
+	m->Ended = true;
+	if (discard) m->ReadPos = m->Length;
+	Mutex_Unlock(map_mutex);
+
+	Waitable_Signal(m->Waitable);
+	Thread_Join(m->Thread);
+	m->Thread = NULL;
+}
+
+static void MapInflater_Free(struct MapInflater* m) {
+	MapInflater_Finish(m, true);
+	Mem_Free(m->Blocks);
+	m->Blocks = NULL;
+	Mem_Free(m->Data);
+	m->Data     = NULL;
+	m->Capacity = 0;
+}
+
 static void Classic_StartLoading(void) {
 	World_Reset();
 	Event_RaiseVoid(&WorldEvents.NewMap);
@@ -402,16 +522,13 @@ static void Classic_StartLoading(void) {
 	classic_receivedFirstPos = false;
 
 	GZipHeader_Init(&map_gzHeader);
-	Inflate_MakeStream(&map_stream, &map_inflateState, &map_part);
 	map_begunLoading = true;
-
-	map_sizeIndex    = 0;
-	map_index        = 0;
+	map_volume       = 0;
 	map_receiveStart = DateTime_CurrentUTC_MS();
 
+	MapInflater_Init(&map_lower);
 #ifdef EXTENDED_BLOCKS
-	Inflate_MakeStream(&map2_stream, &map2_inflateState, &map_part);
-	map2_index = 0;
+	MapInflater_Init(&map_upper);
 #endif
 }
 
@@ -422,15 +539,13 @@ static void Classic_LevelInit(uint8_t* data) {
 	if (cpe_fastMap) {
 		map_volume = Stream_GetU32_BE(data);
 		map_gzHeader.Done = true;
-		map_sizeIndex = sizeof(uint32_t);
-		map_blocks = Mem_Alloc(map_volume, 1, "map blocks");
+		map_lower.Blocks  = Mem_Alloc(map_volume, 1, "map blocks");
 	}
 }
 
 static void Classic_LevelDataChunk(uint8_t* data) {
 	int usedLength;
 	float progress;
-	uint32_t left, read;
 	uint8_t value;
 	ReturnCode res;
 
@@ -451,41 +566,20 @@ static void Classic_LevelDataChunk(uint8_t* data) {
 		if (res && res != ERR_END_OF_STREAM) Logger_Abort2(res, "reading map data");
 	}
 
-	if (map_gzHeader.Done) {
-		if (map_sizeIndex < 4) {
-			left = 4 - map_sizeIndex;
-			map_stream.Read(&map_stream, &map_size[map_sizeIndex], left, &read); 
-			map_sizeIndex += read;
+	if (map_gzHeader.Done && map_part.Meta.Mem.Left) {
+#ifdef EXTENDED_BLOCKS
+		/* Only allocates upper blocks when actually needed */
+		if (cpe_extBlocks && value) {
+			MapInflater_Append(&map_upper, MapInflater_RunUpper, map_part.Meta.Mem.Cur, map_part.Meta.Mem.Left);
+		} else {
+			MapInflater_Append(&map_lower, MapInflater_RunLower, map_part.Meta.Mem.Cur, map_part.Meta.Mem.Left);
 		}
-
-		if (map_sizeIndex == 4) {
-			if (!map_blocks) {
-				map_volume = Stream_GetU32_BE(map_size);
-				map_blocks = Mem_Alloc(map_volume, 1, "map blocks");
-			}
-
-#ifndef EXTENDED_BLOCKS
-			left = map_volume - map_index;
-			map_stream.Read(&map_stream, &map_blocks[map_index], left, &read);
-			map_index += read;
 #else
-			if (cpe_extBlocks && value) {
-				/* Only allocate map2 when needed */
-				if (!map2_blocks) map2_blocks = Mem_Alloc(map_volume, 1, "map blocks upper");
-
-				left = map_volume - map2_index;
-				map2_stream.Read(&map2_stream, &map2_blocks[map2_index], left, &read); 
-				map2_index += read;
-			} else {
-				left = map_volume - map_index;
-				map_stream.Read(&map_stream, &map_blocks[map_index], left, &read); 
-				map_index += read;
-			}
+		MapInflater_Append(&map_lower, MapInflater_RunLower, map_part.Meta.Mem.Cur, map_part.Meta.Mem.Left);
 #endif
-		}
 	}
 
-	progress = !map_blocks ? 0.0f : (float)map_index / map_volume;
+	progress = !map_volume ? 0.0f : (float)map_lower.Index / map_volume;
 	Event_RaiseFloat(&WorldEvents.Loading, progress);
 }
 
@@ -502,6 +596,12 @@ static void Classic_LevelFinalise(uint8_t* data) {
 	height = Stream_GetU16_BE(&data[2]);
 	length = Stream_GetU16_BE(&data[4]);
 
+	/* Only the last few chunks of data should still need to be inflated by now */
+	MapInflater_Finish(&map_lower, false);
+#ifdef EXTENDED_BLOCKS
+	MapInflater_Finish(&map_upper, false);
+#endif
+
 	loadingMs = (int)(DateTime_CurrentUTC_MS() - map_receiveStart);
 	Platform_Log1("map loading took: %i", &loadingMs);
 
@@ -509,22 +609,21 @@ static void Classic_LevelFinalise(uint8_t* data) {
 		Logger_Abort("Blocks array size does not match volume of map");
 	}
 
-	World_SetNewMap(map_blocks, width, height, length);
 #ifdef EXTENDED_BLOCKS
 	/* defer allocation of second map array if possible */
-	if (cpe_extBlocks && map2_blocks) {
-		World_SetMapUpper(map2_blocks);
+	if (cpe_extBlocks && map_upper.Blocks) {
+		World_SetMapUpper(map_upper.Blocks);
 	}
+	map_upper.Blocks = NULL;
+	MapInflater_Free(&map_upper);
 #endif
+	World_SetNewMap(map_lower.Blocks, width, height, length);
+	map_lower.Blocks = NULL;
+	MapInflater_Free(&map_lower);
 
 	Event_RaiseVoid(&WorldEvents.MapLoaded);
 	WoM_CheckSendWomID();
-
-	map_blocks       = NULL;
 	map_begunLoading = false;
-#ifdef EXTENDED_BLOCKS
-	map2_blocks      = NULL;
-#endif
 }
 
 static void Classic_SetBlock(uint8_t* data) {
@@ -681,6 +780,10 @@ static void Classic_ReadAbsoluteLocation(uint8_t* data, EntityID id, bool interp
 }
 
 static void Classic_Reset(void) {
+	MapInflater_Free(&map_lower);
+#ifdef EXTENDED_BLOCKS
+	MapInflater_Free(&map_upper);
+#endif
 	map_begunLoading = false;
 	classic_receivedFirstPos = false;
 
@@ -1163,8 +1266,7 @@ static void CPE_ExtAddEntity2(uint8_t* data) {
 static void CPE_BulkBlockUpdate(uint8_t* data) {
 	int32_t indices[BULK_MAX_BLOCKS];
 	BlockID blocks[BULK_MAX_BLOCKS];
-	int index, i;
-	int x, y, z;
+	int index, i, valid;
 	int count = 1 + *data++;
 
 	for (i = 0; i < count; i++) {
@@ -1188,15 +1290,15 @@ static void CPE_BulkBlockUpdate(uint8_t* data) {
 		data += BULK_MAX_BLOCKS / 4;
 	}
 
-	for (i = 0; i < count; i++) {
+	/* Drop any invalid indices, then apply all the changes at once */
+	for (i = 0, valid = 0; i < count; i++) {
 		index = indices[i];
 		if (index < 0 || index >= World.Volume) continue;
-		World_Unpack(index, x, y, z);
 
-		if (World_Contains(x, y, z)) {
-			Game_UpdateBlock(x, y, z, blocks[i]);
-		}
+		indices[valid] = index;
+		blocks[valid]  = blocks[i]; valid++;
 	}
+	Game_UpdateBlocksBatch(indices, blocks, valid);
 }
 
 static void CPE_SetTextColor(uint8_t* data) {
@@ -1378,7 +1480,7 @@ static void CPE_Tick(void) {
 *------------------------------------------------------Custom blocks------------------------------------------------------*
 *#########################################################################################################################*/
 static void BlockDefs_OnBlockUpdated(BlockID block, bool didBlockLight) {
-	if (!World.Blocks) return;
+	if (!World.Loaded) return;
 	/* Need to refresh lighting when a block's light blocking state changes */
 	if (Blocks.BlocksLight[block] != didBlockLight) { Lighting_Refresh(); }
 }
@@ -10,15 +10,93 @@
 #include "Game.h"
 #include "Event.h"
 #include "GameStructs.h"
+#include "Options.h"
+#include "Platform.h"
 
 
 /*########################################################################################################################*
 *------------------------------------------------------Particle base------------------------------------------------------*
 *#########################################################################################################################*/
 static GfxResourceID Particles_TexId, Particles_VB;
-#define PARTICLES_MAX 600
+/* Maximum number of particles of each type, as each type is drawn from one vertex buffer. */
+#define PARTICLES_MAX_CAPACITY (GFX_MAX_VERTICES / 4)
+#define PARTICLES_DEF_CAPACITY 8192
+static int particles_capacity;
+static VertexP3fT2fC4b* particles_vertices;
 static RNGState rnd;
-static bool particle_hitTerrain;
+
+/* Stores the state of particles as separate arrays, so that physics can be applied to all particles in one pass. */
+struct ParticlePool {
+	/* Position at the start and the end of the current tick. */
+	float* LastX, *LastY, *LastZ;
+	float* NextX, *NextY, *NextZ;
+	float* VelX, *VelY, *VelZ;
+	float* Lifetime;
+	uint8_t* Size;
+	/* Whether the particle should be removed at the end of the current tick. */
+	bool* Dead;
+	int Count;
+	/* Index of the particle replaced next when the pool is full. */
+	int Evict;
+};
+#define PARTICLEPOOL_FLOATS 10
+
+static void ParticlePool_Alloc(struct ParticlePool* pool) {
+	int cap = particles_capacity;
+	float* data = (float*)Mem_Alloc(cap * PARTICLEPOOL_FLOATS, sizeof(float), "particle state");
+
+	pool->LastX = data + cap * 0; pool->LastY = data + cap * 1; pool->LastZ = data + cap * 2;
+	pool->NextX = data + cap * 3; pool->NextY = data + cap * 4; pool->NextZ = data + cap * 5;
+	pool->VelX  = data + cap * 6; pool->VelY  = data + cap * 7; pool->VelZ  = data + cap * 8;
+	pool->Lifetime = data + cap * 9;
+
+	pool->Size  = (uint8_t*)Mem_Alloc(cap, 2, "particle flags");
+	pool->Dead  = pool->Size + cap;
+	pool->Count = 0; pool->Evict = 0;
+}
+
+static void ParticlePool_Free(struct ParticlePool* pool) {
+	Mem_Free(pool->LastX); pool->LastX = NULL;
+	Mem_Free(pool->Size);  pool->Size  = NULL;
+	pool->Count = 0;
+}
+
+/* Returns the index of the slot for a new particle. */
+/* When the pool is full, particles are replaced in turn, which approximately replaces the oldest. */
+static int ParticlePool_Add(struct ParticlePool* pool) {
+	int i;
+	if (pool->Count < particles_capacity) return pool->Count++;
+
+	i = pool->Evict;
+	pool->Evict = (i + 1) % particles_capacity;
+	return i;
+}
+
+/* Removes the given particle, by moving the last particle into its slot. */
+static void ParticlePool_RemoveAt(struct ParticlePool* pool, int i) {
+	int last = --pool->Count;
+
+	pool->LastX[i] = pool->LastX[last]; pool->LastY[i] = pool->LastY[last]; pool->LastZ[i] = pool->LastZ[last];
+	pool->NextX[i] = pool->NextX[last]; pool->NextY[i] = pool->NextY[last]; pool->NextZ[i] = pool->NextZ[last];
+	pool->VelX[i]  = pool->VelX[last];  pool->VelY[i]  = pool->VelY[last];  pool->VelZ[i]  = pool->VelZ[last];
+	pool->Lifetime[i] = pool->Lifetime[last];
+	pool->Size[i]     = pool->Size[last];
+	pool->Dead[i]     = pool->Dead[last];
+}
+
+static void Particle_Reset(struct ParticlePool* pool, int i, Vector3 pos, Vector3 velocity, float lifetime) {
+	pool->LastX[i] = pos.X; pool->LastY[i] = pos.Y; pool->LastZ[i] = pos.Z;
+	pool->NextX[i] = pos.X; pool->NextY[i] = pos.Y; pool->NextZ[i] = pos.Z;
+	pool->VelX[i]  = velocity.X; pool->VelY[i] = velocity.Y; pool->VelZ[i] = velocity.Z;
+	pool->Lifetime[i] = lifetime;
+	pool->Dead[i]     = false;
+}
+
+static void Particle_GetPos(struct ParticlePool* pool, int i, float t, Vector3* pos) {
+	Vector3 last = Vector3_Create3(pool->LastX[i], pool->LastY[i], pool->LastZ[i]);
+	Vector3 next = Vector3_Create3(pool->NextX[i], pool->NextY[i], pool->NextZ[i]);
+	Vector3_Lerp(pos, &last, &next, t);
+}
 
 void Particle_DoRender(Vector2* size, Vector3* pos, TextureRec* rec, PackedCol col, VertexP3fT2fC4b* vertices) {
 	struct Matrix* view;
@@ -48,121 +126,142 @@ void Particle_DoRender(Vector2* size, Vector3* pos, TextureRec* rec, PackedCol c
 				   v.V = rec->V2; vertices[3] = v;
 }
 
-static void Particle_Reset(struct Particle* p, Vector3 pos, Vector3 velocity, float lifetime) {
-	p->LastPos = pos; p->NextPos = pos;
-	p->Velocity = velocity;
-	p->Lifetime = lifetime;
-}
-
 static bool Particle_CanPass(BlockID block, bool throughLiquids) {
 	uint8_t draw = Blocks.Draw[block];
 	return draw == DRAW_GAS || draw == DRAW_SPRITE || (throughLiquids && Blocks.IsLiquid[block]);
 }
 
-static bool Particle_CollideHor(Vector3* nextPos, BlockID block) {
-	Vector3 horPos = Vector3_Create3((float)Math_Floor(nextPos->X), 0.0f, (float)Math_Floor(nextPos->Z));
+static bool Particle_CollideHor(float x, float z, BlockID block) {
+	Vector3 horPos = Vector3_Create3((float)Math_Floor(x), 0.0f, (float)Math_Floor(z));
 	Vector3 min, max;
 	Vector3_Add(&min, &Blocks.MinBB[block], &horPos);
 	Vector3_Add(&max, &Blocks.MaxBB[block], &horPos);
-	return nextPos->X >= min.X && nextPos->Z >= min.Z && nextPos->X < max.X && nextPos->Z < max.Z;
+	return x >= min.X && z >= min.Z && x < max.X && z < max.Z;
 }
 
+/* Particles are spawned in runs from the same block, and the stuck test and first collision test */
+/* of a falling particle look at the same cell, so most lookups are the same as the previous one. */
+static struct ParticleBlockCache { int X, Y, Z; BlockID Block; bool Valid; } particle_cache;
+
 static BlockID Particle_GetBlock(int x, int y, int z) {
-	if (World_Contains(x, y, z)) { return World_GetBlock(x, y, z); }
+	struct ParticleBlockCache* c = &particle_cache;
+	BlockID block;
+	if (c->Valid && c->X == x && c->Y == y && c->Z == z) return c->Block;
+
+	if (World_Contains(x, y, z)) { 
+		block = World_GetBlock(x, y, z); 
+	} else if (y >= Env.EdgeHeight) {
+		block = BLOCK_AIR;
+	} else if (y >= Env_SidesHeight) {
+		block = Env.EdgeBlock;
+	} else {
+		block = Env.SidesBlock;
+	}
 
-	if (y >= Env.EdgeHeight) return BLOCK_AIR;
-	if (y >= Env_SidesHeight) return Env.EdgeBlock;
-	return Env.SidesBlock;
+	c->X = x; c->Y = y; c->Z = z; c->Block = block; c->Valid = true;
+	return block;
 }
 
-static bool Particle_TestY(struct Particle* p, int y, bool topFace, bool throughLiquids) {
+static bool Particle_TestY(struct ParticlePool* pool, int i, int y, bool topFace, bool throughLiquids) {
 	BlockID block;
 	Vector3 minBB, maxBB;
 	float collideY;
 	bool collideVer;
 
 	if (y < 0) {
-		p->NextPos.Y = ENTITY_ADJUSTMENT; p->LastPos.Y = ENTITY_ADJUSTMENT;
-		p->Velocity  = Vector3_Zero();
-		particle_hitTerrain = true;
+		pool->NextY[i] = ENTITY_ADJUSTMENT; pool->LastY[i] = ENTITY_ADJUSTMENT;
+		pool->VelX[i]  = 0.0f; pool->VelY[i] = 0.0f; pool->VelZ[i] = 0.0f;
 		return false;
 	}
 
-	block = Particle_GetBlock((int)p->NextPos.X, y, (int)p->NextPos.Z);
+	block = Particle_GetBlock((int)pool->NextX[i], y, (int)pool->NextZ[i]);
 	if (Particle_CanPass(block, throughLiquids)) return true;
 	minBB = Blocks.MinBB[block]; maxBB = Blocks.MaxBB[block];
 
 	collideY   = y + (topFace ? maxBB.Y : minBB.Y);
-	collideVer = topFace ? (p->NextPos.Y < collideY) : (p->NextPos.Y > collideY);
+	collideVer = topFace ? (pool->NextY[i] < collideY) : (pool->NextY[i] > collideY);
 
-	if (collideVer && Particle_CollideHor(&p->NextPos, block)) {
+	if (collideVer && Particle_CollideHor(pool->NextX[i], pool->NextZ[i], block)) {
 		float adjust = topFace ? ENTITY_ADJUSTMENT : -ENTITY_ADJUSTMENT;
-		p->LastPos.Y = collideY + adjust;
-		p->NextPos.Y = p->LastPos.Y;
-		p->Velocity  = Vector3_Zero();
-		particle_hitTerrain = true;
+		pool->LastY[i] = collideY + adjust;
+		pool->NextY[i] = pool->LastY[i];
+		pool->VelX[i]  = 0.0f; pool->VelY[i] = 0.0f; pool->VelZ[i] = 0.0f;
 		return false;
 	}
 	return true;
 }
 
-static bool Particle_PhysicsTick(struct Particle* p, float gravity, bool throughLiquids, double delta) {
+/* Moves all particles in the pool, and sets Dead for particles which should be removed. */
+/* If dieOnHit is true, particles which land on a block are also removed. */
+static void Particle_PhysicsTick(struct ParticlePool* pool, float gravity, bool throughLiquids, bool dieOnHit, double delta) {
 	BlockID cur;
-	float minY, maxY;
-	Vector3 velocity;
-	int y, begY, endY;
-
-	p->LastPos = p->NextPos;
-	cur  = Particle_GetBlock((int)p->NextPos.X, (int)p->NextPos.Y, (int)p->NextPos.Z);
-	minY = Math_Floor(p->NextPos.Y) + Blocks.MinBB[cur].Y;
-	maxY = Math_Floor(p->NextPos.Y) + Blocks.MaxBB[cur].Y;
+	float minY, maxY, x, y, z;
+	float dt = (float)delta, accel = gravity * dt, step = dt * 3.0f;
+	int i, count = pool->Count;
+	int cy, begY, endY;
+	bool hit;
+	particle_cache.Valid = false;
+
+	/* Particles stuck inside a block are removed */
+	for (i = 0; i < count; i++) {
+		x = pool->NextX[i]; y = pool->NextY[i]; z = pool->NextZ[i];
+
+		cur  = Particle_GetBlock((int)x, (int)y, (int)z);
+		minY = Math_Floor(y) + Blocks.MinBB[cur].Y;
+		maxY = Math_Floor(y) + Blocks.MaxBB[cur].Y;
+
+		pool->Dead[i] = !Particle_CanPass(cur, throughLiquids) && y >= minY
+			&& y < maxY && Particle_CollideHor(x, z, cur);
+	}
 
-	if (!Particle_CanPass(cur, throughLiquids) && p->NextPos.Y >= minY
-		&& p->NextPos.Y < maxY && Particle_CollideHor(&p->NextPos, cur)) {
-		return true;
+	/* Straight loop over the arrays, so that the compiler can vectorise it */
+	for (i = 0; i < count; i++) {
+		pool->LastX[i] = pool->NextX[i];
+		pool->LastY[i] = pool->NextY[i];
+		pool->LastZ[i] = pool->NextZ[i];
+
+		pool->VelY[i] -= accel;
+		pool->NextX[i] += pool->VelX[i] * step;
+		pool->NextY[i] += pool->VelY[i] * step;
+		pool->NextZ[i] += pool->VelZ[i] * step;
+		pool->Lifetime[i] -= dt;
 	}
 
-	p->Velocity.Y -= gravity * (float)delta;
-	begY = Math_Floor(p->NextPos.Y);
-	
-	Vector3_Mul1(&velocity, &p->Velocity, (float)delta * 3.0f);
-	Vector3_Add(&p->NextPos, &p->NextPos, &velocity);
-	endY = Math_Floor(p->NextPos.Y);
+	for (i = 0; i < count; i++) {
+		if (pool->Dead[i]) continue;
+		begY = Math_Floor(pool->LastY[i]);
+		endY = Math_Floor(pool->NextY[i]);
+		hit  = false;
 
-	if (p->Velocity.Y > 0.0f) {
-		/* don't test block we are already in */
-		for (y = begY + 1; y <= endY && Particle_TestY(p, y, false, throughLiquids); y++) {}
-	} else {
-		for (y = begY; y >= endY && Particle_TestY(p, y, true, throughLiquids); y--) {}
+		if (pool->VelY[i] > 0.0f) {
+			/* don't test block we are already in */
+			for (cy = begY + 1; cy <= endY; cy++) {
+				if (!Particle_TestY(pool, i, cy, false, throughLiquids)) { hit = true; break; }
+			}
+		} else {
+			for (cy = begY; cy >= endY; cy--) {
+				if (!Particle_TestY(pool, i, cy, true, throughLiquids))  { hit = true; break; }
+			}
+		}
+		pool->Dead[i] = pool->Lifetime[i] < 0.0f || (hit && dieOnHit);
 	}
-
-	p->Lifetime -= (float)delta;
-	return p->Lifetime < 0.0f;
 }
 
 
 /*########################################################################################################################*
 *-------------------------------------------------------Rain particle-----------------------------------------------------*
 *#########################################################################################################################*/
-struct RainParticle { struct Particle Base; };
-
-static struct RainParticle rain_Particles[PARTICLES_MAX];
-static int rain_count;
+static struct ParticlePool rain;
 static TextureRec rain_rec = { 2.0f/128.0f, 14.0f/128.0f, 5.0f/128.0f, 16.0f/128.0f };
 
-static bool RainParticle_Tick(struct RainParticle* p, double delta) {
-	particle_hitTerrain = false;
-	return Particle_PhysicsTick(&p->Base, 3.5f, false, delta) || particle_hitTerrain;
-}
-
-static void RainParticle_Render(struct RainParticle* p, float t, VertexP3fT2fC4b* vertices) {
+static void RainParticle_Render(int i, float t, VertexP3fT2fC4b* vertices) {
 	Vector3 pos;
 	Vector2 size;
 	PackedCol col;
 	int x, y, z;
 
-	Vector3_Lerp(&pos, &p->Base.LastPos, &p->Base.NextPos, t);
-	size.X = (float)p->Base.Size * 0.015625f; size.Y = size.X;
+	Particle_GetPos(&rain, i, t, &pos);
+	size.X = (float)rain.Size[i] * 0.015625f; size.Y = size.X;
 
 	x = Math_Floor(pos.X); y = Math_Floor(pos.Y); z = Math_Floor(pos.Z);
 	col = World_Contains(x, y, z) ? Lighting_Col(x, y, z) : Env.SunCol;
@@ -170,37 +269,27 @@ static void RainParticle_Render(struct RainParticle* p, float t, VertexP3fT2fC4b
 }
 
 static void Rain_Render(float t) {
-	VertexP3fT2fC4b vertices[PARTICLES_MAX * 4];
 	VertexP3fT2fC4b* ptr;
 	int i;
-	if (!rain_count) return;
+	if (!rain.Count) return;
 	
-	ptr = vertices;
-	for (i = 0; i < rain_count; i++) {
-		RainParticle_Render(&rain_Particles[i], t, ptr);
+	ptr = particles_vertices;
+	for (i = 0; i < rain.Count; i++) {
+		RainParticle_Render(i, t, ptr);
 		ptr += 4;
 	}
 
 	Gfx_BindTexture(Particles_TexId);
-	Gfx_UpdateDynamicVb_IndexedTris(Particles_VB, vertices, rain_count * 4);
-}
-
-static void Rain_RemoveAt(int index) {
-	struct RainParticle removed = rain_Particles[index];
-	int i;
-
-	for (i = index; i < rain_count - 1; i++) {
-		rain_Particles[i] = rain_Particles[i + 1];
-	}
-	rain_Particles[rain_count - 1] = removed;
-	rain_count--;
+	Gfx_UpdateDynamicVb_IndexedTris(Particles_VB, particles_vertices, rain.Count * 4);
 }
 
 static void Rain_Tick(double delta) {
 	int i;
-	for (i = 0; i < rain_count; i++) {
-		if (RainParticle_Tick(&rain_Particles[i], delta)) {
-			Rain_RemoveAt(i); i--;
+	Particle_PhysicsTick(&rain, 3.5f, false, true, delta);
+
+	for (i = 0; i < rain.Count; i++) {
+		if (rain.Dead[i]) {
+			ParticlePool_RemoveAt(&rain, i); i--;
 		}
 	}
 }
@@ -209,43 +298,35 @@ static void Rain_Tick(double delta) {
 /*########################################################################################################################*
 *------------------------------------------------------Terrain particle---------------------------------------------------*
 *#########################################################################################################################*/
-struct TerrainParticle {
-	struct Particle Base;
-	TextureRec Rec;
-	TextureLoc TexLoc;
-	BlockID Block;
-};
-
-static struct TerrainParticle terrain_particles[PARTICLES_MAX];
-static int terrain_count;
-static uint16_t terrain_1DCount[ATLAS1D_MAX_ATLASES];
-static uint16_t terrain_1DIndices[ATLAS1D_MAX_ATLASES];
-
-static bool TerrainParticle_Tick(struct TerrainParticle* p, double delta) {
-	return Particle_PhysicsTick(&p->Base, 5.4f, true, delta);
-}
-
-static void TerrainParticle_Render(struct TerrainParticle* p, float t, VertexP3fT2fC4b* vertices) {
+static struct ParticlePool terrain;
+static TextureRec* terrain_recs;
+static TextureLoc* terrain_texLocs;
+static BlockID* terrain_blocks;
+static int terrain_1DCount[ATLAS1D_MAX_ATLASES];
+static int terrain_1DIndices[ATLAS1D_MAX_ATLASES];
+
+static void TerrainParticle_Render(int i, float t, VertexP3fT2fC4b* vertices) {
 	PackedCol col = PACKEDCOL_WHITE;
+	BlockID block = terrain_blocks[i];
 	Vector3 pos;
 	Vector2 size;
 	int x, y, z;
 
-	Vector3_Lerp(&pos, &p->Base.LastPos, &p->Base.NextPos, t);
-	size.X = (float)p->Base.Size * 0.015625f; size.Y = size.X;
+	Particle_GetPos(&terrain, i, t, &pos);
+	size.X = (float)terrain.Size[i] * 0.015625f; size.Y = size.X;
 	
-	if (!Blocks.FullBright[p->Block]) {
+	if (!Blocks.FullBright[block]) {
 		x = Math_Floor(pos.X); y = Math_Floor(pos.Y); z = Math_Floor(pos.Z);
 		col = World_Contains(x, y, z) ? Lighting_Col_XSide(x, y, z) : Env.SunXSide;
 	}
 
-	if (Blocks.Tinted[p->Block]) {
-		PackedCol tintCol = Blocks.FogCol[p->Block];
+	if (Blocks.Tinted[block]) {
+		PackedCol tintCol = Blocks.FogCol[block];
 		col.R = (uint8_t)(col.R * tintCol.R / 255);
 		col.G = (uint8_t)(col.G * tintCol.G / 255);
 		col.B = (uint8_t)(col.B * tintCol.B / 255);
 	}
-	Particle_DoRender(&size, &pos, &p->Rec, col, vertices);
+	Particle_DoRender(&size, &pos, &terrain_recs[i], col, vertices);
 }
 
 static void Terrain_Update1DCounts(void) {
@@ -255,8 +336,8 @@ static void Terrain_Update1DCounts(void) {
 		terrain_1DCount[i]   = 0;
 		terrain_1DIndices[i] = 0;
 	}
-	for (i = 0; i < terrain_count; i++) {
-		index = Atlas1D_Index(terrain_particles[i].TexLoc);
+	for (i = 0; i < terrain.Count; i++) {
+		index = Atlas1D_Index(terrain_texLocs[i]);
 		terrain_1DCount[index] += 4;
 	}
 	for (i = 1; i < Atlas1D.Count; i++) {
@@ -265,22 +346,21 @@ static void Terrain_Update1DCounts(void) {
 }
 
 static void Terrain_Render(float t) {
-	VertexP3fT2fC4b vertices[PARTICLES_MAX * 4];
 	VertexP3fT2fC4b* ptr;
 	int offset = 0;
 	int i, index;
-	if (!terrain_count) return;
+	if (!terrain.Count) return;
 
 	Terrain_Update1DCounts();
-	for (i = 0; i < terrain_count; i++) {
-		index = Atlas1D_Index(terrain_particles[i].TexLoc);
-		ptr   = &vertices[terrain_1DIndices[index]];
+	for (i = 0; i < terrain.Count; i++) {
+		index = Atlas1D_Index(terrain_texLocs[i]);
+		ptr   = &particles_vertices[terrain_1DIndices[index]];
 
-		TerrainParticle_Render(&terrain_particles[i], t, ptr);
+		TerrainParticle_Render(i, t, ptr);
 		terrain_1DIndices[index] += 4;
 	}
 
-	Gfx_SetDynamicVbData(Particles_VB, vertices, terrain_count * 4);
+	Gfx_SetDynamicVbData(Particles_VB, particles_vertices, terrain.Count * 4);
 	for (i = 0; i < Atlas1D.Count; i++) {
 		int partCount = terrain_1DCount[i];
 		if (!partCount) continue;
@@ -292,20 +372,20 @@ static void Terrain_Render(float t) {
 }
 
 static void Terrain_RemoveAt(int index) {
-	struct TerrainParticle removed = terrain_particles[index];
-	int i;
+	int last = terrain.Count - 1;
+	ParticlePool_RemoveAt(&terrain, index);
 
-	for (i = index; i < terrain_count - 1; i++) {
-		terrain_particles[i] = terrain_particles[i + 1];
-	}
-	terrain_particles[terrain_count - 1] = removed;
-	terrain_count--;
+	terrain_recs[index]    = terrain_recs[last];
+	terrain_texLocs[index] = terrain_texLocs[last];
+	terrain_blocks[index]  = terrain_blocks[last];
 }
 
 static void Terrain_Tick(double delta) {
 	int i;
-	for (i = 0; i < terrain_count; i++) {
-		if (TerrainParticle_Tick(&terrain_particles[i], delta)) {
+	Particle_PhysicsTick(&terrain, 5.4f, true, false, delta);
+
+	for (i = 0; i < terrain.Count; i++) {
+		if (terrain.Dead[i]) {
 			Terrain_RemoveAt(i); i--;
 		}
 	}
@@ -322,7 +402,7 @@ static void Particles_FileChanged(void* obj, struct Stream* stream, const String
 }
 
 void Particles_Render(double delta, float t) {
-	if (!terrain_count && !rain_count) return;
+	if (!terrain.Count && !rain.Count) return;
 	if (Gfx.LostContext) return;
 
 	Gfx_SetTexturing(true);
@@ -342,7 +422,6 @@ void Particles_Tick(struct ScheduledTask* task) {
 }
 
 void Particles_BreakBlockEffect(Vector3I coords, BlockID old, BlockID now) {
-	struct TerrainParticle* p;
 	TextureLoc loc;
 	int texIndex;
 	TextureRec baseRec, rec;
@@ -361,7 +440,7 @@ void Particles_BreakBlockEffect(Vector3I coords, BlockID old, BlockID now) {
 	/* per-particle variables */
 	Vector3 velocity;
 	float life;
-	int x, y, z, type;
+	int x, y, z, type, i;
 
 	if (now != BLOCK_AIR || Blocks.Draw[old] == DRAW_GAS) return;
 	Vector3I_ToVector3(&origin, &coords);
@@ -409,28 +488,26 @@ void Particles_BreakBlockEffect(Vector3I coords, BlockID old, BlockID now) {
 				rec.U2 = min(rec.U2, maxU2) - 0.01f * uScale;
 				rec.V2 = min(rec.V2, maxV2) - 0.01f * vScale;
 
-				if (terrain_count == PARTICLES_MAX) Terrain_RemoveAt(0);
-				p = &terrain_particles[terrain_count++];
+				i = ParticlePool_Add(&terrain);
 
 				life = 0.3f + Random_Float(&rnd) * 1.2f;
 				Vector3_Add(&pos, &origin, &cell);
-				Particle_Reset(&p->Base, pos, velocity, life);
+				Particle_Reset(&terrain, i, pos, velocity, life);
 
-				p->Rec    = rec;
-				p->TexLoc = loc;
-				p->Block  = old;
+				terrain_recs[i]    = rec;
+				terrain_texLocs[i] = loc;
+				terrain_blocks[i]  = old;
 				type = Random_Range(&rnd, 0, 30);
-				p->Base.Size = (uint8_t)(type >= 28 ? 12 : (type >= 25 ? 10 : 8));
+				terrain.Size[i] = (uint8_t)(type >= 28 ? 12 : (type >= 25 ? 10 : 8));
 			}
 		}
 	}
 }
 
 void Particles_RainSnowEffect(Vector3 pos) {
-	struct RainParticle* p;
 	Vector3 origin = pos;
 	Vector3 offset, velocity;
-	int i, type;
+	int i, j, type;
 
 	for (i = 0; i < 2; i++) {
 		velocity.X = Random_Float(&rnd) * 0.8f - 0.4f; /* [-0.4, 0.4] */
@@ -441,14 +518,13 @@ void Particles_RainSnowEffect(Vector3 pos) {
 		offset.Y = Random_Float(&rnd) * 0.1f + 0.01f;
 		offset.Z = Random_Float(&rnd);
 
-		if (rain_count == PARTICLES_MAX) Rain_RemoveAt(0);
-		p = &rain_Particles[rain_count++];
+		j = ParticlePool_Add(&rain);
 
 		Vector3_Add(&pos, &origin, &offset);
-		Particle_Reset(&p->Base, pos, velocity, 40.0f);
+		Particle_Reset(&rain, j, pos, velocity, 40.0f);
 
 		type = Random_Range(&rnd, 0, 30);
-		p->Base.Size = (uint8_t)(type >= 28 ? 2 : (type >= 25 ? 4 : 3));
+		rain.Size[j] = (uint8_t)(type >= 28 ? 2 : (type >= 25 ? 4 : 3));
 	}
 }
 
@@ -460,15 +536,26 @@ static void Particles_ContextLost(void* obj) {
 	Gfx_DeleteVb(&Particles_VB); 
 }
 static void Particles_ContextRecreated(void* obj) {
-	Particles_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_P3FT2FC4B, PARTICLES_MAX * 4);
+	Particles_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_P3FT2FC4B, particles_capacity * 4);
 }
 static void Particles_BreakBlockEffect_Handler(void* obj, Vector3I coords, BlockID old, BlockID now) {
 	Particles_BreakBlockEffect(coords, old, now);
 }
 
 static void Particles_Init(void) {
+	int cap;
 	ScheduledTask_Add(GAME_DEF_TICKS, Particles_Tick);
 	Random_SeedFromCurrentTime(&rnd);
+
+	cap = Options_GetInt(OPT_MAX_PARTICLES, 100, PARTICLES_MAX_CAPACITY, PARTICLES_DEF_CAPACITY);
+	particles_capacity = cap;
+	particles_vertices = (VertexP3fT2fC4b*)Mem_Alloc(cap * 4, sizeof(VertexP3fT2fC4b), "particle vertices");
+
+	ParticlePool_Alloc(&rain);
+	ParticlePool_Alloc(&terrain);
+	terrain_recs    = (TextureRec*)Mem_Alloc(cap, sizeof(TextureRec), "particle recs");
+	terrain_texLocs = (TextureLoc*)Mem_Alloc(cap, sizeof(TextureLoc), "particle texlocs");
+	terrain_blocks  = (BlockID*)Mem_Alloc(cap,    sizeof(BlockID),    "particle blocks");
 	Particles_ContextRecreated(NULL);	
 
 	Event_RegisterBlock(&UserEvents.BlockChanged,   NULL, Particles_BreakBlockEffect_Handler);
@@ -481,13 +568,23 @@ static void Particles_Free(void) {
 	Gfx_DeleteTexture(&Particles_TexId);
 	Particles_ContextLost(NULL);
 
+	ParticlePool_Free(&rain);
+	ParticlePool_Free(&terrain);
+	Mem_Free(terrain_recs);       terrain_recs       = NULL;
+	Mem_Free(terrain_texLocs);    terrain_texLocs    = NULL;
+	Mem_Free(terrain_blocks);     terrain_blocks     = NULL;
+	Mem_Free(particles_vertices); particles_vertices = NULL;
+
 	Event_UnregisterBlock(&UserEvents.BlockChanged,   NULL, Particles_BreakBlockEffect_Handler);
 	Event_UnregisterEntry(&TextureEvents.FileChanged, NULL, Particles_FileChanged);
 	Event_UnregisterVoid(&GfxEvents.ContextLost,      NULL, Particles_ContextLost);
 	Event_UnregisterVoid(&GfxEvents.ContextRecreated, NULL, Particles_ContextRecreated);
 }
 
-static void Particles_Reset(void) { rain_count = 0; terrain_count = 0; }
+static void Particles_Reset(void) { 
+	rain.Count    = 0; rain.Evict    = 0;
+	terrain.Count = 0; terrain.Evict = 0;
+}
 
 struct IGameComponent Particles_Component = {
 	Particles_Init,  /* Init  */
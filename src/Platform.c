@@ -99,18 +99,21 @@ const ReturnCode ReturnCode_SocketWouldBlock = EWOULDBLOCK;
 #include <sys/filio.h>
 #endif
 /* Platform specific include files */
-#if defined CC_BUILD_UNIX
-#include <AL/al.h>
-#include <AL/alc.h>
-#elif defined CC_BUILD_OSX
+#if defined CC_BUILD_OSX
 #include <mach/mach_time.h>
 #include <mach-o/dyld.h>
-#include <OpenAL/al.h>
-#include <OpenAL/alc.h>
 #elif defined CC_BUILD_WEB
 #include <emscripten.h>
+#endif
+
+#if defined CC_BUILD_NOAUDIO
+/* No OpenAL headers needed */
+#elif defined CC_BUILD_UNIX || defined CC_BUILD_WEB
 #include <AL/al.h>
 #include <AL/alc.h>
+#elif defined CC_BUILD_OSX
+#include <OpenAL/al.h>
+#include <OpenAL/alc.h>
 #endif
 
 
@@ -144,6 +147,11 @@ void* Mem_AllocCleared(uint32_t numElems, uint32_t elemsSize, const char* place)
 	return ptr;
 }
 
+void* Mem_TryAlloc(uint32_t numElems, uint32_t elemsSize) {
+	uint32_t numBytes = numElems * elemsSize; /* TODO: avoid overflow here */
+	return HeapAlloc(heap, 0, numBytes);
+}
+
 void* Mem_Realloc(void* mem, uint32_t numElems, uint32_t elemsSize, const char* place) {
 	uint32_t numBytes = numElems * elemsSize; /* TODO: avoid overflow here */
 	void* ptr = HeapReAlloc(heap, 0, mem, numBytes);
@@ -168,6 +176,10 @@ void* Mem_AllocCleared(uint32_t numElems, uint32_t elemsSize, const char* place)
 	return ptr;
 }
 
+void* Mem_TryAlloc(uint32_t numElems, uint32_t elemsSize) {
+	return malloc(numElems * elemsSize); /* TODO: avoid overflow here */
+}
+
 void* Mem_Realloc(void* mem, uint32_t numElems, uint32_t elemsSize, const char* place) {
 	void* ptr = realloc(mem, numElems * elemsSize); /* TODO: avoid overflow here */
 	if (!ptr) Platform_AllocFailed(place);
@@ -756,9 +768,12 @@ void Mutex_Unlock(void* handle) {
 	if (res) Logger_Abort2(res, "Unlocking mutex");
 }
 
+/* NOTE: Signalled is needed so a signal raised before another thread starts waiting isn't lost, */
+/* which makes this behave like an auto-reset event on Windows */
 struct WaitData {
 	pthread_cond_t  cond;
 	pthread_mutex_t mutex;
+	bool signalled;
 };
 
 void* Waitable_Create(void) {
@@ -769,6 +784,7 @@ void* Waitable_Create(void) {
 	if (res) Logger_Abort2(res, "Creating waitable");
 	res = pthread_mutex_init(&ptr->mutex, NULL);
 	if (res) Logger_Abort2(res, "Creating waitable mutex");
+	ptr->signalled = false;
 	return ptr;
 }
 
@@ -785,7 +801,12 @@ void Waitable_Free(void* handle) {
 
 void Waitable_Signal(void* handle) {
 	struct WaitData* ptr = handle;
-	int res = pthread_cond_signal(&ptr->cond);
+	int res;
+
+	Mutex_Lock(&ptr->mutex);
+	ptr->signalled = true;
+	res = pthread_cond_signal(&ptr->cond);
+	Mutex_Unlock(&ptr->mutex);
 	if (res) Logger_Abort2(res, "Signalling event");
 }
 
@@ -794,8 +815,11 @@ void Waitable_Wait(void* handle) {
 	int res;
 
 	Mutex_Lock(&ptr->mutex);
-	res = pthread_cond_wait(&ptr->cond, &ptr->mutex);
-	if (res) Logger_Abort2(res, "Waitable wait");
+	while (!ptr->signalled) {
+		res = pthread_cond_wait(&ptr->cond, &ptr->mutex);
+		if (res) Logger_Abort2(res, "Waitable wait");
+	}
+	ptr->signalled = false;
 	Mutex_Unlock(&ptr->mutex);
 }
 
@@ -813,8 +837,12 @@ void Waitable_WaitFor(void* handle, uint32_t milliseconds) {
 	ts.tv_nsec %= NS_PER_SEC;
 
 	Mutex_Lock(&ptr->mutex);
-	res = pthread_cond_timedwait(&ptr->cond, &ptr->mutex, &ts);
-	if (res && res != ETIMEDOUT) Logger_Abort2(res, "Waitable wait for");
+	while (!ptr->signalled) {
+		res = pthread_cond_timedwait(&ptr->cond, &ptr->mutex, &ts);
+		if (res == ETIMEDOUT) break;
+		if (res) Logger_Abort2(res, "Waitable wait for");
+	}
+	ptr->signalled = false;
 	Mutex_Unlock(&ptr->mutex);
 }
 #endif
@@ -1431,7 +1459,44 @@ ReturnCode Socket_Poll(SocketHandle socket, int mode, bool* success) {
 *----------------------------------------------------------Audio----------------------------------------------------------*
 *#########################################################################################################################*/
 static ReturnCode Audio_AllCompleted(AudioHandle handle, bool* finished);
-#ifdef CC_BUILD_WIN
+#if defined CC_BUILD_NOAUDIO
+/* Null backend that discards all audio data, useful for testing on machines without audio output */
+struct AudioContext { struct AudioFormat Format; int Count; };
+static struct AudioContext Audio_Contexts[20];
+
+void Audio_Init(AudioHandle* handle, int buffers) {
+	int i;
+	for (i = 0; i < Array_Elems(Audio_Contexts); i++) {
+		if (Audio_Contexts[i].Count) continue;
+
+		*handle = i;
+		Audio_Contexts[i].Count = buffers;
+		return;
+	}
+	Logger_Abort("No free audio contexts");
+}
+
+ReturnCode Audio_Free(AudioHandle handle) {
+	struct AudioFormat fmt = { 0 };
+	Audio_Contexts[handle].Count  = 0;
+	Audio_Contexts[handle].Format = fmt;
+	return 0;
+}
+
+ReturnCode Audio_SetFormat(AudioHandle handle, struct AudioFormat* format) {
+	Audio_Contexts[handle].Format = *format; return 0;
+}
+
+ReturnCode Audio_BufferData(AudioHandle handle, int idx, void* data, uint32_t dataSize) { return 0; }
+ReturnCode Audio_Play(AudioHandle handle) { return 0; }
+ReturnCode Audio_Stop(AudioHandle handle) { return 0; }
+
+ReturnCode Audio_IsCompleted(AudioHandle handle, int idx, bool* completed) {
+	*completed = true; return 0;
+}
+
+ReturnCode Audio_IsFinished(AudioHandle handle, bool* finished) { return Audio_AllCompleted(handle, finished); }
+#elif defined CC_BUILD_WIN
 struct AudioContext {
 	HWAVEOUT Handle;
 	WAVEHDR Headers[AUDIO_MAX_BUFFERS];
@@ -1534,8 +1599,7 @@ ReturnCode Audio_IsCompleted(AudioHandle handle, int idx, bool* completed) {
 }
 
 ReturnCode Audio_IsFinished(AudioHandle handle, bool* finished) { return Audio_AllCompleted(handle, finished); }
-#endif
-#ifdef CC_BUILD_POSIX
+#elif defined CC_BUILD_POSIX
 struct AudioContext {
 	ALuint Source;
 	ALuint Buffers[AUDIO_MAX_BUFFERS];
@@ -2156,11 +2220,15 @@ static void Platform_InitCommon(void) {
 	signal(SIGCHLD, SIG_IGN);
 	/* So writing to closed socket doesn't raise SIGPIPE */
 	signal(SIGPIPE, SIG_IGN);
+#ifndef CC_BUILD_NOAUDIO
 	pthread_mutex_init(&audio_lock, NULL);
+#endif
 }
 
 void Platform_Free(void) {
+#ifndef CC_BUILD_NOAUDIO
 	pthread_mutex_destroy(&audio_lock);
+#endif
 }
 
 ReturnCode Platform_SetCurrentDirectory(const String* path) {
@@ -87,6 +87,9 @@ bool DynamicLib_DescribeError(ReturnCode res, String* dst);
 CC_API void* Mem_Alloc(uint32_t numElems, uint32_t elemsSize, const char* place);
 /* Allocates a block of memory, with contents of all 0. Exits process on allocation failure. */
 CC_API void* Mem_AllocCleared(uint32_t numElems, uint32_t elemsSize, const char* place);
+/* Allocates a block of memory, with undetermined contents. Returns NULL on allocation failure. */
+/* NOTE: Only use this for large allocations where running out of memory can be reported to the user. */
+CC_API void* Mem_TryAlloc(uint32_t numElems, uint32_t elemsSize);
 /* Reallocates a block of memory, with undetermined contents. Exits process on reallocation failure. */
 CC_API void* Mem_Realloc(void* mem, uint32_t numElems, uint32_t elemsSize, const char* place);
 /* Frees an allocated a block of memory. Does nothing when passed NULL. */
@@ -250,7 +250,7 @@ static ReturnCode ZipPatcher_FixupLocalFile(struct Stream* s, struct ResourceTex
 	String name = String_FromReadonly(e->Filename);
 	uint8_t tmp[2048];
 	uint32_t dataBeg, dataEnd;
-	uint32_t i, crc, toRead, read;
+	uint32_t crc, toRead, read;
 	ReturnCode res;
 
 	dataBeg = e->Offset + 30 + name.length;
@@ -268,9 +268,7 @@ static ReturnCode ZipPatcher_FixupLocalFile(struct Stream* s, struct ResourceTex
 		if ((res = s->Read(s, tmp, toRead, &read))) return res;
 		if (!read) return ERR_END_OF_STREAM;
 
-		for (i = 0; i < read; i++) {
-			crc = Utils_Crc32Table[(crc ^ tmp[i]) & 0xFF] ^ (crc >> 8);
-		}
+		crc = Utils_Crc32Update(crc, tmp, read);
 	}
 	e->Crc32 = crc ^ 0xffffffffUL;
 
@@ -315,7 +313,7 @@ static ReturnCode ZipPatcher_WritePng(struct Stream* s, struct ResourceTexture*
 	ReturnCode res;
 
 	if ((res = ZipPatcher_LocalFile(s, tex)))   return res;
-	if ((res = Png_Encode(src, s, NULL, true))) return res;
+	if ((res = Png_EncodeEx(src, s, NULL, true, DEFLATE_LEVEL_MAX))) return res;
 	return ZipPatcher_FixupLocalFile(s, tex);
 }
 
@@ -405,18 +403,14 @@ CC_NOINLINE static struct TilePatch* ModernPatcher_GetTile(const String* path) {
 }
 
 static ReturnCode ModernPatcher_PatchTile(struct Stream* data, struct TilePatch* tile) {
-	Bitmap bmp;
 	ReturnCode res;
-
-	if ((res = Png_Decode(&bmp, data))) return res;
-	Bitmap_CopyBlock(0, 0, tile->X1 * 16, tile->Y1 * 16, &bmp, &terrainBmp, 16);
+	/* tiles are 16x16, so can be decoded straight into terrain.png */
+	if ((res = Png_DecodeInto(&terrainBmp, tile->X1 * 16, tile->Y1 * 16, data))) return res;
 
 	/* only quartz needs copying to two tiles */
 	if (tile->Y2) {
-		Bitmap_CopyBlock(0, 0, tile->X2 * 16, tile->Y2 * 16, &bmp, &terrainBmp, 16);
+		Bitmap_CopyBlock(tile->X1 * 16, tile->Y1 * 16, tile->X2 * 16, tile->Y2 * 16, &terrainBmp, &terrainBmp, 16);
 	}
-
-	Mem_Free(bmp.Scan0);
 	return 0;
 }
 
@@ -697,6 +697,89 @@ struct Screen* GeneratingScreen_MakeInstance(void) {
 }
 
 
+/*########################################################################################################################*
+*----------------------------------------------------LoadingMapScreen-----------------------------------------------------*
+*#########################################################################################################################*/
+static String mapTask_path; static char mapTask_pathBuffer[FILENAME_SIZE];
+static IMapExporter mapTask_exporter;
+
+static void LoadingMapScreen_Init(void* screen) {
+	LoadingScreen_Init(screen);
+	Map_BeginLoad(&mapTask_path);
+}
+
+static void LoadingMapScreen_Render(void* screen, double delta) {
+	struct LoadingScreen* s = screen;
+	LoadingScreen_Render(s, delta);
+
+	if (Map_TaskDone) {
+		Gui_CloseActive();
+		Map_EndLoad(); return;
+	}
+	s->Progress = Map_TaskProgress;
+}
+
+static struct ScreenVTABLE LoadingMapScreen_VTABLE = {
+	LoadingMapScreen_Init,   LoadingMapScreen_Render, LoadingScreen_Free,      Gui_DefaultRecreate,
+	LoadingScreen_KeyDown,   LoadingScreen_KeyUp,     LoadingScreen_KeyPress,
+	LoadingScreen_MouseDown, LoadingScreen_MouseUp,   LoadingScreen_MouseMove, LoadingScreen_MouseScroll,
+	LoadingScreen_OnResize,  LoadingScreen_ContextLost, LoadingScreen_ContextRecreated,
+};
+struct Screen* LoadingMapScreen_MakeInstance(const String* path) {
+	const static String title   = String_FromConst("Loading level");
+	const static String message = String_FromConst("Loading..");
+
+	struct Screen* s = LoadingScreen_MakeInstance(&title, &message);
+	s->VTABLE = &LoadingMapScreen_VTABLE;
+
+	String_InitArray(mapTask_path, mapTask_pathBuffer);
+	String_Copy(&mapTask_path, path);
+	return s;
+}
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------SavingMapScreen-----------------------------------------------------*
+*#########################################################################################################################*/
+static void SavingMapScreen_Init(void* screen) {
+	LoadingScreen_Init(screen);
+	Map_BeginSave(&mapTask_path, mapTask_exporter);
+}
+
+static void SavingMapScreen_Render(void* screen, double delta) {
+	struct LoadingScreen* s = screen;
+	bool saved;
+	LoadingScreen_Render(s, delta);
+
+	if (Map_TaskDone) {
+		Gui_CloseActive();
+		saved = Map_EndSave();
+		Gui_SetActive(saved ? PauseScreen_MakeInstance() : SaveLevelScreen_MakeInstance());
+		return;
+	}
+	s->Progress = Map_TaskProgress;
+}
+
+static struct ScreenVTABLE SavingMapScreen_VTABLE = {
+	SavingMapScreen_Init,    SavingMapScreen_Render,  LoadingScreen_Free,      Gui_DefaultRecreate,
+	LoadingScreen_KeyDown,   LoadingScreen_KeyUp,     LoadingScreen_KeyPress,
+	LoadingScreen_MouseDown, LoadingScreen_MouseUp,   LoadingScreen_MouseMove, LoadingScreen_MouseScroll,
+	LoadingScreen_OnResize,  LoadingScreen_ContextLost, LoadingScreen_ContextRecreated,
+};
+struct Screen* SavingMapScreen_MakeInstance(const String* path, IMapExporter exporter) {
+	const static String title   = String_FromConst("Saving level");
+	const static String message = String_FromConst("Saving..");
+
+	struct Screen* s = LoadingScreen_MakeInstance(&title, &message);
+	s->VTABLE = &SavingMapScreen_VTABLE;
+
+	String_InitArray(mapTask_path, mapTask_pathBuffer);
+	String_Copy(&mapTask_path, path);
+	mapTask_exporter = exporter;
+	return s;
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------ChatScreen-------------------------------------------------------*
 *#########################################################################################################################*/
@@ -811,16 +894,13 @@ static void ChatScreen_SetInitialMessages(struct ChatScreen* s) {
 static void ChatScreen_CheckOtherStatuses(struct ChatScreen* s) {
 	const static String texPack = String_FromConst("texturePack");
 	String str; char strBuffer[STRING_SIZE];
-	struct HttpRequest request;
 	int progress;
 	bool hasRequest;
-	String identifier;
 	
-	hasRequest = Http_GetCurrent(&request, &progress);
-	identifier = String_FromRawArray(request.ID);	
+	hasRequest = Http_GetProgress(&texPack, &progress);
 
 	/* Is terrain / texture pack currently being downloaded? */
-	if (!hasRequest || !String_Equals(&identifier, &texPack)) {
+	if (!hasRequest) {
 		if (s->Status.Textures[1].ID) {
 			TextGroupWidget_SetText(&s->Status, 1, &String_Empty);
 		}
@@ -1,6 +1,6 @@
 #ifndef CC_SCREENS_H
 #define CC_SCREENS_H
-#include "String.h"
+#include "Formats.h"
 /* Contains all 2D non-menu screen implementations.
    Copyright 2014-2017 ClassicalSharp | Licensed under BSD-3
 */
@@ -11,6 +11,10 @@ struct Screen* InventoryScreen_MakeInstance(void);
 struct Screen* StatusScreen_MakeInstance(void);
 struct Screen* LoadingScreen_MakeInstance(const String* title, const String* message);
 struct Screen* GeneratingScreen_MakeInstance(void);
+/* Loads the map from the given file on a background thread, showing progress meanwhile. */
+struct Screen* LoadingMapScreen_MakeInstance(const String* path);
+/* Saves the map to the given file on a background thread, showing progress meanwhile. */
+struct Screen* SavingMapScreen_MakeInstance(const String* path, IMapExporter exporter);
 struct Screen* HUDScreen_MakeInstance(void);
 struct Screen* DisconnectScreen_MakeInstance(const String* title, const String* message);
 
@@ -154,8 +154,8 @@ static void SPConnection_BeginConnect(void) {
 	/* For when user drops a map file onto ClassiCube.exe */
 	path = Game_Username;
 	if (SP_HasDir(path) && File_Exists(&path)) {
-		Map_LoadFrom(&path);
-		Gui_CloseActive();
+		Gui_FreeActive();
+		Gui_SetActive(LoadingMapScreen_MakeInstance(&path));
 		return;
 	}
 
@@ -248,10 +248,11 @@ static void SPConnection_Init(void) {
 uint16_t Net_PacketSizes[OPCODE_COUNT];
 Net_Handler Net_Handlers[OPCODE_COUNT];
 
+int Net_QueuedPackets, Net_PacketLatency;
+
 static SocketHandle net_socket;
 static uint8_t  net_readBuffer[4096 * 5];
 static uint8_t  net_writeBuffer[131];
-static uint8_t* net_readCurrent;
 
 static bool net_writeFailed;
 static TimeMS net_lastPacket;
@@ -261,20 +262,179 @@ static double net_discAccumulator;
 static bool net_connecting;
 static TimeMS net_connectTimeout;
 #define NET_TIMEOUT_MS (15 * 1000)
+/* Maximum time spent handling queued packets each network tick */
+#define NET_TICK_BUDGET_US 4000
+
+/* Packets are read from the socket and split up on a separate reader thread. They are then */
+/* passed to the main thread through a single producer, single consumer ring buffer. */
+/* Each packet is prefixed by a header, and is never split across the end of the ring. */
+#define NET_RING_SIZE (256 * 1024)
+#define NET_RING_MASK (NET_RING_SIZE - 1)
+#define NET_RING_WRAP 0xFFFF
+#define Net_EntrySize(size) ((sizeof(struct NetPacketHeader) + (size) + 15) & ~15)
+
+struct NetPacketHeader {
+	uint64_t Received; /* Stopwatch_Measure() when read from the socket */
+	uint16_t Size;     /* Size of packet (including opcode), or NET_RING_WRAP */
+	bool SkippedD3Byte;
+	uint8_t __Padding[5];
+};
+enum NetReaderState { NET_READER_RUNNING, NET_READER_CLOSED, NET_READER_FAILED, NET_READER_INVALID };
+
+static uint8_t net_ring[NET_RING_SIZE];
+/* Head is only changed by reader thread, tail is only changed by main thread. */
+/* Both are only published under net_ringMutex, which also acts as the memory barrier for packet data. */
+static uint32_t net_ringHead, net_ringTail, net_packetsRead, net_packetsHandled;
+static void* net_ringMutex;
+static void* net_ringWaitable;
+static void* net_reader;
+
+static volatile bool net_readerStop;
+static int net_readerState;
+static ReturnCode net_readerRes;
+
+static void NetReader_SetState(int state, ReturnCode res) {
+	Mutex_Lock(net_ringMutex);
+	net_readerState = state;
+	net_readerRes   = res;
+	Mutex_Unlock(net_ringMutex);
+}
+
+static uint32_t NetReader_GetTail(void) {
+	uint32_t tail;
+	Mutex_Lock(net_ringMutex);
+	tail = net_ringTail;
+	Mutex_Unlock(net_ringMutex);
+	return tail;
+}
+
+/* Blocks until the ring has at least the given amount of free space */
+static bool NetReader_WaitSpace(uint32_t head, uint32_t space) {
+	while (NET_RING_SIZE - (head - NetReader_GetTail()) < space) {
+		if (net_readerStop) return false;
+		Waitable_WaitFor(net_ringWaitable, 10);
+	}
+	return !net_readerStop;
+}
+
+static bool NetReader_Push(uint8_t* data, int size, uint64_t received, bool skippedD3Byte) {
+	struct NetPacketHeader* header;
+	uint32_t head = net_ringHead, len = Net_EntrySize(size);
+	uint32_t left = NET_RING_SIZE - (head & NET_RING_MASK);
+
+	if (!NetReader_WaitSpace(head, left < len ? left + len : len)) return false;
+	if (left < len) {
+		header = (struct NetPacketHeader*)&net_ring[head & NET_RING_MASK];
+		header->Size = NET_RING_WRAP;
+		head += left;
+	}
+
+	header = (struct NetPacketHeader*)&net_ring[head & NET_RING_MASK];
+	header->Received      = received;
+	header->Size          = size;
+	header->SkippedD3Byte = skippedD3Byte;
+	Mem_Copy(header + 1, data, size);
+
+	Mutex_Lock(net_ringMutex);
+	net_ringHead = head + len;
+	net_packetsRead++;
+	Mutex_Unlock(net_ringMutex);
+	return true;
+}
+
+static void NetReader_Run(void) {
+	uint8_t* readEnd = net_readBuffer;
+	uint8_t* cur;
+	uint32_t read;
+	uint64_t received;
+	bool skippedD3Byte = false;
+	int i, size, remaining;
+	ReturnCode res;
+
+	while (!net_readerStop) {
+		/* NOTE: Always using a read call that is a multiple of 4096 (appears to?) improve read performance */
+		res = Socket_Read(net_socket, readEnd, 4096 * 4, &read);
+		/* Some platforms only support non-blocking sockets */
+		if (res == ReturnCode_SocketWouldBlock) { Thread_Sleep(1); continue; }
+		if (res)   { NetReader_SetState(NET_READER_FAILED, res); return; }
+		if (!read) { NetReader_SetState(NET_READER_CLOSED, 0);   return; }
+
+		readEnd += read;
+		received = Stopwatch_Measure();
+
+		for (cur = net_readBuffer; cur < readEnd; cur += size) {
+			uint8_t opcode = cur[0];
+
+			/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
+			if (cpe_needD3Fix && net_lastOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
+				skippedD3Byte = true;
+				size = 1; continue;
+			}
+
+			size = opcode < OPCODE_COUNT ? Net_PacketSizes[opcode] : 0;
+			if (!size) { NetReader_SetState(NET_READER_INVALID, 0); return; }
+			if (cur + size > readEnd) break;
+
+			net_lastOpcode = opcode;
+			if (!NetReader_Push(cur, size, received, skippedD3Byte)) return;
+			skippedD3Byte = false;
+
+			/* Handling these packets changes the size of other packets, so wait until they've been handled */
+			if (opcode == OPCODE_EXT_INFO || opcode == OPCODE_EXT_ENTRY) {
+				if (!NetReader_WaitSpace(net_ringHead, NET_RING_SIZE)) return;
+			}
+		}
+
+		/* Protocol packets might be split up across TCP packets */
+		/* If so, copy last few unprocessed bytes back to beginning of buffer */
+		/* These bytes are then later combined with subsequently read TCP packet data */
+		remaining = (int)(readEnd - cur);
+		for (i = 0; i < remaining; i++) {
+			net_readBuffer[i] = cur[i];
+		}
+		readEnd = net_readBuffer + remaining;
+	}
+}
+
+static void NetReader_Start(void) {
+	net_ringHead    = 0; net_ringTail       = 0;
+	net_packetsRead = 0; net_packetsHandled = 0;
+	Net_QueuedPackets = 0; Net_PacketLatency = 0;
+
+	net_readerStop  = false;
+	net_readerState = NET_READER_RUNNING;
+	net_readerRes   = 0;
+	net_lastOpcode  = 0;
+
+	net_ringMutex    = Mutex_Create();
+	net_ringWaitable = Waitable_Create();
+	net_reader       = Thread_Start(NetReader_Run, false);
+}
+
+/* NOTE: Socket must have been closed first, so that the reader thread isn't stuck in Socket_Read */
+static void NetReader_Stop(void) {
+	if (!net_reader) return;
+	net_readerStop = true;
+	Waitable_Signal(net_ringWaitable);
+
+	Thread_Join(net_reader);
+	net_reader = NULL;
+	Mutex_Free(net_ringMutex);
+	Waitable_Free(net_ringWaitable);
+}
 
 static void Server_Free(void);
 static void MPConnection_FinishConnect(void) {
 	net_connecting = false;
 	Event_RaiseVoid(&NetEvents.Connected);
 	Event_RaiseFloat(&WorldEvents.Loading, 0.0f);
-
-	net_readCurrent    = net_readBuffer;
 	Server.WriteBuffer = net_writeBuffer;
 
 	Handlers_Reset();
 	Classic_WriteLogin(&Game_Username, &Game_Mppass);
 	Net_SendPacket();
 	net_lastPacket = DateTime_CurrentUTC_MS();
+	NetReader_Start();
 }
 
 static void MPConnection_FailConnect(ReturnCode result) {
@@ -396,90 +556,110 @@ static void MPConnection_CheckDisconnection(double delta) {
 	}
 }
 
-static void MPConnection_Tick(struct ScheduledTask* task) {
-	const static String title_lost  = String_FromConst("&eLost connection to the server");
-	const static String reason_err  = String_FromConst("I/O error when reading packets");
+/* Handles packets queued by the reader thread, until out of packets or time budget is used up */
+static void MPConnection_HandlePackets(void) {
 	const static String title_disc  = String_FromConst("Disconnected");
 	const static String msg_invalid = String_FromConst("Server sent invalid packet!");
-	String msg; char msgBuffer[STRING_SIZE * 2];
 
+	struct NetPacketHeader* header;
 	struct LocalPlayer* p;
-	TimeMS now;
-	uint32_t pending;
-	uint8_t* readEnd;
+	uint32_t head, tail;
+	uint64_t beg, now;
 	Net_Handler handler;
-	int i, remaining;
-	ReturnCode res;
+	uint8_t* data;
+	int latency;
+
+	Mutex_Lock(net_ringMutex);
+	head = net_ringHead;
+	tail = net_ringTail;
+	Net_QueuedPackets = (int)(net_packetsRead - net_packetsHandled);
+	Mutex_Unlock(net_ringMutex);
+	beg = Stopwatch_Measure();
+
+	while (tail != head) {
+		header = (struct NetPacketHeader*)&net_ring[tail & NET_RING_MASK];
+		if (header->Size == NET_RING_WRAP) {
+			tail += NET_RING_SIZE - (tail & NET_RING_MASK); continue;
+		}
 
-	if (Server.Disconnected) return;
-	if (net_connecting) { MPConnection_TickConnect(); return; }
+		if (header->SkippedD3Byte) {
+			Platform_LogConst("Skipping invalid HackControl byte from D3 server");
+			p = &LocalPlayer_Instance;
+			p->Physics.JumpVel = 0.42f; /* assume default jump height */
+			p->Physics.ServerJumpVel = p->Physics.JumpVel;
+		}
 
-	/* over 30 seconds since last packet */
-	now = DateTime_CurrentUTC_MS();
-	if (net_lastPacket + (30 * 1000) < now) {
-		MPConnection_CheckDisconnection(task->Interval);
-	}
-	if (Server.Disconnected) return;
+		data    = (uint8_t*)(header + 1);
+		handler = Net_Handlers[data[0]];
+		if (!handler) {
+			Game_Disconnect(&title_disc, &msg_invalid); return;
+		}
+
+		now     = Stopwatch_Measure();
+		latency = (int)Stopwatch_ElapsedMicroseconds(header->Received, now);
+		Net_PacketLatency += (latency - Net_PacketLatency) / 16;
+		net_lastPacket = DateTime_CurrentUTC_MS();
 
-	pending = 0;
-	res     = Socket_Available(net_socket, &pending);
-	readEnd = net_readCurrent;
+		tail += Net_EntrySize(header->Size);
+		net_packetsHandled++;
+		handler(data + 1); /* skip opcode */
+		/* Handler might have disconnected, which also stops the reader thread */
+		if (Server.Disconnected) return;
 
-	if (!res && pending) {
-		/* NOTE: Always using a read call that is a multiple of 4096 (appears to?) improve read performance */	
-		res = Socket_Read(net_socket, net_readCurrent, 4096 * 4, &pending);
-		readEnd += pending;
+		if (Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure()) >= NET_TICK_BUDGET_US) break;
 	}
 
-	if (res) {
+	Mutex_Lock(net_ringMutex);
+	net_ringTail = tail;
+	Mutex_Unlock(net_ringMutex);
+	Waitable_Signal(net_ringWaitable);
+}
+
+static void MPConnection_CheckReader(void) {
+	const static String title_lost  = String_FromConst("&eLost connection to the server");
+	const static String reason_err  = String_FromConst("I/O error when reading packets");
+	const static String title_disc  = String_FromConst("Disconnected");
+	const static String msg_invalid = String_FromConst("Server sent invalid packet!");
+	const static String reason_lost = String_FromConst("You've lost connection to the server");
+	String msg; char msgBuffer[STRING_SIZE * 2];
+	int state; ReturnCode res;
+
+	Mutex_Lock(net_ringMutex);
+	state = net_readerState;
+	res   = net_readerRes;
+	/* Only report once all the packets sent before the failure have been handled */
+	if (net_ringHead != net_ringTail) state = NET_READER_RUNNING;
+	Mutex_Unlock(net_ringMutex);
+
+	if (state == NET_READER_FAILED) {
 		String_InitArray(msg, msgBuffer);
 		String_Format3(&msg, "Error reading from %s:%i: %i", &Game_IPAddress, &Game_Port, &res);
 
 		Logger_Log(&msg);
 		Game_Disconnect(&title_lost, &reason_err);
-		return;
+	} else if (state == NET_READER_INVALID) {
+		Game_Disconnect(&title_disc, &msg_invalid);
+	} else if (state == NET_READER_CLOSED) {
+		Game_Disconnect(&title_lost, &reason_lost);
 	}
+}
 
-	net_readCurrent = net_readBuffer;
-	while (net_readCurrent < readEnd) {
-		uint8_t opcode = net_readCurrent[0];
-
-		/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
-		if (cpe_needD3Fix && net_lastOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
-			Platform_LogConst("Skipping invalid HackControl byte from D3 server");
-			net_readCurrent++;
-
-			p = &LocalPlayer_Instance;
-			p->Physics.JumpVel = 0.42f; /* assume default jump height */
-			p->Physics.ServerJumpVel = p->Physics.JumpVel;
-			continue;
-		}
-
-		if (opcode >= OPCODE_COUNT) {
-			Game_Disconnect(&title_disc, &msg_invalid); return; 
-		}
-
-		if (net_readCurrent + Net_PacketSizes[opcode] > readEnd) break;
-		net_lastOpcode = opcode;
-		net_lastPacket = DateTime_CurrentUTC_MS();
-
-		handler = Net_Handlers[opcode];
-		if (!handler) {
-			Game_Disconnect(&title_disc, &msg_invalid); return;
-		}
+static void MPConnection_Tick(struct ScheduledTask* task) {
+	TimeMS now;
+	if (Server.Disconnected) return;
+	if (net_connecting) { MPConnection_TickConnect(); return; }
 
-		handler(net_readCurrent + 1);  /* skip opcode */
-		net_readCurrent += Net_PacketSizes[opcode];
+	/* over 30 seconds since last packet */
+	now = DateTime_CurrentUTC_MS();
+	if (net_lastPacket + (30 * 1000) < now) {
+		MPConnection_CheckDisconnection(task->Interval);
 	}
+	if (Server.Disconnected) return;
 
-	/* Protocol packets might be split up across TCP packets */
-	/* If so, copy last few unprocessed bytes back to beginning of buffer */
-	/* These bytes are then later combined with subsequently read TCP packet data */
-	remaining = (int)(readEnd - net_readCurrent);
-	for (i = 0; i < remaining; i++) {
-		net_readBuffer[i] = net_readCurrent[i];
-	}
-	net_readCurrent = net_readBuffer + remaining;
+	MPConnection_HandlePackets();
+	if (Server.Disconnected) return;
+	MPConnection_CheckReader();
+	if (Server.Disconnected) return;
 
 	/* Network is ticked 60 times a second. We only send position updates 20 times a second */
 	if ((server_ticks % 3) == 0) {
@@ -521,9 +701,7 @@ static void MPConnection_Init(void) {
 	Server.SendChat        = MPConnection_SendChat;
 	Server.SendPosition    = MPConnection_SendPosition;
 	Server.SendPlayerClick = MPConnection_SendPlayerClick;
-
-	net_readCurrent    = net_readBuffer;
-	Server.WriteBuffer = net_writeBuffer;
+	Server.WriteBuffer     = net_writeBuffer;
 }
 
 
@@ -574,6 +752,7 @@ static void Server_Free(void) {
 	} else {
 		if (Server.Disconnected) return;
 		Socket_Close(net_socket);
+		NetReader_Stop();
 		Server.Disconnected = true;
 	}
 }
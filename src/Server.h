@@ -99,6 +99,10 @@ typedef void (*Net_Handler)(uint8_t* data);
 extern uint16_t Net_PacketSizes[OPCODE_COUNT];
 extern Net_Handler Net_Handlers[OPCODE_COUNT];
 #define Net_Set(opcode, handler, size) Net_Handlers[opcode] = handler; Net_PacketSizes[opcode] = size;
+/* Number of packets read from the server which are still waiting to be handled. */
+extern int Net_QueuedPackets;
+/* Average time (in microseconds) between a packet being read from the server and being handled. */
+extern int Net_PacketLatency;
 
 void Net_SendPacket(void);
 #endif
@@ -371,13 +371,7 @@ void Stream_ReadonlyBuffered(struct Stream* s, struct Stream* source, void* data
 *#########################################################################################################################*/
 static ReturnCode Stream_Crc32Write(struct Stream* stream, const uint8_t* data, uint32_t count, uint32_t* modified) {
 	struct Stream* source;
-	uint32_t i, crc32 = stream->Meta.CRC32.CRC32;
-
-	/* TODO: Optimise this calculation */
-	for (i = 0; i < count; i++) {
-		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
-	}
-	stream->Meta.CRC32.CRC32 = crc32;
+	stream->Meta.CRC32.CRC32 = Utils_Crc32Update(stream->Meta.CRC32.CRC32, data, count);
 
 	source = stream->Meta.CRC32.Source;
 	return source->Write(source, data, count, modified);
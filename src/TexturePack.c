@@ -217,6 +217,7 @@ static void Animations_ReadDescription(struct Stream* stream, const String* path
 
 		data.TexLoc = tileX + (tileY * ATLAS2D_TILES_PER_ROW);
 		anims_list[anims_count++] = data;
+		Atlas1D.SameRows[data.TexLoc] = false;
 	}
 }
 
@@ -362,8 +363,10 @@ static void Animations_FileChanged(void* obj, struct Stream* stream, const Strin
 		Animations_ReadDescription(stream, name);
 	} else if (String_CaselessEqualsConst(name, "uselavaanim")) {
 		anims_useLavaAnim = true;
+		Atlas1D.SameRows[30] = false;
 	} else if (String_CaselessEqualsConst(name, "usewateranim")) {
 		anims_useWaterAnim = true;
+		Atlas1D.SameRows[14] = false;
 	}
 }
 
@@ -404,6 +407,38 @@ TextureRec Atlas1D_TexRec(TextureLoc texLoc, int uCount, int* index) {
 	return rec;
 }
 
+static bool Atlas_HasSameRows(int atlasX, int atlasY) {
+	int tileSize = Atlas2D.TileSize;
+	uint32_t* row0 = Bitmap_RawRow(&Atlas2D.Bitmap, atlasY) + atlasX;
+	uint32_t* row;
+	int x, y;
+
+	for (y = 1; y < tileSize; y++) {
+		row = Bitmap_RawRow(&Atlas2D.Bitmap, atlasY + y) + atlasX;
+		for (x = 0; x < tileSize; x++) {
+			if (row[x] != row0[x]) return false;
+		}
+	}
+	return true;
+}
+
+static void Atlas_CalcSameRows(void) {
+	int i, tile, maxTiles = Atlas2D.RowsCount * ATLAS2D_TILES_PER_ROW;
+	int tileSize = Atlas2D.TileSize;
+
+	for (tile = 0; tile < ATLAS1D_MAX_ATLASES; tile++) {
+		Atlas1D.SameRows[tile] = tile < maxTiles &&
+			Atlas_HasSameRows(Atlas2D_TileX(tile) * tileSize, Atlas2D_TileY(tile) * tileSize);
+	}
+
+	/* Animated tiles can change to have different rows at any time */
+	for (i = 0; i < anims_count; i++) {
+		Atlas1D.SameRows[anims_list[i].TexLoc] = false;
+	}
+	if (anims_useLavaAnim)  Atlas1D.SameRows[30] = false;
+	if (anims_useWaterAnim) Atlas1D.SameRows[14] = false;
+}
+
 static void Atlas_Convert2DTo1D(void) {
 	int tileSize      = Atlas2D.TileSize;
 	int tilesPerAtlas = Atlas1D.TilesPerAtlas;
@@ -451,6 +486,7 @@ void Atlas_Update(Bitmap* bmp) {
 
 	Atlas_Update1D();
 	Atlas_Convert2DTo1D();
+	Atlas_CalcSameRows();
 }
 
 static GfxResourceID Atlas_LoadTile_Raw(TextureLoc texLoc, Bitmap* element) {
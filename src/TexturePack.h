@@ -49,6 +49,9 @@ CC_VAR extern struct _Atlas1DData {
 	float InvTileSize;
 	/* Textures for each 1D atlas. Only Atlas1D_Count of these are valid. */
 	GfxResourceID TexIds[ATLAS1D_MAX_ATLASES];
+	/* Whether every row of pixels in each tile is the same, and the tile is not animated. */
+	/* NOTE: Faces using these tiles can be stretched along the V axis, without needing the texture to repeat. */
+	bool SameRows[ATLAS1D_MAX_ATLASES];
 } Atlas1D;
 
 #define Atlas2D_TileX(texLoc) ((texLoc) &  ATLAS2D_MASK)  /* texLoc % ATLAS2D_TILES_PER_ROW */
@@ -41,7 +41,15 @@ int Utils_AccumulateWheelDelta(float* accumulator, float delta);
 #define Utils_AdjViewDist(value) ((int)(1.4142135f * (value)))
 
 uint8_t Utils_GetSkinType(const Bitmap* bmp);
+/* Calculates the CRC32 of the given data. */
 uint32_t Utils_CRC32(const uint8_t* data, uint32_t length);
+/* Updates a running CRC32 with the given data. Initial value should be 0xFFFFFFFFUL. */
+/* To get the final CRC32, xor it with 0xFFFFFFFFUL */
+/* NOTE: Uses PCLMULQDQ or ARMv8 CRC32 instructions when available. */
+uint32_t Utils_Crc32Update(uint32_t crc, const uint8_t* data, uint32_t length);
+/* Builds the CRC32 tables and detects which CRC32 instructions the CPU supports. */
+/* NOTE: Must be called once at startup, before any other thread can use Utils_Crc32Update. */
+void Utils_Init(void);
 /* CRC32 lookup table, for faster CRC32 calculations. */
 /* NOTE: This cannot be just indexed by byte value - see Utils_CRC32 implementation. */
 extern const uint32_t Utils_Crc32Table[256];
@@ -9,4 +9,15 @@
 typedef struct VertexP3fC4b_ { float X, Y, Z; PackedCol Col; } VertexP3fC4b;
 /* 3 floats for position (XYZ), 2 floats for texture coordinates (UV), 4 bytes for colour. */
 typedef struct VertexP3fT2fC4b_ { float X, Y, Z; PackedCol Col; float U, V; } VertexP3fT2fC4b;
+/* 3 shorts for position (XYZ), 4 bytes for colour, 2 shorts for texture coordinates (UV). */
+/* Used for chunk meshes, where position is relative to the minimum corner of the chunk. */
+typedef struct VertexP3sT2sC4b_ { int16_t X, Y, Z, Padding; PackedCol Col; int16_t U, V; } VertexP3sT2sC4b;
+
+/* Number of units in VertexP3sT2sC4b position that equal one block. */
+#define COMPACT_POS_SCALE 1024
+/* Number of units in VertexP3sT2sC4b U that equal one tile. */
+#define COMPACT_U_SCALE 1024
+/* Number of units in VertexP3sT2sC4b V that equal the height of a 1D atlas. */
+/* NOTE: V is stored offset by -COMPACT_V_SCALE / 2, so the whole atlas fits in a signed short. */
+#define COMPACT_V_SCALE 65536
 #endif
@@ -639,6 +639,38 @@ static void TableWidget_Init(void* widget) {
 	Widget_Reposition(w);
 }
 
+/* Draws the cached icons of all visible blocks (except the selected block) as textured quads */
+static void TableWidget_RenderIcons(struct TableWidget* w, VertexP3fT2fC4b* vertices) {
+	PackedCol white = PACKEDCOL_WHITE;
+	VertexP3fT2fC4b* ptr = vertices;
+	GfxResourceID lastTex = 0;
+	struct Texture tex;
+	int cellSize = w->CellSize;
+	int i, x, y;
+
+	for (i = 0; i < w->ElementsCount; i++) {
+		if (!TableWidget_GetCoords(w, i, &x, &y)) continue;
+		if (i == w->SelectedIndex) continue;
+		if (Blocks.Draw[w->Elements[i]] == DRAW_GAS) continue;
+		if (!IsometricDrawer_GetIcon(w->Elements[i], cellSize * 0.7f / 2.0f, &tex)) continue;
+
+		if (tex.ID != lastTex && ptr != vertices) {
+			Gfx_BindTexture(lastTex);
+			Gfx_UpdateDynamicVb_IndexedTris(w->VB, vertices, (int)(ptr - vertices));
+			ptr = vertices;
+		}
+		lastTex = tex.ID;
+
+		tex.X = x + cellSize / 2 - tex.Width  / 2;
+		tex.Y = y + cellSize / 2 - tex.Height / 2;
+		Gfx_Make2DQuad(&tex, white, &ptr);
+	}
+
+	if (ptr == vertices) return;
+	Gfx_BindTexture(lastTex);
+	Gfx_UpdateDynamicVb_IndexedTris(w->VB, vertices, (int)(ptr - vertices));
+}
+
 static void TableWidget_Render(void* widget, double delta) {
 	struct TableWidget* w = widget;
 	VertexP3fT2fC4b vertices[TABLE_MAX_VERTICES];
@@ -672,6 +704,7 @@ static void TableWidget_Render(void* widget, double delta) {
 	}
 	Gfx_SetTexturing(true);
 	Gfx_SetVertexFormat(VERTEX_FORMAT_P3FT2FC4B);
+	TableWidget_RenderIcons(w, vertices);
 
 	IsometricDrawer_BeginBatch(vertices, w->VB);
 	for (i = 0; i < w->ElementsCount; i++) {
@@ -679,6 +712,9 @@ static void TableWidget_Render(void* widget, double delta) {
 
 		/* We want to always draw the selected block on top of others */
 		if (i == w->SelectedIndex) continue;
+		/* Icon is cached, so was already drawn in TableWidget_RenderIcons */
+		if (IsometricDrawer_GetIcon(w->Elements[i], cellSize * 0.7f / 2.0f, NULL)) continue;
+
 		IsometricDrawer_DrawBatch(w->Elements[i], cellSize * 0.7f / 2.0f,
 			x + cellSize / 2, y + cellSize / 2);
 	}
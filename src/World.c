@@ -8,8 +8,159 @@
 #include "ExtMath.h"
 #include "Physics.h"
 #include "Game.h"
+#include "Funcs.h"
 
 struct _WorldData World;
+#ifdef SPARSE_WORLD
+/*########################################################################################################################*
+*-------------------------------------------------------Sub chunks--------------------------------------------------------*
+*#########################################################################################################################*/
+/* Number of uint32_t words needed to store the packed blocks of a sub chunk */
+#define SubChunk_Words(shift) ((SUBCHUNK_SIZE_3 >> 5) << (shift))
+
+static void SubChunk_SetIndex(struct SubChunk* c, int i, int idx) {
+	int shift = c->Shift;
+	int bit   = (i & ((32 >> shift) - 1)) << shift;
+	uint32_t mask  = ((1UL << (1 << shift)) - 1) << bit;
+	uint32_t* word = &c->Data[i >> (5 - shift)];
+
+	*word = (*word & ~mask) | ((uint32_t)idx << bit);
+}
+
+static void SubChunk_Free(struct SubChunk* c) {
+	Mem_Free(c->Data);    c->Data    = NULL;
+	Mem_Free(c->Palette); c->Palette = NULL;
+	c->PaletteCount = 0;
+	c->Shift        = 0;
+}
+
+/* Stores the given blocks using the smallest palette index size possible, but at least 1 << minShift bits */
+static void SubChunk_Encode(struct SubChunk* c, const BlockID* blocks, int minShift) {
+	uint16_t lookup[BLOCK_COUNT];
+	BlockID palette[BLOCK_COUNT];
+	int i, count = 0, shift = minShift;
+	BlockID block;
+
+	Mem_Set(lookup, 0xFF, sizeof(lookup));
+	for (i = 0; i < SUBCHUNK_SIZE_3; i++) {
+		block = blocks[i];
+		if (lookup[block] != 0xFFFF) continue;
+		lookup[block]    = count;
+		palette[count++] = block;
+	}
+
+	c->Uniform = palette[0];
+	if (count == 1 && !minShift) return;
+
+	while (shift < 4 && (1 << (1 << shift)) < count) shift++;
+	c->Shift = shift;
+	c->Data  = (uint32_t*)Mem_AllocCleared(SubChunk_Words(shift), 4, "sub chunk blocks");
+
+	if (shift < 4) {
+		c->Palette      = (BlockID*)Mem_Alloc(1 << (1 << shift), sizeof(BlockID), "sub chunk palette");
+		c->PaletteCount = count;
+		Mem_Copy(c->Palette, palette, count * sizeof(BlockID));
+
+		for (i = 0; i < SUBCHUNK_SIZE_3; i++) { SubChunk_SetIndex(c, i, lookup[blocks[i]]); }
+	} else {
+		for (i = 0; i < SUBCHUNK_SIZE_3; i++) { SubChunk_SetIndex(c, i, blocks[i]); }
+	}
+}
+
+/* Converts a uniform sub chunk into a sub chunk with a 1 bit palette */
+static void SubChunk_Expand(struct SubChunk* c) {
+	c->Shift   = 0;
+	c->Data    = (uint32_t*)Mem_AllocCleared(SubChunk_Words(0), 4, "sub chunk blocks");
+	c->Palette = (BlockID*)Mem_Alloc(2, sizeof(BlockID), "sub chunk palette");
+
+	c->Palette[0]   = c->Uniform;
+	c->PaletteCount = 1;
+}
+
+/* Doubles the number of bits used to store each block in the sub chunk */
+static void SubChunk_Grow(struct SubChunk* c) {
+	BlockID blocks[SUBCHUNK_SIZE_3];
+	int i, shift = c->Shift + 1;
+
+	for (i = 0; i < SUBCHUNK_SIZE_3; i++) { blocks[i] = SubChunk_Get(c, i); }
+	SubChunk_Free(c);
+	SubChunk_Encode(c, blocks, shift);
+}
+
+/* Returns the palette index for the given block, adding it to the palette if necessary */
+static int SubChunk_IndexOf(struct SubChunk* c, BlockID block) {
+	int i;
+	if (!c->Palette) return block;
+
+	for (i = 0; i < c->PaletteCount; i++) {
+		if (c->Palette[i] == block) return i;
+	}
+
+	if (c->PaletteCount == (1 << (1 << c->Shift))) {
+		SubChunk_Grow(c);
+		if (!c->Palette) return block;
+	}
+	c->Palette[c->PaletteCount] = block;
+	return c->PaletteCount++;
+}
+
+static void World_FreeChunks(void) {
+	int i, count = World.ChunksX * World.ChunksY * World.ChunksZ;
+	if (!World.Chunks) return;
+
+	for (i = 0; i < count; i++) { SubChunk_Free(&World.Chunks[i]); }
+	Mem_Free(World.Chunks);
+	World.Chunks = NULL;
+	World.ChunksX = 0; World.ChunksY = 0; World.ChunksZ = 0;
+}
+
+#ifdef EXTENDED_BLOCKS
+#define World_GetFlatBlock(i) ((BlockID)((World.Blocks[i] | (World.Blocks2[i] << 8)) & Block_IDMask))
+#else
+#define World_GetFlatBlock(i) World.Blocks[i]
+#endif
+
+/* Converts the flat blocks array(s) into sub chunks */
+static void World_PackChunks(void) {
+	BlockID blocks[SUBCHUNK_SIZE_3];
+	int cx, cy, cz, x1, y1, z1;
+	int xCount, yCount, zCount;
+	int x, y, z, i, index;
+
+	World.ChunksX = (World.Width  + SUBCHUNK_MASK) >> SUBCHUNK_SHIFT;
+	World.ChunksY = (World.Height + SUBCHUNK_MASK) >> SUBCHUNK_SHIFT;
+	World.ChunksZ = (World.Length + SUBCHUNK_MASK) >> SUBCHUNK_SHIFT;
+	World.Chunks  = (struct SubChunk*)Mem_AllocCleared(World.ChunksX * World.ChunksY * World.ChunksZ,
+											sizeof(struct SubChunk), "world sub chunks");
+
+	for (cy = 0; cy < World.ChunksY; cy++) {
+		y1 = cy << SUBCHUNK_SHIFT; yCount = min(SUBCHUNK_SIZE, World.Height - y1);
+		for (cz = 0; cz < World.ChunksZ; cz++) {
+			z1 = cz << SUBCHUNK_SHIFT; zCount = min(SUBCHUNK_SIZE, World.Length - z1);
+			for (cx = 0; cx < World.ChunksX; cx++) {
+				x1 = cx << SUBCHUNK_SHIFT; xCount = min(SUBCHUNK_SIZE, World.Width - x1);
+
+				/* Parts of sub chunks outside the map are never read, so fill them */
+				/* with a block from the sub chunk to avoid preventing it being uniform */
+				if (xCount < SUBCHUNK_SIZE || yCount < SUBCHUNK_SIZE || zCount < SUBCHUNK_SIZE) {
+					index = World_Pack(x1, y1, z1);
+					for (i = 0; i < SUBCHUNK_SIZE_3; i++) { blocks[i] = World_GetFlatBlock(index); }
+				}
+
+				for (y = 0; y < yCount; y++) {
+					for (z = 0; z < zCount; z++) {
+						index = World_Pack(x1, y1 + y, z1 + z);
+						i     = SubChunk_Pack(0, y, z);
+						for (x = 0; x < xCount; x++, i++, index++) { blocks[i] = World_GetFlatBlock(index); }
+					}
+				}
+				SubChunk_Encode(&World.Chunks[World_PackChunk(cx, cy, cz)], blocks, 0);
+			}
+		}
+	}
+}
+#endif
+
 /*########################################################################################################################*
 *----------------------------------------------------------World----------------------------------------------------------*
 *#########################################################################################################################*/
@@ -34,13 +185,21 @@ static void World_NewUuid(void) {
 	World.Uuid[8] |= 0x80; /* variant 2*/
 }
 
-void World_Reset(void) {
+static void World_FreeBlocks(void) {
 #ifdef EXTENDED_BLOCKS
 	if (World.Blocks != World.Blocks2) Mem_Free(World.Blocks2);
 	World.Blocks2 = NULL;
 #endif
 	Mem_Free(World.Blocks);
 	World.Blocks = NULL;
+}
+
+void World_Reset(void) {
+	World_FreeBlocks();
+#ifdef SPARSE_WORLD
+	World_FreeChunks();
+#endif
+	World.Loaded = false;
 
 	World_SetDimensions(0, 0, 0);
 	Env_Reset();
@@ -59,6 +218,10 @@ void World_SetNewMap(BlockRaw* blocks, int width, int height, int length) {
 		Block_SetUsedCount(256);
 	}
 #endif
+	World.Loaded = World.Blocks != NULL;
+#ifdef SPARSE_WORLD
+	if (World.Loaded) { World_PackChunks(); World_FreeBlocks(); }
+#endif
 
 	if (Env.EdgeHeight == -1)   { Env.EdgeHeight   = height / 2; }
 	if (Env.CloudsHeight == -1) { Env.CloudsHeight = height + 2; }
@@ -82,7 +245,20 @@ void World_SetMapUpper(BlockRaw* blocks) {
 #endif
 
 
+#if defined SPARSE_WORLD
+void World_SetBlock(int x, int y, int z, BlockID block) {
+	struct SubChunk* c = &World.Chunks[World_PackChunk(x >> SUBCHUNK_SHIFT, y >> SUBCHUNK_SHIFT, z >> SUBCHUNK_SHIFT)];
+	if (!c->Data) {
+		if (c->Uniform == block) return;
+		SubChunk_Expand(c);
+	}
+	SubChunk_SetIndex(c, SubChunk_Pack(x, y, z), SubChunk_IndexOf(c, block));
+
 #ifdef EXTENDED_BLOCKS
+	if (block >= 256 && Block_UsedCount <= 256) Block_SetUsedCount(768);
+#endif
+}
+#elif defined EXTENDED_BLOCKS
 void World_SetBlock(int x, int y, int z, BlockID block) {
 	int i = World_Pack(x, y, z);
 	World.Blocks[i] = (BlockRaw)block;
@@ -13,14 +13,49 @@ struct AABB;
 /* Packs an x,y,z into a single index */
 #define World_Pack(x, y, z) (((y) * World.Length + (z)) * World.Width + (x))
 
+#ifdef SPARSE_WORLD
+#define SUBCHUNK_SHIFT 4
+#define SUBCHUNK_SIZE  16
+#define SUBCHUNK_MASK  15
+#define SUBCHUNK_SIZE_3 (SUBCHUNK_SIZE * SUBCHUNK_SIZE * SUBCHUNK_SIZE)
+/* Packs an x,y,z into an index within a sub chunk. (only lowest 4 bits of each coordinate are used) */
+#define SubChunk_Pack(x, y, z) ((((y) & SUBCHUNK_MASK) << 8) | (((z) & SUBCHUNK_MASK) << 4) | ((x) & SUBCHUNK_MASK))
+/* Packs a sub chunk x,y,z into an index into World.Chunks */
+#define World_PackChunk(cx, cy, cz) (((cy) * World.ChunksZ + (cz)) * World.ChunksX + (cx))
+
+/* Stores the blocks in a 16x16x16 region of the world. */
+/* Blocks are stored as 1/2/4/8 bit indices into a palette, or as 16 bit block IDs. */
+struct SubChunk {
+	/* Packed blocks/palette indices, each (1 << Shift) bits wide. */
+	/* NULL when every block in the sub chunk is the same. */
+	uint32_t* Data;
+	/* Blocks the indices in Data refer to. NULL when Data holds 16 bit block IDs. */
+	BlockID* Palette;
+	/* Number of entries used in Palette. (capacity is 1 << (1 << Shift)) */
+	uint16_t PaletteCount;
+	/* The block every block in the sub chunk is, when Data is NULL. */
+	BlockID Uniform;
+	uint8_t Shift;
+};
+#endif
+
 CC_VAR extern struct _WorldData {
 	/* The blocks in the world. */
+	/* NOTE: With SPARSE_WORLD, this is only used to pass blocks to World_SetNewMap when loading. */
 	BlockRaw* Blocks;
 #ifdef EXTENDED_BLOCKS
 	/* The upper 8 bit of blocks in the world. */
 	/* If only 8 bit blocks are used, equals World_Blocks. */
 	BlockRaw* Blocks2;
 #endif
+#ifdef SPARSE_WORLD
+	/* The sub chunks that store the blocks in the world. */
+	struct SubChunk* Chunks;
+	/* Number of sub chunks along each axis. */
+	int ChunksX, ChunksY, ChunksZ;
+#endif
+	/* Whether a map is loaded. (i.e. blocks can be read and set) */
+	bool Loaded;
 	/* Volume of the world. */
 	int Volume;
 
@@ -40,6 +75,7 @@ extern String World_TextureUrl;
 CC_API void World_Reset(void);
 /* Sets the blocks array and dimensions of the map. */
 /* May also sets some environment settings like border/clouds height, if they are -1 */
+/* NOTE: With SPARSE_WORLD, blocks are converted into sub chunks and then freed. */
 CC_API void World_SetNewMap(BlockRaw* blocks, int width, int height, int length);
 /* Sets the various dimension and max coordinate related variables. */
 /* NOTE: This is an internal API. Use World_SetNewMap instead. */
@@ -48,8 +84,27 @@ CC_NOINLINE void World_SetDimensions(int width, int height, int length);
 #ifdef EXTENDED_BLOCKS
 extern int Block_IDMask;
 /* Sets World.Blocks2 and updates internal state for more than 256 blocks. */
+/* NOTE: With SPARSE_WORLD, must be called before World_SetNewMap. */
 void World_SetMapUpper(BlockRaw* blocks);
+#endif
+
+#if defined SPARSE_WORLD
+/* Gets the block at the given index within a sub chunk. */
+static CC_INLINE BlockID SubChunk_Get(const struct SubChunk* c, int i) {
+	int shift = c->Shift, idx;
+	if (!c->Data) return c->Uniform;
 
+	idx = (c->Data[i >> (5 - shift)] >> ((i & ((32 >> shift) - 1)) << shift)) & ((1 << (1 << shift)) - 1);
+	return c->Palette ? c->Palette[idx] : (BlockID)idx;
+}
+
+/* Gets the block at the given coordinates. */
+/* NOTE: Does NOT check that the coordinates are inside the map. */
+static CC_INLINE BlockID World_GetBlock(int x, int y, int z) {
+	const struct SubChunk* c = &World.Chunks[World_PackChunk(x >> SUBCHUNK_SHIFT, y >> SUBCHUNK_SHIFT, z >> SUBCHUNK_SHIFT)];
+	return SubChunk_Get(c, SubChunk_Pack(x, y, z));
+}
+#elif defined EXTENDED_BLOCKS
 /* Gets the block at the given coordinates. */
 /* NOTE: Does NOT check that the coordinates are inside the map. */
 static CC_INLINE BlockID World_GetBlock(int x, int y, int z) {
@@ -57,7 +112,7 @@ static CC_INLINE BlockID World_GetBlock(int x, int y, int z) {
 	return (BlockID)((World.Blocks[i] | (World.Blocks2[i] << 8)) & Block_IDMask);
 }
 #else
-#define World_GetBlock(x, y, z) World_Blocks[World_Pack(x, y, z)]
+#define World_GetBlock(x, y, z) World.Blocks[World_Pack(x, y, z)]
 #endif
 
 /* If Y is above the map, returns BLOCK_AIR. */